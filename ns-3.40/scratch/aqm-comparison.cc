@@ -0,0 +1,242 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// Compare bottleneck queue discs against the same traffic:
+//
+//   ./ns3 run "aqm-comparison --aqms=Fifo,FqCoDel,Pie --stopTime=20s"
+//
+// For each queue disc of --aqms, a dumbbell is built with --nBulk leaves
+// running bulk transfers (--tcpTypeId, BBR by default) and --nShort leaves
+// opening short transfers of --shortSize bytes with exponential
+// inter-arrivals.  The queue disc is installed on the bottleneck with
+// PointToPointDumbbellHelper::InstallBottleneckQueueDisc, with byte queue
+// limits unless --bql=false.  The run number and the random streams are
+// the same for every queue disc, so only the queue disc differs.
+//
+// A BottleneckDelayProbe measures every left-to-right flow; the short
+// connections of one leaf are merged into one row.  One table reports,
+// per queue disc and flow, the throughput, the drops and ECN marks, and
+// the mean and 50th/95th/99th percentile queueing delay; a line per queue
+// disc gives the completion times of the short flows.  The table is also
+// written to <dir>/summary.txt.
+//
+// With --crossFlows=N, every leaf also runs N background UDP flows of
+// --crossRate each, on/off with exponential periods of mean --crossOn and
+// --crossOff (always on if --crossOn is zero).  They are multiplexed by
+// one CrossTrafficApplication per leaf, so thousands of them cost one
+// event per departure rather than one application each:
+//
+//   ./ns3 run "aqm-comparison --crossFlows=500 --crossRate=20kbps --crossOn=0.5s --crossOff=1s"
+
+#include "ns3/applications-module.h"
+#include "ns3/core-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/network-module.h"
+#include "ns3/point-to-point-module.h"
+#include "ns3/point-to-point-layout-module.h"
+#include "ns3/traffic-control-module.h"
+
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+using namespace ns3;
+
+int
+main (int argc, char *argv[])
+{
+  std::string aqms = "Fifo,FqCoDel,CoDel,Pie,FqPie,Cobalt,Red";
+  std::string tcpTypeId = "TcpBbr";
+  uint32_t nBulk = 2;
+  uint32_t nShort = 2;
+  std::string bottleneckRate = "10Mbps";
+  std::string bottleneckDelay = "10ms";
+  std::string queueSize = "100p";
+  bool bql = true;
+  uint32_t shortSize = 20000;
+  double shortInterval = 0.2;
+  uint32_t crossFlows = 0;
+  std::string crossRate = "20kbps";
+  uint32_t crossPacketSize = 200;
+  Time crossOn = Seconds (0);
+  Time crossOff = Seconds (1);
+  Time stopTime = Seconds (30);
+  uint32_t run = 1;
+  std::string dir = "bbr-results/aqm-comparison";
+
+  CommandLine cmd (__FILE__);
+  cmd.AddValue ("aqms", "Comma-separated bottleneck queue discs, e.g. Fifo,FqCoDel,Pie", aqms);
+  cmd.AddValue ("tcpTypeId", "Transport protocol to use: TcpNewReno, TcpBbr", tcpTypeId);
+  cmd.AddValue ("nBulk", "Number of leaves running a bulk transfer", nBulk);
+  cmd.AddValue ("nShort", "Number of leaves running short transfers", nShort);
+  cmd.AddValue ("bottleneckRate", "Bottleneck data rate", bottleneckRate);
+  cmd.AddValue ("bottleneckDelay", "Bottleneck delay", bottleneckDelay);
+  cmd.AddValue ("queueSize", "MaxSize of the bottleneck queue disc", queueSize);
+  cmd.AddValue ("bql", "Enable byte queue limits on the bottleneck", bql);
+  cmd.AddValue ("shortSize", "Size of the short transfers, in bytes", shortSize);
+  cmd.AddValue ("shortInterval", "Mean time between short transfers of a leaf, in seconds", shortInterval);
+  cmd.AddValue ("crossFlows", "Number of background UDP flows per leaf", crossFlows);
+  cmd.AddValue ("crossRate", "Rate of a background flow while on", crossRate);
+  cmd.AddValue ("crossPacketSize", "Payload size of the background packets, in bytes", crossPacketSize);
+  cmd.AddValue ("crossOn", "Mean on period of the background flows, zero for always on", crossOn);
+  cmd.AddValue ("crossOff", "Mean off period of the background flows", crossOff);
+  cmd.AddValue ("stopTime", "Simulation stop time", stopTime);
+  cmd.AddValue ("run", "Run number, the same for every queue disc", run);
+  cmd.AddValue ("dir", "Output directory", dir);
+  cmd.Parse (argc, argv);
+  DumbbellScenario::KeepCommandLineDefaults (argc, argv);
+
+  system (("mkdir -p " + dir).c_str ());
+  std::ofstream summary (dir + "/summary.txt");
+  summary << "# aqm flow kind packets throughput(Mbps) drops marks mean(ms) p50(ms) p95(ms) p99(ms)"
+          << std::endl;
+
+  uint16_t bulkPort = 50000;
+  uint16_t shortPort = 50001;
+  uint16_t crossPort = 50002;
+  uint32_t nLeaf = nBulk + nShort;
+  std::ostringstream table;
+  table << std::left << std::setw (10) << "aqm" << std::setw (32) << "flow" << std::setw (7)
+        << "kind" << std::right << std::setw (9) << "packets" << std::setw (9) << "Mbps"
+        << std::setw (7) << "drops" << std::setw (7) << "marks" << std::setw (9) << "mean"
+        << std::setw (9) << "p50" << std::setw (9) << "p95" << std::setw (9) << "p99" << "\n";
+
+  std::stringstream ss (aqms);
+  std::string aqm;
+  while (std::getline (ss, aqm, ','))
+    {
+      RngSeedManager::SetRun (run);
+      Config::SetDefault ("ns3::TcpL4Protocol::SocketType", StringValue ("ns3::" + tcpTypeId));
+      Config::SetDefault ("ns3::TcpSocket::SndBufSize", UintegerValue (4194304));
+      Config::SetDefault ("ns3::TcpSocket::RcvBufSize", UintegerValue (6291456));
+      Config::SetDefault ("ns3::TcpSocket::InitialCwnd", UintegerValue (10));
+      Config::SetDefault ("ns3::TcpSocket::SegmentSize", UintegerValue (1448));
+      Config::SetDefault ("ns3::DropTailQueue<Packet>::MaxSize", QueueSizeValue (QueueSize ("1p")));
+
+      PointToPointHelper bottleneckLink;
+      bottleneckLink.SetDeviceAttribute ("DataRate", StringValue (bottleneckRate));
+      bottleneckLink.SetChannelAttribute ("Delay", StringValue (bottleneckDelay));
+      PointToPointHelper edgeLink;
+      edgeLink.SetDeviceAttribute ("DataRate", StringValue ("1000Mbps"));
+      edgeLink.SetChannelAttribute ("Delay", StringValue ("5ms"));
+
+      PointToPointDumbbellHelper d (nLeaf, edgeLink, nLeaf, edgeLink, bottleneckLink);
+      InternetStackHelper stack;
+      d.InstallStack (stack);
+      d.AssignIpv4Addresses (Ipv4AddressHelper ("10.1.0.0", "255.255.255.252"),
+                             Ipv4AddressHelper ("10.2.0.0", "255.255.255.252"),
+                             Ipv4AddressHelper ("10.3.0.0", "255.255.255.252"));
+      Ipv4GlobalRoutingHelper::PopulateRoutingTables ();
+      d.InstallBottleneckQueueDisc (aqm, QueueSize (queueSize), bql);
+      Ptr<BottleneckDelayProbe> probe = d.InstallBottleneckDelayProbe (false);
+
+      for (uint32_t i = 0; i < nBulk; ++i)
+        {
+          BulkSendHelper source ("ns3::TcpSocketFactory", InetSocketAddress (d.GetRightIpv4Address (i), bulkPort));
+          source.SetAttribute ("MaxBytes", UintegerValue (0));
+          ApplicationContainer sourceApps = source.Install (d.GetLeft (i));
+          sourceApps.Start (Seconds (0.1));
+          sourceApps.Stop (stopTime);
+          PacketSinkHelper sink ("ns3::TcpSocketFactory", InetSocketAddress (Ipv4Address::GetAny (), bulkPort));
+          ApplicationContainer sinkApps = sink.Install (d.GetRight (i));
+          sinkApps.Start (Seconds (0));
+          sinkApps.Stop (stopTime);
+        }
+
+      WorkloadHelper workload ("ns3::TcpSocketFactory");
+      workload.SetAttribute ("FlowSize", StringValue ("ns3::ConstantRandomVariable[Constant="
+                                                      + std::to_string (shortSize) + "]"));
+      workload.SetAttribute ("InterArrival", StringValue ("ns3::ExponentialRandomVariable[Mean="
+                                                          + std::to_string (shortInterval) + "]"));
+      workload.SetAttribute ("BottleneckRate", DataRateValue (DataRate (bottleneckRate)));
+      workload.SetAttribute ("BaseRtt", TimeValue (2 * (Time (bottleneckDelay) + MilliSeconds (10))));
+      workload.GetStatistics ()->SetSizeBuckets ({});
+      NodeContainer shortSinks;
+      for (uint32_t i = nBulk; i < nLeaf; ++i)
+        {
+          ApplicationContainer apps = workload.Install (d.GetLeft (i), InetSocketAddress (d.GetRightIpv4Address (i), shortPort));
+          // Same arrivals for every queue disc
+          DynamicCast<WorkloadApplication> (apps.Get (0))->AssignStreams (1000 + 2 * i);
+          apps.Start (Seconds (1));
+          apps.Stop (stopTime);
+          shortSinks.Add (d.GetRight (i));
+        }
+      ApplicationContainer sinkApps = workload.InstallSink (shortSinks, shortPort);
+      sinkApps.Start (Seconds (0));
+
+      CrossTrafficHelper cross;
+      if (crossFlows > 0)
+        {
+          cross.AddClass ("udp", crossFlows, DataRate (crossRate), crossPacketSize, crossOn, crossOff);
+          ApplicationContainer crossApps = cross.Install (d, crossPort);
+          crossApps.Start (Seconds (0.5));
+          crossApps.Stop (stopTime);
+          cross.GetSinks ().Start (Seconds (0));
+          cross.AssignStreams (2000);
+        }
+      stack.AssignStreams (NodeContainer::GetGlobal (), 0);
+
+      Simulator::Stop (stopTime + Seconds (1));
+      Simulator::Run ();
+
+      for (uint32_t flowId = 0; flowId < probe->GetNFlows (); ++flowId)
+        {
+          const DumbbellFlowMonitor::FlowTuple &t = probe->GetFlowTuple (flowId);
+          const BottleneckDelayProbe::FlowRecord &record = probe->GetFlowRecord (flowId);
+          std::ostringstream flow;
+          flow << t.source << " > " << t.destination << ":" << t.destinationPort;
+          std::string kind = t.destinationPort == bulkPort    ? "bulk"
+                             : t.destinationPort == shortPort ? "short"
+                             : t.destinationPort == crossPort ? "cross"
+                                                              : "other";
+          double mbps = probe->GetThroughput (flowId) / 1e6;
+          double mean = probe->GetMeanDelay (flowId).GetSeconds () * 1e3;
+          double p50 = probe->GetDelayPercentile (flowId, 50).GetSeconds () * 1e3;
+          double p95 = probe->GetDelayPercentile (flowId, 95).GetSeconds () * 1e3;
+          double p99 = probe->GetDelayPercentile (flowId, 99).GetSeconds () * 1e3;
+
+          table << std::left << std::setw (10) << aqm << std::setw (32) << flow.str () << std::setw (7)
+                << kind << std::right << std::fixed << std::setprecision (2) << std::setw (9)
+                << record.packets << std::setw (9) << mbps << std::setw (7) << record.drops
+                << std::setw (7) << record.marks << std::setw (9) << mean << std::setw (9) << p50
+                << std::setw (9) << p95 << std::setw (9) << p99 << "\n";
+          table.unsetf (std::ios::fixed);
+          summary << aqm << " " << t.source << ">" << t.destination << ":" << t.destinationPort
+                  << " " << kind << " " << record.packets << " " << mbps << " " << record.drops
+                  << " " << record.marks << " " << mean << " " << p50 << " " << p95 << " " << p99
+                  << std::endl;
+        }
+      Ptr<FctStatistics> fct = workload.GetStatistics ();
+      std::cout << aqm << ": " << fct->GetNFlows () << " short flows completed";
+      if (fct->GetNFlows () > 0)
+        {
+          std::cout << ", FCT p50 " << fct->GetFctPercentile (0, 50).As (Time::MS) << ", p99 "
+                    << fct->GetFctPercentile (0, 99).As (Time::MS);
+        }
+      std::cout << std::endl;
+      if (crossFlows > 0)
+        {
+          cross.Report (std::cout, stopTime - Seconds (0.5));
+        }
+
+      DumbbellScenario::Reset ();
+    }
+
+  std::cout << "\nQueueing delay at the bottleneck (ms), left to right\n" << table.str ();
+  summary.close ();
+  return 0;
+}
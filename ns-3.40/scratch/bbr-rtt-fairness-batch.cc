@@ -0,0 +1,150 @@
+#include "ns3/applications-module.h"
+#include "ns3/core-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/network-module.h"
+#include "ns3/point-to-point-module.h"
+#include "ns3/point-to-point-layout-module.h"
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+// RTT-fairness sweep: one small dumbbell per edge-delay pair, all in one
+// simulation.  Instance k has two senders sharing a 10Mbps/10ms bottleneck;
+// the first reaches it over a --baseDelay edge link and the second over the
+// k-th delay of --delays, while both receivers sit behind --baseDelay edge
+// links, as in bbr_tcp_2_nodes.cc.  The throughput of both
+// senders and Jain's fairness index are reported per instance, and each
+// instance streams its own flow statistics to <dir>/instance-<k>-*.csv.
+
+using namespace ns3;
+
+int main (int argc, char * argv[]){
+
+    std::string tcpTypeId = "TcpBbr";
+    std::string baseDelay = "5ms";
+    std::string delays = "5ms,10ms,20ms,50ms,100ms,200ms";
+    std::string dir = "bbr-results/rtt-fairness";
+    Time stopTime = Seconds(10);
+    bool fastExit = false;
+
+    CommandLine cmd;
+    cmd.AddValue("tcpTypeId", "Transport protocol to use: TcpNewReno, TcpBbr", tcpTypeId);
+    cmd.AddValue("baseDelay", "Edge delay of the first sender of every instance", baseDelay);
+    cmd.AddValue("delays", "Comma-separated edge delays of the second sender, one instance each", delays);
+    cmd.AddValue("dir", "Output directory", dir);
+    cmd.AddValue("stopTime", "Simulation stop time", stopTime);
+    cmd.AddValue("fastExit", "Exit without destroying the topologies", fastExit);
+    cmd.Parse(argc, argv);
+
+    Config::SetDefault("ns3::TcpL4Protocol::SocketType", StringValue("ns3::" + tcpTypeId));
+    Config::SetDefault("ns3::TcpSocket::SndBufSize", UintegerValue(4194304));
+    Config::SetDefault("ns3::TcpSocket::RcvBufSize", UintegerValue(6291456));
+    Config::SetDefault("ns3::TcpSocket::InitialCwnd", UintegerValue(10));
+    Config::SetDefault("ns3::TcpSocket::DelAckCount", UintegerValue(2));
+    Config::SetDefault("ns3::TcpSocket::SegmentSize", UintegerValue(1448));
+    Config::SetDefault("ns3::DropTailQueue<Packet>::MaxSize", QueueSizeValue(QueueSize("1p")));
+
+    // The helpers are scoped so that they release the topologies before the
+    // teardown below, which then times all of it
+    {
+        PointToPointHelper bottleneckLink;
+        bottleneckLink.SetDeviceAttribute("DataRate", StringValue("10Mbps"));
+        bottleneckLink.SetChannelAttribute("Delay", StringValue("10ms"));
+
+        // One instance per delay; only the left link of leaf 1 gets the delay,
+        // so it is added once to the RTT of the second flow
+        DataRate edgeRate("1000Mbps");
+        std::vector<PointToPointDumbbellHelper::LeafLink> rightLinks(2, {edgeRate, Time(baseDelay)});
+        PointToPointDumbbellBatchHelper batch;
+        std::vector<std::string> instanceDelays;
+        std::stringstream ss(delays);
+        std::string delay;
+        while (std::getline(ss, delay, ',')){
+            std::vector<PointToPointDumbbellHelper::LeafLink> leftLinks = {{edgeRate, Time(baseDelay)},
+                                                                           {edgeRate, Time(delay)}};
+            batch.Add(leftLinks, rightLinks, bottleneckLink);
+            instanceDelays.push_back(delay);
+        }
+
+        InternetStackHelper internet;
+        batch.InstallStack(internet);
+        batch.AssignIpv4Addresses();
+        Ipv4GlobalRoutingHelper::PopulateRoutingTables();
+
+        std::string dirToSave = "mkdir -p " + dir;
+        system(dirToSave.c_str());
+
+        uint16_t port = 9;
+        std::vector<Ptr<DumbbellFlowMonitor>> monitors;
+        for (uint32_t k = 0; k < batch.GetN(); k++){
+            PointToPointDumbbellHelper& d = batch.Get(k);
+            for (uint32_t i = 0; i < d.LeftCount(); i++){
+                BulkSendHelper source("ns3::TcpSocketFactory", InetSocketAddress(d.GetRightIpv4Address(i), port));
+                source.SetAttribute("MaxBytes", UintegerValue(0));
+                ApplicationContainer sourceApps = source.Install(d.GetLeft(i));
+                sourceApps.Start(Seconds(0.1));
+                sourceApps.Stop(stopTime);
+
+                PacketSinkHelper sink("ns3::TcpSocketFactory", InetSocketAddress(Ipv4Address::GetAny(), port));
+                ApplicationContainer sinkApps = sink.Install(d.GetRight(i));
+                sinkApps.Start(Seconds(0.0));
+                sinkApps.Stop(stopTime);
+            }
+
+            // Separate monitor and exporter per instance, so results never mix
+            monitors.push_back(d.InstallFlowMonitor());
+            Ptr<FlowStatsExporter> exporter = CreateObject<FlowStatsExporter>();
+            exporter->SetAttribute("Interval", TimeValue(Seconds(1)));
+            exporter->Start(monitors.back(), dir + "/instance-" + std::to_string(k));
+            // Write the last snapshot at teardown, on the fast-exit path too
+            SimulationTeardown::AddFlushCallback(MakeCallback(&FlowStatsExporter::Finish, exporter));
+        }
+
+        Simulator::Stop(stopTime);
+        Simulator::Run();
+
+        std::ofstream summary(dir + "/summary.txt");
+        summary << "# instance delay0 delay1 throughput0(Mbps) throughput1(Mbps) jain" << std::endl;
+        double duration = (stopTime - Seconds(0.1)).GetSeconds();
+        for (uint32_t k = 0; k < batch.GetN(); k++){
+            PointToPointDumbbellHelper& d = batch.Get(k);
+            std::vector<double> throughput(d.LeftCount(), 0);
+            Ptr<DumbbellFlowMonitor> monitor = monitors[k];
+            for (uint32_t flowId = 0; flowId < monitor->GetNFlows(); flowId++){
+                const DumbbellFlowMonitor::FlowTuple& t = monitor->GetFlowTuple(flowId);
+                if (t.destinationPort != port){
+                    continue; // ACK flow
+                }
+                for (uint32_t i = 0; i < d.LeftCount(); i++){
+                    if (t.source == d.GetLeftIpv4Address(i)){
+                        throughput[i] = monitor->GetFlowRecord(flowId).rxBytes * 8.0 / duration / 1e6;
+                    }
+                }
+            }
+
+            double sum = 0;
+            double sumSquares = 0;
+            for (double x : throughput){
+                sum += x;
+                sumSquares += x * x;
+            }
+            double jain = sumSquares > 0 ? sum * sum / (throughput.size() * sumSquares) : 0;
+
+            std::cout << "Instance " << k << " (" << baseDelay << " vs " << instanceDelays[k] << "):"
+                      << " " << throughput[0] << " Mbps / " << throughput[1] << " Mbps,"
+                      << " Jain index " << jain << std::endl;
+            summary << k << " " << baseDelay << " " << instanceDelays[k] << " "
+                    << throughput[0] << " " << throughput[1] << " " << jain << std::endl;
+        }
+
+        summary.close();
+
+        if (fastExit){
+            SimulationTeardown::FastExit(0, &std::cout);
+        }
+    }
+    SimulationTeardown::Destroy(&std::cout);
+    return 0;
+
+}
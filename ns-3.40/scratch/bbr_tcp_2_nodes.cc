@@ -4,6 +4,7 @@
 #include "ns3/internet-module.h"
 #include "ns3/network-module.h"
 #include "ns3/point-to-point-module.h"
+#include "ns3/point-to-point-layout-module.h"
 #include "ns3/tcp-bbr.h"
 
 #include "ns3/mobility-module.h"
@@ -130,6 +131,19 @@ int main (int argc, char * argv[]){
     FlowMonitorHelper flowMonitor;
     Ptr<FlowMonitor> monitor = flowMonitor.InstallAll();
 
+    // Stream per-flow statistics once per second instead of dumping XML at the end
+    Ptr<FlowStatsExporter> exporter = CreateObject<FlowStatsExporter>();
+    exporter->SetAttribute("Interval", TimeValue(Seconds(1)));
+    std::string dir = "bbr-results/2-nodes";
+    MakeDirectories(dir);
+    exporter->Start(monitor, DynamicCast<Ipv4FlowClassifier>(flowMonitor.GetClassifier()), dir + "/flowstats");
+
+    // Goodput as delivered to the sinks; only the totals are needed
+    Ptr<GoodputMeter> goodput = CreateObject<GoodputMeter>();
+    goodput->SetAttribute("Interval", TimeValue(Seconds(0)));
+    goodput->Install(sinkApps1);
+    goodput->Install(sinkApps2);
+
     Simulator::Stop(Seconds(10.0));
     std::string animFile = "dumbbell-animation.xml" ;  // Name of file for animation output
     cmd.AddValue ("animFile",  "File Name for Animation Output", animFile);
@@ -143,7 +157,7 @@ int main (int argc, char * argv[]){
 
     Simulator::Run();
 
-    monitor->SerializeToXmlFile("name.xml", true, true);
+    exporter->Finish();
 
     monitor->CheckForLostPackets();
     Ptr<Ipv4FlowClassifier> classifier = DynamicCast<Ipv4FlowClassifier>(flowMonitor.GetClassifier());
@@ -154,9 +168,11 @@ int main (int argc, char * argv[]){
         std::cout << "Flow " << t.sourceAddress << " -> " << t.destinationAddress 
         << " Bytes: " << it->second.txBytes 
         << " rBytes: " << it->second.rxBytes 
-        << " Throughput: " << it->second.txBytes * 8.0 / (it->second.timeLastTxPacket.GetSeconds() - it->second.timeFirstTxPacket.GetSeconds())
+        << " Send rate: " << it->second.txBytes * 8.0 / (it->second.timeLastTxPacket.GetSeconds() - it->second.timeFirstTxPacket.GetSeconds())
         << std::endl;
     }
+    // The send rate includes the packets dropped at the bottleneck
+    goodput->Report(std::cout);
 
     Simulator::Destroy();
     return 0;
@@ -17,6 +17,7 @@
  */
 
 #include <iostream>
+#include <memory>
 #include "ns3/core-module.h"
 #include "ns3/network-module.h"
 #include "ns3/internet-module.h"
@@ -38,6 +39,7 @@ using namespace ns3::SystemPath;
 
 std::string dir;
 std::ofstream throughput;
+std::ofstream goodput;
 std::ofstream queueSize;
 
 uint32_t prev[4] = {0};
@@ -65,6 +67,67 @@ TraceThroughput(Ptr<FlowMonitor> monitor, Ptr<Ipv4FlowClassifier> classifier)
     Simulator::Schedule(Seconds(0.1), &TraceThroughput, monitor, classifier);
 }
 
+// Receiver side goodput, from the bytes delivered to the sinks
+static void
+TraceGoodput (Ptr<GoodputMeter> meter, uint32_t flowId, double bps)
+{
+  const GoodputMeter::FlowRecord &record = meter->GetFlowRecord (flowId);
+  goodput << Now ().ToDouble (Time::NS) << " "
+          << InetSocketAddress::ConvertFrom (record.source).GetIpv4 () << " -> "
+          << InetSocketAddress::ConvertFrom (record.destination).GetIpv4 () << " "
+          << bps / 1e6 << std::endl;
+}
+
+uint64_t rssBeforeRun = 0;
+
+// Report the memory used per QUIC connection once the connections are up
+static void
+ReportConnectionMemory (uint32_t numFlows)
+{
+  uint64_t rss = MemoryProbe::GetResidentBytes ();
+  uint64_t perConnection = rss > rssBeforeRun ? (rss - rssBeforeRun) / numFlows : 0;
+  std::cout << Now ().GetSeconds () << " s: RSS " << rss / 1048576.0 << " MB, "
+            << perConnection << " bytes per connection (" << numFlows << " connections)"
+            << std::endl;
+}
+
+// Stop the simulation when the process outgrows its memory budget
+static void
+CheckMemoryBudget (uint64_t budget)
+{
+  uint64_t rss = MemoryProbe::GetResidentBytes ();
+  if (rss > budget)
+    {
+      std::cout << Now ().GetSeconds () << " s: RSS " << rss / 1048576.0
+                << " MB exceeds the memory budget, stopping" << std::endl;
+      Simulator::Stop ();
+      return;
+    }
+  Simulator::Schedule (Seconds (1), &CheckMemoryBudget, budget);
+}
+
+std::vector<uint64_t> leafPrev;
+std::vector<Time> leafPrevTime;
+
+//calculate throughput from the leaf-only flow monitor
+static void
+TraceLeafThroughput(Ptr<DumbbellFlowMonitor> monitor)
+{
+    Time curTime = Now();
+    leafPrev.resize(monitor->GetNFlows(), 0);
+    leafPrevTime.resize(monitor->GetNFlows(), Seconds(0));
+    for (uint32_t flowId = 0; flowId < monitor->GetNFlows(); flowId++){
+        const DumbbellFlowMonitor::FlowRecord& record = monitor->GetFlowRecord(flowId);
+        const DumbbellFlowMonitor::FlowTuple& t = monitor->GetFlowTuple(flowId);
+        throughput << curTime.ToDouble(Time::NS) << " " << t.source << " -> " << t.destination << " "
+               << 8 * (record.txBytes - leafPrev[flowId]) / ((curTime - leafPrevTime[flowId]).ToDouble(Time::US))
+               << std::endl;
+        leafPrevTime[flowId] = curTime;
+        leafPrev[flowId] = record.txBytes;
+    }
+    Simulator::Schedule(Seconds(0.1), &TraceLeafThroughput, monitor);
+}
+
 
 int main (int argc, char *argv[])
 {
@@ -99,6 +162,15 @@ int main (int argc, char *argv[])
   uint32_t QUICFlows = nLeaf;
   bool isPacingEnabled = true;
   uint32_t maxPackets = 0;
+  bool leafMonitor = false;
+  std::string flowStatsFormat = "Csv";
+  bool flowStatsHistograms = false;
+  bool bbrTimeline = false;
+  bool quicAtScale = false;
+  uint32_t quicBufSize = 65536;
+  uint32_t memoryBudget = 0;
+  std::string liveMetricsName = "";
+  bool memoryAccounting = false;
   CommandLine cmd;
   cmd.AddValue ("nLeftLeaf", "Number of left side leaf nodes", nLeftLeaf);
   cmd.AddValue ("nRightLeaf","Number of right side leaf nodes", nRightLeaf);
@@ -112,8 +184,39 @@ int main (int argc, char *argv[])
   cmd.AddValue ("QUICFlows", "Number of application flows between sender and receiver", QUICFlows);
   cmd.AddValue ("Pacing", "Flag to enable/disable pacing in QUIC", isPacingEnabled);
   cmd.AddValue ("PacingRate", "Max Pacing Rate in bps", pacingRate);
+  cmd.AddValue ("leafMonitor", "Use the leaf-only DumbbellFlowMonitor instead of FlowMonitor", leafMonitor);
+  cmd.AddValue ("flowStatsFormat", "Flow statistics export format: Csv or Binary", flowStatsFormat);
+  cmd.AddValue ("flowStatsHistograms", "Also export the non-empty histogram bins", flowStatsHistograms);
+  cmd.AddValue ("bbrTimeline", "Record the QuicBbr state-machine timeline of every sender", bbrTimeline);
+  cmd.AddValue ("quicAtScale", "Plain IP routers, small QUIC buffers, leaf monitor, no animation, memory and goodput reports", quicAtScale);
+  cmd.AddValue ("quicBufSize", "QUIC socket and stream buffer size with quicAtScale", quicBufSize);
+  cmd.AddValue ("memoryBudget", "Stop the simulation above this RSS, in MB (0 for none)", memoryBudget);
+  cmd.AddValue ("liveMetrics", "Shared memory name to publish live metrics to, empty for none", liveMetricsName);
+  cmd.AddValue ("memoryAccounting", "Write a breakdown of the memory by subsystem and object type", memoryAccounting);
   cmd.Parse (argc,argv);
 
+  // Thousands of connections: cap the QUIC buffers (they only grow with the
+  // data queued, so a small cap bounds every connection), and use the
+  // leaf-only flow monitor since FlowMonitor tracing is sized for 4 flows
+  if (quicAtScale)
+    {
+      if (!leafMonitor)
+        {
+          std::cout << "quicAtScale: using the leaf-only flow monitor (leafMonitor=true)"
+                    << std::endl;
+          leafMonitor = true;
+        }
+      for (std::string buffer : {"ns3::QuicSocketBase::SocketSndBufSize",
+                                 "ns3::QuicSocketBase::SocketRcvBufSize",
+                                 "ns3::QuicStreamBase::StreamSndBufSize",
+                                 "ns3::QuicStreamBase::StreamRcvBufSize"})
+        {
+          // Uncapped buffers would defeat the point of quicAtScale
+          NS_ABORT_MSG_UNLESS (Config::SetDefaultFailSafe (buffer, UintegerValue (quicBufSize)),
+                               "Cannot cap the QUIC buffers: no attribute " << buffer);
+        }
+    }
+
   // Create the point-to-point link helpers
   PointToPointHelper pointToPointRouter;
   pointToPointRouter.SetDeviceAttribute  ("DataRate", StringValue ("10Mbps"));
@@ -132,7 +235,7 @@ int main (int argc, char *argv[])
   
   // Install Stack
   QuicHelper stack;
-  d.InstallStackQuic(stack);
+  d.InstallStackQuic(stack, !quicAtScale);
 
   // Assign IP Addresses
   d.AssignIpv4Addresses (Ipv4AddressHelper ("10.1.1.0", "255.255.255.0"),
@@ -140,6 +243,7 @@ int main (int argc, char *argv[])
                          Ipv4AddressHelper ("10.3.1.0", "255.255.255.0"));
 
   uint32_t numFlows = d.RightCount();
+  ApplicationContainer allSinkApps;
   
   for (uint32_t i = 0; i < numFlows; ++i)
   {
@@ -159,14 +263,19 @@ int main (int argc, char *argv[])
     ApplicationContainer sinkApps = sink.Install(d.GetLeft(i));
     sinkApps.Start(start_time);
     sinkApps.Stop(stopTime);
+    allSinkApps.Add(sinkApps);
   }  
   // Set the bounding box for animation
   d.BoundingBox (1, 1, 100, 100);
 
   // Create the animation object and configure for specified output
-  AnimationInterface anim (animFile);
-  anim.EnablePacketMetadata (); // Optional
-  anim.EnableIpv4L3ProtocolCounters (Seconds (0), stopTime); // Optional
+  std::unique_ptr<AnimationInterface> anim;
+  if (!quicAtScale)
+    {
+      anim = std::make_unique<AnimationInterface> (animFile);
+      anim->EnablePacketMetadata (); // Optional
+      anim->EnableIpv4L3ProtocolCounters (Seconds (0), stopTime); // Optional
+    }
   
   dir = "bbr-results/";
   MakeDirectories(dir);
@@ -176,18 +285,108 @@ int main (int argc, char *argv[])
   Ipv4GlobalRoutingHelper::PopulateRoutingTables ();
   Ptr<FlowMonitor> flowMonitor;
   FlowMonitorHelper flowHelper;
-  flowMonitor = flowHelper.InstallAll();
+  Ptr<DumbbellFlowMonitor> leafFlowMonitor;
+  Ptr<FlowStatsExporter> exporter = CreateObject<FlowStatsExporter> ();
+  exporter->SetAttribute ("Format", StringValue (flowStatsFormat));
+  exporter->SetAttribute ("Histograms", BooleanValue (flowStatsHistograms));
+  exporter->SetAttribute ("Interval", TimeValue (Seconds (1)));
+  if (leafMonitor)
+    {
+      leafFlowMonitor = d.InstallFlowMonitor (flowStatsHistograms);
+      Simulator::Schedule(Seconds(0 + 0.000001), &TraceLeafThroughput, leafFlowMonitor);
+      exporter->Start (leafFlowMonitor, dir + "/flowstats");
+    }
+  else
+    {
+      flowMonitor = flowHelper.InstallAll();
+      Ptr<Ipv4FlowClassifier> classifier = DynamicCast<Ipv4FlowClassifier>(flowHelper.GetClassifier());
+      Simulator::Schedule(Seconds(0 + 0.000001), &TraceThroughput, flowMonitor, classifier);
+      exporter->Start (flowMonitor, classifier, dir + "/flowstats");
+    }
 
-  Ptr<Ipv4FlowClassifier> classifier = DynamicCast<Ipv4FlowClassifier>(flowHelper.GetClassifier());
-  FlowMonitor::FlowStatsContainer stats = flowMonitor->GetFlowStats();
+  // The throughput traces count the bytes sent; with quicAtScale the
+  // goodput meter also counts the bytes delivered to the sinks
+  Ptr<GoodputMeter> goodputMeter;
+  if (quicAtScale)
+    {
+      goodput.open (dir + "/goodput.dat", std::ios::out);
+      goodputMeter = CreateObject<GoodputMeter> ();
+      goodputMeter->SetAttribute ("Interval", TimeValue (Seconds (0.1)));
+      goodputMeter->TraceConnectWithoutContext ("Goodput",
+                                                MakeBoundCallback (&TraceGoodput, goodputMeter));
+      goodputMeter->Install (allSinkApps);
+    }
 
-  Simulator::Schedule(Seconds(0 + 0.000001), &TraceThroughput, flowMonitor, classifier);
+  // Record the QuicBbr state-machine timeline of every sender
+  Ptr<BbrTimelineRecorder> timeline;
+  if (bbrTimeline)
+    {
+      timeline = CreateObject<BbrTimelineRecorder> ();
+      if (isPacingEnabled)
+        {
+          // The mode inference ignores the pacing gain while it is capped
+          timeline->SetAttribute ("MaxPacingRate", StringValue (pacingRate));
+        }
+      timeline->SetOutputFile (dir + "/bbr-timeline.bin");
+      for (uint32_t i = 0; i < numFlows; ++i)
+        {
+          Simulator::Schedule (Seconds (0.2), &BbrTimelineRecorder::TrackQuic, timeline,
+                               d.GetRight (i)->GetId (), 0, 1460);
+        }
+    }
+
+  // Publish live metrics for dumbbell-metrics-viewer; flow throughput
+  // needs the leaf monitor
+  Ptr<LiveMetricsPublisher> liveMetrics;
+  if (!liveMetricsName.empty ())
+    {
+      liveMetrics = d.EnableLiveMetrics (leafFlowMonitor, MilliSeconds (100), liveMetricsName);
+      for (uint32_t i = 0; i < numFlows; ++i)
+        {
+          Simulator::Schedule (Seconds (0.2), &LiveMetricsPublisher::TraceQuicSocket, liveMetrics,
+                               d.GetRight (i)->GetId (), 0, 1460);
+        }
+    }
   Simulator::Stop(stopTime);
-  
+
+  // Per-connection memory, measured once all the connections are open
+  if (quicAtScale)
+    {
+      rssBeforeRun = MemoryProbe::GetResidentBytes ();
+      Simulator::Schedule (Seconds (2), &ReportConnectionMemory, numFlows);
+    }
+  if (memoryBudget > 0)
+    {
+      Simulator::ScheduleNow (&CheckMemoryBudget, uint64_t (memoryBudget) * 1048576);
+    }
+
+  Ptr<MemoryAccountant> memory;
+  if (memoryAccounting)
+    {
+      memory = CreateObject<MemoryAccountant> ();
+      memory->Start ();
+    }
 
   Simulator::Run ();
-  std::cout << "Animation Trace file created:" << animFile.c_str ()<< std::endl;
-  flowMonitor->SerializeToXmlFile("flowmon.xml", true, true);
+  if (anim)
+    {
+      std::cout << "Animation Trace file created:" << animFile.c_str ()<< std::endl;
+    }
+  if (quicAtScale)
+    {
+      goodputMeter->Report (std::cout);
+      std::cout << "Peak RSS: " << MemoryProbe::GetPeakResidentBytes () / 1048576.0 << " MB"
+                << std::endl;
+    }
+  exporter->Finish ();
+  if (timeline)
+    {
+      timeline->Dump ();
+    }
+  if (memory)
+    {
+      memory->Write (dir + "memory");
+    }
 
   Simulator::Destroy ();
   return 0;
@@ -0,0 +1,147 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// Watch a running simulation through its live metrics ring:
+//
+//   ./ns3 run "tcp-bbr-example --liveMetrics=/bbr" &
+//   ./ns3 run "dumbbell-metrics-viewer --name=/bbr"
+//
+// This program does not simulate anything: it attaches to the shared
+// memory of an ns3::LiveMetricsPublisher and redraws, every --period, the
+// latest value, minimum, maximum and sample count of every series.  With
+// --csv the samples are printed as "time series label value" lines
+// instead.  It exits when the publisher is gone.
+
+#include "ns3/core-module.h"
+#include "ns3/point-to-point-layout-module.h"
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <thread>
+
+using namespace ns3;
+
+// Running statistics of one series
+struct SeriesStats
+{
+  double last = 0;
+  double min = std::numeric_limits<double>::max ();
+  double max = std::numeric_limits<double>::lowest ();
+  uint64_t count = 0;
+  int64_t time = 0;
+};
+
+static const char *
+Unit (uint32_t kind)
+{
+  switch (kind)
+    {
+    case LiveMetricsPublisher::THROUGHPUT:
+      return "Mbps";
+    case LiveMetricsPublisher::CWND:
+      return "seg";
+    case LiveMetricsPublisher::RTT:
+      return "ms";
+    case LiveMetricsPublisher::QUEUE:
+      return "pkt";
+    default:
+      return "";
+    }
+}
+
+int
+main (int argc, char *argv[])
+{
+  std::string name = "/ns3-metrics";
+  Time period = MilliSeconds (500);
+  bool csv = false;
+
+  CommandLine cmd (__FILE__);
+  cmd.AddValue ("name", "Shared memory name of the publisher", name);
+  cmd.AddValue ("period", "Refresh period (wall clock)", period);
+  cmd.AddValue ("csv", "Print every sample instead of a table", csv);
+  cmd.Parse (argc, argv);
+
+  auto wait = std::chrono::milliseconds (period.GetMilliSeconds ());
+  LiveMetricsReader reader;
+  while (!reader.Attach (name))
+    {
+      std::cerr << "Waiting for " << name << "..." << std::endl;
+      std::this_thread::sleep_for (wait);
+    }
+
+  std::vector<LiveMetricsPublisher::Sample> samples;
+  std::vector<SeriesStats> stats;
+  uint64_t lost = 0;
+  bool alive = true;
+  while (alive)
+    {
+      // Read once more after the publisher exits, to get its last samples
+      alive = reader.IsPublisherAlive ();
+      samples.clear ();
+      lost += reader.Poll (samples);
+      stats.resize (reader.GetNSeries ());
+      for (const auto &sample : samples)
+        {
+          if (sample.series >= stats.size ())
+            {
+              continue;
+            }
+          SeriesStats &s = stats[sample.series];
+          s.last = sample.value;
+          s.min = std::min (s.min, sample.value);
+          s.max = std::max (s.max, sample.value);
+          s.count++;
+          s.time = sample.time;
+          if (csv)
+            {
+              std::cout << sample.time * 1e-9 << " " << sample.series << " \""
+                        << reader.GetSeries (sample.series).label << "\" " << sample.value << "\n";
+            }
+        }
+
+      if (!csv)
+        {
+          // Clear the screen and redraw the table
+          std::cout << "\033[H\033[2J" << name << (alive ? "" : " (finished)")
+                    << ", lost samples: " << lost << "\n\n";
+          std::cout << std::left << std::setw (48) << "series" << std::right << std::setw (10)
+                    << "time(s)" << std::setw (12) << "last" << std::setw (12) << "min"
+                    << std::setw (12) << "max" << std::setw (10) << "samples" << "\n";
+          for (uint32_t i = 0; i < stats.size (); ++i)
+            {
+              const SeriesStats &s = stats[i];
+              LiveMetricsPublisher::SeriesInfo info = reader.GetSeries (i);
+              std::cout << std::left << std::setw (48)
+                        << (std::string (info.label) + " (" + Unit (info.kind) + ")")
+                        << std::right << std::fixed << std::setprecision (3) << std::setw (10)
+                        << s.time * 1e-9 << std::setw (12) << s.last << std::setw (12)
+                        << (s.count ? s.min : 0) << std::setw (12) << (s.count ? s.max : 0)
+                        << std::setw (10) << s.count << "\n";
+              std::cout.unsetf (std::ios::fixed);
+            }
+        }
+      std::cout << std::flush;
+      if (alive)
+        {
+          std::this_thread::sleep_for (wait);
+        }
+    }
+
+  return 0;
+}
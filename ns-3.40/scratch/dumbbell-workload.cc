@@ -0,0 +1,218 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// This program drives a TCP dumbbell with finite flows instead of infinite
+// bulk transfers:
+//
+//   leaf 0 --+                                 +-- leaf 0
+//   ...      |-- R1 ------ bottleneck ------ R2 --|   ...
+//   leaf n --+                                 +-- leaf n
+//
+// Every left leaf runs a WorkloadApplication towards the right leaf of the
+// same index.  Flow sizes come from --sizeCdf (an empirical "size cdf" file)
+// or are exponential with mean --meanSize; arrivals are Poisson with the rate
+// needed to reach --load on the bottleneck given the mean of those sizes, or
+// are replayed from --trace.
+//
+// Leaf link delays are drawn uniformly from [5ms, --leafDelayMax], so RTT
+// spread studies need no rebuild; the ideal FCT assumes the smallest RTT.
+//
+// With --aggregateLeaves, each side is a single node with one access link
+// per leaf, which keeps memory proportional to the flows, not to full nodes.
+// The packets sent on every left access link are counted, and the program
+// exits with 1 if two active senders share a link.
+//
+// With --linkSchedule, the bottleneck rate, delay and loss follow a recorded
+// schedule (see ns3::LinkScheduleReplayer for the file formats).
+//
+// At the end the flow-completion-time percentiles and slowdowns are printed
+// per flow-size bucket and written to 'fct.txt' in the output directory.
+
+#include "ns3/applications-module.h"
+#include "ns3/core-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/network-module.h"
+#include "ns3/point-to-point-layout-module.h"
+#include "ns3/point-to-point-module.h"
+
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+using namespace ns3;
+
+static void
+CountTx (std::vector<uint64_t> *txPackets, uint32_t leaf, Ptr<const Packet> p)
+{
+  (*txPackets)[leaf]++;
+}
+
+int
+main (int argc, char *argv[])
+{
+  uint32_t nLeaf = 16;
+  std::string bottleneckRate = "100Mbps";
+  std::string bottleneckDelay = "10ms";
+  std::string tcpTypeId = "TcpBbr";
+  std::string sizeCdf = "";
+  std::string trace = "";
+  double meanSize = 100000;
+  double load = 0.6;
+  uint64_t maxFlows = 0;
+  bool reuse = false;
+  Time stopTime = Seconds (10);
+  std::string dir = "bbr-results/workload";
+  std::string linkSchedule = "";
+  Time leafDelayMax = MilliSeconds (5);
+  bool aggregateLeaves = false;
+  bool fastExit = false;
+
+  CommandLine cmd (__FILE__);
+  cmd.AddValue ("nLeaf", "Number of left and right side leaf nodes", nLeaf);
+  cmd.AddValue ("bottleneckRate", "Bottleneck link rate", bottleneckRate);
+  cmd.AddValue ("bottleneckDelay", "Bottleneck link delay", bottleneckDelay);
+  cmd.AddValue ("tcpTypeId", "Transport protocol to use: TcpNewReno, TcpBbr", tcpTypeId);
+  cmd.AddValue ("sizeCdf", "Empirical flow size CDF file (\"size cdf\" per line)", sizeCdf);
+  cmd.AddValue ("trace", "Flow arrival trace to replay (\"start size\" per line)", trace);
+  cmd.AddValue ("meanSize", "Mean flow size (bytes) when no CDF is given", meanSize);
+  cmd.AddValue ("load", "Offered load on the bottleneck, in (0, 1)", load);
+  cmd.AddValue ("maxFlows", "Flows per sender, zero for no limit", maxFlows);
+  cmd.AddValue ("reuse", "Reuse the connections of completed flows", reuse);
+  cmd.AddValue ("stopTime", "Simulation stop time", stopTime);
+  cmd.AddValue ("dir", "Output directory", dir);
+  cmd.AddValue ("leafDelayMax", "Leaf link delays are uniform in [5ms, leafDelayMax]", leafDelayMax);
+  cmd.AddValue ("aggregateLeaves", "Host all the leaves of a side on a single node", aggregateLeaves);
+  cmd.AddValue ("fastExit", "Exit without destroying the topology", fastExit);
+  cmd.AddValue ("linkSchedule", "Rate/delay/loss schedule to replay on the bottleneck", linkSchedule);
+  cmd.Parse (argc, argv);
+
+  Config::SetDefault ("ns3::TcpL4Protocol::SocketType", StringValue ("ns3::" + tcpTypeId));
+  Config::SetDefault ("ns3::TcpSocket::SndBufSize", UintegerValue (4194304));
+  Config::SetDefault ("ns3::TcpSocket::RcvBufSize", UintegerValue (6291456));
+  Config::SetDefault ("ns3::TcpSocket::InitialCwnd", UintegerValue (10));
+  Config::SetDefault ("ns3::TcpSocket::SegmentSize", UintegerValue (1448));
+
+  // The helpers are scoped so that they release the topology before the
+  // teardown below, which then times all of it
+  bool linksOk = true;
+  {
+    // Create the point-to-point link helpers
+    PointToPointHelper bottleneckLink;
+    bottleneckLink.SetDeviceAttribute ("DataRate", StringValue (bottleneckRate));
+    bottleneckLink.SetChannelAttribute ("Delay", StringValue (bottleneckDelay));
+
+    // Per-leaf delays give every sender its own RTT; leaves that draw the
+    // same delay share one link configuration
+    Ptr<ConstantRandomVariable> leafRate = CreateObject<ConstantRandomVariable> ();
+    leafRate->SetAttribute ("Constant", DoubleValue (1e9));
+    Ptr<UniformRandomVariable> leafDelay = CreateObject<UniformRandomVariable> ();
+    leafDelay->SetAttribute ("Min", DoubleValue (0.005));
+    leafDelay->SetAttribute ("Max", DoubleValue (std::max (leafDelayMax.GetSeconds (), 0.005)));
+    PointToPointDumbbellHelper d (PointToPointDumbbellHelper::SampleLeafLinks (nLeaf, leafRate, leafDelay),
+                                  PointToPointDumbbellHelper::SampleLeafLinks (nLeaf, leafRate, leafDelay),
+                                  bottleneckLink, PointToPointHelper (),
+                                  aggregateLeaves ? PointToPointDumbbellHelper::AGGREGATE_BOTH
+                                                  : PointToPointDumbbellHelper::AGGREGATE_NONE);
+
+    InternetStackHelper stack;
+    d.InstallStack (stack);
+    d.AssignIpv4Addresses (Ipv4AddressHelper ("10.1.1.0", "255.255.255.0"),
+                           Ipv4AddressHelper ("10.2.1.0", "255.255.255.0"),
+                           Ipv4AddressHelper ("10.3.1.0", "255.255.255.0"));
+    Ipv4GlobalRoutingHelper::PopulateRoutingTables ();
+
+    // Replay a recorded capacity trace on the bottleneck instead of a constant rate
+    if (!linkSchedule.empty ())
+      {
+        d.ReplayBottleneckSchedule (linkSchedule);
+      }
+
+    // Poisson arrivals sized so that all senders together offer the requested
+    // load; with a CDF file the rate follows the mean of the CDF
+    DataRate rate (bottleneckRate);
+    WorkloadHelper workload ("ns3::TcpSocketFactory");
+    double flowSize = workload.SetOfferedLoad (load, rate, nLeaf, meanSize, sizeCdf);
+    std::cout << "Mean flow size: " << flowSize << " bytes" << std::endl;
+    workload.SetAttribute ("TraceFile", StringValue (trace));
+    workload.SetAttribute ("MaxFlows", UintegerValue (maxFlows));
+    workload.SetAttribute ("ReuseConnections", BooleanValue (reuse));
+    workload.SetAttribute ("BottleneckRate", DataRateValue (rate));
+    workload.SetAttribute ("BaseRtt", TimeValue (2 * (Time (bottleneckDelay) + 2 * MilliSeconds (5))));
+
+    uint16_t port = 50001;
+    ApplicationContainer senders = workload.Install (d, port);
+    senders.Start (Seconds (0.0));
+    senders.Stop (stopTime);
+    ApplicationContainer sinks = workload.GetSinks ();
+    sinks.Start (Seconds (0.0));
+
+    // Count the packets of every left access link, to check that the senders
+    // of aggregated leaves each use their own link
+    std::vector<uint64_t> leafTx (d.LeftCount (), 0);
+    for (uint32_t i = 0; i < d.LeftCount (); ++i)
+      {
+        Ptr<Ipv4> ipv4 = d.GetLeft (i)->GetObject<Ipv4> ();
+        Ptr<NetDevice> device = ipv4->GetNetDevice (ipv4->GetInterfaceForAddress (d.GetLeftIpv4Address (i)));
+        device->TraceConnectWithoutContext ("MacTx", MakeBoundCallback (&CountTx, &leafTx, i));
+      }
+
+    // Flows still in progress at stopTime are aborted and not counted
+    Simulator::Stop (stopTime + TimeStep (1));
+    Simulator::Run ();
+
+    uint64_t started = 0;
+    uint64_t completed = 0;
+    for (uint32_t i = 0; i < senders.GetN (); ++i)
+      {
+        Ptr<WorkloadApplication> app = DynamicCast<WorkloadApplication> (senders.Get (i));
+        started += app->GetFlowsStarted ();
+        completed += app->GetFlowsCompleted ();
+      }
+    std::cout << "Flows started: " << started << ", completed: " << completed << std::endl;
+
+    uint32_t activeSenders = 0;
+    uint32_t usedLinks = 0;
+    for (uint32_t i = 0; i < senders.GetN (); ++i)
+      {
+        activeSenders += DynamicCast<WorkloadApplication> (senders.Get (i))->GetFlowsStarted () > 0;
+        usedLinks += leafTx[i] > 0;
+      }
+    std::cout << "Left access links used: " << usedLinks << " by " << activeSenders
+              << " active senders" << std::endl;
+    linksOk = usedLinks >= activeSenders;
+    if (!linksOk)
+      {
+        std::cerr << "Some senders share an access link" << std::endl;
+      }
+    workload.GetStatistics ()->Report (std::cout);
+
+    std::string dirToSave = "mkdir -p " + dir;
+    system (dirToSave.c_str ());
+    std::ofstream fct (dir + "/fct.txt");
+    workload.GetStatistics ()->Report (fct);
+    fct.close ();
+
+    // Tearing down thousands of leaves one object at a time is wasted work
+    // when the process is about to exit
+    if (fastExit)
+      {
+        SimulationTeardown::FastExit (linksOk ? 0 : 1, &std::cout);
+      }
+  }
+  SimulationTeardown::Destroy (&std::cout);
+
+  return linksOk ? 0 : 1;
+}
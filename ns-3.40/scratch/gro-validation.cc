@@ -0,0 +1,252 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// Check that receive coalescing cuts the events without changing the flows:
+//
+//   ./ns3 run "gro-validation --nLeaf=4 --bottleneckRate=900Mbps --tolerance=0.05"
+//
+// The same dumbbell, with --nLeaf bulk transfers (--tcpTypeId, BBR by
+// default) over 1000 Mbps edges, is simulated twice with the same run
+// number: without, then with PointToPointDumbbellHelper::
+// EnableReceiveCoalescing.  For each run the program prints the events
+// per simulated second and the mean queueing delay at the bottleneck;
+// then the event reduction and, for every flow, the relative difference
+// of the goodput (GoodputMeter), of the mean cwnd and pacing rate over
+// its rounds (BbrTimelineRecorder), and the median and 99th percentile
+// queueing delays at the bottleneck (BottleneckDelayProbe) of both runs.
+// It exits with 1 if a flow's goodput, cwnd or pacing rate differs by more
+// than --tolerance or one of its delay percentiles by more than
+// --delayTolerance, so it can be run as a check.
+//
+// Coalescing only merges segments that arrive closer than --groBudget, so
+// the bottleneck must be fast: behind 10 Mbps the segments are 1.2 ms
+// apart and nothing changes.
+
+#include "ns3/applications-module.h"
+#include "ns3/core-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/network-module.h"
+#include "ns3/point-to-point-module.h"
+#include "ns3/point-to-point-layout-module.h"
+#include "ns3/traffic-control-module.h"
+
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+using namespace ns3;
+
+// Results of one flow
+struct FlowResult
+{
+  double goodput = 0;
+  Time delayP50;
+  Time delayP99;
+  uint64_t rounds = 0;
+  double cwndSum = 0;
+  double pacingSum = 0;
+};
+
+// Results of one run
+struct RunResult
+{
+  uint64_t events;
+  std::vector<FlowResult> flows;
+  double meanDelay;
+};
+
+// Sum the cwnd and pacing rate of every round of a flow
+static void
+RecordRound (RunResult *result, const BbrTimelineRecorder::Record &record)
+{
+  if (record.event == BbrTimelineRecorder::ROUND_END && record.flowId < result->flows.size ())
+    {
+      FlowResult &flow = result->flows[record.flowId];
+      flow.rounds++;
+      flow.cwndSum += record.cwnd;
+      flow.pacingSum += record.pacingRate;
+    }
+}
+
+// Relative difference of b from a
+static double
+RelativeDiff (double a, double b)
+{
+  return a > 0 ? std::abs (b - a) / a : 0;
+}
+
+static RunResult
+RunOnce (bool gro, uint32_t nLeaf, std::string tcpTypeId, std::string bottleneckRate,
+         std::string bottleneckDelay, Time groBudget, Time stopTime, uint32_t run)
+{
+  RngSeedManager::SetRun (run);
+  Config::SetDefault ("ns3::TcpL4Protocol::SocketType", StringValue ("ns3::" + tcpTypeId));
+  Config::SetDefault ("ns3::TcpSocket::SndBufSize", UintegerValue (4194304));
+  Config::SetDefault ("ns3::TcpSocket::RcvBufSize", UintegerValue (6291456));
+  Config::SetDefault ("ns3::TcpSocket::InitialCwnd", UintegerValue (10));
+  Config::SetDefault ("ns3::TcpSocket::DelAckCount", UintegerValue (2));
+  Config::SetDefault ("ns3::TcpSocket::SegmentSize", UintegerValue (1448));
+
+  PointToPointHelper bottleneckLink;
+  bottleneckLink.SetDeviceAttribute ("DataRate", StringValue (bottleneckRate));
+  bottleneckLink.SetChannelAttribute ("Delay", StringValue (bottleneckDelay));
+  PointToPointHelper edgeLink;
+  edgeLink.SetDeviceAttribute ("DataRate", StringValue ("1000Mbps"));
+  edgeLink.SetChannelAttribute ("Delay", StringValue ("5ms"));
+
+  PointToPointDumbbellHelper d (nLeaf, edgeLink, nLeaf, edgeLink, bottleneckLink);
+  InternetStackHelper stack;
+  d.InstallStack (stack);
+  d.AssignIpv4Addresses (Ipv4AddressHelper ("10.1.0.0", "255.255.255.252"),
+                         Ipv4AddressHelper ("10.2.0.0", "255.255.255.252"),
+                         Ipv4AddressHelper ("10.3.0.0", "255.255.255.252"));
+  Ipv4GlobalRoutingHelper::PopulateRoutingTables ();
+  d.InstallBottleneckQueueDisc ("Fifo", QueueSize ("1000p"));
+  Ptr<BottleneckDelayProbe> probe = d.InstallBottleneckDelayProbe ();
+  Ptr<ReceiveCoalescer> coalescer;
+  if (gro)
+    {
+      coalescer = d.EnableReceiveCoalescing (groBudget);
+    }
+
+  RunResult result;
+  result.flows.resize (nLeaf);
+  Ptr<BbrTimelineRecorder> timeline = CreateObject<BbrTimelineRecorder> ();
+  timeline->TraceConnectWithoutContext ("Record", MakeBoundCallback (&RecordRound, &result));
+
+  uint16_t port = 50000;
+  ApplicationContainer sinks;
+  for (uint32_t i = 0; i < nLeaf; ++i)
+    {
+      BulkSendHelper source ("ns3::TcpSocketFactory", InetSocketAddress (d.GetRightIpv4Address (i), port));
+      source.SetAttribute ("MaxBytes", UintegerValue (0));
+      ApplicationContainer sourceApps = source.Install (d.GetLeft (i));
+      sourceApps.Start (Seconds (0.1 * i));
+      sourceApps.Stop (stopTime);
+      // The sender's only socket, tracked as flow i once it exists
+      Simulator::Schedule (Seconds (0.1 * i) + MilliSeconds (1), &BbrTimelineRecorder::TrackTcp,
+                           timeline, d.GetLeft (i)->GetId (), 0, 1448);
+      PacketSinkHelper sink ("ns3::TcpSocketFactory", InetSocketAddress (Ipv4Address::GetAny (), port));
+      sinks.Add (sink.Install (d.GetRight (i)));
+    }
+  sinks.Start (Seconds (0));
+  Ptr<GoodputMeter> meter = CreateObject<GoodputMeter> ();
+  meter->SetAttribute ("Interval", TimeValue (Seconds (0)));
+  meter->Install (sinks);
+  stack.AssignStreams (NodeContainer::GetGlobal (), 0);
+
+  Simulator::Stop (stopTime);
+  Simulator::Run ();
+
+  result.events = Simulator::GetEventCount ();
+  // One flow per sink; the meter numbers them in order of first arrival
+  for (uint32_t flowId = 0; flowId < meter->GetNFlows (); ++flowId)
+    {
+      InetSocketAddress sink = InetSocketAddress::ConvertFrom (meter->GetFlowRecord (flowId).destination);
+      for (uint32_t i = 0; i < nLeaf; ++i)
+        {
+          if (sink.GetIpv4 () == d.GetRightIpv4Address (i))
+            {
+              result.flows[i].goodput = meter->GetGoodput (flowId);
+            }
+        }
+    }
+  double delaySum = 0;
+  for (uint32_t flowId = 0; flowId < probe->GetNFlows (); ++flowId)
+    {
+      delaySum += probe->GetMeanDelay (flowId).GetSeconds ();
+      for (uint32_t i = 0; i < nLeaf; ++i)
+        {
+          if (probe->GetFlowTuple (flowId).destination == d.GetRightIpv4Address (i))
+            {
+              result.flows[i].delayP50 = probe->GetDelayPercentile (flowId, 50);
+              result.flows[i].delayP99 = probe->GetDelayPercentile (flowId, 99);
+            }
+        }
+    }
+  result.meanDelay = probe->GetNFlows () > 0 ? delaySum / probe->GetNFlows () : 0;
+
+  std::cout << (gro ? "With coalescing: " : "Without coalescing: ") << result.events << " events ("
+            << result.events / stopTime.GetSeconds () << " per simulated second), mean queueing delay "
+            << result.meanDelay * 1e3 << " ms" << std::endl;
+  if (coalescer)
+    {
+      coalescer->Report (std::cout);
+      NS_ABORT_MSG_IF (coalescer->GetBypassedPackets () > 0,
+                       "Packets bypassed the coalescer; the comparison is invalid");
+    }
+  DumbbellScenario::Reset ();
+  return result;
+}
+
+int
+main (int argc, char *argv[])
+{
+  uint32_t nLeaf = 4;
+  std::string tcpTypeId = "TcpBbr";
+  std::string bottleneckRate = "900Mbps";
+  std::string bottleneckDelay = "10ms";
+  Time groBudget = MicroSeconds (50);
+  Time stopTime = Seconds (10);
+  double tolerance = 0.05;
+  Time delayTolerance = MilliSeconds (1);
+  uint32_t run = 1;
+
+  CommandLine cmd (__FILE__);
+  cmd.AddValue ("nLeaf", "Number of bulk transfers", nLeaf);
+  cmd.AddValue ("tcpTypeId", "Transport protocol to use: TcpNewReno, TcpBbr", tcpTypeId);
+  cmd.AddValue ("bottleneckRate", "Bottleneck data rate", bottleneckRate);
+  cmd.AddValue ("bottleneckDelay", "Bottleneck delay", bottleneckDelay);
+  cmd.AddValue ("groBudget", "How long a segment may be held for coalescing", groBudget);
+  cmd.AddValue ("stopTime", "Simulation stop time", stopTime);
+  cmd.AddValue ("tolerance", "Maximum relative goodput, cwnd and pacing rate difference of a flow", tolerance);
+  cmd.AddValue ("delayTolerance", "Maximum queueing delay percentile difference of a flow", delayTolerance);
+  cmd.AddValue ("run", "Run number, the same for both runs", run);
+  cmd.Parse (argc, argv);
+  DumbbellScenario::KeepCommandLineDefaults (argc, argv);
+
+  RunResult base = RunOnce (false, nLeaf, tcpTypeId, bottleneckRate, bottleneckDelay, groBudget, stopTime, run);
+  RunResult gro = RunOnce (true, nLeaf, tcpTypeId, bottleneckRate, bottleneckDelay, groBudget, stopTime, run);
+
+  std::cout << "\nEvents: " << std::fixed << std::setprecision (1)
+            << 100.0 * (1 - double (gro.events) / base.events) << "% fewer with coalescing\n";
+  std::cout << std::left << std::setw (6) << "flow" << std::right << std::setw (12) << "Mbps"
+            << std::setw (12) << "Mbps (gro)" << std::setw (10) << "diff" << std::setw (10) << "cwnd"
+            << std::setw (10) << "pacing" << std::setw (16) << "p50 delay (ms)" << std::setw (16)
+            << "p99 delay (ms)" << "\n";
+  bool ok = true;
+  for (uint32_t i = 0; i < nLeaf; ++i)
+    {
+      const FlowResult &a = base.flows[i];
+      const FlowResult &b = gro.flows[i];
+      double diff = RelativeDiff (a.goodput, b.goodput);
+      double cwndDiff = a.rounds > 0 && b.rounds > 0 ? RelativeDiff (a.cwndSum / a.rounds, b.cwndSum / b.rounds) : 0;
+      double pacingDiff = a.rounds > 0 && b.rounds > 0 ? RelativeDiff (a.pacingSum / a.rounds, b.pacingSum / b.rounds) : 0;
+      ok = ok && diff <= tolerance && cwndDiff <= tolerance && pacingDiff <= tolerance
+           && Abs (b.delayP50 - a.delayP50) <= delayTolerance
+           && Abs (b.delayP99 - a.delayP99) <= delayTolerance;
+      std::cout << std::left << std::setw (6) << i << std::right << std::setprecision (2)
+                << std::setw (12) << a.goodput / 1e6 << std::setw (12) << b.goodput / 1e6
+                << std::setw (9) << 100 * diff << "%" << std::setw (9) << 100 * cwndDiff << "%"
+                << std::setw (9) << 100 * pacingDiff << "%" << std::setw (8) << a.delayP50.GetSeconds () * 1e3
+                << std::setw (8) << b.delayP50.GetSeconds () * 1e3 << std::setw (8)
+                << a.delayP99.GetSeconds () * 1e3 << std::setw (8) << b.delayP99.GetSeconds () * 1e3 << "\n";
+    }
+  std::cout << (ok ? "All flows within " : "Some flows beyond ") << 100 * tolerance << "% and "
+            << delayTolerance.GetSeconds () * 1e3 << " ms" << std::endl;
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,178 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// Per-packet forwarding microbenchmark of the dumbbell routers.
+//
+// For every leaf count of --leaves, a dumbbell with aggregated leaves is
+// built and the right router's Ipv4ListRouting::RouteInput is called
+// --lookups times for packets from the bottleneck towards random right
+// leaves, first with the default static and global routing and then with
+// an Ipv4CompiledRouting in front of them.  The right router reaches every
+// right leaf through its own access link, so both must pick the same
+// output interface and gateway for every destination; the cost per
+// lookup is printed for each.
+
+#include "ns3/core-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/network-module.h"
+#include "ns3/point-to-point-layout-module.h"
+#include "ns3/point-to-point-module.h"
+
+#include <chrono>
+#include <iostream>
+#include <set>
+#include <sstream>
+#include <utility>
+#include <vector>
+
+using namespace ns3;
+
+static uint32_t g_forwarded = 0;
+static std::pair<uint32_t, Ipv4Address> g_nextHop;
+
+static void
+Forward (Ptr<Ipv4Route> route, Ptr<const Packet> p, const Ipv4Header &header)
+{
+  g_forwarded++;
+  g_nextHop = {route->GetOutputDevice ()->GetIfIndex (), route->GetGateway ()};
+}
+
+// Returns the nanoseconds per lookup over the given destinations
+static double
+Measure (Ptr<Ipv4RoutingProtocol> routing, Ptr<const NetDevice> idev, Ipv4Address source,
+         const std::vector<Ipv4Address> &destinations,
+         std::vector<std::pair<uint32_t, Ipv4Address>> &nextHops)
+{
+  Ptr<Packet> p = Create<Packet> (1000);
+  Ipv4Header header;
+  header.SetSource (source);
+  header.SetProtocol (6);
+  header.SetTtl (64);
+  Ipv4RoutingProtocol::UnicastForwardCallback ucb = MakeCallback (&Forward);
+  Ipv4RoutingProtocol::MulticastForwardCallback mcb;
+  Ipv4RoutingProtocol::LocalDeliverCallback lcb;
+  Ipv4RoutingProtocol::ErrorCallback ecb;
+
+  g_forwarded = 0;
+  nextHops.resize (destinations.size ());
+  auto start = std::chrono::steady_clock::now ();
+  for (uint32_t i = 0; i < destinations.size (); ++i)
+    {
+      header.SetDestination (destinations[i]);
+      routing->RouteInput (p, header, idev, ucb, mcb, lcb, ecb);
+      nextHops[i] = g_nextHop;
+    }
+  auto end = std::chrono::steady_clock::now ();
+  NS_ABORT_MSG_UNLESS (g_forwarded == destinations.size (), "Some packets were not forwarded");
+  return std::chrono::duration<double, std::nano> (end - start).count () / destinations.size ();
+}
+
+int
+main (int argc, char *argv[])
+{
+  std::string leaves = "16,256,1024,4096";
+  uint32_t lookups = 1000000;
+
+  CommandLine cmd (__FILE__);
+  cmd.AddValue ("leaves", "Comma-separated leaf counts per side, one dumbbell each", leaves);
+  cmd.AddValue ("lookups", "Forwarding lookups per measurement", lookups);
+  cmd.Parse (argc, argv);
+
+  std::cout << "# leaves routes list(ns) compiled(ns) trie-nodes" << std::endl;
+
+  std::stringstream ss (leaves);
+  std::string field;
+  while (std::getline (ss, field, ','))
+    {
+      uint32_t nLeaf = std::stoul (field);
+
+      PointToPointHelper link;
+      link.SetDeviceAttribute ("DataRate", StringValue ("1Gbps"));
+      link.SetChannelAttribute ("Delay", StringValue ("1ms"));
+      PointToPointDumbbellHelper d (
+          std::vector<PointToPointDumbbellHelper::LeafLink> (
+              nLeaf, {DataRate ("1Gbps"), MilliSeconds (1)}),
+          std::vector<PointToPointDumbbellHelper::LeafLink> (
+              nLeaf, {DataRate ("1Gbps"), MilliSeconds (1)}),
+          link, link, PointToPointDumbbellHelper::AGGREGATE_BOTH);
+
+      InternetStackHelper stack;
+      d.InstallStack (stack);
+      // /30 leaf subnets, so that thousands of them fit in each side's /16
+      d.AssignIpv4Addresses (Ipv4AddressHelper ("10.1.0.0", "255.255.255.252"),
+                             Ipv4AddressHelper ("10.2.0.0", "255.255.255.252"),
+                             Ipv4AddressHelper ("10.3.0.0", "255.255.255.252"));
+      Ipv4GlobalRoutingHelper::PopulateRoutingTables ();
+
+      Ptr<UniformRandomVariable> leaf = CreateObject<UniformRandomVariable> ();
+      std::vector<Ipv4Address> destinations (lookups);
+      for (auto &destination : destinations)
+        {
+          destination = d.GetRightIpv4Address (leaf->GetInteger (0, nLeaf - 1));
+        }
+
+      Ptr<Node> router = d.GetRight ();
+      Ptr<Ipv4> ipv4 = router->GetObject<Ipv4> ();
+      Ptr<Ipv4RoutingProtocol> routing = ipv4->GetRoutingProtocol ();
+      // Packets arrive on the router end of the bottleneck
+      Ptr<const NetDevice> idev;
+      for (uint32_t i = 0; i < router->GetNDevices (); ++i)
+        {
+          Ptr<Channel> channel = router->GetDevice (i)->GetChannel ();
+          if (channel && channel->GetNDevices () == 2
+              && (channel->GetDevice (0)->GetNode () == d.GetLeft ()
+                  || channel->GetDevice (1)->GetNode () == d.GetLeft ()))
+            {
+              idev = router->GetDevice (i);
+            }
+        }
+      NS_ABORT_MSG_UNLESS (idev, "No bottleneck device on the right router");
+      Ipv4Address source = d.GetLeftIpv4Address (0);
+      Ptr<Ipv4GlobalRouting> global;
+      Ptr<Ipv4ListRouting> list = DynamicCast<Ipv4ListRouting> (routing);
+      for (uint32_t i = 0; i < list->GetNRoutingProtocols (); ++i)
+        {
+          int16_t priority;
+          global = global ? global
+                          : DynamicCast<Ipv4GlobalRouting> (list->GetRoutingProtocol (i, priority));
+        }
+
+      std::vector<std::pair<uint32_t, Ipv4Address>> listNextHops;
+      double listNs = Measure (routing, idev, source, destinations, listNextHops);
+      std::set<uint32_t> interfaces;
+      for (const auto &nextHop : listNextHops)
+        {
+          interfaces.insert (nextHop.first);
+        }
+      NS_ABORT_MSG_IF (nLeaf > 1 && interfaces.size () < 2,
+                       "All destinations leave through one interface; the check is void");
+
+      Ptr<Ipv4CompiledRouting> compiled = Ipv4CompiledRouting::Install (router);
+      std::vector<std::pair<uint32_t, Ipv4Address>> compiledNextHops;
+      double compiledNs = Measure (routing, idev, source, destinations, compiledNextHops);
+      NS_ABORT_MSG_UNLESS (listNextHops == compiledNextHops,
+                           "Compiled forwarding disagrees with the routing tables");
+
+      std::cout << nLeaf << " " << global->GetNRoutes () << " " << listNs << " " << compiledNs
+                << " " << compiled->GetNTrieNodes () << std::endl;
+
+      // Start the next size from an empty node list and address pool
+      Simulator::Destroy ();
+      Ipv4AddressGenerator::Reset ();
+    }
+
+  return 0;
+}
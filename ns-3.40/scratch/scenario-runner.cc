@@ -0,0 +1,145 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// Run a batch of dumbbell scenario files in one process:
+//
+//   ./ns3 run "scenario-runner scratch/tcp-bbr-example.ini scratch/dumbbell-quic.ini"
+//   ./ns3 run "scenario-runner --list=batch.txt --set=run.stopTime=5s"
+//
+// See ns3::DumbbellScenario for the file format.  Every scenario writes
+// its results to its own directory (bbr-results/scenarios/<name> unless
+// [run] dir is set); the simulator and the attribute defaults are reset
+// between scenarios, so a variation is a text edit, not a rebuild.
+// --set overrides keys of every scenario, e.g.
+// --set="transport.congestion=TcpNewReno;config.ns3::TcpSocket::DelAckCount=1".
+// Attribute defaults and global values given on the command line, e.g.
+// --ns3::TcpSocket::SegmentSize=1448, hold for every scenario of the batch,
+// below the [config] of each.
+//
+// With --cache, a scenario whose canonical text, attribute defaults and
+// build match an earlier run is not simulated again; its cached results
+// are copied to its output directory (see ns3::ScenarioResultCache).
+
+#include "ns3/core-module.h"
+#include "ns3/point-to-point-layout-module.h"
+
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+using namespace ns3;
+
+int
+main (int argc, char *argv[])
+{
+  std::string list = "";
+  std::string overrides = "";
+  bool cache = false;
+  std::string cacheDir = "bbr-results/cache";
+  uint64_t cacheMaxSize = 1 << 30;
+  bool cacheVerify = false;
+
+  CommandLine cmd (__FILE__);
+  cmd.Usage ("Run the scenario files given as arguments, one after the other.");
+  cmd.AddValue ("list", "File listing scenario files, one per line", list);
+  cmd.AddValue ("set", "Overrides applied to every scenario: \"section.key=value;...\"", overrides);
+  cmd.AddValue ("cache", "Reuse the results of identical earlier runs", cache);
+  cmd.AddValue ("cacheDir", "Result cache directory", cacheDir);
+  cmd.AddValue ("cacheMaxSize", "Result cache size limit in bytes, 0 for none", cacheMaxSize);
+  cmd.AddValue ("cacheVerify", "Run even on a cache hit and compare with the cached results", cacheVerify);
+  cmd.Parse (argc, argv);
+  DumbbellScenario::KeepCommandLineDefaults (argc, argv);
+
+  Ptr<ScenarioResultCache> resultCache;
+  if (cache)
+    {
+      resultCache = CreateObject<ScenarioResultCache> ();
+      resultCache->SetAttribute ("Directory", StringValue (cacheDir));
+      resultCache->SetAttribute ("MaxSize", UintegerValue (cacheMaxSize));
+      resultCache->SetAttribute ("Verify", BooleanValue (cacheVerify));
+    }
+  uint32_t failures = 0;
+
+  std::vector<std::string> files;
+  for (std::size_t i = 0; i < cmd.GetNExtraNonOptions (); ++i)
+    {
+      files.push_back (cmd.GetExtraNonOption (i));
+    }
+  if (!list.empty ())
+    {
+      std::ifstream is (list);
+      NS_ABORT_MSG_UNLESS (is.is_open (), "Cannot open scenario list " << list);
+      std::string line;
+      while (std::getline (is, line))
+        {
+          if (!line.empty () && line[0] != '#')
+            {
+              files.push_back (line);
+            }
+        }
+    }
+  NS_ABORT_MSG_IF (files.empty (), "No scenario to run");
+
+  auto batchStart = std::chrono::steady_clock::now ();
+  for (const auto &file : files)
+    {
+      DumbbellScenario scenario;
+      scenario.Load (file);
+
+      std::stringstream ss (overrides);
+      std::string assignment;
+      while (std::getline (ss, assignment, ';'))
+        {
+          // The section ends at the first '.', the key at the last '='
+          std::size_t dot = assignment.find ('.');
+          std::size_t equal = assignment.rfind ('=');
+          NS_ABORT_MSG_IF (dot == std::string::npos || equal == std::string::npos || equal < dot,
+                           "Malformed override \"" << assignment << "\"");
+          scenario.Set (assignment.substr (0, dot), assignment.substr (dot + 1, equal - dot - 1),
+                        assignment.substr (equal + 1));
+        }
+
+      auto start = std::chrono::steady_clock::now ();
+      if (resultCache)
+        {
+          std::ostringstream canonical;
+          scenario.Print (canonical);
+          resultCache->ComputeKey (canonical.str ());
+          if (resultCache->Lookup (scenario.GetOutputDirectory ()))
+            {
+              std::cout << "Scenario " << scenario.GetName () << ": cached results "
+                        << resultCache->GetKey () << std::endl;
+              std::cout << resultCache->GetSummary ();
+              continue;
+            }
+        }
+      std::ostringstream summary;
+      scenario.Run (&summary);
+      std::cout << summary.str ();
+      DumbbellScenario::Reset ();
+      if (resultCache && !resultCache->Store (scenario.GetOutputDirectory (), summary.str ()))
+        {
+          failures++;
+        }
+      std::chrono::duration<double> elapsed = std::chrono::steady_clock::now () - start;
+      std::cout << "  (" << elapsed.count () << " s wall clock)" << std::endl;
+    }
+  std::chrono::duration<double> total = std::chrono::steady_clock::now () - batchStart;
+  std::cout << files.size () << " scenarios in " << total.count () << " s" << std::endl;
+
+  return failures > 0 ? 1 : 0;
+}
@@ -32,7 +32,7 @@
 // This program runs by default for 100 seconds and creates a new directory
 // called 'bbr-results' in the ns-3 root directory. The program creates one
 // sub-directory called 'pcap' in 'bbr-results' directory (if pcap generation
-// is enabled) and three .dat files.
+// is enabled) and four .dat files.
 //
 // (1) 'pcap' sub-directory contains six PCAP files:
 //     * bbr-0-0.pcap for the interface on Sender
@@ -44,6 +44,9 @@
 // (2) cwnd.dat file contains congestion window trace for the sender node
 // (3) throughput.dat file contains sender side throughput trace
 // (4) queueSize.dat file contains queue length trace from the bottleneck link
+// (5) goodput.dat file contains receiver side goodput trace, i.e. the bytes
+//     delivered to the sink (see ns3::GoodputMeter); unlike throughput.dat
+//     it does not count the packets dropped at the bottleneck
 //
 // BBR algorithm enters PROBE_RTT phase in every 10 seconds. The congestion
 // window is fixed to 4 segments in this phase with a goal to achieve a better
@@ -52,6 +55,49 @@
 //
 // The congestion window and queue occupancy traces output by this program show
 // periodic drops every 10 seconds when BBR algorithm is in PROBE_RTT phase.
+//
+// With --bbrTimeline, the inferred BBR mode transitions (STARTUP/DRAIN/PROBE_BW),
+// gains, BtlBw and min-RTT estimates are recorded once per round into
+// 'bbr-timeline.bin' (see ns3::BbrTimelineRecorder for the format).
+//
+// With --cache, the results are stored in --cacheDir under a hash of the
+// command line, the attribute defaults and the build, and an identical
+// later run copies them and prints the same summary instead of simulating
+// (see ns3::ScenarioResultCache).
+//
+// With --liveMetrics=<name>, the throughput, cwnd, RTT and queue samples are
+// also published into the shared memory ring <name>, which
+// dumbbell-metrics-viewer can watch while the simulation runs.
+//
+// With --downsample=<width>, the .dat traces keep only the first, last,
+// minimum and maximum point of each <width> time bucket (see
+// ns3::DownsamplingSeriesWriter): the plots look the same, with exact
+// extremes, from far fewer points.  Pick the plotted duration divided by
+// the plot width in pixels, e.g. --downsample=100ms for 100 s on 1000
+// pixels.
+//
+// With --memoryAccounting, the memory held by nodes, devices, queues, sockets
+// and socket buffers, applications and the FlowMonitor is sampled every
+// second (see ns3::MemoryAccountant); 'memory-summary.txt' breaks down the
+// peak by subsystem and object type and 'memory-timeline.dat' has one line
+// per sample.
+//
+// With --gro, back-to-back in-order segments arriving at the receiver are
+// merged before its stack, within --groBudget (see ns3::ReceiveCoalescer),
+// which cuts the ACKs and the events.  The event count per simulated second
+// is printed at the end, so runs with and without --gro can be compared;
+// scratch/gro-validation.cc checks that the flows behave the same.  Merging
+// needs segments closer than the budget, i.e. a fast bottleneck: behind the
+// default 10 Mbps one they arrive 1.2 ms apart and are left alone.
+//
+// With --forkAt=<time> and --branches, the warm-up up to <time> is simulated
+// once, then the process forks one child per branch, each applying its
+// change and writing to its own sub-directory ('branch-<index>-<change>',
+// starting with a copy of the warm-up traces), with its own RNG run number
+// (see ns3::ScenarioForker).  A change is "rate=<DataRate>" or
+// "delay=<Time>" for the bottleneck link, or "flow" for a competing flow:
+//
+//   ./ns3 run "tcp-bbr-example --forkAt=20s --branches=rate=5Mbps,rate=20Mbps,flow"
 
 #include "ns3/core-module.h"
 #include "ns3/network-module.h"
@@ -60,12 +106,24 @@
 #include "ns3/applications-module.h"
 #include "ns3/traffic-control-module.h"
 #include "ns3/flow-monitor-module.h"
+#include "ns3/point-to-point-layout-module.h"
+
+#include <algorithm>
+#include <cctype>
+#include <sstream>
 
 using namespace ns3;
 
 std::string dir;
+Ptr<DownsamplingSeriesWriter> cwndWriter;
+Ptr<DownsamplingSeriesWriter> throughputWriter;
+Ptr<DownsamplingSeriesWriter> queueWriter;
+Ptr<DownsamplingSeriesWriter> goodputWriter;
 uint32_t prev = 0;
 Time prevTime = Seconds (0);
+Ptr<LiveMetricsPublisher> liveMetrics;
+uint32_t throughputSeries = 0;
+uint32_t queueSeries = 0;
 
 // Calculate throughput
 static void
@@ -74,37 +132,129 @@ TraceThroughput (Ptr<FlowMonitor> monitor)
   FlowMonitor::FlowStatsContainer stats = monitor->GetFlowStats();
   auto itr = stats.begin();
   Time curTime = Now();
-  std::ofstream thr(dir + "/throughput.dat", std::ios::out | std::ios::app);
 
   // Convert time to seconds and use GetSeconds()
-  thr << curTime.GetSeconds() << " " << 8 * (itr->second.txBytes - prev) / (1000 * 1000 * (curTime.GetSeconds() - prevTime.GetSeconds())) << std::endl;
+  double mbps = 8 * (itr->second.txBytes - prev) / (1000 * 1000 * (curTime.GetSeconds() - prevTime.GetSeconds()));
+  throughputWriter->Write (curTime, mbps);
+  if (liveMetrics)
+    {
+      liveMetrics->Publish (throughputSeries, mbps);
+    }
 
   prevTime = curTime;
   prev = itr->second.txBytes;
 
   Simulator::Schedule(Seconds(0.2), &TraceThroughput, monitor);}
 
+// Memory held by the FlowMonitor statistics
+static uint64_t
+FlowMonitorBytes (Ptr<FlowMonitor> monitor)
+{
+  const FlowMonitor::FlowStatsContainer &stats = monitor->GetFlowStats ();
+  return stats.size () * sizeof (FlowMonitor::FlowStats);
+}
+
 // Check the queue size
 void CheckQueueSize (Ptr<QueueDisc> qd)
 {
   uint32_t qsize = qd->GetCurrentSize ().GetValue ();
+  if (liveMetrics)
+    {
+      liveMetrics->Publish (queueSeries, qsize);
+    }
   Simulator::Schedule (Seconds (0.2), &CheckQueueSize, qd);
-  std::ofstream q (dir + "/queueSize.dat", std::ios::out | std::ios::app);
-  q << Simulator::Now ().GetSeconds () << " " << qsize << std::endl;
-  q.close ();
+  queueWriter->Write (Simulator::Now (), qsize);
+}
+
+// Trace the goodput of the sender's connection
+static void
+GoodputTracer (uint32_t flowId, double bps)
+{
+  if (flowId == 0)
+    {
+      goodputWriter->Write (Simulator::Now (), bps / 1e6);
+    }
 }
 
 // Trace congestion window
-static void CwndTracer (Ptr<OutputStreamWrapper> stream, uint32_t oldval, uint32_t newval)
+static void CwndTracer (uint32_t oldval, uint32_t newval)
 {
-  *stream->GetStream () << Simulator::Now ().GetSeconds () << " " << newval / 1448.0 << std::endl;
+  cwndWriter->Write (Simulator::Now (), newval / 1448.0);
 }
 
 void TraceCwnd (uint32_t nodeId, uint32_t socketId)
 {
-  AsciiTraceHelper ascii;
-  Ptr<OutputStreamWrapper> stream = ascii.CreateFileStream (dir + "/cwnd.dat");
-  Config::ConnectWithoutContext ("/NodeList/" + std::to_string (nodeId) + "/$ns3::TcpL4Protocol/SocketList/" + std::to_string (socketId) + "/CongestionWindow", MakeBoundCallback (&CwndTracer, stream));
+  Config::ConnectWithoutContext ("/NodeList/" + std::to_string (nodeId) + "/$ns3::TcpL4Protocol/SocketList/" + std::to_string (socketId) + "/CongestionWindow", MakeCallback (&CwndTracer));
+}
+
+// Flush the traces before forking
+static void FlushTraces ()
+{
+  cwndWriter->Flush ();
+  throughputWriter->Flush ();
+  queueWriter->Flush ();
+  goodputWriter->Flush ();
+}
+
+// Start a branch of --forkAt: move the outputs to the branch directory,
+// then apply the change of the branch
+static void
+StartBranch (std::string change, NetDeviceContainer bottleneck, Ptr<Node> sender,
+             Ptr<Node> receiver, Ipv4Address receiverAddress, Time stopTime,
+             Ptr<BbrTimelineRecorder> timeline, uint32_t branch)
+{
+  std::string name = change;
+  std::replace_if (name.begin (), name.end (), [] (char c) { return !std::isalnum (c) && c != '.'; }, '-');
+  std::string branchDir = dir + "branch-" + std::to_string (branch) + "-" + name + "/";
+  system (("mkdir -p " + branchDir).c_str ());
+  system (("cp " + dir + "*.dat " + branchDir).c_str ());
+  dir = branchDir;
+  cwndWriter->Open (dir + "cwnd.dat", true);
+  throughputWriter->Open (dir + "throughput.dat", true);
+  queueWriter->Open (dir + "queueSize.dat", true);
+  goodputWriter->Open (dir + "goodput.dat", true);
+  if (timeline)
+    {
+      timeline->SetOutputFile (dir + "bbr-timeline.bin");
+    }
+
+  // The forker has set the run number of the branch; re-assign the streams
+  // of the random variables created before the fork, or every branch would
+  // draw the same values from them
+  InternetStackHelper internet;
+  internet.AssignStreams (NodeContainer::GetGlobal (), 0);
+
+  std::string key = change.substr (0, change.find ('='));
+  std::string value = change.find ('=') == std::string::npos ? "" : change.substr (change.find ('=') + 1);
+  if (key == "rate")
+    {
+      for (uint32_t i = 0; i < bottleneck.GetN (); ++i)
+        {
+          DynamicCast<PointToPointNetDevice> (bottleneck.Get (i))->SetDataRate (DataRate (value));
+        }
+    }
+  else if (key == "delay")
+    {
+      bottleneck.Get (0)->GetChannel ()->SetAttribute ("Delay", TimeValue (Time (value)));
+    }
+  else if (key == "flow")
+    {
+      uint16_t port = 50002;
+      PacketSinkHelper sink ("ns3::TcpSocketFactory", InetSocketAddress (Ipv4Address::GetAny (), port));
+      ApplicationContainer sinkApps = sink.Install (receiver);
+      sinkApps.Start (Seconds (0));
+      sinkApps.Stop (stopTime - Simulator::Now ());
+      BulkSendHelper source ("ns3::TcpSocketFactory", InetSocketAddress (receiverAddress, port));
+      source.SetAttribute ("MaxBytes", UintegerValue (0));
+      ApplicationContainer sourceApps = source.Install (sender);
+      sourceApps.Start (Seconds (0));
+      sourceApps.Stop (stopTime - Simulator::Now ());
+    }
+  else
+    {
+      NS_ABORT_MSG ("Unknown branch change \"" << change << "\"");
+    }
+  std::cout << "Branch " << branch << " (" << change << ") writes to " << dir << std::endl;
 }
 
 int main (int argc, char *argv [])
@@ -123,15 +273,46 @@ int main (int argc, char *argv [])
   uint32_t delAckCount = 2;
   bool bql = true;
   bool enablePcap = false;
+  bool bbrTimeline = false;
   Time stopTime = Seconds (100);
+  bool cache = false;
+  std::string cacheDir = "bbr-results/cache";
+  uint64_t cacheMaxSize = 1 << 30;
+  bool cacheVerify = false;
+  std::string liveMetricsName = "";
+  Time forkAt = Seconds (0);
+  std::string branches = "";
+  uint32_t maxParallel = 0;
+  Time downsample = Seconds (0);
+  bool memoryAccounting = false;
+  bool gro = false;
+  Time groBudget = MicroSeconds (50);
 
   CommandLine cmd (__FILE__);
   cmd.AddValue ("tcpTypeId", "Transport protocol to use: TcpNewReno, TcpBbr", tcpTypeId);
   cmd.AddValue ("delAckCount", "Delayed ACK count", delAckCount);
   cmd.AddValue ("enablePcap", "Enable/Disable pcap file generation", enablePcap);
+  cmd.AddValue ("bbrTimeline", "Record the BBR state-machine timeline of the sender", bbrTimeline);
   cmd.AddValue ("stopTime", "Stop time for applications / simulation time will be stopTime + 1", stopTime);
+  cmd.AddValue ("cache", "Reuse the results of an identical earlier run", cache);
+  cmd.AddValue ("cacheDir", "Result cache directory", cacheDir);
+  cmd.AddValue ("cacheMaxSize", "Result cache size limit in bytes, 0 for none", cacheMaxSize);
+  cmd.AddValue ("cacheVerify", "Run even on a cache hit and compare with the cached results", cacheVerify);
+  cmd.AddValue ("liveMetrics", "Shared memory name to publish live metrics to, empty for none", liveMetricsName);
+  cmd.AddValue ("forkAt", "Fork into --branches at this time, 0 for no fork", forkAt);
+  cmd.AddValue ("branches", "Comma-separated changes of the branches: rate=<DataRate>, delay=<Time> or flow", branches);
+  cmd.AddValue ("maxParallel", "Maximum number of branches running at once, 0 for all", maxParallel);
+  cmd.AddValue ("downsample", "Keep the first, last, min and max point of each bucket of this width in the .dat traces, 0 for every point", downsample);
+  cmd.AddValue ("memoryAccounting", "Write a breakdown of the memory by subsystem and object type", memoryAccounting);
+  cmd.AddValue ("gro", "Coalesce the segments received by the receiver", gro);
+  cmd.AddValue ("groBudget", "How long --gro may hold a segment", groBudget);
   cmd.Parse (argc, argv);
 
+  bool forking = forkAt.IsStrictlyPositive ();
+  NS_ABORT_MSG_IF (forking && branches.empty (), "--forkAt needs --branches");
+  NS_ABORT_MSG_IF (forking && (cache || enablePcap || !liveMetricsName.empty ()),
+                   "--forkAt cannot be combined with --cache, --enablePcap or --liveMetrics");
+
   queueDisc = std::string ("ns3::") + queueDisc;
 
   Config::SetDefault ("ns3::TcpL4Protocol::SocketType", StringValue ("ns3::" + tcpTypeId));
@@ -196,6 +377,15 @@ int main (int argc, char *argv [])
   // Populate routing tables
   Ipv4GlobalRoutingHelper::PopulateRoutingTables ();
 
+  // Coalesce the data segments before the receiver's stack
+  Ptr<ReceiveCoalescer> coalescer;
+  if (gro)
+    {
+      coalescer = CreateObject<ReceiveCoalescer> ();
+      coalescer->SetAttribute ("Budget", TimeValue (groBudget));
+      coalescer->Install (receiverEdge.Get (1));
+    }
+
   // Select sender side port
   uint16_t port = 50001;
 
@@ -230,6 +420,35 @@ int main (int argc, char *argv [])
   system (("cp -R PlotScripts/gnuplotScriptThroughput " + dir).c_str ());
   system (("cp -R PlotScripts/gnuplotScriptQueueSize " + dir).c_str ());
 
+  // Skip the simulation if an identical run was already cached
+  Ptr<ScenarioResultCache> resultCache;
+  if (cache)
+    {
+      resultCache = CreateObject<ScenarioResultCache> ();
+      resultCache->SetAttribute ("Directory", StringValue (cacheDir));
+      resultCache->SetAttribute ("MaxSize", UintegerValue (cacheMaxSize));
+      resultCache->SetAttribute ("Verify", BooleanValue (cacheVerify));
+      resultCache->ComputeKey (argc, argv);
+      if (resultCache->Lookup (dir))
+        {
+          std::cout << resultCache->GetSummary ();
+          std::cout << "Cached results " << resultCache->GetKey () << " copied to " << dir << std::endl;
+          Simulator::Destroy ();
+          return 0;
+        }
+    }
+
+  // Open the .dat traces
+  for (Ptr<DownsamplingSeriesWriter> *writer : {&cwndWriter, &throughputWriter, &queueWriter, &goodputWriter})
+    {
+      *writer = CreateObject<DownsamplingSeriesWriter> ();
+      (*writer)->SetAttribute ("Bucket", TimeValue (downsample));
+    }
+  cwndWriter->Open (dir + "/cwnd.dat");
+  throughputWriter->Open (dir + "/throughput.dat");
+  queueWriter->Open (dir + "/queueSize.dat");
+  goodputWriter->Open (dir + "/goodput.dat");
+
   // Trace the queue occupancy on the second interface of R1
   tch.Uninstall (routers.Get (0)->GetDevice (1));
   QueueDiscContainer qd;
@@ -243,14 +462,106 @@ int main (int argc, char *argv [])
       bottleneckLink.EnablePcapAll (dir + "/pcap/bbr", true);
     }
 
+  // Record the BBR state-machine timeline of the sender socket
+  Ptr<BbrTimelineRecorder> timeline;
+  if (bbrTimeline)
+    {
+      timeline = CreateObject<BbrTimelineRecorder> ();
+      // A file opened now would be shared by the branches: each branch
+      // sets its own instead
+      if (!forking)
+        {
+          timeline->SetOutputFile (dir + "/bbr-timeline.bin");
+        }
+      Simulator::Schedule (Seconds (0.2), &BbrTimelineRecorder::TrackTcp, timeline, 0, 0, 1448);
+    }
+
+  // Publish live metrics for dumbbell-metrics-viewer
+  if (!liveMetricsName.empty ())
+    {
+      liveMetrics = CreateObject<LiveMetricsPublisher> ();
+      liveMetrics->SetAttribute ("Name", StringValue (liveMetricsName));
+      throughputSeries = liveMetrics->AddSeries ("sender throughput", LiveMetricsPublisher::THROUGHPUT);
+      queueSeries = liveMetrics->AddSeries ("R1 queue disc", LiveMetricsPublisher::QUEUE);
+      Simulator::Schedule (Seconds (0.2), &LiveMetricsPublisher::TraceTcpSocket, liveMetrics, 0, 0, 1448);
+    }
+
   // Check for dropped packets using Flow Monitor
   FlowMonitorHelper flowmon;
   Ptr<FlowMonitor> monitor = flowmon.InstallAll ();
   Simulator::Schedule (Seconds (0 + 0.000001), &TraceThroughput, monitor);
 
+  // Measure the goodput delivered to the sink
+  Ptr<GoodputMeter> goodput = CreateObject<GoodputMeter> ();
+  goodput->SetAttribute ("Interval", TimeValue (Seconds (0.2)));
+  goodput->TraceConnectWithoutContext ("Goodput", MakeCallback (&GoodputTracer));
+  goodput->Install (sinkApps);
+
+  // Account the memory of the simulation objects
+  Ptr<MemoryAccountant> memory;
+  if (memoryAccounting)
+    {
+      memory = CreateObject<MemoryAccountant> ();
+      memory->AddSubsystem ("flow monitor", MakeBoundCallback (&FlowMonitorBytes, monitor));
+      memory->Start ();
+    }
+
+  // Simulate the warm-up once, then continue in one child per branch
+  Ptr<ScenarioForker> forker;
+  if (forking)
+    {
+      forker = CreateObject<ScenarioForker> ();
+      forker->SetAttribute ("MaxParallel", UintegerValue (maxParallel));
+      std::stringstream ss (branches);
+      std::string change;
+      while (std::getline (ss, change, ','))
+        {
+          forker->AddBranch (change, MakeBoundCallback (&StartBranch, change, r1r2, sender.Get (0),
+                                                        receiver.Get (0), ir1.GetAddress (1),
+                                                        stopTime, timeline));
+        }
+      forker->AddFlushCallback (MakeCallback (&FlushTraces));
+      forker->ForkAt (forkAt);
+    }
+
   Simulator::Stop (stopTime + TimeStep (1));
   Simulator::Run ();
+  cwndWriter->Close ();
+  throughputWriter->Close ();
+  queueWriter->Close ();
+  goodputWriter->Close ();
+  // The summary is kept with the cached results, so that a hit prints it too
+  std::ostringstream summary;
+  goodput->Report (summary);
+  summary << "Events: " << Simulator::GetEventCount () << " ("
+          << Simulator::GetEventCount () / Simulator::Now ().GetSeconds ()
+          << " per simulated second)" << std::endl;
+  if (coalescer)
+    {
+      coalescer->Report (summary);
+    }
+  if (downsample.IsStrictlyPositive ())
+    {
+      summary << "cwnd.dat: " << cwndWriter->GetNPointsOut () << " of "
+              << cwndWriter->GetNPointsIn () << " points written" << std::endl;
+    }
+  if (timeline)
+    {
+      timeline->Dump ();
+    }
+  if (memory)
+    {
+      memory->Write (dir + "memory");
+      summary << "Memory accounted at the peak: " << memory->GetPeakBytes () / 1048576.0
+              << " MB, see " << dir << "memory-summary.txt" << std::endl;
+    }
+  std::cout << summary.str ();
   Simulator::Destroy ();
+  liveMetrics = nullptr;
+  if (resultCache && !resultCache->Store (dir, summary.str ()))
+    {
+      return 1;
+    }
 
   return 0;
 }
\ No newline at end of file
@@ -0,0 +1,311 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// Event and wall-clock cost of packet-train transmission on the leaf links.
+//
+//   ./ns3 run "train-batching-benchmark --leaves=2,100,1000 --stopTime=2s"
+//
+// For every leaf count of --leaves and every bottleneck rate of
+// --bottleneckRates, a dumbbell with --edgeRate leaf links carrying one
+// bulk TCP transfer per leaf pair is simulated twice with the same run
+// number: with PointToPointHelper leaf links (one transmit and one receive
+// event per packet), then with PointToPointTrainHelper leaf links
+// (PointToPointTrainNetDevice, one transmit event per train).  Each run
+// prints the events, the events per simulated second, the wall-clock time
+// and the bytes received, and train runs the mean train length of the left
+// leaves (train L, the data senders) and of the right router towards the
+// right leaves (train R, the data after the bottleneck).
+//
+// The default bottlenecks are narrower than the leaf links, as in the
+// dumbbell programs: the right router then forwards one packet at a time
+// from the bottleneck (train R near 1) and only the sender bursts queue on
+// the left leaves, so the train lengths show how much batching is left.
+// Trains only form where packets wait in the device queue, so the leaf
+// devices keep their default 100 packet queue; with a 1 packet queue in
+// front of a queue disc every train is a single packet.
+//
+// Unless --check=false, the program first sends the same bursts of raw
+// packets of mixed sizes over a plain link and over a train link, one of
+// them joining the queue while a train is on the wire, and compares the
+// PhyRxEnd and MacRx times at the receiver packet by packet.  It exits
+// with 1 at the first difference.
+
+#include "ns3/applications-module.h"
+#include "ns3/core-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/network-module.h"
+#include "ns3/point-to-point-layout-module.h"
+#include "ns3/point-to-point-module.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace ns3;
+
+// One receive trace call at the far end of the check link
+struct RxEvent
+{
+  std::string trace;
+  uint32_t size;
+  Time time;
+};
+
+static void
+RecordRx (std::vector<RxEvent> *events, std::string trace, Ptr<const Packet> packet)
+{
+  events->push_back ({trace, packet->GetSize (), Simulator::Now ()});
+}
+
+static void
+SendBurst (Ptr<NetDevice> device, uint32_t first, uint32_t count)
+{
+  for (uint32_t i = first; i < first + count; ++i)
+    {
+      device->Send (Create<Packet> (100 + (i * 379) % 1400), device->GetBroadcast (), 0x0800);
+    }
+}
+
+// Send the check bursts over one link and return its receive trace calls
+static std::vector<RxEvent>
+ReceiveTimes (bool trains)
+{
+  NodeContainer nodes;
+  nodes.Create (2);
+  NetDeviceContainer devices;
+  if (trains)
+    {
+      PointToPointTrainHelper link;
+      link.SetDeviceAttribute ("DataRate", StringValue ("1Gbps"));
+      link.SetDeviceAttribute ("InterframeGap", TimeValue (NanoSeconds (96)));
+      link.SetChannelAttribute ("Delay", StringValue ("1ms"));
+      devices = link.Install (nodes.Get (0), nodes.Get (1));
+    }
+  else
+    {
+      PointToPointHelper link;
+      link.SetDeviceAttribute ("DataRate", StringValue ("1Gbps"));
+      link.SetDeviceAttribute ("InterframeGap", TimeValue (NanoSeconds (96)));
+      link.SetChannelAttribute ("Delay", StringValue ("1ms"));
+      devices = link.Install (nodes.Get (0), nodes.Get (1));
+    }
+
+  std::vector<RxEvent> events;
+  devices.Get (1)->TraceConnectWithoutContext (
+      "PhyRxEnd", MakeBoundCallback (&RecordRx, &events, std::string ("PhyRxEnd")));
+  devices.Get (1)->TraceConnectWithoutContext (
+      "MacRx", MakeBoundCallback (&RecordRx, &events, std::string ("MacRx")));
+  // The second burst arrives while the first is on the wire, the third
+  // once the link is idle again
+  Simulator::Schedule (Seconds (0), &SendBurst, devices.Get (0), 0, 40);
+  Simulator::Schedule (MicroSeconds (50), &SendBurst, devices.Get (0), 40, 40);
+  Simulator::Schedule (MilliSeconds (5), &SendBurst, devices.Get (0), 80, 10);
+  Simulator::Run ();
+  DumbbellScenario::Reset ();
+  return events;
+}
+
+// Compare the receive times of the check bursts over plain and train links
+static bool
+CheckReceiveTimes ()
+{
+  std::vector<RxEvent> plain = ReceiveTimes (false);
+  std::vector<RxEvent> train = ReceiveTimes (true);
+  for (std::size_t i = 0; i < std::max (plain.size (), train.size ()); ++i)
+    {
+      if (i >= plain.size () || i >= train.size () || plain[i].trace != train[i].trace
+          || plain[i].size != train[i].size || plain[i].time != train[i].time)
+        {
+          std::cout << "Receive times differ at call " << i << " of " << plain.size ()
+                    << " (plain) and " << train.size () << " (train)";
+          if (i < plain.size () && i < train.size ())
+            {
+              std::cout << ": " << plain[i].trace << " of " << plain[i].size << " bytes at "
+                        << plain[i].time.As (Time::NS) << " vs " << train[i].trace << " of "
+                        << train[i].size << " bytes at " << train[i].time.As (Time::NS);
+            }
+          std::cout << std::endl;
+          return false;
+        }
+    }
+  std::cout << "Receive times match for " << plain.size () << " trace calls" << std::endl;
+  return true;
+}
+
+// Add the trains and packets sent by the train devices of a node
+static void
+CountTrains (Ptr<Node> node, uint64_t &nTrains, uint64_t &nPackets)
+{
+  for (uint32_t i = 0; i < node->GetNDevices (); ++i)
+    {
+      Ptr<PointToPointTrainNetDevice> device =
+          DynamicCast<PointToPointTrainNetDevice> (node->GetDevice (i));
+      if (device)
+        {
+          nTrains += device->GetNTrains ();
+          nPackets += device->GetNPackets ();
+        }
+    }
+}
+
+static void
+RunOnce (bool trains, uint32_t nLeaf, std::string edgeRate, std::string bottleneckRate,
+         Time stopTime, uint32_t run)
+{
+  RngSeedManager::SetRun (run);
+  Config::SetDefault ("ns3::TcpSocket::SndBufSize", UintegerValue (4194304));
+  Config::SetDefault ("ns3::TcpSocket::RcvBufSize", UintegerValue (6291456));
+  Config::SetDefault ("ns3::TcpSocket::SegmentSize", UintegerValue (1448));
+
+  PointToPointHelper bottleneckLink;
+  bottleneckLink.SetDeviceAttribute ("DataRate", StringValue (bottleneckRate));
+  bottleneckLink.SetChannelAttribute ("Delay", StringValue ("10ms"));
+
+  auto start = std::chrono::steady_clock::now ();
+  std::unique_ptr<PointToPointDumbbellHelper> d;
+  if (trains)
+    {
+      PointToPointTrainHelper edgeLink;
+      edgeLink.SetDeviceAttribute ("DataRate", StringValue (edgeRate));
+      edgeLink.SetChannelAttribute ("Delay", StringValue ("1ms"));
+      d = std::make_unique<PointToPointDumbbellHelper> (nLeaf, edgeLink, nLeaf, edgeLink,
+                                                        bottleneckLink);
+    }
+  else
+    {
+      PointToPointHelper edgeLink;
+      edgeLink.SetDeviceAttribute ("DataRate", StringValue (edgeRate));
+      edgeLink.SetChannelAttribute ("Delay", StringValue ("1ms"));
+      d = std::make_unique<PointToPointDumbbellHelper> (nLeaf, edgeLink, nLeaf, edgeLink,
+                                                        bottleneckLink);
+    }
+
+  InternetStackHelper stack;
+  d->InstallStack (stack);
+  // /30 leaf subnets, so that thousands of them fit in each side's /16
+  d->AssignIpv4Addresses (Ipv4AddressHelper ("10.1.0.0", "255.255.255.252"),
+                          Ipv4AddressHelper ("10.2.0.0", "255.255.255.252"),
+                          Ipv4AddressHelper ("10.3.0.0", "255.255.255.252"));
+  Ipv4GlobalRoutingHelper::PopulateRoutingTables ();
+
+  uint16_t port = 50000;
+  ApplicationContainer sinks;
+  Ptr<UniformRandomVariable> jitter = CreateObject<UniformRandomVariable> ();
+  for (uint32_t i = 0; i < nLeaf; ++i)
+    {
+      BulkSendHelper source ("ns3::TcpSocketFactory", InetSocketAddress (d->GetRightIpv4Address (i), port));
+      source.SetAttribute ("MaxBytes", UintegerValue (0));
+      ApplicationContainer sourceApps = source.Install (d->GetLeft (i));
+      sourceApps.Start (Seconds (jitter->GetValue (0, 0.1)));
+      sourceApps.Stop (stopTime);
+      PacketSinkHelper sink ("ns3::TcpSocketFactory", InetSocketAddress (Ipv4Address::GetAny (), port));
+      sinks.Add (sink.Install (d->GetRight (i)));
+    }
+  sinks.Start (Seconds (0));
+  stack.AssignStreams (NodeContainer::GetGlobal (), 0);
+
+  Simulator::Stop (stopTime);
+  Simulator::Run ();
+  auto end = std::chrono::steady_clock::now ();
+
+  uint64_t events = Simulator::GetEventCount ();
+  uint64_t rxBytes = 0;
+  for (uint32_t i = 0; i < sinks.GetN (); ++i)
+    {
+      rxBytes += DynamicCast<PacketSink> (sinks.Get (i))->GetTotalRx ();
+    }
+  // Data leaves the senders in bursts, and the right router in the
+  // bottleneck's pace
+  uint64_t senderTrains = 0;
+  uint64_t senderPackets = 0;
+  for (uint32_t i = 0; i < nLeaf; ++i)
+    {
+      CountTrains (d->GetLeft (i), senderTrains, senderPackets);
+    }
+  uint64_t routerTrains = 0;
+  uint64_t routerPackets = 0;
+  CountTrains (d->GetRight (), routerTrains, routerPackets);
+
+  std::cout << std::left << std::setw (8) << nLeaf << std::setw (12) << bottleneckRate
+            << std::setw (8) << (trains ? "train" : "packet") << std::right << std::setw (14)
+            << events
+            << std::setw (16) << uint64_t (events / stopTime.GetSeconds ()) << std::fixed
+            << std::setprecision (2) << std::setw (10)
+            << std::chrono::duration<double> (end - start).count () << std::setw (14) << rxBytes;
+  if (senderTrains > 0 && routerTrains > 0)
+    {
+      std::cout << std::setw (10) << double (senderPackets) / senderTrains << std::setw (10)
+                << double (routerPackets) / routerTrains;
+    }
+  std::cout << std::endl;
+
+  d.reset ();
+  DumbbellScenario::Reset ();
+}
+
+int
+main (int argc, char *argv[])
+{
+  std::string leaves = "2,100,1000";
+  std::string edgeRate = "1000Mbps";
+  std::string bottleneckRates = "100Mbps,500Mbps,900Mbps";
+  Time stopTime = Seconds (2);
+  uint32_t run = 1;
+  bool check = true;
+
+  CommandLine cmd (__FILE__);
+  cmd.AddValue ("leaves", "Comma-separated leaf counts per side, one dumbbell each", leaves);
+  cmd.AddValue ("edgeRate", "Leaf link data rate", edgeRate);
+  cmd.AddValue ("bottleneckRates", "Comma-separated bottleneck data rates, one dumbbell each",
+                bottleneckRates);
+  cmd.AddValue ("stopTime", "Simulation stop time", stopTime);
+  cmd.AddValue ("run", "Run number, the same for both runs of a leaf count", run);
+  cmd.AddValue ("check", "First compare the receive times of plain and train links", check);
+  cmd.Parse (argc, argv);
+  DumbbellScenario::KeepCommandLineDefaults (argc, argv);
+
+  if (check && !CheckReceiveTimes ())
+    {
+      return 1;
+    }
+
+  std::cout << std::left << std::setw (8) << "leaves" << std::setw (12) << "bottleneck"
+            << std::setw (8) << "mode" << std::right
+            << std::setw (14) << "events" << std::setw (16) << "events/sim-s" << std::setw (10)
+            << "wall(s)" << std::setw (14) << "rx bytes" << std::setw (10) << "train L"
+            << std::setw (10) << "train R" << std::endl;
+
+  std::stringstream ss (leaves);
+  std::string field;
+  while (std::getline (ss, field, ','))
+    {
+      uint32_t nLeaf = std::stoul (field);
+      std::stringstream rates (bottleneckRates);
+      std::string bottleneckRate;
+      while (std::getline (rates, bottleneckRate, ','))
+        {
+          RunOnce (false, nLeaf, edgeRate, bottleneckRate, stopTime, run);
+          RunOnce (true, nLeaf, edgeRate, bottleneckRate, stopTime, run);
+        }
+    }
+
+  return 0;
+}
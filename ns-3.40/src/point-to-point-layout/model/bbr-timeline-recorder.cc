@@ -0,0 +1,428 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// Implement a recorder for the BBR state-machine timeline of many flows.
+
+#include "bbr-timeline-recorder.h"
+
+#include "ns3/abort.h"
+#include "ns3/config.h"
+#include "ns3/log.h"
+#include "ns3/simulator.h"
+#include "ns3/uinteger.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace ns3
+{
+
+NS_LOG_COMPONENT_DEFINE("BbrTimelineRecorder");
+
+NS_OBJECT_ENSURE_REGISTERED(BbrTimelineRecorder);
+
+static_assert(sizeof(BbrTimelineRecorder::Record) == 64,
+              "Record is expected to fill exactly one cache line");
+
+TypeId
+BbrTimelineRecorder::GetTypeId()
+{
+    static TypeId tid =
+        TypeId("ns3::BbrTimelineRecorder")
+            .SetParent<Object>()
+            .SetGroupName("PointToPointLayout")
+            .AddConstructor<BbrTimelineRecorder>()
+            .AddAttribute("Capacity",
+                          "Number of records in the ring of every flow",
+                          UintegerValue(4096),
+                          MakeUintegerAccessor(&BbrTimelineRecorder::m_capacity),
+                          MakeUintegerChecker<uint32_t>(1))
+            .AddAttribute("BtlBwRounds",
+                          "Length of the BtlBw max filter, in rounds",
+                          UintegerValue(10),
+                          MakeUintegerAccessor(&BbrTimelineRecorder::m_btlBwRounds),
+                          MakeUintegerChecker<uint32_t>(1))
+            .AddAttribute("MinRttWindow",
+                          "Length of the min-RTT filter",
+                          TimeValue(Seconds(10)),
+                          MakeTimeAccessor(&BbrTimelineRecorder::m_minRttWindow),
+                          MakeTimeChecker())
+            .AddAttribute("ModeRounds",
+                          "Consecutive rounds with a PROBE_BW pacing gain needed to "
+                          "leave STARTUP without going through DRAIN",
+                          UintegerValue(2),
+                          MakeUintegerAccessor(&BbrTimelineRecorder::m_modeRounds),
+                          MakeUintegerChecker<uint32_t>(1))
+            .AddAttribute("MaxPacingRate",
+                          "Pacing rate cap of the tracked sockets; zero if none",
+                          DataRateValue(DataRate(0)),
+                          MakeDataRateAccessor(&BbrTimelineRecorder::m_maxPacingRate),
+                          MakeDataRateChecker())
+            .AddTraceSource("Record",
+                            "A timeline record was appended",
+                            MakeTraceSourceAccessor(&BbrTimelineRecorder::m_recordTrace),
+                            "ns3::BbrTimelineRecorder::RecordTracedCallback");
+    return tid;
+}
+
+BbrTimelineRecorder::BbrTimelineRecorder()
+    : m_capacity(4096),
+      m_btlBwRounds(10),
+      m_modeRounds(2)
+{
+    NS_LOG_FUNCTION(this);
+}
+
+BbrTimelineRecorder::~BbrTimelineRecorder()
+{
+    NS_LOG_FUNCTION(this);
+}
+
+void
+BbrTimelineRecorder::DoDispose()
+{
+    NS_LOG_FUNCTION(this);
+    if (m_file.is_open())
+    {
+        m_file.close();
+    }
+    m_flows.clear();
+    Object::DoDispose();
+}
+
+uint32_t
+BbrTimelineRecorder::Track(std::string socketPath, uint32_t segmentSize)
+{
+    NS_LOG_FUNCTION(this << socketPath << segmentSize);
+    uint32_t flowId = m_flows.size();
+    m_flows.emplace_back();
+    FlowState& flow = m_flows.back();
+    flow.segmentSize = segmentSize;
+    flow.bwSamples.assign(m_btlBwRounds, 0);
+    flow.ring.resize(m_capacity);
+
+    std::vector<std::pair<std::string, CallbackBase>> sinks = {
+        {"/CongestionWindow", MakeCallback(&BbrTimelineRecorder::CwndChange, this).Bind(flowId)},
+        {"/PacingRate", MakeCallback(&BbrTimelineRecorder::PacingRateChange, this).Bind(flowId)},
+        {"/RTT", MakeCallback(&BbrTimelineRecorder::RttChange, this).Bind(flowId)},
+        {"/HighestSequence",
+         MakeCallback(&BbrTimelineRecorder::HighestSequenceChange, this).Bind(flowId)},
+        {"/HighestRxAck",
+         MakeCallback(&BbrTimelineRecorder::HighestRxAckChange, this).Bind(flowId)},
+    };
+    std::size_t connected = 0;
+    while (connected < sinks.size() &&
+           Config::ConnectWithoutContextFailSafe(socketPath + sinks[connected].first,
+                                                 sinks[connected].second))
+    {
+        connected++;
+    }
+    if (connected < sinks.size())
+    {
+        // A partial model would be wrong: leave the flow without records
+        NS_LOG_WARN("Not tracking " << socketPath << ": no " << sinks[connected].first
+                                    << " trace source");
+        for (std::size_t i = 0; i < connected; ++i)
+        {
+            Config::DisconnectWithoutContext(socketPath + sinks[i].first, sinks[i].second);
+        }
+    }
+    return flowId;
+}
+
+uint32_t
+BbrTimelineRecorder::TrackTcp(uint32_t nodeId, uint32_t socketId, uint32_t segmentSize)
+{
+    return Track("/NodeList/" + std::to_string(nodeId) + "/$ns3::TcpL4Protocol/SocketList/" +
+                     std::to_string(socketId),
+                 segmentSize);
+}
+
+uint32_t
+BbrTimelineRecorder::TrackQuic(uint32_t nodeId, uint32_t socketId, uint32_t segmentSize)
+{
+    return Track("/NodeList/" + std::to_string(nodeId) + "/$ns3::QuicL4Protocol/SocketList/" +
+                     std::to_string(socketId) + "/QuicSocketBase",
+                 segmentSize);
+}
+
+void
+BbrTimelineRecorder::CwndChange(uint32_t flowId, uint32_t oldValue, uint32_t newValue)
+{
+    m_flows[flowId].cwnd = newValue;
+}
+
+void
+BbrTimelineRecorder::PacingRateChange(uint32_t flowId, DataRate oldValue, DataRate newValue)
+{
+    m_flows[flowId].pacingRate = newValue.GetBitRate();
+}
+
+void
+BbrTimelineRecorder::RttChange(uint32_t flowId, Time oldValue, Time newValue)
+{
+    FlowState& flow = m_flows[flowId];
+    int64_t now = Simulator::Now().GetNanoSeconds();
+    int64_t rtt = newValue.GetNanoSeconds();
+    if (rtt <= 0)
+    {
+        return;
+    }
+    if (flow.minRtt == 0 || rtt <= flow.minRtt ||
+        now - flow.minRttStamp > m_minRttWindow.GetNanoSeconds())
+    {
+        flow.minRtt = rtt;
+        flow.minRttStamp = now;
+    }
+}
+
+void
+BbrTimelineRecorder::HighestSequenceChange(uint32_t flowId,
+                                           SequenceNumber32 oldValue,
+                                           SequenceNumber32 newValue)
+{
+    FlowState& flow = m_flows[flowId];
+    flow.highestSent = newValue;
+    if (!flow.roundStarted)
+    {
+        flow.roundStarted = true;
+        flow.roundEnd = newValue;
+        flow.roundStartAck = oldValue;
+        flow.roundStartTime = Simulator::Now().GetNanoSeconds();
+    }
+}
+
+void
+BbrTimelineRecorder::HighestRxAckChange(uint32_t flowId,
+                                        SequenceNumber32 oldValue,
+                                        SequenceNumber32 newValue)
+{
+    FlowState& flow = m_flows[flowId];
+    if (!flow.roundStarted || newValue < flow.roundEnd)
+    {
+        return;
+    }
+
+    // The round is over: take one delivery-rate sample for it
+    int64_t now = Simulator::Now().GetNanoSeconds();
+    int64_t elapsed = now - flow.roundStartTime;
+    if (elapsed > 0)
+    {
+        uint64_t delivered = static_cast<uint32_t>(newValue - flow.roundStartAck);
+        uint64_t rate = delivered * 8 * 1000000000ULL / static_cast<uint64_t>(elapsed);
+        flow.bwSamples[flow.round % flow.bwSamples.size()] = rate;
+        flow.btlBw = *std::max_element(flow.bwSamples.begin(), flow.bwSamples.end());
+    }
+    flow.round++;
+    flow.roundEnd = flow.highestSent;
+    flow.roundStartAck = newValue;
+    flow.roundStartTime = now;
+
+    UpdateMode(flowId);
+    Append(flowId, ROUND_END);
+}
+
+double
+BbrTimelineRecorder::PacingGain(const FlowState& flow) const
+{
+    if (flow.btlBw == 0)
+    {
+        return 0;
+    }
+    return static_cast<double>(flow.pacingRate) / flow.btlBw;
+}
+
+double
+BbrTimelineRecorder::CwndGain(const FlowState& flow) const
+{
+    double bdp = static_cast<double>(flow.btlBw) / 8 * flow.minRtt / 1e9;
+    if (bdp <= 0)
+    {
+        return 0;
+    }
+    return flow.cwnd / bdp;
+}
+
+void
+BbrTimelineRecorder::UpdateMode(uint32_t flowId)
+{
+    FlowState& flow = m_flows[flowId];
+    double pacingGain = PacingGain(flow);
+    // A capped pacing rate hides the gain; so does a missing BtlBw sample
+    bool capped = m_maxPacingRate.GetBitRate() != 0 &&
+                  flow.pacingRate >= m_maxPacingRate.GetBitRate();
+    bool gainKnown = !capped && pacingGain != 0;
+
+    Mode mode = flow.mode;
+    if (flow.mode == STARTUP && gainKnown)
+    {
+        if (pacingGain < 0.6)
+        {
+            mode = DRAIN;
+        }
+        else if (pacingGain <= 2)
+        {
+            // Without a DRAIN round, require a few PROBE_BW-like rounds
+            flow.candidateRounds = (flow.candidate == PROBE_BW) ? flow.candidateRounds + 1 : 1;
+            flow.candidate = PROBE_BW;
+            if (flow.candidateRounds >= m_modeRounds)
+            {
+                mode = PROBE_BW;
+            }
+        }
+        else
+        {
+            flow.candidate = STARTUP;
+            flow.candidateRounds = 0;
+        }
+    }
+    else if (flow.mode == DRAIN && gainKnown && pacingGain >= 0.6)
+    {
+        mode = PROBE_BW;
+    }
+
+    if (mode != flow.mode)
+    {
+        NS_LOG_LOGIC("Flow " << flowId << " " << ModeName(flow.mode) << " -> "
+                             << ModeName(mode));
+        flow.mode = mode;
+        flow.candidate = mode;
+        flow.candidateRounds = 0;
+        Append(flowId, TRANSITION);
+    }
+}
+
+void
+BbrTimelineRecorder::Append(uint32_t flowId, Event event)
+{
+    FlowState& flow = m_flows[flowId];
+    if (flow.count == flow.ring.size())
+    {
+        if (m_file.is_open())
+        {
+            Spill(flow);
+        }
+        else
+        {
+            // Overwrite the oldest record
+            flow.head = (flow.head + 1) % flow.ring.size();
+            flow.count--;
+        }
+    }
+
+    Record& record = flow.ring[(flow.head + flow.count) % flow.ring.size()];
+    record.time = Simulator::Now().GetNanoSeconds();
+    record.pacingRate = flow.pacingRate;
+    record.btlBw = flow.btlBw;
+    record.minRtt = flow.minRtt;
+    record.round = flow.round;
+    record.cwnd = flow.cwnd;
+    record.pacingGain = static_cast<float>(PacingGain(flow));
+    record.cwndGain = static_cast<float>(CwndGain(flow));
+    record.flowId = flowId;
+    record.mode = flow.mode;
+    record.event = event;
+    record.reserved = 0;
+    flow.count++;
+
+    m_recordTrace(record);
+}
+
+void
+BbrTimelineRecorder::Spill(FlowState& flow)
+{
+    for (uint32_t i = 0; i < flow.count; ++i)
+    {
+        const Record& record = flow.ring[(flow.head + i) % flow.ring.size()];
+        m_file.write(reinterpret_cast<const char*>(&record), sizeof(Record));
+    }
+    flow.head = 0;
+    flow.count = 0;
+}
+
+void
+BbrTimelineRecorder::OpenFile(std::string filename)
+{
+    m_file.open(filename, std::ios::out | std::ios::binary);
+    NS_ABORT_MSG_UNLESS(m_file.is_open(), "Cannot open BBR timeline file " << filename);
+    uint32_t version = 1;
+    uint32_t recordSize = sizeof(Record);
+    m_file.write("NS3BBRTL", 8);
+    m_file.write(reinterpret_cast<const char*>(&version), sizeof(version));
+    m_file.write(reinterpret_cast<const char*>(&recordSize), sizeof(recordSize));
+}
+
+void
+BbrTimelineRecorder::SetOutputFile(std::string filename)
+{
+    NS_LOG_FUNCTION(this << filename);
+    NS_ABORT_MSG_IF(m_file.is_open(), "BBR timeline output file already set");
+    OpenFile(filename);
+}
+
+void
+BbrTimelineRecorder::Dump(std::string filename)
+{
+    NS_LOG_FUNCTION(this << filename);
+    if (!m_file.is_open())
+    {
+        NS_ABORT_MSG_IF(filename.empty(), "No BBR timeline output file");
+        OpenFile(filename);
+    }
+    for (auto& flow : m_flows)
+    {
+        Spill(flow);
+    }
+    m_file.close();
+}
+
+uint32_t
+BbrTimelineRecorder::GetNFlows() const
+{
+    return m_flows.size();
+}
+
+std::vector<BbrTimelineRecorder::Record>
+BbrTimelineRecorder::GetRecords(uint32_t flowId) const
+{
+    NS_ASSERT(flowId < m_flows.size());
+    const FlowState& flow = m_flows[flowId];
+    std::vector<Record> records;
+    records.reserve(flow.count);
+    for (uint32_t i = 0; i < flow.count; ++i)
+    {
+        records.push_back(flow.ring[(flow.head + i) % flow.ring.size()]);
+    }
+    return records;
+}
+
+std::string
+BbrTimelineRecorder::ModeName(Mode mode)
+{
+    switch (mode)
+    {
+    case STARTUP:
+        return "STARTUP";
+    case DRAIN:
+        return "DRAIN";
+    case PROBE_BW:
+        return "PROBE_BW";
+    case PROBE_RTT:
+        return "PROBE_RTT";
+    }
+    return "UNKNOWN";
+}
+
+} // namespace ns3
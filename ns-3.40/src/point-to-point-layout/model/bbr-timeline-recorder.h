@@ -0,0 +1,316 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// Define a recorder for the BBR state-machine timeline of many flows.
+
+#ifndef BBR_TIMELINE_RECORDER_H
+#define BBR_TIMELINE_RECORDER_H
+
+#include "ns3/data-rate.h"
+#include "ns3/nstime.h"
+#include "ns3/object.h"
+#include "ns3/sequence-number.h"
+#include "ns3/traced-callback.h"
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * \ingroup point-to-point-layout
+ *
+ * \brief Record the BBR state-machine timeline of TCP or QUIC flows into
+ * per-flow binary rings.
+ *
+ * The recorder connects to the standard socket trace sources
+ * (CongestionWindow, PacingRate, RTT, HighestSequence and HighestRxAck)
+ * of every tracked socket and reconstructs the BBR model from them:
+ *
+ * - BtlBw is the windowed maximum of the per-round delivery rate over
+ *   the last BtlBwRounds rounds;
+ * - min-RTT is the windowed minimum of the RTT samples over
+ *   MinRttWindow;
+ * - a round ends when the cumulative ACK passes the highest sequence
+ *   number sent when the round started;
+ * - the pacing gain is PacingRate / BtlBw and the cwnd gain is
+ *   cwnd / (BtlBw * min-RTT).
+ *
+ * The mode is inferred, not read from the congestion control, which does
+ * not export it.  It is classified once per round, at the round end, and
+ * only along the transitions of the BBR state machine:
+ *
+ * - STARTUP moves to DRAIN when the pacing gain falls below 0.6, or to
+ *   PROBE_BW when it stays between 0.6 and 2 for ModeRounds rounds;
+ * - DRAIN moves to PROBE_BW when the pacing gain is back above 0.6;
+ * - PROBE_BW never goes back to STARTUP or DRAIN, so its 0.75 phase and
+ *   noisy rate samples do not change the mode.
+ *
+ * PROBE_RTT is never inferred: its only visible sign, a cwnd of four
+ * segments, is shared with loss recovery and retransmission timeouts.
+ * The cwnd column shows it instead.  While the pacing rate is held at
+ * MaxPacingRate the pacing gain is meaningless and the mode does not
+ * change; set MaxPacingRate to the cap of the sockets.
+ *
+ * One ROUND_END record is appended at the end of every round, preceded by
+ * a TRANSITION record when the mode changed in that round, never per ACK.
+ * Each flow owns a fixed-capacity ring;
+ * when a ring is full it is either spilled to the output file (if one
+ * was set with SetOutputFile) or overwritten from its oldest record.
+ *
+ * The binary file starts with the magic "NS3BBRTL", a uint32 version
+ * and a uint32 record size, followed by Record structures in host byte
+ * order.
+ */
+class BbrTimelineRecorder : public Object
+{
+  public:
+    /**
+     * \brief Get the type ID.
+     * \return the object TypeId
+     */
+    static TypeId GetTypeId();
+
+    BbrTimelineRecorder();
+    ~BbrTimelineRecorder() override;
+
+    /// BBR state-machine modes
+    enum Mode : uint8_t
+    {
+        STARTUP = 0,
+        DRAIN = 1,
+        PROBE_BW = 2,
+        PROBE_RTT = 3, //!< Never inferred, see the class description
+    };
+
+    /// Why a record was appended
+    enum Event : uint8_t
+    {
+        ROUND_END = 0,  //!< A round trip completed
+        TRANSITION = 1, //!< The mode changed
+    };
+
+    /// One fixed-size timeline record
+    struct Record
+    {
+        int64_t time;        //!< Simulation time (ns)
+        uint64_t pacingRate; //!< Pacing rate (bit/s)
+        uint64_t btlBw;      //!< Bottleneck bandwidth estimate (bit/s)
+        int64_t minRtt;      //!< Min-RTT estimate (ns)
+        uint32_t round;      //!< Round count
+        uint32_t cwnd;       //!< Congestion window (bytes)
+        float pacingGain;    //!< Pacing gain
+        float cwndGain;      //!< Cwnd gain
+        uint32_t flowId;     //!< Flow index, in Track() order
+        Mode mode;           //!< Inferred mode after this record
+        Event event;         //!< Reason for this record
+        uint16_t reserved;   //!< Padding
+    };
+
+    /**
+     * TracedCallback signature for timeline records
+     * \param [in] record the record that was appended
+     */
+    typedef void (*RecordTracedCallback)(const Record& record);
+
+    /**
+     * Track a socket given the Config path of its trace sources, e.g.
+     * "/NodeList/0/$ns3::TcpL4Protocol/SocketList/0".  Must be called once
+     * the socket exists.  If one of the trace sources is missing, a
+     * warning is logged and the flow index is kept but gets no records.
+     *
+     * \param socketPath Config path of the socket
+     * \param segmentSize the segment size of the flow, in bytes
+     * \returns the flow index used in the records
+     */
+    uint32_t Track(std::string socketPath, uint32_t segmentSize);
+
+    /**
+     * Track the i'th TCP socket of a node.
+     *
+     * \param nodeId the node identifier
+     * \param socketId the socket index in the TcpL4Protocol socket list
+     * \param segmentSize the segment size of the flow, in bytes
+     * \returns the flow index used in the records
+     */
+    uint32_t TrackTcp(uint32_t nodeId, uint32_t socketId, uint32_t segmentSize);
+
+    /**
+     * Track the i'th QUIC socket of a node.
+     *
+     * \param nodeId the node identifier
+     * \param socketId the socket index in the QuicL4Protocol socket list
+     * \param segmentSize the segment size of the flow, in bytes
+     * \returns the flow index used in the records
+     */
+    uint32_t TrackQuic(uint32_t nodeId, uint32_t socketId, uint32_t segmentSize);
+
+    /**
+     * Spill full rings to a file instead of overwriting them.  Dump()
+     * writes the remaining records to the same file.
+     *
+     * \param filename the binary output file
+     */
+    void SetOutputFile(std::string filename);
+
+    /**
+     * Write the records held in the rings.  If no output file was set,
+     * filename is used; otherwise the records are appended to the
+     * output file and filename is ignored.
+     *
+     * \param filename the binary output file
+     */
+    void Dump(std::string filename = "");
+
+    /**
+     * \returns the number of tracked flows
+     */
+    uint32_t GetNFlows() const;
+
+    /**
+     * \returns the records currently held in the ring of a flow, oldest first
+     * \param flowId the flow index
+     */
+    std::vector<Record> GetRecords(uint32_t flowId) const;
+
+    /**
+     * \returns the short name of a mode
+     * \param mode the mode
+     */
+    static std::string ModeName(Mode mode);
+
+  protected:
+    void DoDispose() override;
+
+  private:
+    /// Per-flow reconstruction state and ring
+    struct FlowState
+    {
+        uint32_t segmentSize{0};         //!< Segment size (bytes)
+        uint32_t cwnd{0};                //!< Last congestion window (bytes)
+        uint64_t pacingRate{0};          //!< Last pacing rate (bit/s)
+        uint64_t btlBw{0};               //!< Windowed max delivery rate (bit/s)
+        int64_t minRtt{0};               //!< Windowed min RTT (ns), zero if unknown
+        int64_t minRttStamp{0};          //!< Time the min RTT was sampled (ns)
+        SequenceNumber32 highestSent;    //!< Highest sequence number sent
+        SequenceNumber32 roundEnd;       //!< Sequence number ending the round
+        SequenceNumber32 roundStartAck;  //!< Cumulative ACK at the start of the round
+        int64_t roundStartTime{0};       //!< Start of the round (ns)
+        bool roundStarted{false};        //!< A round is in progress
+        uint32_t round{0};               //!< Round count
+        std::vector<uint64_t> bwSamples; //!< Delivery rate of the last rounds
+        Mode mode{STARTUP};              //!< Current mode
+        Mode candidate{STARTUP};         //!< Mode suggested by the last rounds
+        uint32_t candidateRounds{0};     //!< Consecutive rounds suggesting candidate
+        std::vector<Record> ring;        //!< Record ring
+        uint32_t head{0};                //!< Index of the oldest record
+        uint32_t count{0};               //!< Number of records in the ring
+    };
+
+    /**
+     * CongestionWindow trace sink
+     * \param flowId the flow index
+     * \param oldValue previous value
+     * \param newValue new value
+     */
+    void CwndChange(uint32_t flowId, uint32_t oldValue, uint32_t newValue);
+
+    /**
+     * PacingRate trace sink
+     * \param flowId the flow index
+     * \param oldValue previous value
+     * \param newValue new value
+     */
+    void PacingRateChange(uint32_t flowId, DataRate oldValue, DataRate newValue);
+
+    /**
+     * RTT trace sink
+     * \param flowId the flow index
+     * \param oldValue previous value
+     * \param newValue new value
+     */
+    void RttChange(uint32_t flowId, Time oldValue, Time newValue);
+
+    /**
+     * HighestSequence trace sink
+     * \param flowId the flow index
+     * \param oldValue previous value
+     * \param newValue new value
+     */
+    void HighestSequenceChange(uint32_t flowId,
+                               SequenceNumber32 oldValue,
+                               SequenceNumber32 newValue);
+
+    /**
+     * HighestRxAck trace sink
+     * \param flowId the flow index
+     * \param oldValue previous value
+     * \param newValue new value
+     */
+    void HighestRxAckChange(uint32_t flowId, SequenceNumber32 oldValue, SequenceNumber32 newValue);
+
+    /**
+     * \returns the pacing gain of a flow
+     * \param flow the flow state
+     */
+    double PacingGain(const FlowState& flow) const;
+
+    /**
+     * \returns the cwnd gain of a flow
+     * \param flow the flow state
+     */
+    double CwndGain(const FlowState& flow) const;
+
+    /**
+     * Reclassify a flow at the end of a round and append a TRANSITION
+     * record if its mode changed
+     * \param flowId the flow index
+     */
+    void UpdateMode(uint32_t flowId);
+
+    /**
+     * Append a record to the ring of a flow
+     * \param flowId the flow index
+     * \param event the reason for the record
+     */
+    void Append(uint32_t flowId, Event event);
+
+    /**
+     * Write the records of a ring to the output file and empty it
+     * \param flow the flow state
+     */
+    void Spill(FlowState& flow);
+
+    /**
+     * Open a binary timeline file and write its header
+     * \param filename the file name
+     */
+    void OpenFile(std::string filename);
+
+    std::vector<FlowState> m_flows;              //!< Per-flow state, indexed by flow index
+    uint32_t m_capacity;                         //!< Ring capacity (records per flow)
+    uint32_t m_btlBwRounds;                      //!< BtlBw filter length (rounds)
+    Time m_minRttWindow;                         //!< Min-RTT filter length
+    uint32_t m_modeRounds;                       //!< Rounds confirming STARTUP exit
+    DataRate m_maxPacingRate;                    //!< Pacing rate cap, zero if none
+    std::ofstream m_file;                        //!< Spill/dump file
+    TracedCallback<const Record&> m_recordTrace; //!< Fired for every appended record
+};
+
+} // namespace ns3
+
+#endif /* BBR_TIMELINE_RECORDER_H */
@@ -0,0 +1,361 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// Implement a probe of the per-flow queueing delay at a bottleneck.
+
+#include "bottleneck-delay-probe.h"
+
+#include "ns3/abort.h"
+#include "ns3/boolean.h"
+#include "ns3/ipv4-queue-disc-item.h"
+#include "ns3/log.h"
+#include "ns3/node.h"
+#include "ns3/simulator.h"
+#include "ns3/traffic-control-layer.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace ns3
+{
+
+NS_LOG_COMPONENT_DEFINE("BottleneckDelayProbe");
+
+NS_OBJECT_ENSURE_REGISTERED(BottleneckDelayTag);
+NS_OBJECT_ENSURE_REGISTERED(BottleneckDelayProbe);
+
+namespace
+{
+
+/// Next sequence number, shared by all probes so that their tags never collide
+uint64_t g_nextSequence = 0;
+
+} // namespace
+
+TypeId
+BottleneckDelayTag::GetTypeId()
+{
+    static TypeId tid = TypeId("ns3::BottleneckDelayTag")
+                            .SetParent<Tag>()
+                            .SetGroupName("PointToPointLayout")
+                            .AddConstructor<BottleneckDelayTag>();
+    return tid;
+}
+
+TypeId
+BottleneckDelayTag::GetInstanceTypeId() const
+{
+    return GetTypeId();
+}
+
+uint32_t
+BottleneckDelayTag::GetSerializedSize() const
+{
+    return 8 + 8;
+}
+
+void
+BottleneckDelayTag::Serialize(TagBuffer buf) const
+{
+    buf.WriteU64(m_sequence);
+    buf.WriteU64(static_cast<uint64_t>(m_enqueueTime));
+}
+
+void
+BottleneckDelayTag::Deserialize(TagBuffer buf)
+{
+    m_sequence = buf.ReadU64();
+    m_enqueueTime = static_cast<int64_t>(buf.ReadU64());
+}
+
+void
+BottleneckDelayTag::Print(std::ostream& os) const
+{
+    os << "Sequence=" << m_sequence << " EnqueueTime=" << TimeStep(m_enqueueTime);
+}
+
+BottleneckDelayTag::BottleneckDelayTag()
+    : m_sequence(0),
+      m_enqueueTime(0)
+{
+}
+
+BottleneckDelayTag::BottleneckDelayTag(uint64_t sequence, Time enqueueTime)
+    : m_sequence(sequence),
+      m_enqueueTime(enqueueTime.GetTimeStep())
+{
+}
+
+uint64_t
+BottleneckDelayTag::GetSequence() const
+{
+    return m_sequence;
+}
+
+Time
+BottleneckDelayTag::GetEnqueueTime() const
+{
+    return TimeStep(m_enqueueTime);
+}
+
+TypeId
+BottleneckDelayProbe::GetTypeId()
+{
+    static TypeId tid =
+        TypeId("ns3::BottleneckDelayProbe")
+            .SetParent<Object>()
+            .SetGroupName("PointToPointLayout")
+            .AddConstructor<BottleneckDelayProbe>()
+            .AddAttribute("PerConnection",
+                          "Tell flows apart by their source port too",
+                          BooleanValue(true),
+                          MakeBooleanAccessor(&BottleneckDelayProbe::m_perConnection),
+                          MakeBooleanChecker());
+    return tid;
+}
+
+BottleneckDelayProbe::BottleneckDelayProbe()
+    : m_perConnection(true)
+{
+    NS_LOG_FUNCTION(this);
+}
+
+BottleneckDelayProbe::~BottleneckDelayProbe()
+{
+    NS_LOG_FUNCTION(this);
+}
+
+void
+BottleneckDelayProbe::DoDispose()
+{
+    NS_LOG_FUNCTION(this);
+    m_pending.clear();
+    Object::DoDispose();
+}
+
+void
+BottleneckDelayProbe::Install(Ptr<NetDevice> device)
+{
+    NS_LOG_FUNCTION(this << device);
+    Ptr<TrafficControlLayer> tc = device->GetNode()->GetObject<TrafficControlLayer>();
+    NS_ABORT_MSG_UNLESS(tc, "BottleneckDelayProbe: no Internet stack on the node");
+    Ptr<QueueDisc> queueDisc = tc->GetRootQueueDiscOnDevice(device);
+    NS_ABORT_MSG_UNLESS(queueDisc, "BottleneckDelayProbe: no queue disc on the device");
+
+    queueDisc->TraceConnectWithoutContext("Enqueue",
+                                          MakeCallback(&BottleneckDelayProbe::Enqueue, this));
+    queueDisc->TraceConnectWithoutContext("Drop", MakeCallback(&BottleneckDelayProbe::Drop, this));
+    queueDisc->TraceConnectWithoutContext("Mark", MakeCallback(&BottleneckDelayProbe::Mark, this));
+    device->TraceConnectWithoutContext("PhyTxBegin",
+                                       MakeCallback(&BottleneckDelayProbe::TxBegin, this));
+}
+
+int32_t
+BottleneckDelayProbe::Classify(Ptr<const QueueDiscItem> item)
+{
+    Ptr<const Ipv4QueueDiscItem> ipItem = DynamicCast<const Ipv4QueueDiscItem>(item);
+    if (!ipItem)
+    {
+        return -1;
+    }
+    const Ipv4Header& header = ipItem->GetHeader();
+    DumbbellFlowMonitor::FlowTuple tuple{header.GetSource(),
+                                         header.GetDestination(),
+                                         0,
+                                         0,
+                                         header.GetProtocol()};
+    // The transport header is still the first header of the packet; both
+    // TCP and UDP start with the source and destination ports
+    uint8_t ports[4];
+    if ((tuple.protocol == 6 || tuple.protocol == 17) && item->GetPacket()->GetSize() >= 4)
+    {
+        item->GetPacket()->CopyData(ports, 4);
+        tuple.sourcePort = m_perConnection ? (ports[0] << 8) | ports[1] : 0;
+        tuple.destinationPort = (ports[2] << 8) | ports[3];
+    }
+
+    std::pair<uint64_t, uint64_t> key{
+        (uint64_t(tuple.source.Get()) << 32) | tuple.destination.Get(),
+        (uint64_t(tuple.sourcePort) << 24) | (uint64_t(tuple.destinationPort) << 8) |
+            tuple.protocol};
+    auto it = m_flowIds.find(key);
+    if (it != m_flowIds.end())
+    {
+        return it->second;
+    }
+    uint32_t flowId = m_records.size();
+    m_flowIds.emplace(key, flowId);
+    m_tuples.push_back(tuple);
+    m_records.emplace_back();
+    return flowId;
+}
+
+void
+BottleneckDelayProbe::Enqueue(Ptr<const QueueDiscItem> item)
+{
+    int32_t flowId = Classify(item);
+    if (flowId >= 0)
+    {
+        // Replaces the tag of a probe on a previous hop
+        BottleneckDelayTag tag(g_nextSequence++, Simulator::Now());
+        item->GetPacket()->ReplacePacketTag(tag);
+        m_pending[tag.GetSequence()] = flowId;
+    }
+}
+
+void
+BottleneckDelayProbe::Drop(Ptr<const QueueDiscItem> item)
+{
+    // Dropped before or after its enqueue
+    BottleneckDelayTag tag;
+    auto it = item->GetPacket()->PeekPacketTag(tag) ? m_pending.find(tag.GetSequence())
+                                                     : m_pending.end();
+    int32_t flowId = it != m_pending.end() ? int32_t(it->second) : Classify(item);
+    if (it != m_pending.end())
+    {
+        m_pending.erase(it);
+    }
+    if (flowId >= 0)
+    {
+        m_records[flowId].drops++;
+    }
+}
+
+void
+BottleneckDelayProbe::Mark(Ptr<const QueueDiscItem> item, const char* reason)
+{
+    int32_t flowId = Classify(item);
+    if (flowId >= 0)
+    {
+        m_records[flowId].marks++;
+    }
+}
+
+void
+BottleneckDelayProbe::TxBegin(Ptr<const Packet> packet)
+{
+    BottleneckDelayTag tag;
+    if (!packet->PeekPacketTag(tag))
+    {
+        return;
+    }
+    auto it = m_pending.find(tag.GetSequence());
+    if (it == m_pending.end())
+    {
+        // Not queued by this probe, or already transmitted
+        return;
+    }
+    int64_t now = Simulator::Now().GetTimeStep();
+    FlowRecord& record = m_records[it->second];
+    int64_t delay = now - tag.GetEnqueueTime().GetTimeStep();
+    m_pending.erase(it);
+
+    if (record.packets == 0)
+    {
+        record.firstTx = now;
+    }
+    record.lastTx = now;
+    record.packets++;
+    record.bytes += packet->GetSize();
+    record.delaySum += delay;
+    uint32_t bin = GetBin(TimeStep(delay));
+    if (bin >= record.histogram.size())
+    {
+        record.histogram.resize(bin + 1, 0);
+    }
+    record.histogram[bin]++;
+}
+
+uint32_t
+BottleneckDelayProbe::GetBin(Time delay)
+{
+    // Bins of 1 us below 32 us, then 16 bins per power of two
+    uint64_t us = std::max<int64_t>(delay.GetMicroSeconds(), 0);
+    if (us < 32)
+    {
+        return us;
+    }
+    uint32_t exponent = 63 - __builtin_clzll(us);
+    return 16 * (exponent - 3) + ((us >> (exponent - 4)) - 16);
+}
+
+double
+BottleneckDelayProbe::GetBinMiddle(uint32_t bin)
+{
+    if (bin < 32)
+    {
+        return bin + 0.5;
+    }
+    uint32_t exponent = bin / 16 + 3;
+    double width = std::ldexp(1.0, exponent - 4);
+    return (16 + bin % 16) * width + width / 2;
+}
+
+uint32_t
+BottleneckDelayProbe::GetNFlows() const
+{
+    return m_records.size();
+}
+
+const DumbbellFlowMonitor::FlowTuple&
+BottleneckDelayProbe::GetFlowTuple(uint32_t flowId) const
+{
+    return m_tuples.at(flowId);
+}
+
+const BottleneckDelayProbe::FlowRecord&
+BottleneckDelayProbe::GetFlowRecord(uint32_t flowId) const
+{
+    return m_records.at(flowId);
+}
+
+Time
+BottleneckDelayProbe::GetMeanDelay(uint32_t flowId) const
+{
+    const FlowRecord& record = m_records.at(flowId);
+    return record.packets ? TimeStep(record.delaySum / int64_t(record.packets)) : Time(0);
+}
+
+Time
+BottleneckDelayProbe::GetDelayPercentile(uint32_t flowId, double percentile) const
+{
+    const FlowRecord& record = m_records.at(flowId);
+    if (record.packets == 0)
+    {
+        return Time(0);
+    }
+    // The rank of the percentile, counted from 1
+    uint64_t rank = std::max<uint64_t>(std::ceil(percentile / 100 * record.packets), 1);
+    uint64_t count = 0;
+    for (uint32_t bin = 0; bin < record.histogram.size(); ++bin)
+    {
+        count += record.histogram[bin];
+        if (count >= rank)
+        {
+            return Seconds(GetBinMiddle(bin) * 1e-6);
+        }
+    }
+    return Seconds(GetBinMiddle(record.histogram.size() - 1) * 1e-6);
+}
+
+double
+BottleneckDelayProbe::GetThroughput(uint32_t flowId) const
+{
+    const FlowRecord& record = m_records.at(flowId);
+    double seconds = TimeStep(record.lastTx - record.firstTx).GetSeconds();
+    return seconds > 0 ? record.bytes * 8.0 / seconds : 0;
+}
+
+} // namespace ns3
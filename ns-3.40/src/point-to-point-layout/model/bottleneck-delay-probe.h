@@ -0,0 +1,231 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// Define a probe of the per-flow queueing delay at a bottleneck.
+
+#ifndef BOTTLENECK_DELAY_PROBE_H
+#define BOTTLENECK_DELAY_PROBE_H
+
+#include "dumbbell-flow-monitor.h"
+
+#include "ns3/net-device.h"
+#include "ns3/nstime.h"
+#include "ns3/object.h"
+#include "ns3/queue-disc.h"
+#include "ns3/tag.h"
+
+#include <map>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * \ingroup point-to-point-layout
+ *
+ * \brief Packet tag carrying the probe sequence number and enqueue time of
+ * a packet queued at a bottleneck observed by a BottleneckDelayProbe.
+ */
+class BottleneckDelayTag : public Tag
+{
+  public:
+    /**
+     * \brief Get the type ID.
+     * \return the object TypeId
+     */
+    static TypeId GetTypeId();
+    TypeId GetInstanceTypeId() const override;
+    uint32_t GetSerializedSize() const override;
+    void Serialize(TagBuffer buf) const override;
+    void Deserialize(TagBuffer buf) override;
+    void Print(std::ostream& os) const override;
+
+    BottleneckDelayTag();
+    /**
+     * \param sequence the probe sequence number
+     * \param enqueueTime the time the packet entered the queue disc
+     */
+    BottleneckDelayTag(uint64_t sequence, Time enqueueTime);
+
+    /**
+     * \returns the probe sequence number
+     */
+    uint64_t GetSequence() const;
+
+    /**
+     * \returns the time the packet entered the queue disc
+     */
+    Time GetEnqueueTime() const;
+
+  private:
+    uint64_t m_sequence;   //!< Probe sequence number
+    int64_t m_enqueueTime; //!< Enqueue time (time steps)
+};
+
+/**
+ * \ingroup point-to-point-layout
+ *
+ * \brief Measure, per flow, the queueing delay of the packets crossing a
+ * bottleneck device, from their enqueue into the root queue disc to the
+ * start of their transmission, and count the packets dropped or marked
+ * by the queue disc.
+ *
+ * The delay therefore includes the time spent in the device queue (see
+ * byte queue limits) but not the transmission itself.  Delays are kept in
+ * a log-linear histogram (1 us bins up to 32 us, then 16 bins per power of
+ * two, i.e. within about 3% of the exact value), so memory does not grow
+ * with the number of packets.
+ *
+ * Every enqueued packet is tagged with a BottleneckDelayTag carrying a
+ * sequence number unique across probes, so IP fragments, which share the
+ * packet uid, are told apart, and a packet crossing several probed
+ * devices is matched by the last one that queued it.
+ *
+ * Only IPv4 packets are classified.  With the PerConnection attribute
+ * false, packets that only differ by their source port belong to the same
+ * flow, which merges the many short connections of a sender into one row.
+ */
+class BottleneckDelayProbe : public Object
+{
+  public:
+    /**
+     * \brief Get the type ID.
+     * \return the object TypeId
+     */
+    static TypeId GetTypeId();
+
+    BottleneckDelayProbe();
+    ~BottleneckDelayProbe() override;
+
+    /// Per-flow statistics
+    struct FlowRecord
+    {
+        uint64_t packets{0};             //!< Packets transmitted
+        uint64_t bytes{0};               //!< Bytes transmitted, with the link header
+        uint32_t drops{0};               //!< Packets dropped by the queue disc
+        uint32_t marks{0};               //!< Packets ECN-marked by the queue disc
+        int64_t delaySum{0};             //!< Sum of queueing delays (time steps)
+        int64_t firstTx{0};              //!< Time of the first transmission (time steps)
+        int64_t lastTx{0};               //!< Time of the last transmission (time steps)
+        std::vector<uint32_t> histogram; //!< Delay histogram, grown on demand
+    };
+
+    /**
+     * Probe a device and its root queue disc.  The Internet stack and the
+     * queue disc must already be installed.
+     *
+     * \param device the bottleneck device
+     */
+    void Install(Ptr<NetDevice> device);
+
+    /**
+     * \returns the number of flows seen so far
+     */
+    uint32_t GetNFlows() const;
+
+    /**
+     * \returns the five-tuple of the given flow; the source port is 0
+     *          unless PerConnection is true
+     * \param flowId flow identifier, in [0, GetNFlows())
+     */
+    const DumbbellFlowMonitor::FlowTuple& GetFlowTuple(uint32_t flowId) const;
+
+    /**
+     * \returns the statistics of the given flow
+     * \param flowId flow identifier, in [0, GetNFlows())
+     */
+    const FlowRecord& GetFlowRecord(uint32_t flowId) const;
+
+    /**
+     * \returns the mean queueing delay of the given flow
+     * \param flowId flow identifier, in [0, GetNFlows())
+     */
+    Time GetMeanDelay(uint32_t flowId) const;
+
+    /**
+     * \returns the queueing delay below which a given percentage of the
+     *          packets of a flow stayed
+     * \param flowId flow identifier, in [0, GetNFlows())
+     * \param percentile the percentage, in [0, 100]
+     */
+    Time GetDelayPercentile(uint32_t flowId, double percentile) const;
+
+    /**
+     * \returns the transmit throughput of the given flow, in bit/s, between
+     *          its first and last transmission
+     * \param flowId flow identifier, in [0, GetNFlows())
+     */
+    double GetThroughput(uint32_t flowId) const;
+
+  protected:
+    void DoDispose() override;
+
+  private:
+    /**
+     * \param item a queue disc item
+     * \returns the flow of the item, created if needed, or -1 if the item
+     *          is not IPv4
+     */
+    int32_t Classify(Ptr<const QueueDiscItem> item);
+
+    /**
+     * Queue disc enqueue trace sink
+     * \param item the enqueued item
+     */
+    void Enqueue(Ptr<const QueueDiscItem> item);
+
+    /**
+     * Queue disc drop trace sink
+     * \param item the dropped item
+     */
+    void Drop(Ptr<const QueueDiscItem> item);
+
+    /**
+     * Queue disc mark trace sink
+     * \param item the marked item
+     * \param reason the reason of the mark
+     */
+    void Mark(Ptr<const QueueDiscItem> item, const char* reason);
+
+    /**
+     * Device transmit trace sink
+     * \param packet the packet starting its transmission
+     */
+    void TxBegin(Ptr<const Packet> packet);
+
+    /**
+     * \param delay a delay
+     * \returns its histogram bin
+     */
+    static uint32_t GetBin(Time delay);
+
+    /**
+     * \param bin a histogram bin
+     * \returns the middle of the bin, in microseconds
+     */
+    static double GetBinMiddle(uint32_t bin);
+
+    bool m_perConnection;                                        //!< Key flows by source port too
+    std::map<std::pair<uint64_t, uint64_t>, uint32_t> m_flowIds; //!< Flow of each key
+    std::vector<DumbbellFlowMonitor::FlowTuple> m_tuples;        //!< Five-tuple of each flow
+    std::vector<FlowRecord> m_records;                           //!< Statistics of each flow
+    std::unordered_map<uint64_t, uint32_t> m_pending;            //!< Flow of each queued sequence
+};
+
+} // namespace ns3
+
+#endif /* BOTTLENECK_DELAY_PROBE_H */
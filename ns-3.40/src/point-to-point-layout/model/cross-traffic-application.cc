@@ -0,0 +1,295 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// Implement an application multiplexing many UDP cross-traffic flows.
+
+#include "cross-traffic-application.h"
+
+#include "ns3/abort.h"
+#include "ns3/address-utils.h"
+#include "ns3/inet6-socket-address.h"
+#include "ns3/log.h"
+#include "ns3/packet.h"
+#include "ns3/simulator.h"
+#include "ns3/udp-socket-factory.h"
+#include "ns3/uinteger.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace ns3
+{
+
+NS_LOG_COMPONENT_DEFINE("CrossTrafficApplication");
+
+NS_OBJECT_ENSURE_REGISTERED(CrossTrafficApplication);
+
+namespace
+{
+
+/**
+ * Draw an exponential period.
+ *
+ * \param rv the exponential random variable
+ * \param mean the mean period
+ * \returns the period in time steps
+ */
+int64_t
+DrawPeriod(Ptr<ExponentialRandomVariable> rv, Time mean)
+{
+    return Seconds(rv->GetValue(mean.GetSeconds(), 0)).GetTimeStep();
+}
+
+} // namespace
+
+TypeId
+CrossTrafficApplication::GetTypeId()
+{
+    static TypeId tid =
+        TypeId("ns3::CrossTrafficApplication")
+            .SetParent<Application>()
+            .SetGroupName("PointToPointLayout")
+            .AddConstructor<CrossTrafficApplication>()
+            .AddAttribute("Remote",
+                          "The address of the destination",
+                          AddressValue(),
+                          MakeAddressAccessor(&CrossTrafficApplication::m_peer),
+                          MakeAddressChecker())
+            .AddAttribute("Local",
+                          "The address on which to bind the sockets; unset to let "
+                          "the stack choose",
+                          AddressValue(),
+                          MakeAddressAccessor(&CrossTrafficApplication::m_local),
+                          MakeAddressChecker())
+            .AddAttribute("Sockets",
+                          "The number of UDP sockets the flows are spread over; "
+                          "0 for one socket per flow",
+                          UintegerValue(0),
+                          MakeUintegerAccessor(&CrossTrafficApplication::m_nSockets),
+                          MakeUintegerChecker<uint32_t>());
+    return tid;
+}
+
+CrossTrafficApplication::CrossTrafficApplication()
+    : m_nSockets(0),
+      m_nEvents(0)
+{
+    NS_LOG_FUNCTION(this);
+    m_exponential = CreateObject<ExponentialRandomVariable>();
+    m_uniform = CreateObject<UniformRandomVariable>();
+}
+
+CrossTrafficApplication::~CrossTrafficApplication()
+{
+    NS_LOG_FUNCTION(this);
+}
+
+void
+CrossTrafficApplication::DoDispose()
+{
+    NS_LOG_FUNCTION(this);
+    m_event.Cancel();
+    m_sockets.clear();
+    m_flows.clear();
+    m_departures = DepartureHeap();
+    m_boundDevice = nullptr;
+    m_exponential = nullptr;
+    m_uniform = nullptr;
+    Application::DoDispose();
+}
+
+uint32_t
+CrossTrafficApplication::AddClass(std::string name,
+                                  uint32_t nFlows,
+                                  DataRate rate,
+                                  uint32_t packetSize,
+                                  Time meanOn,
+                                  Time meanOff)
+{
+    NS_LOG_FUNCTION(this << name << nFlows << rate << packetSize << meanOn << meanOff);
+    NS_ABORT_MSG_IF(m_sockets.size() > 0, "Cannot add a class to a running application");
+    NS_ABORT_MSG_IF(rate.GetBitRate() == 0 || packetSize == 0,
+                    "Cross-traffic class " << name << " sends nothing");
+    m_classes.push_back(
+        {name, nFlows, packetSize, rate.CalculateBytesTxTime(packetSize), meanOn, meanOff, 0, 0});
+    return m_classes.size() - 1;
+}
+
+void
+CrossTrafficApplication::SetBoundDevice(Ptr<NetDevice> device)
+{
+    NS_LOG_FUNCTION(this << device);
+    m_boundDevice = device;
+}
+
+uint32_t
+CrossTrafficApplication::GetNClasses() const
+{
+    return m_classes.size();
+}
+
+std::string
+CrossTrafficApplication::GetClassName(uint32_t classId) const
+{
+    return m_classes.at(classId).name;
+}
+
+uint64_t
+CrossTrafficApplication::GetTxBytes(uint32_t classId) const
+{
+    return m_classes.at(classId).txBytes;
+}
+
+uint64_t
+CrossTrafficApplication::GetTxPackets(uint32_t classId) const
+{
+    return m_classes.at(classId).txPackets;
+}
+
+uint32_t
+CrossTrafficApplication::GetNFlows() const
+{
+    uint32_t nFlows = 0;
+    for (const auto& c : m_classes)
+    {
+        nFlows += c.nFlows;
+    }
+    return nFlows;
+}
+
+uint64_t
+CrossTrafficApplication::GetNEvents() const
+{
+    return m_nEvents;
+}
+
+int64_t
+CrossTrafficApplication::AssignStreams(int64_t stream)
+{
+    NS_LOG_FUNCTION(this << stream);
+    m_exponential->SetStream(stream);
+    m_uniform->SetStream(stream + 1);
+    return 2;
+}
+
+void
+CrossTrafficApplication::StartApplication()
+{
+    NS_LOG_FUNCTION(this);
+    uint32_t nSockets = m_nSockets > 0 ? m_nSockets : std::max<uint32_t>(GetNFlows(), 1);
+    for (uint32_t i = 0; i < nSockets; ++i)
+    {
+        Ptr<Socket> socket = Socket::CreateSocket(GetNode(), UdpSocketFactory::GetTypeId());
+        int ret = -1;
+        if (!m_local.IsInvalid())
+        {
+            ret = socket->Bind(m_local);
+        }
+        else if (Inet6SocketAddress::IsMatchingType(m_peer))
+        {
+            ret = socket->Bind6();
+        }
+        else
+        {
+            ret = socket->Bind();
+        }
+        NS_ABORT_MSG_IF(ret == -1, "Failed to bind socket");
+        if (m_boundDevice)
+        {
+            // UDP looks up its route without a source address, so the
+            // bound address alone does not select the device
+            socket->BindToNetDevice(m_boundDevice);
+        }
+        socket->Connect(m_peer);
+        socket->ShutdownRecv();
+        m_sockets.push_back(socket);
+    }
+
+    // Random phases, so that the flows of a class do not send in lockstep;
+    // on/off flows start with an off period
+    int64_t now = Simulator::Now().GetTimeStep();
+    for (uint32_t c = 0; c < m_classes.size(); ++c)
+    {
+        const Class& cls = m_classes[c];
+        for (uint32_t i = 0; i < cls.nFlows; ++i)
+        {
+            Flow flow{c, std::numeric_limits<int64_t>::max()};
+            int64_t start = now + Seconds(m_uniform->GetValue(0, cls.interval.GetSeconds()))
+                                      .GetTimeStep();
+            if (cls.meanOn.IsStrictlyPositive())
+            {
+                start += DrawPeriod(m_exponential, cls.meanOff);
+                flow.onEnd = start + DrawPeriod(m_exponential, cls.meanOn);
+            }
+            m_departures.emplace(start, m_flows.size());
+            m_flows.push_back(flow);
+        }
+    }
+    if (!m_departures.empty())
+    {
+        m_event = Simulator::Schedule(TimeStep(m_departures.top().first - now),
+                                      &CrossTrafficApplication::Depart,
+                                      this);
+    }
+}
+
+void
+CrossTrafficApplication::StopApplication()
+{
+    NS_LOG_FUNCTION(this);
+    m_event.Cancel();
+    for (auto& socket : m_sockets)
+    {
+        socket->Close();
+    }
+    m_sockets.clear();
+    m_flows.clear();
+    m_departures = DepartureHeap();
+}
+
+void
+CrossTrafficApplication::Depart()
+{
+    int64_t now = Simulator::Now().GetTimeStep();
+    m_nEvents++;
+    while (!m_departures.empty() && m_departures.top().first <= now)
+    {
+        uint32_t flowId = m_departures.top().second;
+        m_departures.pop();
+        Flow& flow = m_flows[flowId];
+        Class& cls = m_classes[flow.classId];
+
+        if (m_sockets[flowId % m_sockets.size()]->Send(Create<Packet>(cls.packetSize)) >= 0)
+        {
+            cls.txBytes += cls.packetSize;
+            cls.txPackets++;
+        }
+
+        int64_t next = now + cls.interval.GetTimeStep();
+        if (next > flow.onEnd)
+        {
+            // The on period is over: the next packet opens the next one
+            next = std::max(flow.onEnd, now) + DrawPeriod(m_exponential, cls.meanOff);
+            next = std::max(next, now + 1);
+            flow.onEnd = next + DrawPeriod(m_exponential, cls.meanOn);
+        }
+        m_departures.emplace(next, flowId);
+    }
+    m_event = Simulator::Schedule(TimeStep(m_departures.top().first - now),
+                                  &CrossTrafficApplication::Depart,
+                                  this);
+}
+
+} // namespace ns3
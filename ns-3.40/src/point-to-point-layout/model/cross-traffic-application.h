@@ -0,0 +1,194 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// Define an application multiplexing many UDP cross-traffic flows.
+
+#ifndef CROSS_TRAFFIC_APPLICATION_H
+#define CROSS_TRAFFIC_APPLICATION_H
+
+#include "ns3/address.h"
+#include "ns3/application.h"
+#include "ns3/data-rate.h"
+#include "ns3/event-id.h"
+#include "ns3/net-device.h"
+#include "ns3/random-variable-stream.h"
+#include "ns3/socket.h"
+
+#include <functional>
+#include <queue>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * \ingroup point-to-point-layout
+ *
+ * \brief Send many logical UDP flows from one application, with one
+ * simulator event per departure time across all of them.
+ *
+ * Flows are grouped in classes (AddClass): every flow of a class sends
+ * packets of one size at one rate, optionally in exponential on/off
+ * periods.  The next departure of every flow is kept in a min-heap; the
+ * single pending event fires at the earliest one, sends every packet due
+ * at that time and re-arms itself.  The cost of a flow is a heap entry, so
+ * the number of events grows with the packets sent, not with the flows
+ * configured.
+ *
+ * By default every flow has its own UDP socket, hence its own source
+ * port, so a flow-aware queue disc (e.g. FqCoDel) sees as many flows as
+ * were configured.  A non-zero Sockets spreads the flows over that many
+ * sockets instead (flow i uses socket i modulo Sockets), which saves
+ * memory with many flows but makes the flows sharing a socket one flow,
+ * with one queue and one share, for a flow-aware queue disc.  Bytes and
+ * packets sent are counted per class.
+ */
+class CrossTrafficApplication : public Application
+{
+  public:
+    /**
+     * \brief Get the type ID.
+     * \return the object TypeId
+     */
+    static TypeId GetTypeId();
+
+    CrossTrafficApplication();
+    ~CrossTrafficApplication() override;
+
+    /**
+     * Add a class of flows; must be called before the application starts.
+     *
+     * \param name the class name
+     * \param nFlows the number of flows of the class
+     * \param rate the payload rate of each flow while on
+     * \param packetSize the payload size of the packets
+     * \param meanOn the mean on period, zero for always on
+     * \param meanOff the mean off period
+     * \returns the class index
+     */
+    uint32_t AddClass(std::string name,
+                      uint32_t nFlows,
+                      DataRate rate,
+                      uint32_t packetSize,
+                      Time meanOn = Time(0),
+                      Time meanOff = Time(0));
+
+    /**
+     * Bind every socket to a device, e.g. the leaf device of an aggregated
+     * dumbbell leaf, so that its packets leave through that device.
+     * \param device the device, or nullptr to leave the sockets unbound
+     */
+    void SetBoundDevice(Ptr<NetDevice> device);
+
+    /**
+     * \returns the number of classes
+     */
+    uint32_t GetNClasses() const;
+
+    /**
+     * \returns the name of a class
+     * \param classId the class index
+     */
+    std::string GetClassName(uint32_t classId) const;
+
+    /**
+     * \returns the payload bytes sent by the flows of a class
+     * \param classId the class index
+     */
+    uint64_t GetTxBytes(uint32_t classId) const;
+
+    /**
+     * \returns the packets sent by the flows of a class
+     * \param classId the class index
+     */
+    uint64_t GetTxPackets(uint32_t classId) const;
+
+    /**
+     * \returns the number of flows of all the classes
+     */
+    uint32_t GetNFlows() const;
+
+    /**
+     * \returns the number of departure events so far
+     */
+    uint64_t GetNEvents() const;
+
+    /**
+     * Assign a fixed random variable stream number to the random variables
+     * used by this application.
+     *
+     * \param stream first stream index to use
+     * \return the number of stream indices assigned by this application
+     */
+    int64_t AssignStreams(int64_t stream);
+
+  protected:
+    void DoDispose() override;
+
+  private:
+    void StartApplication() override;
+    void StopApplication() override;
+
+    /**
+     * Send the packets due now and schedule the next departure
+     */
+    void Depart();
+
+    /// A class of flows
+    struct Class
+    {
+        std::string name;    //!< Name
+        uint32_t nFlows;     //!< Number of flows
+        uint32_t packetSize; //!< Payload size
+        Time interval;       //!< Time between the packets of a flow
+        Time meanOn;         //!< Mean on period, zero for always on
+        Time meanOff;        //!< Mean off period
+        uint64_t txBytes;    //!< Payload bytes sent
+        uint64_t txPackets;  //!< Packets sent
+    };
+
+    /// A flow
+    struct Flow
+    {
+        uint32_t classId; //!< Class of the flow
+        int64_t onEnd;    //!< End of the current on period (time steps)
+    };
+
+    /// Time of the next departure (time steps) and flow
+    typedef std::pair<int64_t, uint32_t> Departure;
+    /// Min-heap of departures
+    typedef std::priority_queue<Departure, std::vector<Departure>, std::greater<Departure>>
+        DepartureHeap;
+
+    Address m_peer;               //!< Remote address
+    Address m_local;              //!< Local address to bind to
+    Ptr<NetDevice> m_boundDevice; //!< Device to bind to, if any
+    uint32_t m_nSockets;          //!< Number of sockets
+
+    std::vector<Class> m_classes;                 //!< Classes
+    std::vector<Flow> m_flows;                    //!< Flows
+    std::vector<Ptr<Socket>> m_sockets;           //!< Sockets
+    DepartureHeap m_departures;                   //!< Next departure of every flow
+    Ptr<ExponentialRandomVariable> m_exponential; //!< On and off periods
+    Ptr<UniformRandomVariable> m_uniform;         //!< Initial phases
+    EventId m_event;                              //!< Next departure event
+    uint64_t m_nEvents;                           //!< Departure events so far
+};
+
+} // namespace ns3
+
+#endif /* CROSS_TRAFFIC_APPLICATION_H */
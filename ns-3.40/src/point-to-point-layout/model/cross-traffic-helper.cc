@@ -0,0 +1,173 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// Implement a helper to install cross-traffic generators on dumbbell leaves.
+
+#include "cross-traffic-helper.h"
+
+#include "cross-traffic-application.h"
+
+#include "ns3/inet-socket-address.h"
+#include "ns3/ipv4.h"
+#include "ns3/packet-sink-helper.h"
+
+#include <set>
+
+namespace ns3
+{
+
+CrossTrafficHelper::CrossTrafficHelper()
+{
+    m_factory.SetTypeId("ns3::CrossTrafficApplication");
+}
+
+void
+CrossTrafficHelper::SetAttribute(std::string name, const AttributeValue& value)
+{
+    m_factory.Set(name, value);
+}
+
+uint32_t
+CrossTrafficHelper::AddClass(std::string name,
+                             uint32_t flowsPerLeaf,
+                             DataRate rate,
+                             uint32_t packetSize,
+                             Time meanOn,
+                             Time meanOff)
+{
+    m_classes.push_back({name, flowsPerLeaf, rate, packetSize, meanOn, meanOff});
+    return m_classes.size() - 1;
+}
+
+ApplicationContainer
+CrossTrafficHelper::Install(Ptr<Node> node,
+                            const Address& remote,
+                            const Address& local,
+                            Ptr<NetDevice> device)
+{
+    Ptr<CrossTrafficApplication> app = m_factory.Create<CrossTrafficApplication>();
+    app->SetAttribute("Remote", AddressValue(remote));
+    if (!local.IsInvalid())
+    {
+        app->SetAttribute("Local", AddressValue(local));
+    }
+    app->SetBoundDevice(device);
+    for (const auto& c : m_classes)
+    {
+        app->AddClass(c.name, c.flowsPerLeaf, c.rate, c.packetSize, c.meanOn, c.meanOff);
+    }
+    node->AddApplication(app);
+    m_apps.Add(app);
+    return ApplicationContainer(app);
+}
+
+ApplicationContainer
+CrossTrafficHelper::Install(const PointToPointDumbbellHelper& dumbbell, uint16_t port)
+{
+    PacketSinkHelper sinkHelper("ns3::UdpSocketFactory",
+                                InetSocketAddress(Ipv4Address::GetAny(), port));
+    m_sinks = ApplicationContainer();
+    std::set<uint32_t> installed;
+    for (uint32_t i = 0; i < dumbbell.RightCount(); ++i)
+    {
+        Ptr<Node> node = dumbbell.GetRight(i);
+        if (installed.insert(node->GetId()).second)
+        {
+            m_sinks.Add(sinkHelper.Install(node));
+        }
+    }
+
+    ApplicationContainer apps;
+    for (uint32_t i = 0; i < dumbbell.LeftCount(); ++i)
+    {
+        Ipv4Address remote = dumbbell.GetRightIpv4Address(i % dumbbell.RightCount());
+        Ipv4Address local = dumbbell.GetLeftIpv4Address(i);
+        Ptr<Node> node = dumbbell.GetLeft(i);
+        Ptr<Ipv4> ipv4 = node->GetObject<Ipv4>();
+        Ptr<NetDevice> device = ipv4->GetNetDevice(ipv4->GetInterfaceForAddress(local));
+        apps.Add(
+            Install(node, InetSocketAddress(remote, port), InetSocketAddress(local, 0), device));
+    }
+    return apps;
+}
+
+ApplicationContainer
+CrossTrafficHelper::GetSinks() const
+{
+    return m_sinks;
+}
+
+uint64_t
+CrossTrafficHelper::GetTxBytes(uint32_t classId) const
+{
+    uint64_t bytes = 0;
+    for (auto i = m_apps.Begin(); i != m_apps.End(); ++i)
+    {
+        bytes += DynamicCast<CrossTrafficApplication>(*i)->GetTxBytes(classId);
+    }
+    return bytes;
+}
+
+uint64_t
+CrossTrafficHelper::GetTxPackets(uint32_t classId) const
+{
+    uint64_t packets = 0;
+    for (auto i = m_apps.Begin(); i != m_apps.End(); ++i)
+    {
+        packets += DynamicCast<CrossTrafficApplication>(*i)->GetTxPackets(classId);
+    }
+    return packets;
+}
+
+uint64_t
+CrossTrafficHelper::GetNEvents() const
+{
+    uint64_t events = 0;
+    for (auto i = m_apps.Begin(); i != m_apps.End(); ++i)
+    {
+        events += DynamicCast<CrossTrafficApplication>(*i)->GetNEvents();
+    }
+    return events;
+}
+
+void
+CrossTrafficHelper::Report(std::ostream& os, Time duration) const
+{
+    for (uint32_t c = 0; c < m_classes.size(); ++c)
+    {
+        uint64_t bytes = GetTxBytes(c);
+        os << m_classes[c].name << ": " << m_classes[c].flowsPerLeaf * m_apps.GetN()
+           << " flows, " << GetTxPackets(c) << " packets, " << bytes << " bytes";
+        if (duration.IsStrictlyPositive())
+        {
+            os << ", " << bytes * 8 / duration.GetSeconds() / 1e6 << " Mbps";
+        }
+        os << std::endl;
+    }
+    os << GetNEvents() << " departure events" << std::endl;
+}
+
+int64_t
+CrossTrafficHelper::AssignStreams(int64_t stream)
+{
+    int64_t currentStream = stream;
+    for (auto i = m_apps.Begin(); i != m_apps.End(); ++i)
+    {
+        currentStream += DynamicCast<CrossTrafficApplication>(*i)->AssignStreams(currentStream);
+    }
+    return currentStream - stream;
+}
+
+} // namespace ns3
@@ -0,0 +1,162 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// Define a helper to install cross-traffic generators on dumbbell leaves.
+
+#ifndef CROSS_TRAFFIC_HELPER_H
+#define CROSS_TRAFFIC_HELPER_H
+
+#include "point-to-point-dumbbell.h"
+
+#include "ns3/application-container.h"
+#include "ns3/data-rate.h"
+#include "ns3/node-container.h"
+#include "ns3/nstime.h"
+#include "ns3/object-factory.h"
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * \ingroup point-to-point-layout
+ *
+ * \brief Install CrossTrafficApplication senders and UDP sinks.
+ *
+ * The classes added to the helper are added to every sender it installs,
+ * so a dumbbell with N left leaves and a class of F flows per leaf runs
+ * N * F flows with N applications.  The per-class counters of the
+ * installed senders are summed by GetTxBytes and GetTxPackets.
+ */
+class CrossTrafficHelper
+{
+  public:
+    CrossTrafficHelper();
+
+    /**
+     * Set an attribute of the CrossTrafficApplication instances.
+     *
+     * \param name the name of the attribute to set
+     * \param value the value of the attribute to set
+     */
+    void SetAttribute(std::string name, const AttributeValue& value);
+
+    /**
+     * Add a class of flows to the senders installed afterwards.
+     *
+     * \param name the class name
+     * \param flowsPerLeaf the number of flows of the class on each sender
+     * \param rate the payload rate of each flow while on
+     * \param packetSize the payload size of the packets
+     * \param meanOn the mean on period, zero for always on
+     * \param meanOff the mean off period
+     * \returns the class index
+     */
+    uint32_t AddClass(std::string name,
+                      uint32_t flowsPerLeaf,
+                      DataRate rate,
+                      uint32_t packetSize,
+                      Time meanOn = Time(0),
+                      Time meanOff = Time(0));
+
+    /**
+     * Install a sender on a node.
+     *
+     * \param node the node
+     * \param remote the address of the sink
+     * \param local the address to bind the sockets to, if any
+     * \param device the device to bind the sockets to, if any
+     * \returns the installed application
+     */
+    ApplicationContainer Install(Ptr<Node> node,
+                                 const Address& remote,
+                                 const Address& local = Address(),
+                                 Ptr<NetDevice> device = nullptr);
+
+    /**
+     * Install a sender on every left leaf of a dumbbell, sending to the
+     * right leaf of the same index (modulo the number of right leaves),
+     * and a UDP PacketSink on every right leaf.  Each sender binds to the
+     * address and the device of its leaf, so aggregated leaves work too.
+     * The IPv4 addresses of the dumbbell must have been assigned.
+     *
+     * \param dumbbell the dumbbell
+     * \param port the port of the sinks
+     * \returns the installed senders; the sinks are not returned
+     */
+    ApplicationContainer Install(const PointToPointDumbbellHelper& dumbbell, uint16_t port);
+
+    /**
+     * \returns the sinks installed by the last dumbbell Install call
+     */
+    ApplicationContainer GetSinks() const;
+
+    /**
+     * \returns the payload bytes sent by a class over all the senders
+     * \param classId the class index
+     */
+    uint64_t GetTxBytes(uint32_t classId) const;
+
+    /**
+     * \returns the packets sent by a class over all the senders
+     * \param classId the class index
+     */
+    uint64_t GetTxPackets(uint32_t classId) const;
+
+    /**
+     * \returns the departure events of all the senders
+     */
+    uint64_t GetNEvents() const;
+
+    /**
+     * Print one line per class: flows, packets, bytes and mean rate.
+     *
+     * \param os the output stream
+     * \param duration the time the senders ran, for the mean rate
+     */
+    void Report(std::ostream& os, Time duration) const;
+
+    /**
+     * Assign fixed random variable streams to the installed senders.
+     *
+     * \param stream first stream index to use
+     * \returns the number of stream indices assigned
+     */
+    int64_t AssignStreams(int64_t stream);
+
+  private:
+    /// A class added to the senders
+    struct Class
+    {
+        std::string name;      //!< Name
+        uint32_t flowsPerLeaf; //!< Flows per sender
+        DataRate rate;         //!< Rate of a flow while on
+        uint32_t packetSize;   //!< Payload size
+        Time meanOn;           //!< Mean on period
+        Time meanOff;          //!< Mean off period
+    };
+
+    ObjectFactory m_factory;      //!< Sender factory
+    std::vector<Class> m_classes; //!< Classes
+    ApplicationContainer m_apps;  //!< Installed senders
+    ApplicationContainer m_sinks; //!< Sinks of the last dumbbell install
+};
+
+} // namespace ns3
+
+#endif /* CROSS_TRAFFIC_HELPER_H */
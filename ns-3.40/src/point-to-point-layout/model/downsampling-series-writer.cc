@@ -0,0 +1,170 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// Implement a time-series writer that downsamples while writing.
+
+#include "downsampling-series-writer.h"
+
+#include "ns3/abort.h"
+#include "ns3/log.h"
+
+#include <algorithm>
+
+namespace ns3
+{
+
+NS_LOG_COMPONENT_DEFINE("DownsamplingSeriesWriter");
+
+NS_OBJECT_ENSURE_REGISTERED(DownsamplingSeriesWriter);
+
+TypeId
+DownsamplingSeriesWriter::GetTypeId()
+{
+    static TypeId tid =
+        TypeId("ns3::DownsamplingSeriesWriter")
+            .SetParent<Object>()
+            .SetGroupName("PointToPointLayout")
+            .AddConstructor<DownsamplingSeriesWriter>()
+            .AddAttribute("Bucket",
+                          "Width of the time buckets, zero to write every point",
+                          TimeValue(Time(0)),
+                          MakeTimeAccessor(&DownsamplingSeriesWriter::m_bucket),
+                          MakeTimeChecker(Time(0)));
+    return tid;
+}
+
+DownsamplingSeriesWriter::DownsamplingSeriesWriter()
+    : m_bucketIndex(0),
+      m_pending(false),
+      m_nIn(0),
+      m_nOut(0)
+{
+    NS_LOG_FUNCTION(this);
+}
+
+DownsamplingSeriesWriter::~DownsamplingSeriesWriter()
+{
+    NS_LOG_FUNCTION(this);
+    Close();
+}
+
+void
+DownsamplingSeriesWriter::DoDispose()
+{
+    NS_LOG_FUNCTION(this);
+    Close();
+    Object::DoDispose();
+}
+
+void
+DownsamplingSeriesWriter::Open(std::string filename, bool append)
+{
+    NS_LOG_FUNCTION(this << filename << append);
+    Close();
+    m_os.open(filename, append ? std::ios::app : std::ios::trunc);
+    NS_ABORT_MSG_UNLESS(m_os.is_open(), "Cannot open " << filename);
+}
+
+void
+DownsamplingSeriesWriter::Write(Time time, double value)
+{
+    Point point{m_nIn++, time.GetTimeStep(), value};
+    if (m_bucket.IsZero())
+    {
+        WritePoint(point);
+        return;
+    }
+
+    int64_t bucketIndex = point.time / m_bucket.GetTimeStep();
+    if (m_pending && bucketIndex != m_bucketIndex)
+    {
+        WriteBucket();
+    }
+    if (!m_pending)
+    {
+        m_bucketIndex = bucketIndex;
+        m_pending = true;
+        m_first = m_min = m_max = point;
+    }
+    // Ties keep the earliest point
+    if (value < m_min.value)
+    {
+        m_min = point;
+    }
+    if (value > m_max.value)
+    {
+        m_max = point;
+    }
+    m_last = point;
+}
+
+void
+DownsamplingSeriesWriter::WritePoint(const Point& point)
+{
+    m_os << TimeStep(point.time).GetSeconds() << " " << point.value << "\n";
+    m_nOut++;
+}
+
+void
+DownsamplingSeriesWriter::WriteBucket()
+{
+    if (!m_pending)
+    {
+        return;
+    }
+    m_pending = false;
+    Point points[4] = {m_first, m_min, m_max, m_last};
+    std::sort(points, points + 4, [](const Point& a, const Point& b) { return a.index < b.index; });
+    for (uint32_t i = 0; i < 4; ++i)
+    {
+        if (i == 0 || points[i].index != points[i - 1].index)
+        {
+            WritePoint(points[i]);
+        }
+    }
+}
+
+void
+DownsamplingSeriesWriter::Flush()
+{
+    NS_LOG_FUNCTION(this);
+    WriteBucket();
+    m_os.flush();
+}
+
+void
+DownsamplingSeriesWriter::Close()
+{
+    if (m_os.is_open())
+    {
+        NS_LOG_FUNCTION(this);
+        WriteBucket();
+        m_os.close();
+    }
+}
+
+uint64_t
+DownsamplingSeriesWriter::GetNPointsIn() const
+{
+    return m_nIn;
+}
+
+uint64_t
+DownsamplingSeriesWriter::GetNPointsOut() const
+{
+    return m_nOut;
+}
+
+} // namespace ns3
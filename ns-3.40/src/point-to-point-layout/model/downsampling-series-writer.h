@@ -0,0 +1,133 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// Define a time-series writer that downsamples while writing.
+
+#ifndef DOWNSAMPLING_SERIES_WRITER_H
+#define DOWNSAMPLING_SERIES_WRITER_H
+
+#include "ns3/nstime.h"
+#include "ns3/object.h"
+
+#include <fstream>
+#include <string>
+
+namespace ns3
+{
+
+/**
+ * \ingroup point-to-point-layout
+ *
+ * \brief Write a "time value" series (time in seconds, one point per line,
+ * as read by gnuplot), keeping only the points that shape the plot.
+ *
+ * Time is cut into buckets of the Bucket attribute, e.g. the plotted
+ * duration divided by the plot width in pixels.  Of the points of a
+ * bucket only the first, the last, the minimum and the maximum are
+ * written, in time order: the extremes of every bucket, hence of every
+ * interval of whole buckets, are exact, and a line through the written
+ * points draws the same picture as one through all of them.  A per-ACK
+ * trace then costs at most four lines per bucket instead of one per
+ * event.  With a zero Bucket every point is written.
+ *
+ * Points must be written in non-decreasing time order.  A bucket is
+ * written when a point of a later bucket arrives, on Flush and on Close.
+ */
+class DownsamplingSeriesWriter : public Object
+{
+  public:
+    /**
+     * \brief Get the type ID.
+     * \return the object TypeId
+     */
+    static TypeId GetTypeId();
+
+    DownsamplingSeriesWriter();
+    ~DownsamplingSeriesWriter() override;
+
+    /**
+     * Open the output file, closing the previous one if any.
+     *
+     * \param filename the output file
+     * \param append append to the file instead of truncating it
+     */
+    void Open(std::string filename, bool append = false);
+
+    /**
+     * Add a point.
+     *
+     * \param time the time of the point
+     * \param value the value of the point
+     */
+    void Write(Time time, double value);
+
+    /**
+     * Write the pending bucket and flush the file.
+     */
+    void Flush();
+
+    /**
+     * Write the pending bucket and close the file.
+     */
+    void Close();
+
+    /**
+     * \returns the number of points added
+     */
+    uint64_t GetNPointsIn() const;
+
+    /**
+     * \returns the number of points written
+     */
+    uint64_t GetNPointsOut() const;
+
+  protected:
+    void DoDispose() override;
+
+  private:
+    /// A point of the pending bucket
+    struct Point
+    {
+        uint64_t index; //!< Rank of the point among the added points
+        int64_t time;   //!< Time (time steps)
+        double value;   //!< Value
+    };
+
+    /**
+     * Write one point
+     * \param point the point
+     */
+    void WritePoint(const Point& point);
+
+    /**
+     * Write the points kept from the pending bucket, if any
+     */
+    void WriteBucket();
+
+    Time m_bucket;         //!< Bucket width, zero to keep every point
+    std::ofstream m_os;    //!< Output file
+    int64_t m_bucketIndex; //!< Index of the pending bucket
+    bool m_pending;        //!< The pending bucket has points
+    Point m_first;         //!< First point of the pending bucket
+    Point m_last;          //!< Last point of the pending bucket
+    Point m_min;           //!< Minimum of the pending bucket
+    Point m_max;           //!< Maximum of the pending bucket
+    uint64_t m_nIn;        //!< Points added
+    uint64_t m_nOut;       //!< Points written
+};
+
+} // namespace ns3
+
+#endif /* DOWNSAMPLING_SERIES_WRITER_H */
@@ -0,0 +1,342 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// Implement a lightweight per-flow monitor for the leaves of a dumbbell.
+
+#include "dumbbell-flow-monitor.h"
+
+#include "ns3/abort.h"
+#include "ns3/boolean.h"
+#include "ns3/ipv4-l3-protocol.h"
+#include "ns3/log.h"
+#include "ns3/simulator.h"
+
+namespace ns3
+{
+
+NS_LOG_COMPONENT_DEFINE("DumbbellFlowMonitor");
+
+NS_OBJECT_ENSURE_REGISTERED(DumbbellFlowTag);
+NS_OBJECT_ENSURE_REGISTERED(DumbbellFlowMonitor);
+
+static_assert(sizeof(DumbbellFlowMonitor::FlowRecord) == 64,
+              "FlowRecord is expected to fill exactly one cache line");
+
+TypeId
+DumbbellFlowTag::GetTypeId()
+{
+    static TypeId tid = TypeId("ns3::DumbbellFlowTag")
+                            .SetParent<Tag>()
+                            .SetGroupName("PointToPointLayout")
+                            .AddConstructor<DumbbellFlowTag>();
+    return tid;
+}
+
+TypeId
+DumbbellFlowTag::GetInstanceTypeId() const
+{
+    return GetTypeId();
+}
+
+uint32_t
+DumbbellFlowTag::GetSerializedSize() const
+{
+    return 4 + 8;
+}
+
+void
+DumbbellFlowTag::Serialize(TagBuffer buf) const
+{
+    buf.WriteU32(m_flowId);
+    buf.WriteU64(static_cast<uint64_t>(m_txTime));
+}
+
+void
+DumbbellFlowTag::Deserialize(TagBuffer buf)
+{
+    m_flowId = buf.ReadU32();
+    m_txTime = static_cast<int64_t>(buf.ReadU64());
+}
+
+void
+DumbbellFlowTag::Print(std::ostream& os) const
+{
+    os << "FlowId=" << m_flowId << " TxTime=" << TimeStep(m_txTime);
+}
+
+DumbbellFlowTag::DumbbellFlowTag()
+    : m_flowId(0),
+      m_txTime(0)
+{
+}
+
+DumbbellFlowTag::DumbbellFlowTag(uint32_t flowId, Time txTime)
+    : m_flowId(flowId),
+      m_txTime(txTime.GetTimeStep())
+{
+}
+
+uint32_t
+DumbbellFlowTag::GetFlowId() const
+{
+    return m_flowId;
+}
+
+Time
+DumbbellFlowTag::GetTxTime() const
+{
+    return TimeStep(m_txTime);
+}
+
+TypeId
+DumbbellFlowMonitor::GetTypeId()
+{
+    static TypeId tid =
+        TypeId("ns3::DumbbellFlowMonitor")
+            .SetParent<Object>()
+            .SetGroupName("PointToPointLayout")
+            .AddConstructor<DumbbellFlowMonitor>()
+            .AddAttribute("DelayHistogram",
+                          "Keep a log2-binned one-way delay histogram for every flow",
+                          BooleanValue(false),
+                          MakeBooleanAccessor(&DumbbellFlowMonitor::m_enableDelayHistogram),
+                          MakeBooleanChecker());
+    return tid;
+}
+
+DumbbellFlowMonitor::DumbbellFlowMonitor()
+    : m_enableDelayHistogram(false)
+{
+    NS_LOG_FUNCTION(this);
+}
+
+DumbbellFlowMonitor::~DumbbellFlowMonitor()
+{
+    NS_LOG_FUNCTION(this);
+}
+
+void
+DumbbellFlowMonitor::DoDispose()
+{
+    NS_LOG_FUNCTION(this);
+    m_flowIds.clear();
+    Object::DoDispose();
+}
+
+std::size_t
+DumbbellFlowMonitor::FlowKeyHash::operator()(const FlowKey& key) const
+{
+    // splitmix64 finalizer over the two packed words
+    uint64_t h = key.addresses ^ (key.portsAndProtocol * 0x9e3779b97f4a7c15ULL);
+    h ^= h >> 30;
+    h *= 0xbf58476d1ce4e5b9ULL;
+    h ^= h >> 27;
+    h *= 0x94d049bb133111ebULL;
+    h ^= h >> 31;
+    return static_cast<std::size_t>(h);
+}
+
+void
+DumbbellFlowMonitor::Install(Ptr<Node> node)
+{
+    NS_LOG_FUNCTION(this << node);
+    Ptr<Ipv4L3Protocol> ipv4 = node->GetObject<Ipv4L3Protocol>();
+    NS_ABORT_MSG_UNLESS(ipv4, "DumbbellFlowMonitor requires an Internet stack on the node");
+    ipv4->TraceConnectWithoutContext("SendOutgoing",
+                                     MakeCallback(&DumbbellFlowMonitor::SendOutgoing, this));
+    ipv4->TraceConnectWithoutContext("LocalDeliver",
+                                     MakeCallback(&DumbbellFlowMonitor::LocalDeliver, this));
+}
+
+uint32_t
+DumbbellFlowMonitor::Classify(const Ipv4Header& header, Ptr<const Packet> packet)
+{
+    uint16_t sourcePort = 0;
+    uint16_t destinationPort = 0;
+    uint8_t protocol = header.GetProtocol();
+    // TCP and UDP both start with the source and destination ports
+    if ((protocol == 6 || protocol == 17) && packet->GetSize() >= 4)
+    {
+        uint8_t data[4];
+        packet->CopyData(data, 4);
+        sourcePort = (static_cast<uint16_t>(data[0]) << 8) | data[1];
+        destinationPort = (static_cast<uint16_t>(data[2]) << 8) | data[3];
+    }
+
+    FlowKey key;
+    key.addresses = (static_cast<uint64_t>(header.GetSource().Get()) << 32) |
+                    header.GetDestination().Get();
+    key.portsAndProtocol = (static_cast<uint64_t>(sourcePort) << 24) |
+                           (static_cast<uint64_t>(destinationPort) << 8) | protocol;
+
+    auto it = m_flowIds.find(key);
+    if (it != m_flowIds.end())
+    {
+        return it->second;
+    }
+
+    uint32_t flowId = m_records.size();
+    NS_LOG_LOGIC("New flow " << flowId << ": " << header.GetSource() << ":" << sourcePort
+                             << " -> " << header.GetDestination() << ":" << destinationPort
+                             << " proto " << +protocol);
+    m_flowIds.emplace(key, flowId);
+    m_records.emplace_back();
+    m_tuples.push_back({header.GetSource(),
+                        header.GetDestination(),
+                        sourcePort,
+                        destinationPort,
+                        protocol});
+    if (m_enableDelayHistogram)
+    {
+        m_delayHistogram.resize(m_records.size() * DELAY_BINS, 0);
+    }
+    return flowId;
+}
+
+void
+DumbbellFlowMonitor::SendOutgoing(const Ipv4Header& header,
+                                  Ptr<const Packet> packet,
+                                  uint32_t interface)
+{
+    DumbbellFlowTag tag;
+    if (packet->PeekPacketTag(tag))
+    {
+        // Already accounted for, e.g. a packet looped back to the stack
+        return;
+    }
+    uint32_t flowId = Classify(header, packet);
+    int64_t now = Simulator::Now().GetTimeStep();
+
+    FlowRecord& record = m_records[flowId];
+    if (record.txPackets == 0)
+    {
+        record.firstTx = now;
+    }
+    record.lastTx = now;
+    record.txPackets++;
+    record.txBytes += packet->GetSize() + header.GetSerializedSize();
+
+    packet->AddPacketTag(DumbbellFlowTag(flowId, TimeStep(now)));
+}
+
+void
+DumbbellFlowMonitor::LocalDeliver(const Ipv4Header& header,
+                                  Ptr<const Packet> packet,
+                                  uint32_t interface)
+{
+    DumbbellFlowTag tag;
+    if (!packet->PeekPacketTag(tag) || tag.GetFlowId() >= m_records.size())
+    {
+        // Not sent from a probed leaf
+        return;
+    }
+    int64_t now = Simulator::Now().GetTimeStep();
+    int64_t delay = now - tag.GetTxTime().GetTimeStep();
+
+    FlowRecord& record = m_records[tag.GetFlowId()];
+    if (record.rxPackets == 0)
+    {
+        record.firstRx = now;
+    }
+    record.lastRx = now;
+    record.rxPackets++;
+    record.rxBytes += packet->GetSize() + header.GetSerializedSize();
+    record.delaySum += delay;
+
+    if (m_enableDelayHistogram)
+    {
+        if (m_delayHistogram.size() < m_records.size() * DELAY_BINS)
+        {
+            // The histogram was enabled after some flows were created
+            m_delayHistogram.resize(m_records.size() * DELAY_BINS, 0);
+        }
+        uint64_t us = static_cast<uint64_t>(TimeStep(delay).GetMicroSeconds());
+        uint32_t bin = 0;
+        while (us != 0 && bin < DELAY_BINS - 1)
+        {
+            us >>= 1;
+            ++bin;
+        }
+        m_delayHistogram[tag.GetFlowId() * DELAY_BINS + bin]++;
+    }
+}
+
+uint32_t
+DumbbellFlowMonitor::GetNFlows() const
+{
+    return m_records.size();
+}
+
+const DumbbellFlowMonitor::FlowRecord&
+DumbbellFlowMonitor::GetFlowRecord(uint32_t flowId) const
+{
+    NS_ASSERT(flowId < m_records.size());
+    return m_records[flowId];
+}
+
+const DumbbellFlowMonitor::FlowTuple&
+DumbbellFlowMonitor::GetFlowTuple(uint32_t flowId) const
+{
+    NS_ASSERT(flowId < m_tuples.size());
+    return m_tuples[flowId];
+}
+
+uint32_t
+DumbbellFlowMonitor::GetLostPackets(uint32_t flowId) const
+{
+    const FlowRecord& record = GetFlowRecord(flowId);
+    return record.txPackets - record.rxPackets;
+}
+
+Time
+DumbbellFlowMonitor::GetMeanDelay(uint32_t flowId) const
+{
+    const FlowRecord& record = GetFlowRecord(flowId);
+    if (record.rxPackets == 0)
+    {
+        return Time(0);
+    }
+    return TimeStep(record.delaySum / record.rxPackets);
+}
+
+bool
+DumbbellFlowMonitor::IsDelayHistogramEnabled() const
+{
+    return m_enableDelayHistogram;
+}
+
+const uint32_t*
+DumbbellFlowMonitor::GetDelayHistogram(uint32_t flowId) const
+{
+    NS_ASSERT(flowId < m_records.size());
+    if (!m_enableDelayHistogram || m_delayHistogram.size() < (flowId + 1) * DELAY_BINS)
+    {
+        return nullptr;
+    }
+    return &m_delayHistogram[flowId * DELAY_BINS];
+}
+
+Time
+DumbbellFlowMonitor::GetDelayBinStart(uint32_t bin)
+{
+    NS_ASSERT(bin < DELAY_BINS);
+    if (bin == 0)
+    {
+        return Time(0);
+    }
+    return MicroSeconds(static_cast<uint64_t>(1) << (bin - 1));
+}
+
+} // namespace ns3
@@ -0,0 +1,253 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// Define a lightweight per-flow monitor for the leaves of a dumbbell.
+
+#ifndef DUMBBELL_FLOW_MONITOR_H
+#define DUMBBELL_FLOW_MONITOR_H
+
+#include "ns3/ipv4-address.h"
+#include "ns3/ipv4-header.h"
+#include "ns3/node.h"
+#include "ns3/nstime.h"
+#include "ns3/object.h"
+#include "ns3/packet.h"
+#include "ns3/tag.h"
+
+#include <unordered_map>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * \ingroup point-to-point-layout
+ *
+ * \brief Packet tag carrying the flow id and transmit time of a packet
+ * observed by a DumbbellFlowMonitor.
+ */
+class DumbbellFlowTag : public Tag
+{
+  public:
+    /**
+     * \brief Get the type ID.
+     * \return the object TypeId
+     */
+    static TypeId GetTypeId();
+    TypeId GetInstanceTypeId() const override;
+    uint32_t GetSerializedSize() const override;
+    void Serialize(TagBuffer buf) const override;
+    void Deserialize(TagBuffer buf) override;
+    void Print(std::ostream& os) const override;
+
+    DumbbellFlowTag();
+    /**
+     * \param flowId the flow identifier
+     * \param txTime the time the packet left the sending leaf
+     */
+    DumbbellFlowTag(uint32_t flowId, Time txTime);
+
+    /**
+     * \returns the flow identifier
+     */
+    uint32_t GetFlowId() const;
+
+    /**
+     * \returns the time the packet left the sending leaf
+     */
+    Time GetTxTime() const;
+
+  private:
+    uint32_t m_flowId; //!< Flow identifier
+    int64_t m_txTime;  //!< Transmit time (time steps)
+};
+
+/**
+ * \ingroup point-to-point-layout
+ *
+ * \brief A per-flow monitor that only probes the leaves of a dumbbell.
+ *
+ * Unlike FlowMonitor, this monitor does not probe forwarding nodes and
+ * does not keep jitter or packet-size histograms.  For every flow it keeps
+ * a fixed-size record (bytes, packets and one-way delay) in a contiguous
+ * array indexed by flow id, so the per-packet work is one hash lookup on
+ * transmit and one tag peek on receive.  An optional log2-binned delay
+ * histogram can be enabled with the DelayHistogram attribute.
+ *
+ * Packets that were transmitted but not (yet) received are counted as
+ * lost; call the accessors after the applications have stopped to get
+ * exact loss counts.
+ */
+class DumbbellFlowMonitor : public Object
+{
+  public:
+    /**
+     * \brief Get the type ID.
+     * \return the object TypeId
+     */
+    static TypeId GetTypeId();
+
+    DumbbellFlowMonitor();
+    ~DumbbellFlowMonitor() override;
+
+    /// Number of log2-spaced bins in the optional delay histogram
+    static constexpr uint32_t DELAY_BINS = 32;
+
+    /// The five-tuple identifying a flow
+    struct FlowTuple
+    {
+        Ipv4Address source;       //!< Source address
+        Ipv4Address destination;  //!< Destination address
+        uint16_t sourcePort;      //!< Source port
+        uint16_t destinationPort; //!< Destination port
+        uint8_t protocol;         //!< IP protocol number
+    };
+
+    /// Fixed-size per-flow statistics, one cache line per flow
+    struct FlowRecord
+    {
+        uint64_t txBytes{0};   //!< Bytes sent by the source leaf (IP level)
+        uint64_t rxBytes{0};   //!< Bytes received by the destination leaf (IP level)
+        uint32_t txPackets{0}; //!< Packets sent by the source leaf
+        uint32_t rxPackets{0}; //!< Packets received by the destination leaf
+        int64_t delaySum{0};   //!< Sum of one-way delays (time steps)
+        int64_t firstTx{0};    //!< Time of the first transmitted packet (time steps)
+        int64_t lastTx{0};     //!< Time of the last transmitted packet (time steps)
+        int64_t firstRx{0};    //!< Time of the first received packet (time steps)
+        int64_t lastRx{0};     //!< Time of the last received packet (time steps)
+    };
+
+    /**
+     * Attach the monitor to the Ipv4 stack of a leaf node.  The node must
+     * already have an Internet stack installed.
+     *
+     * \param node the leaf node to probe
+     */
+    void Install(Ptr<Node> node);
+
+    /**
+     * \returns the number of flows seen so far
+     */
+    uint32_t GetNFlows() const;
+
+    /**
+     * \returns the statistics of the given flow
+     * \param flowId flow identifier, in [0, GetNFlows())
+     */
+    const FlowRecord& GetFlowRecord(uint32_t flowId) const;
+
+    /**
+     * \returns the five-tuple of the given flow
+     * \param flowId flow identifier, in [0, GetNFlows())
+     */
+    const FlowTuple& GetFlowTuple(uint32_t flowId) const;
+
+    /**
+     * \returns the packets of the given flow that were sent but not received
+     * \param flowId flow identifier, in [0, GetNFlows())
+     */
+    uint32_t GetLostPackets(uint32_t flowId) const;
+
+    /**
+     * \returns the mean one-way delay of the given flow
+     * \param flowId flow identifier, in [0, GetNFlows())
+     */
+    Time GetMeanDelay(uint32_t flowId) const;
+
+    /**
+     * \returns true if the delay histogram is being collected
+     */
+    bool IsDelayHistogramEnabled() const;
+
+    /**
+     * The delay histogram has DELAY_BINS bins; bin 0 counts delays below
+     * 1 us and bin k counts delays in [2^(k-1), 2^k) us.
+     *
+     * \returns a pointer to the DELAY_BINS counters of the given flow, or
+     *          nullptr if the histogram is disabled
+     * \param flowId flow identifier, in [0, GetNFlows())
+     */
+    const uint32_t* GetDelayHistogram(uint32_t flowId) const;
+
+    /**
+     * \returns the lower bound of the given delay histogram bin
+     * \param bin histogram bin, in [0, DELAY_BINS)
+     */
+    static Time GetDelayBinStart(uint32_t bin);
+
+  protected:
+    void DoDispose() override;
+
+  private:
+    /// Hash-map key packing a five-tuple into two words
+    struct FlowKey
+    {
+        uint64_t addresses;        //!< Source (high) and destination (low) addresses
+        uint64_t portsAndProtocol; //!< Ports and protocol number
+
+        /**
+         * \param other the key to compare with
+         * \returns true if both keys are equal
+         */
+        bool operator==(const FlowKey& other) const
+        {
+            return addresses == other.addresses && portsAndProtocol == other.portsAndProtocol;
+        }
+    };
+
+    /// Hasher for FlowKey
+    struct FlowKeyHash
+    {
+        /**
+         * \param key the key to hash
+         * \returns the hash value
+         */
+        std::size_t operator()(const FlowKey& key) const;
+    };
+
+    /**
+     * Ipv4L3Protocol SendOutgoing trace sink
+     * \param header the IPv4 header
+     * \param packet the IPv4 payload
+     * \param interface the outgoing interface
+     */
+    void SendOutgoing(const Ipv4Header& header, Ptr<const Packet> packet, uint32_t interface);
+
+    /**
+     * Ipv4L3Protocol LocalDeliver trace sink
+     * \param header the IPv4 header
+     * \param packet the IPv4 payload
+     * \param interface the incoming interface
+     */
+    void LocalDeliver(const Ipv4Header& header, Ptr<const Packet> packet, uint32_t interface);
+
+    /**
+     * Find the flow of a packet, creating it if needed
+     * \param header the IPv4 header
+     * \param packet the IPv4 payload
+     * \returns the flow identifier
+     */
+    uint32_t Classify(const Ipv4Header& header, Ptr<const Packet> packet);
+
+    std::vector<FlowRecord> m_records;      //!< Per-flow statistics, indexed by flow id
+    std::vector<FlowTuple> m_tuples;        //!< Per-flow five-tuples, indexed by flow id
+    std::vector<uint32_t> m_delayHistogram; //!< DELAY_BINS counters per flow, flattened
+    std::unordered_map<FlowKey, uint32_t, FlowKeyHash> m_flowIds; //!< Five-tuple to flow id
+    bool m_enableDelayHistogram; //!< Collect the delay histogram
+};
+
+} // namespace ns3
+
+#endif /* DUMBBELL_FLOW_MONITOR_H */
@@ -0,0 +1,534 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// Implement a dumbbell experiment described by a scenario file.
+
+#include "dumbbell-scenario.h"
+
+#include "bbr-timeline-recorder.h"
+#include "dumbbell-flow-monitor.h"
+#include "flow-stats-exporter.h"
+#include "point-to-point-dumbbell.h"
+#include "workload-helper.h"
+
+#include "ns3/abort.h"
+#include "ns3/boolean.h"
+#include "ns3/bulk-send-helper.h"
+#include "ns3/config.h"
+#include "ns3/double.h"
+#include "ns3/global-value.h"
+#include "ns3/inet-socket-address.h"
+#include "ns3/ipv4-address-generator.h"
+#include "ns3/ipv4-global-routing-helper.h"
+#include "ns3/ipv4.h"
+#include "ns3/ipv6-address-generator.h"
+#include "ns3/log.h"
+#include "ns3/names.h"
+#include "ns3/packet-sink-helper.h"
+#include "ns3/quic-helper.h"
+#include "ns3/random-variable-stream.h"
+#include "ns3/rng-seed-manager.h"
+#include "ns3/simulator.h"
+#include "ns3/string.h"
+#include "ns3/system-path.h"
+#include "ns3/uinteger.h"
+
+#include <algorithm>
+#include <fstream>
+#include <set>
+#include <sstream>
+
+namespace ns3
+{
+
+NS_LOG_COMPONENT_DEFINE("DumbbellScenario");
+
+namespace
+{
+
+/// Known keys of each section; [config] takes any attribute name
+const std::map<std::string, std::set<std::string>> KEYS = {
+    {"run", {"name", "stopTime", "dir", "seed", "run"}},
+    {"topology", {"leaves", "aggregate", "compiledRouting"}},
+    {"bottleneck", {"rate", "delay", "schedule", "queueDisc", "queueSize", "bql"}},
+    {"leaf", {"rate", "delay", "delayMax", "delays"}},
+    {"transport", {"protocol", "congestion", "quicOnRouters"}},
+    {"app", {"type", "port", "start", "maxBytes", "meanSize", "sizeCdf", "load", "direction"}},
+    {"trace", {"flowStats", "flowStatsFormat", "interval", "bbrTimeline"}},
+};
+
+/**
+ * \param s a string
+ * \returns the string without leading and trailing blanks
+ */
+std::string
+Trim(const std::string& s)
+{
+    std::size_t first = s.find_first_not_of(" \t\r");
+    if (first == std::string::npos)
+    {
+        return "";
+    }
+    return s.substr(first, s.find_last_not_of(" \t\r") - first + 1);
+}
+
+/**
+ * \param value a boolean value: true/false, yes/no or 1/0
+ * \param key the key, for error messages
+ * \returns the parsed value
+ */
+bool
+ParseBool(std::string value, std::string key)
+{
+    if (value == "true" || value == "yes" || value == "1")
+    {
+        return true;
+    }
+    NS_ABORT_MSG_UNLESS(value == "false" || value == "no" || value == "0",
+                        "Invalid boolean \"" << value << "\" for " << key);
+    return false;
+}
+
+/**
+ * \returns the attribute defaults and global values to set again after
+ *          a reset, as (name, value) pairs
+ */
+std::vector<std::pair<std::string, std::string>>&
+CommandLineDefaults()
+{
+    static std::vector<std::pair<std::string, std::string>> defaults;
+    return defaults;
+}
+
+} // namespace
+
+DumbbellScenario::DumbbellScenario()
+{
+}
+
+void
+DumbbellScenario::Load(std::string filename)
+{
+    NS_LOG_FUNCTION(this << filename);
+    std::ifstream is(filename);
+    NS_ABORT_MSG_UNLESS(is.is_open(), "Cannot open scenario " << filename);
+    // The file name, without directory and extension, is the default name
+    std::string base = filename.substr(filename.find_last_of('/') + 1);
+    m_name = base.substr(0, base.find_last_of('.'));
+    Parse(is, filename);
+}
+
+void
+DumbbellScenario::Parse(std::istream& is, std::string source)
+{
+    std::string section;
+    std::string line;
+    uint32_t lineNumber = 0;
+    while (std::getline(is, line))
+    {
+        lineNumber++;
+        line = Trim(line.substr(0, line.find('#')));
+        if (line.empty())
+        {
+            continue;
+        }
+        std::string where = source + ":" + std::to_string(lineNumber);
+        if (line.front() == '[')
+        {
+            NS_ABORT_MSG_UNLESS(line.back() == ']', where << ": malformed section \"" << line << "\"");
+            section = Trim(line.substr(1, line.size() - 2));
+            NS_ABORT_MSG_UNLESS(section == "config" || KEYS.count(section),
+                                where << ": unknown section [" << section << "]");
+            continue;
+        }
+        std::size_t equal = line.find('=');
+        NS_ABORT_MSG_IF(equal == std::string::npos, where << ": expected \"key = value\"");
+        NS_ABORT_MSG_IF(section.empty(), where << ": key outside of any section");
+        std::string key = Trim(line.substr(0, equal));
+        std::string value = Trim(line.substr(equal + 1));
+        if (section != "config")
+        {
+            CheckKey(section, key, where);
+        }
+        Set(section, key, value);
+    }
+}
+
+void
+DumbbellScenario::Set(std::string section, std::string key, std::string value)
+{
+    NS_LOG_FUNCTION(this << section << key << value);
+    if (section == "config")
+    {
+        m_config.emplace_back(key, value);
+        return;
+    }
+    CheckKey(section, key, "Set");
+    m_values[section + "." + key] = value;
+}
+
+std::string
+DumbbellScenario::Get(std::string section, std::string key, std::string defaultValue) const
+{
+    auto it = m_values.find(section + "." + key);
+    return it == m_values.end() || it->second.empty() ? defaultValue : it->second;
+}
+
+std::string
+DumbbellScenario::GetName() const
+{
+    return Get("run", "name", m_name.empty() ? "scenario" : m_name);
+}
+
+std::string
+DumbbellScenario::GetOutputDirectory() const
+{
+    return Get("run", "dir", "bbr-results/scenarios/" + GetName());
+}
+
+void
+DumbbellScenario::Print(std::ostream& os) const
+{
+    for (const auto& value : m_values)
+    {
+        os << value.first << " = " << value.second << "\n";
+    }
+    for (const auto& entry : m_config)
+    {
+        os << "config." << entry.first << " = " << entry.second << "\n";
+    }
+}
+
+void
+DumbbellScenario::CheckKey(std::string section, std::string key, std::string source)
+{
+    auto it = KEYS.find(section);
+    NS_ABORT_MSG_UNLESS(it != KEYS.end(), source << ": unknown section [" << section << "]");
+    NS_ABORT_MSG_UNLESS(it->second.count(key),
+                        source << ": unknown key \"" << key << "\" in [" << section << "]");
+}
+
+void
+DumbbellScenario::Run(std::ostream* report) const
+{
+    NS_LOG_FUNCTION(this);
+    std::string name = GetName();
+    std::string dir = GetOutputDirectory();
+    SystemPath::MakeDirectories(dir);
+
+    if (!Get("run", "seed").empty())
+    {
+        RngSeedManager::SetSeed(std::stoul(Get("run", "seed")));
+    }
+    if (!Get("run", "run").empty())
+    {
+        RngSeedManager::SetRun(std::stoull(Get("run", "run")));
+    }
+
+    // Transport defaults first, so that [config] can still override them
+    std::string protocol = Get("transport", "protocol", "tcp");
+    bool quic = protocol == "quic";
+    NS_ABORT_MSG_UNLESS(quic || protocol == "tcp", "Unknown protocol \"" << protocol << "\"");
+    std::string congestion = Get("transport", "congestion", quic ? "QuicBbr" : "TcpBbr");
+    Config::SetDefault("ns3::TcpL4Protocol::SocketType", StringValue("ns3::" + congestion));
+    if (quic)
+    {
+        Config::SetDefault("ns3::QuicL4Protocol::SocketType", StringValue("ns3::" + congestion));
+    }
+    for (const auto& entry : m_config)
+    {
+        NS_ABORT_MSG_UNLESS(Config::SetDefaultFailSafe(entry.first, StringValue(entry.second)),
+                            "Cannot set " << entry.first << " = " << entry.second);
+    }
+
+    // Topology
+    uint32_t nLeaf = std::stoul(Get("topology", "leaves", "2"));
+    PointToPointHelper bottleneckLink;
+    bottleneckLink.SetDeviceAttribute("DataRate", StringValue(Get("bottleneck", "rate", "10Mbps")));
+    bottleneckLink.SetChannelAttribute("Delay", StringValue(Get("bottleneck", "delay", "10ms")));
+
+    DataRate leafRate(Get("leaf", "rate", "1000Mbps"));
+    Time leafDelay(Get("leaf", "delay", "5ms"));
+    Time leafDelayMax(Get("leaf", "delayMax", Get("leaf", "delay", "5ms")));
+    std::vector<PointToPointDumbbellHelper::LeafLink> leftLinks(nLeaf, {leafRate, leafDelay});
+    std::vector<PointToPointDumbbellHelper::LeafLink> rightLinks(nLeaf, {leafRate, leafDelay});
+    if (leafDelayMax > leafDelay)
+    {
+        Ptr<ConstantRandomVariable> rate = CreateObject<ConstantRandomVariable>();
+        rate->SetAttribute("Constant", DoubleValue(leafRate.GetBitRate()));
+        Ptr<UniformRandomVariable> delay = CreateObject<UniformRandomVariable>();
+        delay->SetAttribute("Min", DoubleValue(leafDelay.GetSeconds()));
+        delay->SetAttribute("Max", DoubleValue(leafDelayMax.GetSeconds()));
+        leftLinks = PointToPointDumbbellHelper::SampleLeafLinks(nLeaf, rate, delay);
+        rightLinks = PointToPointDumbbellHelper::SampleLeafLinks(nLeaf, rate, delay);
+    }
+    // Fixed per-leaf delays, for leaf i on both sides
+    std::stringstream delays(Get("leaf", "delays"));
+    std::string field;
+    for (uint32_t i = 0; std::getline(delays, field, ','); ++i)
+    {
+        NS_ABORT_MSG_IF(leafDelayMax > leafDelay, "leaf.delays and leaf.delayMax are exclusive");
+        NS_ABORT_MSG_IF(i >= nLeaf, "leaf.delays has more delays than leaves");
+        leftLinks[i].delay = Time(Trim(field));
+        rightLinks[i].delay = leftLinks[i].delay;
+    }
+    bool aggregate = ParseBool(Get("topology", "aggregate", "false"), "topology.aggregate");
+    PointToPointDumbbellHelper d(leftLinks,
+                                 rightLinks,
+                                 bottleneckLink,
+                                 PointToPointHelper(),
+                                 aggregate ? PointToPointDumbbellHelper::AGGREGATE_BOTH
+                                           : PointToPointDumbbellHelper::AGGREGATE_NONE);
+
+    if (quic)
+    {
+        QuicHelper stack;
+        d.InstallStackQuic(stack,
+                           ParseBool(Get("transport", "quicOnRouters", "true"),
+                                     "transport.quicOnRouters"));
+    }
+    else
+    {
+        InternetStackHelper stack;
+        d.InstallStack(stack);
+    }
+    // /30 leaf subnets, so that thousands of leaves fit in each side's /16
+    d.AssignIpv4Addresses(Ipv4AddressHelper("10.1.0.0", "255.255.255.252"),
+                          Ipv4AddressHelper("10.2.0.0", "255.255.255.252"),
+                          Ipv4AddressHelper("10.3.0.0", "255.255.255.252"));
+    Ipv4GlobalRoutingHelper::PopulateRoutingTables();
+    if (ParseBool(Get("topology", "compiledRouting", "false"), "topology.compiledRouting"))
+    {
+        d.CompileRouterForwarding();
+    }
+    if (!Get("bottleneck", "queueDisc").empty())
+    {
+        d.InstallBottleneckQueueDisc(Get("bottleneck", "queueDisc"),
+                                     QueueSize(Get("bottleneck", "queueSize", "100p")),
+                                     ParseBool(Get("bottleneck", "bql", "true"), "bottleneck.bql"));
+    }
+    if (!Get("bottleneck", "schedule").empty())
+    {
+        d.ReplayBottleneckSchedule(Get("bottleneck", "schedule"));
+    }
+
+    // Applications
+    std::string factory = quic ? "ns3::QuicSocketFactory" : "ns3::TcpSocketFactory";
+    std::string type = Get("app", "type", "bulk");
+    uint16_t port = std::stoul(Get("app", "port", "50001"));
+    Time start(Get("app", "start", "0s"));
+    Time stopTime(Get("run", "stopTime", "10s"));
+    uint32_t nFlows = std::min(d.LeftCount(), d.RightCount());
+    std::string direction = Get("app", "direction", "leftToRight");
+    NS_ABORT_MSG_UNLESS(direction == "leftToRight" || direction == "rightToLeft",
+                        "Unknown app.direction \"" << direction << "\"");
+    bool reverse = direction == "rightToLeft";
+    // Senders and sinks of flow i
+    auto sender = [&d, reverse](uint32_t i) { return reverse ? d.GetRight(i) : d.GetLeft(i); };
+    auto receiver = [&d, reverse](uint32_t i) { return reverse ? d.GetLeft(i) : d.GetRight(i); };
+    auto senderAddress = [&d, reverse](uint32_t i) {
+        return reverse ? d.GetRightIpv4Address(i) : d.GetLeftIpv4Address(i);
+    };
+    auto receiverAddress = [&d, reverse](uint32_t i) {
+        return reverse ? d.GetLeftIpv4Address(i) : d.GetRightIpv4Address(i);
+    };
+    WorkloadHelper workload(factory);
+    if (type == "bulk")
+    {
+        uint64_t maxBytes = std::stoull(Get("app", "maxBytes", "0"));
+        if (aggregate)
+        {
+            // BulkSendApplication cannot bind its socket to the leaf device
+            // that an aggregated leaf needs (see Ipv4SourceAddressRouting):
+            // each leaf sends a single WorkloadApplication flow instead
+            double size = maxBytes != 0 ? maxBytes : 1e18;
+            workload.SetAttribute("FlowSize",
+                                  StringValue("ns3::ConstantRandomVariable[Constant=" +
+                                              std::to_string(size) + "]"));
+            workload.SetAttribute("InterArrival",
+                                  StringValue("ns3::ConstantRandomVariable[Constant=0]"));
+            workload.SetAttribute("MaxFlows", UintegerValue(1));
+        }
+        for (uint32_t i = 0; i < nFlows; ++i)
+        {
+            InetSocketAddress remote(receiverAddress(i), port + i);
+            ApplicationContainer sourceApps;
+            if (aggregate)
+            {
+                Ipv4Address local = senderAddress(i);
+                Ptr<Ipv4> ipv4 = sender(i)->GetObject<Ipv4>();
+                Ptr<NetDevice> device = ipv4->GetNetDevice(ipv4->GetInterfaceForAddress(local));
+                sourceApps =
+                    workload.Install(sender(i), remote, InetSocketAddress(local, 0), device);
+            }
+            else
+            {
+                BulkSendHelper source(factory, remote);
+                source.SetAttribute("MaxBytes", UintegerValue(maxBytes));
+                sourceApps = source.Install(sender(i));
+            }
+            sourceApps.Start(start);
+            sourceApps.Stop(stopTime);
+
+            PacketSinkHelper sink(factory, InetSocketAddress(Ipv4Address::GetAny(), port + i));
+            ApplicationContainer sinkApps = sink.Install(receiver(i));
+            sinkApps.Start(Seconds(0));
+            sinkApps.Stop(stopTime);
+        }
+    }
+    else
+    {
+        NS_ABORT_MSG_UNLESS(type == "workload", "Unknown application type \"" << type << "\"");
+        NS_ABORT_MSG_IF(reverse, "Workload senders are on the left leaves");
+        // Poisson arrivals sized for the requested load, as in dumbbell-workload.cc
+        DataRate rate(Get("bottleneck", "rate", "10Mbps"));
+        workload.SetOfferedLoad(std::stod(Get("app", "load", "0.6")),
+                                rate,
+                                nLeaf,
+                                std::stod(Get("app", "meanSize", "100000")),
+                                Get("app", "sizeCdf"));
+        workload.SetAttribute("BottleneckRate", DataRateValue(rate));
+        workload.SetAttribute(
+            "BaseRtt",
+            TimeValue(2 * (Time(Get("bottleneck", "delay", "10ms")) + 2 * leafDelay)));
+        ApplicationContainer senders = workload.Install(d, port);
+        senders.Start(start);
+        senders.Stop(stopTime);
+        workload.GetSinks().Start(Seconds(0));
+    }
+
+    // Tracers
+    Ptr<DumbbellFlowMonitor> monitor;
+    Ptr<FlowStatsExporter> exporter;
+    if (ParseBool(Get("trace", "flowStats", "true"), "trace.flowStats"))
+    {
+        monitor = d.InstallFlowMonitor();
+        exporter = CreateObject<FlowStatsExporter>();
+        exporter->SetAttribute("Format", StringValue(Get("trace", "flowStatsFormat", "Csv")));
+        exporter->SetAttribute("Interval", TimeValue(Time(Get("trace", "interval", "1s"))));
+        exporter->Start(monitor, dir + "/flowstats");
+    }
+    Ptr<BbrTimelineRecorder> timeline;
+    if (ParseBool(Get("trace", "bbrTimeline", "false"), "trace.bbrTimeline"))
+    {
+        NS_ABORT_MSG_UNLESS(type == "bulk", "The BBR timeline needs bulk senders");
+        timeline = CreateObject<BbrTimelineRecorder>();
+        timeline->SetOutputFile(dir + "/bbr-timeline.bin");
+        for (uint32_t i = 0; i < nFlows; ++i)
+        {
+            // An aggregated sender node holds one socket per leaf
+            uint32_t socketId = aggregate ? i : 0;
+            Simulator::Schedule(start + Seconds(0.2),
+                                quic ? &BbrTimelineRecorder::TrackQuic
+                                     : &BbrTimelineRecorder::TrackTcp,
+                                timeline,
+                                sender(i)->GetId(),
+                                socketId,
+                                quic ? 1460 : 1448);
+        }
+    }
+
+    Simulator::Stop(stopTime + TimeStep(1));
+    Simulator::Run();
+
+    if (exporter)
+    {
+        exporter->Finish();
+    }
+    if (timeline)
+    {
+        timeline->Dump();
+    }
+
+    // Summary
+    std::ofstream summary(dir + "/summary.txt");
+    std::ostringstream os;
+    os << "Scenario " << name << ": " << protocol << "/" << congestion << ", " << nLeaf
+       << " leaves, " << Get("bottleneck", "rate", "10Mbps") << " bottleneck, "
+       << stopTime.As(Time::S) << std::endl;
+    if (monitor && type == "bulk")
+    {
+        double duration = (stopTime - start).GetSeconds();
+        double total = 0;
+        for (uint32_t flowId = 0; flowId < monitor->GetNFlows(); flowId++)
+        {
+            const DumbbellFlowMonitor::FlowTuple& t = monitor->GetFlowTuple(flowId);
+            if (t.destinationPort < port || t.destinationPort >= port + nFlows)
+            {
+                continue; // ACK flow
+            }
+            double mbps = monitor->GetFlowRecord(flowId).rxBytes * 8.0 / duration / 1e6;
+            total += mbps;
+            os << "  " << t.source << " -> " << t.destination << ": " << mbps << " Mbps"
+               << std::endl;
+        }
+        os << "  total: " << total << " Mbps" << std::endl;
+    }
+    if (type == "workload")
+    {
+        workload.GetStatistics()->Report(os);
+    }
+    summary << os.str();
+    if (report)
+    {
+        *report << os.str();
+    }
+}
+
+void
+DumbbellScenario::Reset()
+{
+    Simulator::Destroy();
+    Config::Reset();
+    RngSeedManager::ResetNextStreamIndex();
+    Ipv4AddressGenerator::Reset();
+    Ipv6AddressGenerator::Reset();
+    Names::Clear();
+    for (const auto& entry : CommandLineDefaults())
+    {
+        if (entry.first.rfind("ns3::", 0) == 0)
+        {
+            Config::SetDefault(entry.first, StringValue(entry.second));
+        }
+        else
+        {
+            Config::SetGlobal(entry.first, StringValue(entry.second));
+        }
+    }
+}
+
+void
+DumbbellScenario::KeepCommandLineDefaults(int argc, char* argv[])
+{
+    CommandLineDefaults().clear();
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg(argv[i]);
+        std::size_t equal = arg.find('=');
+        if (arg.rfind("--", 0) != 0 || equal == std::string::npos)
+        {
+            continue;
+        }
+        // The program's own options are neither attributes nor global values
+        std::string name = arg.substr(2, equal - 2);
+        StringValue value;
+        if (name.rfind("ns3::", 0) == 0 || GlobalValue::GetValueByNameFailSafe(name, value))
+        {
+            CommandLineDefaults().emplace_back(name, arg.substr(equal + 1));
+        }
+    }
+}
+
+} // namespace ns3
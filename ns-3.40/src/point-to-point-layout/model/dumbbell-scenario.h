@@ -0,0 +1,199 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// Define a dumbbell experiment described by a scenario file.
+
+#ifndef DUMBBELL_SCENARIO_H
+#define DUMBBELL_SCENARIO_H
+
+#include <iostream>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * \ingroup point-to-point-layout
+ *
+ * \brief A dumbbell experiment read from a declarative scenario file,
+ * so that variations need no rebuild.
+ *
+ * A scenario file holds "key = value" lines grouped in sections; '#'
+ * starts a comment.  Every key is optional:
+ *
+ * \verbatim
+   [run]
+   name = bbr-10m            # defaults to the file name
+   stopTime = 10s
+   dir = bbr-results/scenarios/bbr-10m
+   seed = 1                  # RngSeedManager seed and run number
+   run = 1
+
+   [topology]
+   leaves = 2                # per side
+   aggregate = false         # one node per side, see LeafAggregation
+   compiledRouting = false   # see CompileRouterForwarding
+
+   [bottleneck]
+   rate = 10Mbps
+   delay = 10ms
+   schedule = trace.txt      # see LinkScheduleReplayer
+   queueDisc = FqCoDel       # root queue disc, default pfifo_fast
+   queueSize = 100p          # MaxSize of the queue disc
+   bql = true                # byte queue limits, with queueDisc
+
+   [leaf]
+   rate = 1000Mbps
+   delay = 5ms
+   delayMax = 5ms            # leaf delays uniform in [delay, delayMax]
+   delays =                  # or fixed delays of leaf 0, 1, ... on both
+                             # sides, e.g. 5ms,10ms; other leaves use delay
+
+   [transport]
+   protocol = tcp            # tcp or quic
+   congestion = TcpBbr       # socket type, without "ns3::"
+   quicOnRouters = true
+
+   [config]                  # any Config::SetDefault, applied in order
+   ns3::TcpSocket::SndBufSize = 4194304
+   ns3::DropTailQueue<Packet>::MaxSize = 100p
+
+   [app]
+   type = bulk               # bulk or workload
+   port = 50001
+   start = 0s
+   direction = leftToRight   # bulk; or rightToLeft, senders on the right
+   maxBytes = 0              # bulk; aggregated leaves send it as one
+                             # WorkloadApplication flow per leaf
+   meanSize = 100000         # workload, as in dumbbell-workload.cc
+   sizeCdf =                 # workload; its mean replaces meanSize
+   load = 0.6
+
+   [trace]
+   flowStats = true          # DumbbellFlowMonitor + FlowStatsExporter
+   flowStatsFormat = Csv
+   interval = 1s
+   bbrTimeline = false
+   \endverbatim
+ *
+ * Run builds the topology, runs it and writes its results under the
+ * output directory; Reset then returns the simulator, the attribute
+ * defaults and the address allocators to their initial state, so that
+ * one process can run a batch of scenarios.  Unknown sections and keys
+ * are rejected when the file is read.
+ */
+class DumbbellScenario
+{
+  public:
+    DumbbellScenario();
+
+    /**
+     * Read a scenario file.
+     *
+     * \param filename the file
+     */
+    void Load(std::string filename);
+
+    /**
+     * Read scenario lines from a stream.
+     *
+     * \param is the stream
+     * \param source the name used in error messages
+     */
+    void Parse(std::istream& is, std::string source);
+
+    /**
+     * Set or override a value.
+     *
+     * \param section the section
+     * \param key the key
+     * \param value the value
+     */
+    void Set(std::string section, std::string key, std::string value);
+
+    /**
+     * \param section the section
+     * \param key the key
+     * \param defaultValue the value returned if the key is not set
+     * \returns the value of a key
+     */
+    std::string Get(std::string section, std::string key, std::string defaultValue = "") const;
+
+    /**
+     * \returns the scenario name
+     */
+    std::string GetName() const;
+
+    /**
+     * \returns the output directory
+     */
+    std::string GetOutputDirectory() const;
+
+    /**
+     * Print the scenario in canonical form, one "section.key = value"
+     * line per key in key order, then the [config] entries in order.
+     *
+     * \param os the stream
+     */
+    void Print(std::ostream& os) const;
+
+    /**
+     * Build the scenario, run it and write its results.  Must be called
+     * once, on a fresh simulator.
+     *
+     * \param report stream for the summary, if any
+     */
+    void Run(std::ostream* report = nullptr) const;
+
+    /**
+     * Destroy the simulation and restore the attribute defaults, the
+     * global values, the automatic random stream numbering and the IP
+     * address allocators, ready for the next scenario.  The attribute
+     * defaults and global values passed to KeepCommandLineDefaults are
+     * then set again.
+     */
+    static void Reset();
+
+    /**
+     * Keep the "--name=value" attribute defaults (--ns3::TcpSocket::SegmentSize=1448)
+     * and global values (--RngRun=2) of a command line across Reset, which
+     * otherwise discards them after the first scenario.  Call it once,
+     * after CommandLine::Parse; other arguments are ignored.
+     *
+     * \param argc the argument count
+     * \param argv the arguments
+     */
+    static void KeepCommandLineDefaults(int argc, char* argv[]);
+
+  private:
+    /**
+     * Abort unless a key is known
+     * \param section the section
+     * \param key the key
+     * \param source the name used in error messages
+     */
+    static void CheckKey(std::string section, std::string key, std::string source);
+
+    std::string m_name;                                        //!< Scenario name
+    std::map<std::string, std::string> m_values;               //!< "section.key" to value
+    std::vector<std::pair<std::string, std::string>> m_config; //!< [config] entries, in order
+};
+
+} // namespace ns3
+
+#endif /* DUMBBELL_SCENARIO_H */
@@ -0,0 +1,228 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// Implement constant-memory flow-completion-time statistics.
+
+#include "fct-statistics.h"
+
+#include "ns3/abort.h"
+#include "ns3/log.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+
+namespace ns3
+{
+
+NS_LOG_COMPONENT_DEFINE("FctStatistics");
+
+NS_OBJECT_ENSURE_REGISTERED(FctStatistics);
+
+namespace
+{
+
+const double BIN_RATIO = 1.02;   //!< Ratio between consecutive histogram bins
+const double FCT_MIN = 1e-6;     //!< Smallest FCT histogram bin (s)
+const double FCT_MAX = 1e4;      //!< Largest FCT histogram bin (s)
+const double SLOWDOWN_MIN = 1;   //!< Smallest slowdown histogram bin
+const double SLOWDOWN_MAX = 1e6; //!< Largest slowdown histogram bin
+
+} // namespace
+
+void
+FctStatistics::LogHistogram::Add(double value)
+{
+    uint32_t bin = 0;
+    if (value > min)
+    {
+        bin = std::min<uint32_t>(std::log(value / min) / logRatio, bins.size() - 1);
+    }
+    bins[bin]++;
+}
+
+double
+FctStatistics::LogHistogram::Percentile(uint64_t count, double percentile) const
+{
+    if (count == 0)
+    {
+        return 0;
+    }
+    auto rank = static_cast<uint64_t>(std::ceil(percentile / 100 * count));
+    rank = std::max<uint64_t>(rank, 1);
+    uint64_t seen = 0;
+    for (uint32_t bin = 0; bin < bins.size(); ++bin)
+    {
+        seen += bins[bin];
+        if (seen >= rank)
+        {
+            // Geometric centre of the bin
+            return min * std::exp((bin + 0.5) * logRatio);
+        }
+    }
+    return min * std::exp(bins.size() * logRatio);
+}
+
+TypeId
+FctStatistics::GetTypeId()
+{
+    static TypeId tid = TypeId("ns3::FctStatistics")
+                            .SetParent<Object>()
+                            .SetGroupName("PointToPointLayout")
+                            .AddConstructor<FctStatistics>();
+    return tid;
+}
+
+FctStatistics::FctStatistics()
+    : m_edges{10000, 100000, 1000000, 10000000}
+{
+    NS_LOG_FUNCTION(this);
+    CreateBuckets();
+}
+
+FctStatistics::~FctStatistics()
+{
+    NS_LOG_FUNCTION(this);
+}
+
+void
+FctStatistics::SetSizeBuckets(std::vector<uint64_t> edges)
+{
+    NS_LOG_FUNCTION(this);
+    NS_ABORT_MSG_IF(GetNFlows() != 0, "Cannot change the size buckets after recording flows");
+    NS_ABORT_MSG_UNLESS(std::is_sorted(edges.begin(), edges.end()),
+                        "Size bucket edges must be increasing");
+    m_edges = edges;
+    CreateBuckets();
+}
+
+void
+FctStatistics::CreateBuckets()
+{
+    double logRatio = std::log(BIN_RATIO);
+    auto fctBins = static_cast<uint32_t>(std::ceil(std::log(FCT_MAX / FCT_MIN) / logRatio));
+    auto slowdownBins =
+        static_cast<uint32_t>(std::ceil(std::log(SLOWDOWN_MAX / SLOWDOWN_MIN) / logRatio));
+
+    m_buckets.assign(m_edges.size() + 1, Bucket());
+    for (auto& bucket : m_buckets)
+    {
+        bucket.fct.bins.assign(fctBins, 0);
+        bucket.fct.min = FCT_MIN;
+        bucket.fct.logRatio = logRatio;
+        bucket.slowdown.bins.assign(slowdownBins, 0);
+        bucket.slowdown.min = SLOWDOWN_MIN;
+        bucket.slowdown.logRatio = logRatio;
+    }
+}
+
+void
+FctStatistics::RecordFlow(uint64_t size, Time fct, Time ideal)
+{
+    NS_LOG_FUNCTION(this << size << fct << ideal);
+    uint32_t index = std::lower_bound(m_edges.begin(), m_edges.end(), size) - m_edges.begin();
+    Bucket& bucket = m_buckets[index];
+
+    double seconds = fct.GetSeconds();
+    double slowdown = ideal.IsStrictlyPositive() ? seconds / ideal.GetSeconds() : 1;
+    // Rounding in the ideal FCT must not make a flow faster than ideal
+    slowdown = std::max(slowdown, 1.0);
+
+    bucket.flows++;
+    bucket.fctSum += seconds;
+    bucket.slowdownSum += slowdown;
+    bucket.fct.Add(seconds);
+    bucket.slowdown.Add(slowdown);
+}
+
+uint32_t
+FctStatistics::GetNBuckets() const
+{
+    return m_buckets.size();
+}
+
+uint64_t
+FctStatistics::GetNFlows(uint32_t bucket) const
+{
+    NS_ASSERT(bucket < m_buckets.size());
+    return m_buckets[bucket].flows;
+}
+
+uint64_t
+FctStatistics::GetNFlows() const
+{
+    uint64_t flows = 0;
+    for (const auto& bucket : m_buckets)
+    {
+        flows += bucket.flows;
+    }
+    return flows;
+}
+
+Time
+FctStatistics::GetFctPercentile(uint32_t bucket, double percentile) const
+{
+    NS_ASSERT(bucket < m_buckets.size());
+    const Bucket& b = m_buckets[bucket];
+    return Seconds(b.fct.Percentile(b.flows, percentile));
+}
+
+double
+FctStatistics::GetSlowdownPercentile(uint32_t bucket, double percentile) const
+{
+    NS_ASSERT(bucket < m_buckets.size());
+    const Bucket& b = m_buckets[bucket];
+    return b.slowdown.Percentile(b.flows, percentile);
+}
+
+Time
+FctStatistics::GetMeanFct(uint32_t bucket) const
+{
+    NS_ASSERT(bucket < m_buckets.size());
+    const Bucket& b = m_buckets[bucket];
+    return b.flows ? Seconds(b.fctSum / b.flows) : Time(0);
+}
+
+double
+FctStatistics::GetMeanSlowdown(uint32_t bucket) const
+{
+    NS_ASSERT(bucket < m_buckets.size());
+    const Bucket& b = m_buckets[bucket];
+    return b.flows ? b.slowdownSum / b.flows : 0;
+}
+
+void
+FctStatistics::Report(std::ostream& os) const
+{
+    os << std::left << std::setw(24) << "size (bytes)" << std::right << std::setw(10) << "flows"
+       << std::setw(12) << "mean(ms)" << std::setw(12) << "p50(ms)" << std::setw(12) << "p99(ms)"
+       << std::setw(12) << "p99.9(ms)" << std::setw(10) << "sd-mean" << std::setw(10) << "sd-p50"
+       << std::setw(10) << "sd-p99" << std::endl;
+    for (uint32_t i = 0; i < m_buckets.size(); ++i)
+    {
+        std::string range = (i == 0 ? "0" : std::to_string(m_edges[i - 1] + 1)) + "-" +
+                            (i < m_edges.size() ? std::to_string(m_edges[i]) : "inf");
+        os << std::left << std::setw(24) << range << std::right << std::setw(10) << GetNFlows(i)
+           << std::fixed << std::setprecision(3) << std::setw(12)
+           << GetMeanFct(i).GetSeconds() * 1000 << std::setw(12)
+           << GetFctPercentile(i, 50).GetSeconds() * 1000 << std::setw(12)
+           << GetFctPercentile(i, 99).GetSeconds() * 1000 << std::setw(12)
+           << GetFctPercentile(i, 99.9).GetSeconds() * 1000 << std::setprecision(2)
+           << std::setw(10) << GetMeanSlowdown(i) << std::setw(10) << GetSlowdownPercentile(i, 50)
+           << std::setw(10) << GetSlowdownPercentile(i, 99) << std::defaultfloat << std::endl;
+    }
+}
+
+} // namespace ns3
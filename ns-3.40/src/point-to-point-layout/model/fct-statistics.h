@@ -0,0 +1,165 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// Define constant-memory flow-completion-time statistics.
+
+#ifndef FCT_STATISTICS_H
+#define FCT_STATISTICS_H
+
+#include "ns3/nstime.h"
+#include "ns3/object.h"
+
+#include <ostream>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * \ingroup point-to-point-layout
+ *
+ * \brief Flow-completion-time and slowdown statistics per flow-size bucket.
+ *
+ * Completed flows are folded into log-spaced histograms (bin ratio of
+ * 1.02, i.e. about 1% relative error on the percentiles), so the memory
+ * used does not grow with the number of completed flows.  The slowdown
+ * of a flow is its FCT divided by the FCT it would have in an empty
+ * network, as computed by the caller.
+ */
+class FctStatistics : public Object
+{
+  public:
+    /**
+     * \brief Get the type ID.
+     * \return the object TypeId
+     */
+    static TypeId GetTypeId();
+
+    FctStatistics();
+    ~FctStatistics() override;
+
+    /**
+     * Set the upper edges of the flow-size buckets.  A last bucket
+     * without upper bound is always added.  Must be called before any
+     * flow is recorded.  The default edges are 10 KB, 100 KB, 1 MB and
+     * 10 MB.
+     *
+     * \param edges increasing bucket upper edges, in bytes
+     */
+    void SetSizeBuckets(std::vector<uint64_t> edges);
+
+    /**
+     * Record a completed flow.
+     *
+     * \param size the flow size, in bytes
+     * \param fct the flow completion time
+     * \param ideal the completion time of the flow in an empty network
+     */
+    void RecordFlow(uint64_t size, Time fct, Time ideal);
+
+    /**
+     * \returns the number of size buckets
+     */
+    uint32_t GetNBuckets() const;
+
+    /**
+     * \returns the number of flows recorded in a bucket
+     * \param bucket the bucket index
+     */
+    uint64_t GetNFlows(uint32_t bucket) const;
+
+    /**
+     * \returns the total number of flows recorded
+     */
+    uint64_t GetNFlows() const;
+
+    /**
+     * \returns an FCT percentile of a bucket
+     * \param bucket the bucket index
+     * \param percentile the percentile, in [0, 100]
+     */
+    Time GetFctPercentile(uint32_t bucket, double percentile) const;
+
+    /**
+     * \returns a slowdown percentile of a bucket
+     * \param bucket the bucket index
+     * \param percentile the percentile, in [0, 100]
+     */
+    double GetSlowdownPercentile(uint32_t bucket, double percentile) const;
+
+    /**
+     * \returns the mean FCT of a bucket
+     * \param bucket the bucket index
+     */
+    Time GetMeanFct(uint32_t bucket) const;
+
+    /**
+     * \returns the mean slowdown of a bucket
+     * \param bucket the bucket index
+     */
+    double GetMeanSlowdown(uint32_t bucket) const;
+
+    /**
+     * Print one line per bucket with the flow count, mean, p50, p99 and
+     * p99.9 FCT, and the mean, p50 and p99 slowdown.
+     *
+     * \param os the output stream
+     */
+    void Report(std::ostream& os) const;
+
+  private:
+    /// Log-spaced histogram
+    struct LogHistogram
+    {
+        std::vector<uint64_t> bins; //!< Bin counters
+        double min;                 //!< Lower edge of bin 0
+        double logRatio;            //!< Natural log of the bin ratio
+
+        /**
+         * Count a value
+         * \param value the value
+         */
+        void Add(double value);
+
+        /**
+         * \returns a percentile of the counted values
+         * \param count total number of counted values
+         * \param percentile the percentile, in [0, 100]
+         */
+        double Percentile(uint64_t count, double percentile) const;
+    };
+
+    /// Statistics of one size bucket
+    struct Bucket
+    {
+        uint64_t flows{0};     //!< Flows recorded
+        double fctSum{0};      //!< Sum of FCTs (s)
+        double slowdownSum{0}; //!< Sum of slowdowns
+        LogHistogram fct;      //!< FCT histogram (s)
+        LogHistogram slowdown; //!< Slowdown histogram
+    };
+
+    /**
+     * Create the buckets from m_edges
+     */
+    void CreateBuckets();
+
+    std::vector<uint64_t> m_edges; //!< Bucket upper edges (bytes)
+    std::vector<Bucket> m_buckets; //!< Per-bucket statistics
+};
+
+} // namespace ns3
+
+#endif /* FCT_STATISTICS_H */
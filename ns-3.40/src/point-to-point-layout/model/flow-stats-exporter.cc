@@ -0,0 +1,521 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// Implement a streaming exporter for per-flow statistics.
+
+#include "flow-stats-exporter.h"
+
+#include "ns3/abort.h"
+#include "ns3/boolean.h"
+#include "ns3/enum.h"
+#include "ns3/log.h"
+#include "ns3/simulator.h"
+
+#include <algorithm>
+#include <iterator>
+
+namespace ns3
+{
+
+NS_LOG_COMPONENT_DEFINE("FlowStatsExporter");
+
+NS_OBJECT_ENSURE_REGISTERED(FlowStatsExporter);
+
+namespace
+{
+
+/// Column types of the binary flows table
+enum ColumnType : uint8_t
+{
+    COLUMN_U32 = 0,
+    COLUMN_U64 = 1,
+    COLUMN_I64 = 2,
+};
+
+/// Column directory of the flows table, in output order
+const std::pair<const char*, ColumnType> FLOW_COLUMNS[] = {
+    {"flow_id", COLUMN_U32},
+    {"tx_bytes", COLUMN_U64},
+    {"rx_bytes", COLUMN_U64},
+    {"tx_packets", COLUMN_U32},
+    {"rx_packets", COLUMN_U32},
+    {"lost_packets", COLUMN_U32},
+    {"delay_sum_ns", COLUMN_I64},
+    {"first_tx_ns", COLUMN_I64},
+    {"last_rx_ns", COLUMN_I64},
+};
+
+/**
+ * Write a value in host byte order
+ * \param os the output stream
+ * \param value the value
+ */
+template <typename T>
+void
+WriteRaw(std::ofstream& os, T value)
+{
+    os.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+/**
+ * Write the magic and version that start a binary file
+ * \param os the output stream
+ * \param magic the 8-byte magic
+ */
+void
+WriteMagic(std::ofstream& os, const char* magic)
+{
+    os.write(magic, 8);
+    WriteRaw<uint32_t>(os, 1);
+}
+
+/**
+ * Write one column of the binary flows table
+ * \param os the output stream
+ * \param rows the rows of the snapshot
+ * \param field the field of Row making up the column
+ */
+template <typename Row, typename T>
+void
+WriteColumn(std::ofstream& os, const std::vector<Row>& rows, T Row::*field)
+{
+    for (const auto& row : rows)
+    {
+        WriteRaw<T>(os, row.*field);
+    }
+}
+
+} // namespace
+
+TypeId
+FlowStatsExporter::GetTypeId()
+{
+    static TypeId tid =
+        TypeId("ns3::FlowStatsExporter")
+            .SetParent<Object>()
+            .SetGroupName("PointToPointLayout")
+            .AddConstructor<FlowStatsExporter>()
+            .AddAttribute("Format",
+                          "Output file format",
+                          EnumValue(FlowStatsExporter::CSV),
+                          MakeEnumAccessor(&FlowStatsExporter::m_format),
+                          MakeEnumChecker(FlowStatsExporter::CSV,
+                                          "Csv",
+                                          FlowStatsExporter::BINARY,
+                                          "Binary"))
+            .AddAttribute("Histograms",
+                          "Export the non-empty histogram bins to a separate table",
+                          BooleanValue(false),
+                          MakeBooleanAccessor(&FlowStatsExporter::m_histograms),
+                          MakeBooleanChecker())
+            .AddAttribute("Interval",
+                          "Interval between incremental snapshots; zero only writes "
+                          "the final snapshot",
+                          TimeValue(Seconds(0)),
+                          MakeTimeAccessor(&FlowStatsExporter::m_interval),
+                          MakeTimeChecker());
+    return tid;
+}
+
+FlowStatsExporter::FlowStatsExporter()
+    : m_format(CSV),
+      m_histograms(false),
+      m_rowsWritten(0)
+{
+    NS_LOG_FUNCTION(this);
+}
+
+FlowStatsExporter::~FlowStatsExporter()
+{
+    NS_LOG_FUNCTION(this);
+}
+
+void
+FlowStatsExporter::DoDispose()
+{
+    NS_LOG_FUNCTION(this);
+    m_snapshotEvent.Cancel();
+    m_flowMonitor = nullptr;
+    m_classifier = nullptr;
+    m_leafMonitor = nullptr;
+    Object::DoDispose();
+}
+
+void
+FlowStatsExporter::Start(Ptr<FlowMonitor> monitor,
+                         Ptr<Ipv4FlowClassifier> classifier,
+                         std::string prefix)
+{
+    NS_LOG_FUNCTION(this << monitor << classifier << prefix);
+    m_flowMonitor = monitor;
+    m_classifier = classifier;
+    Open(prefix);
+}
+
+void
+FlowStatsExporter::Start(Ptr<DumbbellFlowMonitor> monitor, std::string prefix)
+{
+    NS_LOG_FUNCTION(this << monitor << prefix);
+    m_leafMonitor = monitor;
+    Open(prefix);
+}
+
+void
+FlowStatsExporter::Open(std::string prefix)
+{
+    bool binary = (m_format == BINARY);
+    std::string suffix = binary ? ".bin" : ".csv";
+    std::ios::openmode mode = binary ? std::ios::out | std::ios::binary : std::ios::out;
+
+    m_flows.open(prefix + "-flows" + suffix, mode);
+    m_tuples.open(prefix + "-tuples" + suffix, mode);
+    NS_ABORT_MSG_UNLESS(m_flows.is_open() && m_tuples.is_open(),
+                        "Cannot open flow statistics files with prefix " << prefix);
+    if (m_histograms)
+    {
+        m_hist.open(prefix + "-hist" + suffix, mode);
+        NS_ABORT_MSG_UNLESS(m_hist.is_open(),
+                            "Cannot open histogram file with prefix " << prefix);
+    }
+
+    if (binary)
+    {
+        WriteMagic(m_flows, "NS3FLOWS");
+        WriteMagic(m_tuples, "NS3TUPLE");
+        if (m_histograms)
+        {
+            WriteMagic(m_hist, "NS3HISTO");
+        }
+        WriteRaw<uint32_t>(m_flows, std::size(FLOW_COLUMNS));
+        for (const auto& column : FLOW_COLUMNS)
+        {
+            WriteRaw<uint8_t>(m_flows, column.second);
+            WriteRaw<uint8_t>(m_flows, std::char_traits<char>::length(column.first));
+            m_flows.write(column.first, std::char_traits<char>::length(column.first));
+        }
+    }
+    else
+    {
+        m_flows << "time_ns";
+        for (const auto& column : FLOW_COLUMNS)
+        {
+            m_flows << "," << column.first;
+        }
+        m_flows << "\n";
+        m_tuples << "flow_id,source,destination,source_port,destination_port,protocol\n";
+        if (m_histograms)
+        {
+            m_hist << "time_ns,flow_id,kind,bin_start,bin_width,count\n";
+        }
+    }
+
+    if (!m_interval.IsZero())
+    {
+        m_snapshotEvent =
+            Simulator::Schedule(m_interval, &FlowStatsExporter::WriteSnapshot, this);
+    }
+}
+
+bool
+FlowStatsExporter::Changed(uint32_t flowId, uint64_t packets)
+{
+    if (flowId >= m_lastPackets.size())
+    {
+        m_lastPackets.resize(flowId + 1, 0);
+        m_tupleWritten.resize(flowId + 1, false);
+    }
+    if (m_lastPackets[flowId] == packets)
+    {
+        return false;
+    }
+    m_lastPackets[flowId] = packets;
+    return true;
+}
+
+void
+FlowStatsExporter::CollectRows(std::vector<Row>& rows)
+{
+    if (m_flowMonitor)
+    {
+        m_flowMonitor->CheckForLostPackets();
+        const FlowMonitor::FlowStatsContainer& stats = m_flowMonitor->GetFlowStats();
+        for (const auto& [flowId, flow] : stats)
+        {
+            if (!Changed(flowId, static_cast<uint64_t>(flow.txPackets) + flow.rxPackets +
+                                     flow.lostPackets))
+            {
+                continue;
+            }
+            if (!m_tupleWritten[flowId])
+            {
+                Ipv4FlowClassifier::FiveTuple t = m_classifier->FindFlow(flowId);
+                WriteTuple(flowId,
+                           t.sourceAddress,
+                           t.destinationAddress,
+                           t.sourcePort,
+                           t.destinationPort,
+                           t.protocol);
+            }
+            rows.push_back({flowId,
+                            flow.txBytes,
+                            flow.rxBytes,
+                            flow.txPackets,
+                            flow.rxPackets,
+                            flow.lostPackets,
+                            flow.delaySum.GetNanoSeconds(),
+                            flow.timeFirstTxPacket.GetNanoSeconds(),
+                            flow.timeLastRxPacket.GetNanoSeconds()});
+        }
+    }
+    else if (m_leafMonitor)
+    {
+        for (uint32_t flowId = 0; flowId < m_leafMonitor->GetNFlows(); ++flowId)
+        {
+            const DumbbellFlowMonitor::FlowRecord& flow = m_leafMonitor->GetFlowRecord(flowId);
+            if (!Changed(flowId, static_cast<uint64_t>(flow.txPackets) + flow.rxPackets))
+            {
+                continue;
+            }
+            if (!m_tupleWritten[flowId])
+            {
+                const DumbbellFlowMonitor::FlowTuple& t = m_leafMonitor->GetFlowTuple(flowId);
+                WriteTuple(flowId,
+                           t.source,
+                           t.destination,
+                           t.sourcePort,
+                           t.destinationPort,
+                           t.protocol);
+            }
+            rows.push_back({flowId,
+                            flow.txBytes,
+                            flow.rxBytes,
+                            flow.txPackets,
+                            flow.rxPackets,
+                            m_leafMonitor->GetLostPackets(flowId),
+                            TimeStep(flow.delaySum).GetNanoSeconds(),
+                            TimeStep(flow.firstTx).GetNanoSeconds(),
+                            TimeStep(flow.lastRx).GetNanoSeconds()});
+        }
+    }
+}
+
+void
+FlowStatsExporter::WriteTuple(uint32_t flowId,
+                              Ipv4Address source,
+                              Ipv4Address destination,
+                              uint16_t sourcePort,
+                              uint16_t destinationPort,
+                              uint8_t protocol)
+{
+    m_tupleWritten[flowId] = true;
+    if (m_format == BINARY)
+    {
+        WriteRaw<uint32_t>(m_tuples, flowId);
+        WriteRaw<uint32_t>(m_tuples, source.Get());
+        WriteRaw<uint32_t>(m_tuples, destination.Get());
+        WriteRaw<uint16_t>(m_tuples, sourcePort);
+        WriteRaw<uint16_t>(m_tuples, destinationPort);
+        WriteRaw<uint8_t>(m_tuples, protocol);
+    }
+    else
+    {
+        m_tuples << flowId << "," << source << "," << destination << "," << sourcePort << ","
+                 << destinationPort << "," << +protocol << "\n";
+    }
+}
+
+void
+FlowStatsExporter::WriteSnapshot()
+{
+    NS_LOG_FUNCTION(this);
+    if (!m_flows.is_open())
+    {
+        return;
+    }
+
+    std::vector<Row> rows;
+    CollectRows(rows);
+    int64_t now = Simulator::Now().GetNanoSeconds();
+    NS_LOG_LOGIC("Snapshot at " << now << " ns: " << rows.size() << " changed flows");
+
+    if (m_format == BINARY)
+    {
+        WriteRaw<int64_t>(m_flows, now);
+        WriteRaw<uint32_t>(m_flows, rows.size());
+        WriteColumn(m_flows, rows, &Row::flowId);
+        WriteColumn(m_flows, rows, &Row::txBytes);
+        WriteColumn(m_flows, rows, &Row::rxBytes);
+        WriteColumn(m_flows, rows, &Row::txPackets);
+        WriteColumn(m_flows, rows, &Row::rxPackets);
+        WriteColumn(m_flows, rows, &Row::lostPackets);
+        WriteColumn(m_flows, rows, &Row::delaySum);
+        WriteColumn(m_flows, rows, &Row::firstTx);
+        WriteColumn(m_flows, rows, &Row::lastRx);
+    }
+    else
+    {
+        for (const auto& row : rows)
+        {
+            m_flows << now << "," << row.flowId << "," << row.txBytes << "," << row.rxBytes << ","
+                    << row.txPackets << "," << row.rxPackets << "," << row.lostPackets << ","
+                    << row.delaySum << "," << row.firstTx << "," << row.lastRx << "\n";
+        }
+    }
+    m_rowsWritten += rows.size();
+
+    if (m_histograms)
+    {
+        std::vector<HistogramBin> bins;
+        CollectHistograms(rows, bins);
+        WriteHistograms(now, bins);
+    }
+
+    // Hand the snapshot to the OS so nothing accumulates in memory
+    m_flows.flush();
+    m_tuples.flush();
+    if (m_hist.is_open())
+    {
+        m_hist.flush();
+    }
+
+    if (!m_interval.IsZero())
+    {
+        m_snapshotEvent =
+            Simulator::Schedule(m_interval, &FlowStatsExporter::WriteSnapshot, this);
+    }
+}
+
+void
+FlowStatsExporter::CollectHistograms(const std::vector<Row>& rows,
+                                     std::vector<HistogramBin>& bins)
+{
+    if (m_flowMonitor)
+    {
+        const FlowMonitor::FlowStatsContainer& stats = m_flowMonitor->GetFlowStats();
+        for (const auto& row : rows)
+        {
+            uint32_t flowId = row.flowId;
+            const FlowMonitor::FlowStats& flow = stats.at(flowId);
+            const Histogram* histograms[] = {&flow.delayHistogram,
+                                             &flow.jitterHistogram,
+                                             &flow.packetSizeHistogram};
+            for (uint8_t kind = 0; kind < 3; ++kind)
+            {
+                const Histogram& h = *histograms[kind];
+                BinCounts& written = WrittenBins(flowId, kind);
+                written.resize(std::max<std::size_t>(written.size(), h.GetNBins()), 0);
+                for (uint32_t bin = 0; bin < h.GetNBins(); ++bin)
+                {
+                    if (h.GetBinCount(bin) != written[bin])
+                    {
+                        written[bin] = h.GetBinCount(bin);
+                        bins.push_back({flowId,
+                                        kind,
+                                        h.GetBinStart(bin),
+                                        h.GetBinWidth(bin),
+                                        h.GetBinCount(bin)});
+                    }
+                }
+            }
+        }
+    }
+    else if (m_leafMonitor && m_leafMonitor->IsDelayHistogramEnabled())
+    {
+        for (const auto& row : rows)
+        {
+            uint32_t flowId = row.flowId;
+            const uint32_t* h = m_leafMonitor->GetDelayHistogram(flowId);
+            if (!h)
+            {
+                continue;
+            }
+            BinCounts& written = WrittenBins(flowId, 0);
+            written.resize(DumbbellFlowMonitor::DELAY_BINS, 0);
+            for (uint32_t bin = 0; bin < DumbbellFlowMonitor::DELAY_BINS; ++bin)
+            {
+                if (h[bin] != written[bin])
+                {
+                    written[bin] = h[bin];
+                    double start = DumbbellFlowMonitor::GetDelayBinStart(bin).GetSeconds();
+                    double width =
+                        (bin + 1 < DumbbellFlowMonitor::DELAY_BINS)
+                            ? DumbbellFlowMonitor::GetDelayBinStart(bin + 1).GetSeconds() - start
+                            : start;
+                    bins.push_back({flowId, 0, start, width, h[bin]});
+                }
+            }
+        }
+    }
+}
+
+FlowStatsExporter::BinCounts&
+FlowStatsExporter::WrittenBins(uint32_t flowId, uint8_t kind)
+{
+    std::size_t index = flowId * 3 + kind;
+    if (index >= m_binsWritten.size())
+    {
+        m_binsWritten.resize(index + 1);
+    }
+    return m_binsWritten[index];
+}
+
+void
+FlowStatsExporter::WriteHistograms(int64_t now, const std::vector<HistogramBin>& bins)
+{
+    if (m_format == BINARY)
+    {
+        WriteRaw<int64_t>(m_hist, now);
+        WriteRaw<uint32_t>(m_hist, bins.size());
+    }
+    for (const auto& bin : bins)
+    {
+        if (m_format == BINARY)
+        {
+            WriteRaw<uint32_t>(m_hist, bin.flowId);
+            WriteRaw<uint8_t>(m_hist, bin.kind);
+            WriteRaw<double>(m_hist, bin.start);
+            WriteRaw<double>(m_hist, bin.width);
+            WriteRaw<uint32_t>(m_hist, bin.count);
+        }
+        else
+        {
+            m_hist << now << "," << bin.flowId << "," << +bin.kind << "," << bin.start << ","
+                   << bin.width << "," << bin.count << "\n";
+        }
+    }
+}
+
+void
+FlowStatsExporter::Finish()
+{
+    NS_LOG_FUNCTION(this);
+    if (!m_flows.is_open())
+    {
+        return;
+    }
+    m_snapshotEvent.Cancel();
+    m_interval = Seconds(0);
+    WriteSnapshot();
+
+    NS_LOG_INFO("Exported " << m_rowsWritten << " flow rows");
+    m_flows.close();
+    m_tuples.close();
+    if (m_histograms)
+    {
+        m_hist.close();
+    }
+}
+
+} // namespace ns3
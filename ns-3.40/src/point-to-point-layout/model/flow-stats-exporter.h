@@ -0,0 +1,223 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// Define a streaming exporter for per-flow statistics.
+
+#ifndef FLOW_STATS_EXPORTER_H
+#define FLOW_STATS_EXPORTER_H
+
+#include "dumbbell-flow-monitor.h"
+
+#include "ns3/event-id.h"
+#include "ns3/flow-monitor.h"
+#include "ns3/ipv4-flow-classifier.h"
+#include "ns3/nstime.h"
+#include "ns3/object.h"
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * \ingroup point-to-point-layout
+ *
+ * \brief Stream per-flow statistics to compact CSV or columnar binary files.
+ *
+ * This is a replacement for FlowMonitor::SerializeToXmlFile when there
+ * are many flows.  Statistics are written as a sequence of snapshots;
+ * every snapshot only contains the flows whose counters changed since the
+ * previous one, so a long simulation can be exported while it runs
+ * instead of in one go at the end.  Three files are produced from the
+ * output prefix:
+ *
+ * - `<prefix>-flows.{csv,bin}`: one row per changed flow per snapshot
+ * - `<prefix>-tuples.{csv,bin}`: the five-tuple of every flow, written once
+ * - `<prefix>-hist.{csv,bin}`: non-empty histogram bins (optional)
+ *
+ * The histograms are cumulative: every snapshot writes the bins whose
+ * count changed since they were last written, with their new count, so
+ * the latest entry of a bin supersedes the earlier ones and the file
+ * grows with the changes, not with snapshots times bins.
+ *
+ * Every binary file starts with an 8-byte magic ("NS3FLOWS", "NS3TUPLE"
+ * or "NS3HISTO") and a uint32 version.  The flows file then has the
+ * column directory (uint32 count, then for each column a uint8 type and a
+ * length-prefixed name).  Each snapshot follows as a block made of an
+ * int64 time in nanoseconds, a uint32 row count and then every column
+ * stored contiguously.  Tuples are fixed-size records (uint32 flow,
+ * uint32 source, uint32 destination, uint16 ports, uint8 protocol); each
+ * histogram snapshot is an int64 time, a uint32 bin count and the bins
+ * (uint32 flow, uint8 kind, double start, double width, uint32 count).
+ * All values are in host byte order.
+ */
+class FlowStatsExporter : public Object
+{
+  public:
+    /**
+     * \brief Get the type ID.
+     * \return the object TypeId
+     */
+    static TypeId GetTypeId();
+
+    FlowStatsExporter();
+    ~FlowStatsExporter() override;
+
+    /// Output file format
+    enum Format
+    {
+        CSV,   //!< Comma separated text files
+        BINARY //!< Columnar binary files
+    };
+
+    /**
+     * Export the flows of a FlowMonitor.
+     *
+     * \param monitor the flow monitor
+     * \param classifier the classifier used to resolve five-tuples
+     * \param prefix output file prefix
+     */
+    void Start(Ptr<FlowMonitor> monitor, Ptr<Ipv4FlowClassifier> classifier, std::string prefix);
+
+    /**
+     * Export the flows of a DumbbellFlowMonitor.
+     *
+     * \param monitor the flow monitor
+     * \param prefix output file prefix
+     */
+    void Start(Ptr<DumbbellFlowMonitor> monitor, std::string prefix);
+
+    /**
+     * Write a snapshot of the flows that changed since the previous one.
+     * Called periodically when the Interval attribute is not zero.
+     */
+    void WriteSnapshot();
+
+    /**
+     * Write a final snapshot and close the output files.
+     */
+    void Finish();
+
+  protected:
+    void DoDispose() override;
+
+  private:
+    /// One exported row
+    struct Row
+    {
+        uint32_t flowId;      //!< Flow identifier
+        uint64_t txBytes;     //!< Transmitted bytes
+        uint64_t rxBytes;     //!< Received bytes
+        uint32_t txPackets;   //!< Transmitted packets
+        uint32_t rxPackets;   //!< Received packets
+        uint32_t lostPackets; //!< Lost packets
+        int64_t delaySum;     //!< Sum of one-way delays (ns)
+        int64_t firstTx;      //!< Time of the first transmitted packet (ns)
+        int64_t lastRx;       //!< Time of the last received packet (ns)
+    };
+
+    /// One non-empty histogram bin
+    struct HistogramBin
+    {
+        uint32_t flowId; //!< Flow identifier
+        uint8_t kind;    //!< 0 delay (s), 1 jitter (s), 2 packet size (bytes)
+        double start;    //!< Bin start
+        double width;    //!< Bin width
+        uint32_t count;  //!< Bin count
+    };
+
+    /// The counts of the bins of one histogram
+    typedef std::vector<uint32_t> BinCounts;
+
+    /**
+     * Open the output files and schedule the first snapshot
+     * \param prefix output file prefix
+     */
+    void Open(std::string prefix);
+
+    /**
+     * Collect the rows that changed since the previous snapshot
+     * \param rows output rows
+     */
+    void CollectRows(std::vector<Row>& rows);
+
+    /**
+     * Collect the histogram bins of the exported flows whose count changed
+     * since they were last written
+     * \param rows the rows of the snapshot
+     * \param bins output bins
+     */
+    void CollectHistograms(const std::vector<Row>& rows, std::vector<HistogramBin>& bins);
+
+    /**
+     * Write the five-tuple of a flow seen for the first time
+     * \param flowId the flow identifier
+     * \param source source address
+     * \param destination destination address
+     * \param sourcePort source port
+     * \param destinationPort destination port
+     * \param protocol IP protocol number
+     */
+    void WriteTuple(uint32_t flowId,
+                    Ipv4Address source,
+                    Ipv4Address destination,
+                    uint16_t sourcePort,
+                    uint16_t destinationPort,
+                    uint8_t protocol);
+
+    /**
+     * \param flowId the flow identifier
+     * \param kind the histogram kind, see HistogramBin
+     * \returns the bin counts of a histogram as last written
+     */
+    BinCounts& WrittenBins(uint32_t flowId, uint8_t kind);
+
+    /**
+     * Write the histograms of a snapshot
+     * \param now the snapshot time (ns)
+     * \param bins the bins to write
+     */
+    void WriteHistograms(int64_t now, const std::vector<HistogramBin>& bins);
+
+    /**
+     * Check if a flow changed since the last snapshot and remember its
+     * current packet count
+     * \param flowId the flow identifier
+     * \param packets total transmitted and received packets of the flow
+     * \returns true if the flow must be exported
+     */
+    bool Changed(uint32_t flowId, uint64_t packets);
+
+    Ptr<FlowMonitor> m_flowMonitor;           //!< Source FlowMonitor, if any
+    Ptr<Ipv4FlowClassifier> m_classifier;     //!< Classifier of m_flowMonitor
+    Ptr<DumbbellFlowMonitor> m_leafMonitor;   //!< Source DumbbellFlowMonitor, if any
+    Format m_format;                          //!< Output format
+    bool m_histograms;                        //!< Export histograms
+    Time m_interval;                          //!< Snapshot interval, zero to disable
+    std::ofstream m_flows;                    //!< Flows table
+    std::ofstream m_tuples;                   //!< Tuples table
+    std::ofstream m_hist;                     //!< Histogram table
+    std::vector<uint64_t> m_lastPackets;      //!< Per-flow packet count at the last snapshot
+    std::vector<bool> m_tupleWritten;         //!< Per-flow tuple already written
+    std::vector<BinCounts> m_binsWritten;     //!< Bin counts last written, by flow * 3 + kind
+    EventId m_snapshotEvent;                  //!< Next periodic snapshot
+    uint64_t m_rowsWritten;                   //!< Total rows written to the flows table
+};
+
+} // namespace ns3
+
+#endif /* FLOW_STATS_EXPORTER_H */
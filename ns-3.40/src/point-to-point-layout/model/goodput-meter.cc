@@ -0,0 +1,200 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// Implement a receiver-side goodput meter fed by PacketSink Rx traces.
+
+#include "goodput-meter.h"
+
+#include "ns3/abort.h"
+#include "ns3/inet-socket-address.h"
+#include "ns3/inet6-socket-address.h"
+#include "ns3/log.h"
+#include "ns3/simulator.h"
+
+#include <iomanip>
+
+namespace ns3
+{
+
+NS_LOG_COMPONENT_DEFINE("GoodputMeter");
+
+NS_OBJECT_ENSURE_REGISTERED(GoodputMeter);
+
+namespace
+{
+
+/**
+ * Print a socket address as "address:port".
+ *
+ * \param os the output stream
+ * \param address the address
+ */
+void
+PrintAddress(std::ostream& os, const Address& address)
+{
+    if (InetSocketAddress::IsMatchingType(address))
+    {
+        InetSocketAddress inet = InetSocketAddress::ConvertFrom(address);
+        os << inet.GetIpv4() << ":" << inet.GetPort();
+    }
+    else if (Inet6SocketAddress::IsMatchingType(address))
+    {
+        Inet6SocketAddress inet6 = Inet6SocketAddress::ConvertFrom(address);
+        os << "[" << inet6.GetIpv6() << "]:" << inet6.GetPort();
+    }
+    else
+    {
+        os << address;
+    }
+}
+
+} // namespace
+
+TypeId
+GoodputMeter::GetTypeId()
+{
+    static TypeId tid =
+        TypeId("ns3::GoodputMeter")
+            .SetParent<Object>()
+            .SetGroupName("PointToPointLayout")
+            .AddConstructor<GoodputMeter>()
+            .AddAttribute("Interval",
+                          "Goodput sampling interval, zero to keep the totals only",
+                          TimeValue(MilliSeconds(200)),
+                          MakeTimeAccessor(&GoodputMeter::m_interval),
+                          MakeTimeChecker(Time(0)))
+            .AddTraceSource("Goodput",
+                            "The goodput of a flow over the last interval",
+                            MakeTraceSourceAccessor(&GoodputMeter::m_goodputTrace),
+                            "ns3::GoodputMeter::GoodputTracedCallback");
+    return tid;
+}
+
+GoodputMeter::GoodputMeter()
+    : m_nSamples(0)
+{
+    NS_LOG_FUNCTION(this);
+}
+
+GoodputMeter::~GoodputMeter()
+{
+    NS_LOG_FUNCTION(this);
+}
+
+void
+GoodputMeter::DoDispose()
+{
+    NS_LOG_FUNCTION(this);
+    m_sampleEvent.Cancel();
+    Object::DoDispose();
+}
+
+void
+GoodputMeter::Install(ApplicationContainer sinks)
+{
+    NS_LOG_FUNCTION(this);
+    for (auto i = sinks.Begin(); i != sinks.End(); ++i)
+    {
+        bool connected =
+            (*i)->TraceConnectWithoutContext("RxWithAddresses",
+                                             MakeCallback(&GoodputMeter::Rx, this));
+        NS_ABORT_MSG_UNLESS(connected, "Application " << (*i)->GetInstanceTypeId().GetName()
+                                                      << " has no RxWithAddresses trace");
+    }
+    if (m_interval.IsStrictlyPositive() && !m_sampleEvent.IsRunning())
+    {
+        m_sampleEvent = Simulator::Schedule(m_interval, &GoodputMeter::Sample, this);
+    }
+}
+
+void
+GoodputMeter::Rx(Ptr<const Packet> packet, const Address& from, const Address& local)
+{
+    auto [it, inserted] = m_flowIds.emplace(FlowKey(from, local), m_flows.size());
+    if (inserted)
+    {
+        NS_LOG_INFO("New flow " << it->second);
+        m_flows.push_back({from, local, 0, 0, Simulator::Now(), Simulator::Now(), 0});
+        m_series.emplace_back(m_nSamples, 0.0);
+    }
+    FlowRecord& flow = m_flows[it->second];
+    flow.rxBytes += packet->GetSize();
+    flow.rxPackets++;
+    flow.lastRx = Simulator::Now();
+}
+
+void
+GoodputMeter::Sample()
+{
+    double seconds = m_interval.GetSeconds();
+    for (uint32_t flowId = 0; flowId < m_flows.size(); ++flowId)
+    {
+        FlowRecord& flow = m_flows[flowId];
+        double bps = (flow.rxBytes - flow.windowBytes) * 8 / seconds;
+        flow.windowBytes = flow.rxBytes;
+        m_series[flowId].push_back(bps);
+        m_goodputTrace(flowId, bps);
+    }
+    m_nSamples++;
+    m_sampleEvent = Simulator::Schedule(m_interval, &GoodputMeter::Sample, this);
+}
+
+uint32_t
+GoodputMeter::GetNFlows() const
+{
+    return m_flows.size();
+}
+
+const GoodputMeter::FlowRecord&
+GoodputMeter::GetFlowRecord(uint32_t flowId) const
+{
+    return m_flows.at(flowId);
+}
+
+const std::vector<double>&
+GoodputMeter::GetSeries(uint32_t flowId) const
+{
+    return m_series.at(flowId);
+}
+
+double
+GoodputMeter::GetGoodput(uint32_t flowId) const
+{
+    const FlowRecord& flow = m_flows.at(flowId);
+    Time active = flow.lastRx - flow.firstRx;
+    return active.IsStrictlyPositive() ? flow.rxBytes * 8 / active.GetSeconds() : 0;
+}
+
+void
+GoodputMeter::Report(std::ostream& os) const
+{
+    std::ios::fmtflags flags = os.flags();
+    std::streamsize precision = os.precision();
+    for (uint32_t flowId = 0; flowId < m_flows.size(); ++flowId)
+    {
+        const FlowRecord& flow = m_flows[flowId];
+        os << "Flow " << flowId << " ";
+        PrintAddress(os, flow.source);
+        os << " > ";
+        PrintAddress(os, flow.destination);
+        os << " Bytes: " << flow.rxBytes << " Packets: " << flow.rxPackets << " Active: "
+           << (flow.lastRx - flow.firstRx).GetSeconds() << " s Goodput: " << std::fixed
+           << std::setprecision(3) << GetGoodput(flowId) / 1e6 << " Mbps" << std::endl;
+        os.flags(flags);
+        os.precision(precision);
+    }
+}
+
+} // namespace ns3
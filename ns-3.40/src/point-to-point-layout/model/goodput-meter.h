@@ -0,0 +1,157 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// Define a receiver-side goodput meter fed by PacketSink Rx traces.
+
+#ifndef GOODPUT_METER_H
+#define GOODPUT_METER_H
+
+#include "ns3/address.h"
+#include "ns3/application-container.h"
+#include "ns3/event-id.h"
+#include "ns3/nstime.h"
+#include "ns3/object.h"
+#include "ns3/packet.h"
+#include "ns3/traced-callback.h"
+
+#include <map>
+#include <ostream>
+#include <utility>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * \ingroup point-to-point-layout
+ *
+ * \brief Measure the goodput delivered to PacketSink applications.
+ *
+ * Sender-side counters (e.g. FlowMonitor txBytes) include the packets
+ * dropped at the bottleneck and the retransmissions; the bytes handed to
+ * a sink do not.  The meter connects to the RxWithAddresses trace of
+ * every installed sink and adds each packet to the counters of its flow,
+ * identified by the sender and sink addresses (so the connections of one
+ * sink are told apart).  Nothing is scheduled per packet.
+ *
+ * Every Interval, a single sampler event turns the bytes received by each
+ * flow during the window into a goodput sample, appended to the series
+ * of the flow and fired on the Goodput trace.  With a zero Interval only
+ * the totals are kept.
+ */
+class GoodputMeter : public Object
+{
+  public:
+    /**
+     * \brief Get the type ID.
+     * \return the object TypeId
+     */
+    static TypeId GetTypeId();
+
+    GoodputMeter();
+    ~GoodputMeter() override;
+
+    /// Counters of a flow
+    struct FlowRecord
+    {
+        Address source;       //!< Sender address and port
+        Address destination;  //!< Sink address and port
+        uint64_t rxBytes;     //!< Bytes received
+        uint64_t rxPackets;   //!< Packets received
+        Time firstRx;         //!< Time of the first packet
+        Time lastRx;          //!< Time of the last packet
+        uint64_t windowBytes; //!< Bytes received at the last sample
+    };
+
+    /**
+     * TracedCallback signature for goodput samples
+     * \param [in] flowId the flow index
+     * \param [in] bps the goodput over the last window, in bit/s
+     */
+    typedef void (*GoodputTracedCallback)(uint32_t flowId, double bps);
+
+    /**
+     * Connect the meter to the Rx traces of PacketSink applications, and
+     * schedule the sampler if not done yet.
+     *
+     * \param sinks the sinks
+     */
+    void Install(ApplicationContainer sinks);
+
+    /**
+     * \returns the number of flows seen so far
+     */
+    uint32_t GetNFlows() const;
+
+    /**
+     * \returns the counters of a flow
+     * \param flowId the flow index
+     */
+    const FlowRecord& GetFlowRecord(uint32_t flowId) const;
+
+    /**
+     * \returns the goodput samples of a flow, in bit/s; sample k covers
+     * the k-th window of every flow, zero before the flow started
+     * \param flowId the flow index
+     */
+    const std::vector<double>& GetSeries(uint32_t flowId) const;
+
+    /**
+     * \returns the goodput of a flow between its first and last packet,
+     * in bit/s
+     * \param flowId the flow index
+     */
+    double GetGoodput(uint32_t flowId) const;
+
+    /**
+     * Print one line per flow: addresses, bytes, packets, active time and
+     * goodput.
+     *
+     * \param os the output stream
+     */
+    void Report(std::ostream& os) const;
+
+  protected:
+    void DoDispose() override;
+
+  private:
+    /**
+     * Add a received packet to its flow
+     * \param packet the packet
+     * \param from the sender address
+     * \param local the sink address
+     */
+    void Rx(Ptr<const Packet> packet, const Address& from, const Address& local);
+
+    /**
+     * Take the goodput samples of every flow and schedule the next ones
+     */
+    void Sample();
+
+    /// Sender and sink addresses of a flow
+    typedef std::pair<Address, Address> FlowKey;
+
+    Time m_interval;                                 //!< Sampling interval
+    std::map<FlowKey, uint32_t> m_flowIds;           //!< Flow index by addresses
+    std::vector<FlowRecord> m_flows;                 //!< Flows
+    std::vector<std::vector<double>> m_series;       //!< Goodput samples of the flows
+    EventId m_sampleEvent;                           //!< Next sample
+    uint32_t m_nSamples;                             //!< Samples taken so far
+    TracedCallback<uint32_t, double> m_goodputTrace; //!< Fired for every sample
+};
+
+} // namespace ns3
+
+#endif /* GOODPUT_METER_H */
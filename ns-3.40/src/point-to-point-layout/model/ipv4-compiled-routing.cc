@@ -0,0 +1,404 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// Implement a forwarding fast path compiled from the static and global routes.
+
+#include "ipv4-compiled-routing.h"
+
+#include "ns3/abort.h"
+#include "ns3/ipv4-list-routing.h"
+#include "ns3/log.h"
+#include "ns3/output-stream-wrapper.h"
+#include "ns3/simulator.h"
+
+#include <algorithm>
+#include <iomanip>
+
+namespace ns3
+{
+
+NS_LOG_COMPONENT_DEFINE("Ipv4CompiledRouting");
+
+NS_OBJECT_ENSURE_REGISTERED(Ipv4CompiledRouting);
+
+void
+Ipv4CompiledRouting::Trie::Insert(uint32_t prefix, uint32_t length, int32_t route)
+{
+    if (length == 0)
+    {
+        defaultRoute = route;
+        return;
+    }
+    if (nodes.empty())
+    {
+        nodes.emplace_back();
+    }
+    uint32_t node = 0;
+    for (uint32_t level = 0;; ++level)
+    {
+        uint32_t byte = (prefix >> (24 - 8 * level)) & 0xff;
+        uint32_t remaining = length - 8 * level;
+        if (remaining <= 8)
+        {
+            // Expand the prefix over the slots of this level it covers
+            uint32_t span = 1U << (8 - remaining);
+            uint32_t first = byte & ~(span - 1);
+            for (uint32_t slot = first; slot < first + span; ++slot)
+            {
+                nodes[node][slot].route = route;
+            }
+            return;
+        }
+        if (nodes[node][byte].child < 0)
+        {
+            nodes[node][byte].child = nodes.size();
+            nodes.emplace_back();
+        }
+        node = nodes[node][byte].child;
+    }
+}
+
+int32_t
+Ipv4CompiledRouting::Trie::Lookup(uint32_t address) const
+{
+    int32_t best = defaultRoute;
+    if (nodes.empty())
+    {
+        return best;
+    }
+    uint32_t node = 0;
+    for (uint32_t level = 0; level < 4; ++level)
+    {
+        const Slot& slot = nodes[node][(address >> (24 - 8 * level)) & 0xff];
+        if (slot.route >= 0)
+        {
+            best = slot.route;
+        }
+        if (slot.child < 0)
+        {
+            break;
+        }
+        node = slot.child;
+    }
+    return best;
+}
+
+TypeId
+Ipv4CompiledRouting::GetTypeId()
+{
+    static TypeId tid = TypeId("ns3::Ipv4CompiledRouting")
+                            .SetParent<Ipv4RoutingProtocol>()
+                            .SetGroupName("PointToPointLayout")
+                            .AddConstructor<Ipv4CompiledRouting>();
+    return tid;
+}
+
+Ipv4CompiledRouting::Ipv4CompiledRouting()
+    : m_dirty(true),
+      m_nStaticRoutes(0),
+      m_nGlobalRoutes(0),
+      m_nBuilds(0)
+{
+    NS_LOG_FUNCTION(this);
+}
+
+Ipv4CompiledRouting::~Ipv4CompiledRouting()
+{
+    NS_LOG_FUNCTION(this);
+}
+
+void
+Ipv4CompiledRouting::DoDispose()
+{
+    NS_LOG_FUNCTION(this);
+    m_ipv4 = nullptr;
+    m_static = nullptr;
+    m_global = nullptr;
+    m_entries.clear();
+    m_staticTrie = Trie();
+    m_globalTrie = Trie();
+    Ipv4RoutingProtocol::DoDispose();
+}
+
+Ptr<Ipv4CompiledRouting>
+Ipv4CompiledRouting::Install(Ptr<Node> node)
+{
+    Ptr<Ipv4> ipv4 = node->GetObject<Ipv4>();
+    NS_ABORT_MSG_UNLESS(ipv4, "Install an Internet stack first");
+    Ptr<Ipv4ListRouting> list = DynamicCast<Ipv4ListRouting>(ipv4->GetRoutingProtocol());
+    NS_ABORT_MSG_UNLESS(list, "Ipv4CompiledRouting needs an Ipv4ListRouting");
+    // A second instance would only compile the same tables again
+    for (uint32_t i = 0; i < list->GetNRoutingProtocols(); ++i)
+    {
+        int16_t priority;
+        Ptr<Ipv4CompiledRouting> routing =
+            DynamicCast<Ipv4CompiledRouting>(list->GetRoutingProtocol(i, priority));
+        if (routing)
+        {
+            return routing;
+        }
+    }
+    Ptr<Ipv4CompiledRouting> routing = CreateObject<Ipv4CompiledRouting>();
+    // Just above the static routing (0), which it stands in for
+    list->AddRoutingProtocol(routing, 1);
+    return routing;
+}
+
+void
+Ipv4CompiledRouting::Invalidate()
+{
+    m_dirty = true;
+}
+
+uint32_t
+Ipv4CompiledRouting::GetNBuilds() const
+{
+    return m_nBuilds;
+}
+
+uint32_t
+Ipv4CompiledRouting::GetNTrieNodes() const
+{
+    return m_staticTrie.nodes.size() + m_globalTrie.nodes.size();
+}
+
+void
+Ipv4CompiledRouting::Update()
+{
+    // Route counts are O(1) to read and catch PopulateRoutingTables,
+    // RecomputeRoutingTables and Add/RemoveRoute calls
+    if (m_dirty || (m_static && m_static->GetNRoutes() != m_nStaticRoutes) ||
+        (m_global && m_global->GetNRoutes() != m_nGlobalRoutes))
+    {
+        Compile();
+    }
+}
+
+void
+Ipv4CompiledRouting::Compile()
+{
+    NS_LOG_FUNCTION(this);
+    m_entries.clear();
+    m_staticTrie = Trie();
+    m_globalTrie = Trie();
+
+    m_static = nullptr;
+    m_global = nullptr;
+    Ptr<Ipv4ListRouting> list = DynamicCast<Ipv4ListRouting>(m_ipv4->GetRoutingProtocol());
+    for (uint32_t i = 0; list && i < list->GetNRoutingProtocols(); ++i)
+    {
+        int16_t priority;
+        Ptr<Ipv4RoutingProtocol> protocol = list->GetRoutingProtocol(i, priority);
+        if (!m_static)
+        {
+            m_static = DynamicCast<Ipv4StaticRouting>(protocol);
+        }
+        if (!m_global)
+        {
+            m_global = DynamicCast<Ipv4GlobalRouting>(protocol);
+        }
+    }
+
+    // Both tables keep their routes in lists that they only expose by
+    // index, and GetRoute(i) walks the list up to i, so reading a table
+    // is quadratic in its size; the tries are therefore only rebuilt when
+    // the tables changed (see Update), never per packet
+    std::vector<Candidate> candidates;
+    if (m_static)
+    {
+        m_nStaticRoutes = m_static->GetNRoutes();
+        candidates.reserve(m_nStaticRoutes);
+        for (uint32_t i = 0; i < m_nStaticRoutes; ++i)
+        {
+            candidates.push_back({m_static->GetRoute(i), m_static->GetMetric(i), i});
+        }
+        CompileTable(candidates, m_staticTrie);
+    }
+    candidates.clear();
+    if (m_global)
+    {
+        m_nGlobalRoutes = m_global->GetNRoutes();
+        candidates.reserve(m_nGlobalRoutes);
+        for (uint32_t i = 0; i < m_nGlobalRoutes; ++i)
+        {
+            candidates.push_back({*m_global->GetRoute(i), 0, i});
+        }
+        CompileTable(candidates, m_globalTrie);
+    }
+
+    m_dirty = false;
+    m_nBuilds++;
+    NS_LOG_INFO("Compiled " << m_entries.size() << " routes into " << GetNTrieNodes()
+                            << " trie nodes");
+}
+
+void
+Ipv4CompiledRouting::CompileTable(std::vector<Candidate>& candidates, Trie& trie)
+{
+    // Insert the shorter prefixes first so that longer ones override them,
+    // and among equal prefixes the preferred route last
+    std::sort(candidates.begin(), candidates.end(), [](const Candidate& a, const Candidate& b) {
+        uint16_t la = a.entry.GetDestNetworkMask().GetPrefixLength();
+        uint16_t lb = b.entry.GetDestNetworkMask().GetPrefixLength();
+        if (la != lb)
+        {
+            return la < lb;
+        }
+        if (a.metric != b.metric)
+        {
+            return a.metric > b.metric;
+        }
+        return a.order > b.order;
+    });
+
+    for (const auto& candidate : candidates)
+    {
+        const Ipv4RoutingTableEntry& e = candidate.entry;
+        if (e.GetDest().IsMulticast() || !m_ipv4->IsUp(e.GetInterface()))
+        {
+            continue;
+        }
+        Entry entry;
+        entry.mask = e.GetDestNetworkMask();
+        entry.network = e.GetDest().CombineMask(entry.mask);
+        entry.gateway = e.GetGateway();
+        entry.interface = e.GetInterface();
+        entry.route = Create<Ipv4Route>();
+        entry.route->SetDestination(entry.network);
+        entry.route->SetGateway(entry.gateway);
+        entry.route->SetOutputDevice(m_ipv4->GetNetDevice(entry.interface));
+        entry.route->SetSource(m_ipv4->SourceAddressSelection(entry.interface, entry.network));
+        trie.Insert(entry.network.Get(), entry.mask.GetPrefixLength(), m_entries.size());
+        m_entries.push_back(entry);
+    }
+}
+
+int32_t
+Ipv4CompiledRouting::Lookup(Ipv4Address destination)
+{
+    Update();
+    int32_t route = m_staticTrie.Lookup(destination.Get());
+    if (route < 0)
+    {
+        route = m_globalTrie.Lookup(destination.Get());
+    }
+    return route;
+}
+
+Ptr<Ipv4Route>
+Ipv4CompiledRouting::RouteOutput(Ptr<Packet> p,
+                                 const Ipv4Header& header,
+                                 Ptr<NetDevice> oif,
+                                 Socket::SocketErrno& sockerr)
+{
+    NS_LOG_FUNCTION(this << header << oif);
+    Ipv4Address destination = header.GetDestination();
+    sockerr = Socket::ERROR_NOROUTETOHOST;
+    if (oif || destination.IsMulticast() || destination.IsBroadcast())
+    {
+        return nullptr;
+    }
+    int32_t index = Lookup(destination);
+    if (index < 0)
+    {
+        return nullptr;
+    }
+    const Entry& entry = m_entries[index];
+    Ptr<Ipv4Route> route = Create<Ipv4Route>();
+    route->SetDestination(destination);
+    route->SetGateway(entry.gateway);
+    route->SetOutputDevice(entry.route->GetOutputDevice());
+    route->SetSource(entry.route->GetSource());
+    sockerr = Socket::ERROR_NOTERROR;
+    return route;
+}
+
+bool
+Ipv4CompiledRouting::RouteInput(Ptr<const Packet> p,
+                                const Ipv4Header& header,
+                                Ptr<const NetDevice> idev,
+                                const UnicastForwardCallback& ucb,
+                                const MulticastForwardCallback& mcb,
+                                const LocalDeliverCallback& lcb,
+                                const ErrorCallback& ecb)
+{
+    NS_LOG_FUNCTION(this << p << header << idev);
+    // Ipv4ListRouting has already delivered local packets and rejected
+    // those of non-forwarding interfaces
+    Ipv4Address destination = header.GetDestination();
+    if (destination.IsMulticast() || destination.IsBroadcast())
+    {
+        return false;
+    }
+    int32_t index = Lookup(destination);
+    if (index < 0)
+    {
+        return false;
+    }
+    ucb(m_entries[index].route, p, header);
+    return true;
+}
+
+void
+Ipv4CompiledRouting::NotifyInterfaceUp(uint32_t interface)
+{
+    m_dirty = true;
+}
+
+void
+Ipv4CompiledRouting::NotifyInterfaceDown(uint32_t interface)
+{
+    m_dirty = true;
+}
+
+void
+Ipv4CompiledRouting::NotifyAddAddress(uint32_t interface, Ipv4InterfaceAddress address)
+{
+    m_dirty = true;
+}
+
+void
+Ipv4CompiledRouting::NotifyRemoveAddress(uint32_t interface, Ipv4InterfaceAddress address)
+{
+    m_dirty = true;
+}
+
+void
+Ipv4CompiledRouting::SetIpv4(Ptr<Ipv4> ipv4)
+{
+    NS_LOG_FUNCTION(this << ipv4);
+    NS_ASSERT(!m_ipv4 && ipv4);
+    m_ipv4 = ipv4;
+    m_dirty = true;
+}
+
+void
+Ipv4CompiledRouting::PrintRoutingTable(Ptr<OutputStreamWrapper> stream, Time::Unit unit) const
+{
+    std::ostream* os = stream->GetStream();
+    *os << "Node: " << m_ipv4->GetObject<Node>()->GetId() << ", Time: " << Now().As(unit)
+        << ", Ipv4CompiledRouting table (" << m_entries.size() << " routes, " << GetNTrieNodes()
+        << " trie nodes" << (m_dirty ? ", stale" : "") << ")" << std::endl;
+    *os << std::setiosflags(std::ios::left) << std::setw(16) << "Destination" << std::setw(16)
+        << "Gateway" << std::setw(16) << "Genmask" << "Iface" << std::endl;
+    for (const auto& entry : m_entries)
+    {
+        *os << std::setw(16) << entry.network << std::setw(16) << entry.gateway << std::setw(16)
+            << entry.mask << entry.interface << std::endl;
+    }
+    *os << std::resetiosflags(std::ios::left) << std::endl;
+}
+
+} // namespace ns3
@@ -0,0 +1,204 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// Define a forwarding fast path compiled from the static and global routes.
+
+#ifndef IPV4_COMPILED_ROUTING_H
+#define IPV4_COMPILED_ROUTING_H
+
+#include "ns3/ipv4-global-routing.h"
+#include "ns3/ipv4-routing-protocol.h"
+#include "ns3/ipv4-static-routing.h"
+#include "ns3/ipv4.h"
+#include "ns3/node.h"
+
+#include <array>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * \ingroup point-to-point-layout
+ *
+ * \brief Forward unicast packets with a multibit trie compiled from the
+ * Ipv4StaticRouting and Ipv4GlobalRouting tables of the node.
+ *
+ * Ipv4StaticRouting and Ipv4GlobalRouting scan their route lists for
+ * every packet, so the forwarding cost of a router grows with the number
+ * of leaf subnets behind it.  This protocol compiles both tables into
+ * stride-8 tries (four levels for IPv4, prefixes expanded to the next
+ * level boundary), so a lookup is at most four array accesses per table
+ * whatever the number of routes, and forwarding reuses one precomputed
+ * Ipv4Route per table entry.
+ *
+ * It must be added to the node's Ipv4ListRouting just above the static
+ * routing (Install does that).  The static table is searched first, then
+ * the global one, as Ipv4ListRouting would; within a table the longest
+ * prefix wins, then the lowest metric, then the first route.  Multicast,
+ * broadcast, packets sent through a bound device and destinations
+ * without a compiled route are left to the other protocols.
+ *
+ * The tries are rebuilt lazily, on the first lookup after an interface
+ * or address change or after the number of routes of either table
+ * changed.  Call Invalidate after replacing routes without changing
+ * their number.  A rebuild is quadratic in the number of routes, since
+ * Ipv4StaticRouting and Ipv4GlobalRouting only give indexed access to
+ * their route lists; populate the tables once rather than route by route
+ * between packets.
+ */
+class Ipv4CompiledRouting : public Ipv4RoutingProtocol
+{
+  public:
+    /**
+     * \brief Get the type ID.
+     * \return the object TypeId
+     */
+    static TypeId GetTypeId();
+
+    Ipv4CompiledRouting();
+    ~Ipv4CompiledRouting() override;
+
+    /**
+     * Add an Ipv4CompiledRouting to the Ipv4ListRouting of a node, unless
+     * it already has one, which is then returned.
+     *
+     * \param node the node, with an Internet stack installed
+     * \returns the routing protocol
+     */
+    static Ptr<Ipv4CompiledRouting> Install(Ptr<Node> node);
+
+    /**
+     * Force a rebuild of the tries on the next lookup.
+     */
+    void Invalidate();
+
+    /**
+     * \returns the number of times the tries were built
+     */
+    uint32_t GetNBuilds() const;
+
+    /**
+     * \returns the number of trie nodes, over both tables
+     */
+    uint32_t GetNTrieNodes() const;
+
+    Ptr<Ipv4Route> RouteOutput(Ptr<Packet> p,
+                               const Ipv4Header& header,
+                               Ptr<NetDevice> oif,
+                               Socket::SocketErrno& sockerr) override;
+    bool RouteInput(Ptr<const Packet> p,
+                    const Ipv4Header& header,
+                    Ptr<const NetDevice> idev,
+                    const UnicastForwardCallback& ucb,
+                    const MulticastForwardCallback& mcb,
+                    const LocalDeliverCallback& lcb,
+                    const ErrorCallback& ecb) override;
+    void NotifyInterfaceUp(uint32_t interface) override;
+    void NotifyInterfaceDown(uint32_t interface) override;
+    void NotifyAddAddress(uint32_t interface, Ipv4InterfaceAddress address) override;
+    void NotifyRemoveAddress(uint32_t interface, Ipv4InterfaceAddress address) override;
+    void SetIpv4(Ptr<Ipv4> ipv4) override;
+    void PrintRoutingTable(Ptr<OutputStreamWrapper> stream,
+                           Time::Unit unit = Time::S) const override;
+
+  protected:
+    void DoDispose() override;
+
+  private:
+    /// One trie slot
+    struct Slot
+    {
+        int32_t route{-1}; //!< Route of the longest prefix ending here, or -1
+        int32_t child{-1}; //!< Next-level node, or -1
+    };
+
+    /// A compiled routing table
+    struct Trie
+    {
+        std::vector<std::array<Slot, 256>> nodes; //!< Trie nodes; node 0 is the root
+        int32_t defaultRoute{-1};                 //!< Default route, or -1
+
+        /**
+         * Insert a prefix, overriding the shorter prefixes it covers
+         * \param prefix the prefix
+         * \param length the prefix length
+         * \param route the route index
+         */
+        void Insert(uint32_t prefix, uint32_t length, int32_t route);
+
+        /**
+         * \returns the route of the longest prefix matching an address, or -1
+         * \param address the address
+         */
+        int32_t Lookup(uint32_t address) const;
+    };
+
+    /// A compiled route
+    struct Entry
+    {
+        Ipv4Address network;  //!< Destination network
+        Ipv4Mask mask;        //!< Destination mask
+        Ipv4Address gateway;  //!< Next hop, zero if on-link
+        uint32_t interface;   //!< Output interface
+        Ptr<Ipv4Route> route; //!< Route handed to forwarded packets
+    };
+
+    /// A route read from a table, before compilation
+    struct Candidate
+    {
+        Ipv4RoutingTableEntry entry; //!< The route
+        uint32_t metric;             //!< Its metric
+        uint32_t order;              //!< Its position in the table
+    };
+
+    /**
+     * Rebuild the tries if the routes may have changed
+     */
+    void Update();
+
+    /**
+     * Rebuild the tries from the static and global tables
+     */
+    void Compile();
+
+    /**
+     * Compile one table
+     * \param candidates the routes of the table
+     * \param trie the trie to fill
+     */
+    void CompileTable(std::vector<Candidate>& candidates, Trie& trie);
+
+    /**
+     * \returns the compiled route for a destination, or -1
+     * \param destination the destination
+     */
+    int32_t Lookup(Ipv4Address destination);
+
+    Ptr<Ipv4> m_ipv4;                //!< IPv4 of the node
+    Ptr<Ipv4StaticRouting> m_static; //!< Static routing of the node
+    Ptr<Ipv4GlobalRouting> m_global; //!< Global routing of the node
+    std::vector<Entry> m_entries;    //!< Compiled routes
+    Trie m_staticTrie;               //!< Compiled static table
+    Trie m_globalTrie;               //!< Compiled global table
+    bool m_dirty;                    //!< Rebuild before the next lookup
+    uint32_t m_nStaticRoutes;        //!< Static routes when compiled
+    uint32_t m_nGlobalRoutes;        //!< Global routes when compiled
+    uint32_t m_nBuilds;              //!< Number of builds
+};
+
+} // namespace ns3
+
+#endif /* IPV4_COMPILED_ROUTING_H */
@@ -0,0 +1,205 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// Implement a routing protocol sending each source address out of its own interface.
+
+#include "ipv4-source-address-routing.h"
+
+#include "ns3/abort.h"
+#include "ns3/log.h"
+#include "ns3/net-device.h"
+#include "ns3/node.h"
+#include "ns3/output-stream-wrapper.h"
+#include "ns3/simulator.h"
+
+#include <iomanip>
+
+namespace ns3
+{
+
+NS_LOG_COMPONENT_DEFINE("Ipv4SourceAddressRouting");
+
+NS_OBJECT_ENSURE_REGISTERED(Ipv4SourceAddressRouting);
+
+TypeId
+Ipv4SourceAddressRouting::GetTypeId()
+{
+    static TypeId tid = TypeId("ns3::Ipv4SourceAddressRouting")
+                            .SetParent<Ipv4RoutingProtocol>()
+                            .SetGroupName("PointToPointLayout")
+                            .AddConstructor<Ipv4SourceAddressRouting>();
+    return tid;
+}
+
+Ipv4SourceAddressRouting::Ipv4SourceAddressRouting()
+{
+    NS_LOG_FUNCTION(this);
+}
+
+Ipv4SourceAddressRouting::~Ipv4SourceAddressRouting()
+{
+    NS_LOG_FUNCTION(this);
+}
+
+void
+Ipv4SourceAddressRouting::DoDispose()
+{
+    NS_LOG_FUNCTION(this);
+    m_ipv4 = nullptr;
+    m_interfaces.clear();
+    m_managed.clear();
+    Ipv4RoutingProtocol::DoDispose();
+}
+
+void
+Ipv4SourceAddressRouting::AddInterface(uint32_t interface)
+{
+    NS_LOG_FUNCTION(this << interface);
+    NS_ABORT_MSG_UNLESS(m_ipv4, "The routing protocol is not attached to a node");
+    NS_ABORT_MSG_IF(m_ipv4->GetNAddresses(interface) == 0, "Interface without address");
+    if (m_managed.size() <= interface)
+    {
+        m_managed.resize(interface + 1, false);
+    }
+    m_managed[interface] = true;
+    for (uint32_t i = 0; i < m_ipv4->GetNAddresses(interface); ++i)
+    {
+        m_interfaces[m_ipv4->GetAddress(interface, i).GetLocal().Get()] = interface;
+    }
+}
+
+uint32_t
+Ipv4SourceAddressRouting::GetNInterfaces() const
+{
+    uint32_t n = 0;
+    for (bool managed : m_managed)
+    {
+        n += managed;
+    }
+    return n;
+}
+
+Ptr<Ipv4Route>
+Ipv4SourceAddressRouting::MakeRoute(uint32_t interface, Ipv4Address destination) const
+{
+    // Point-to-point access links need no gateway
+    Ptr<Ipv4Route> route = Create<Ipv4Route>();
+    route->SetDestination(destination);
+    route->SetSource(m_ipv4->GetAddress(interface, 0).GetLocal());
+    route->SetGateway(Ipv4Address::GetZero());
+    route->SetOutputDevice(m_ipv4->GetNetDevice(interface));
+    return route;
+}
+
+Ptr<Ipv4Route>
+Ipv4SourceAddressRouting::RouteOutput(Ptr<Packet> p,
+                                      const Ipv4Header& header,
+                                      Ptr<NetDevice> oif,
+                                      Socket::SocketErrno& sockerr)
+{
+    NS_LOG_FUNCTION(this << header << oif);
+    auto it = m_interfaces.find(header.GetSource().Get());
+    if (it != m_interfaces.end() && m_ipv4->IsUp(it->second))
+    {
+        sockerr = Socket::ERROR_NOTERROR;
+        return MakeRoute(it->second, header.GetDestination());
+    }
+    // Sockets ask for a route before they have a source address (TCP when
+    // it connects, UDP on every send), so they bind to their leaf device
+    if (oif)
+    {
+        int32_t interface = m_ipv4->GetInterfaceForDevice(oif);
+        if (interface >= 0 && static_cast<uint32_t>(interface) < m_managed.size() &&
+            m_managed[interface] && m_ipv4->IsUp(interface))
+        {
+            sockerr = Socket::ERROR_NOTERROR;
+            return MakeRoute(interface, header.GetDestination());
+        }
+    }
+    sockerr = Socket::ERROR_NOROUTETOHOST;
+    return nullptr;
+}
+
+bool
+Ipv4SourceAddressRouting::RouteInput(Ptr<const Packet> p,
+                                     const Ipv4Header& header,
+                                     Ptr<const NetDevice> idev,
+                                     const UnicastForwardCallback& ucb,
+                                     const MulticastForwardCallback& mcb,
+                                     const LocalDeliverCallback& lcb,
+                                     const ErrorCallback& ecb)
+{
+    // Left to Ipv4ListRouting and the other protocols
+    return false;
+}
+
+void
+Ipv4SourceAddressRouting::NotifyInterfaceUp(uint32_t interface)
+{
+}
+
+void
+Ipv4SourceAddressRouting::NotifyInterfaceDown(uint32_t interface)
+{
+}
+
+void
+Ipv4SourceAddressRouting::NotifyAddAddress(uint32_t interface, Ipv4InterfaceAddress address)
+{
+    NS_LOG_FUNCTION(this << interface << address);
+    if (interface < m_managed.size() && m_managed[interface])
+    {
+        m_interfaces[address.GetLocal().Get()] = interface;
+    }
+}
+
+void
+Ipv4SourceAddressRouting::NotifyRemoveAddress(uint32_t interface, Ipv4InterfaceAddress address)
+{
+    NS_LOG_FUNCTION(this << interface << address);
+    auto it = m_interfaces.find(address.GetLocal().Get());
+    if (it != m_interfaces.end() && it->second == interface)
+    {
+        m_interfaces.erase(it);
+    }
+}
+
+void
+Ipv4SourceAddressRouting::SetIpv4(Ptr<Ipv4> ipv4)
+{
+    NS_LOG_FUNCTION(this << ipv4);
+    NS_ASSERT(!m_ipv4 && ipv4);
+    m_ipv4 = ipv4;
+}
+
+void
+Ipv4SourceAddressRouting::PrintRoutingTable(Ptr<OutputStreamWrapper> stream, Time::Unit unit) const
+{
+    std::ostream* os = stream->GetStream();
+    *os << "Node: " << m_ipv4->GetObject<Node>()->GetId() << ", Time: " << Now().As(unit)
+        << ", Ipv4SourceAddressRouting table" << std::endl;
+    *os << std::setiosflags(std::ios::left) << std::setw(16) << "Source" << "Iface" << std::endl;
+    for (uint32_t interface = 0; interface < m_managed.size(); ++interface)
+    {
+        if (m_managed[interface])
+        {
+            *os << std::setw(16) << m_ipv4->GetAddress(interface, 0).GetLocal() << interface
+                << std::endl;
+        }
+    }
+    *os << std::resetiosflags(std::ios::left) << std::endl;
+}
+
+} // namespace ns3
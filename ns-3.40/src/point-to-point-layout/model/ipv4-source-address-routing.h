@@ -0,0 +1,114 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// Define a routing protocol sending each source address out of its own interface.
+
+#ifndef IPV4_SOURCE_ADDRESS_ROUTING_H
+#define IPV4_SOURCE_ADDRESS_ROUTING_H
+
+#include "ns3/ipv4-routing-protocol.h"
+#include "ns3/ipv4.h"
+
+#include <unordered_map>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * \ingroup point-to-point-layout
+ *
+ * \brief Route locally originated packets out of the interface owning
+ * their source address.
+ *
+ * Used by the aggregated-leaf mode of PointToPointDumbbellHelper, where
+ * one node stands for many leaves and each leaf is one interface with
+ * its own access link.  A packet whose source address belongs to a
+ * managed interface, or that is sent through a socket bound to the
+ * device of a managed interface, leaves through that interface whatever
+ * its destination; everything else is left to the other routing
+ * protocols of the node.  The lookup is a single hash-table access.
+ *
+ * Sockets must be bound to the device of their leaf (BindToNetDevice):
+ * TCP and UDP look up their route with no source address and then take
+ * the source of that route, so binding to the leaf address alone lets
+ * every socket of the node use the first leaf.
+ *
+ * Forwarding and local delivery are not handled; add this protocol to
+ * an Ipv4ListRouting above the static and global routing.
+ */
+class Ipv4SourceAddressRouting : public Ipv4RoutingProtocol
+{
+  public:
+    /**
+     * \brief Get the type ID.
+     * \return the object TypeId
+     */
+    static TypeId GetTypeId();
+
+    Ipv4SourceAddressRouting();
+    ~Ipv4SourceAddressRouting() override;
+
+    /**
+     * Manage an interface: packets from its address leave through it.
+     * The interface must have an address.
+     *
+     * \param interface the interface index
+     */
+    void AddInterface(uint32_t interface);
+
+    /**
+     * \returns the number of managed interfaces
+     */
+    uint32_t GetNInterfaces() const;
+
+    Ptr<Ipv4Route> RouteOutput(Ptr<Packet> p,
+                               const Ipv4Header& header,
+                               Ptr<NetDevice> oif,
+                               Socket::SocketErrno& sockerr) override;
+    bool RouteInput(Ptr<const Packet> p,
+                    const Ipv4Header& header,
+                    Ptr<const NetDevice> idev,
+                    const UnicastForwardCallback& ucb,
+                    const MulticastForwardCallback& mcb,
+                    const LocalDeliverCallback& lcb,
+                    const ErrorCallback& ecb) override;
+    void NotifyInterfaceUp(uint32_t interface) override;
+    void NotifyInterfaceDown(uint32_t interface) override;
+    void NotifyAddAddress(uint32_t interface, Ipv4InterfaceAddress address) override;
+    void NotifyRemoveAddress(uint32_t interface, Ipv4InterfaceAddress address) override;
+    void SetIpv4(Ptr<Ipv4> ipv4) override;
+    void PrintRoutingTable(Ptr<OutputStreamWrapper> stream,
+                           Time::Unit unit = Time::S) const override;
+
+  protected:
+    void DoDispose() override;
+
+  private:
+    /**
+     * \returns the route of a packet leaving through a managed interface
+     * \param interface the interface index
+     * \param destination the packet destination
+     */
+    Ptr<Ipv4Route> MakeRoute(uint32_t interface, Ipv4Address destination) const;
+
+    Ptr<Ipv4> m_ipv4;                                    //!< IPv4 of the node
+    std::unordered_map<uint32_t, uint32_t> m_interfaces; //!< Source address to interface
+    std::vector<bool> m_managed;                         //!< Managed interfaces
+};
+
+} // namespace ns3
+
+#endif /* IPV4_SOURCE_ADDRESS_ROUTING_H */
@@ -0,0 +1,298 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// Implement a replayer of recorded link rate/delay/loss schedules.
+
+#include "link-schedule-replayer.h"
+
+#include "ns3/abort.h"
+#include "ns3/boolean.h"
+#include "ns3/log.h"
+#include "ns3/pointer.h"
+#include "ns3/simulator.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace ns3
+{
+
+NS_LOG_COMPONENT_DEFINE("LinkScheduleReplayer");
+
+NS_OBJECT_ENSURE_REGISTERED(LinkScheduleReplayer);
+
+namespace
+{
+
+const char MAGIC[8] = {'N', 'S', '3', 'L', 'S', 'C', 'H', 'D'}; //!< Binary file magic
+
+/**
+ * Parse one field of a text schedule line
+ * \param field the field, "-" if unchanged
+ * \param unchanged the value meaning unchanged
+ * \returns the parsed value
+ */
+double
+ParseField(const char* field, double unchanged)
+{
+    if (std::strcmp(field, "-") == 0)
+    {
+        return unchanged;
+    }
+    char* end;
+    double value = std::strtod(field, &end);
+    NS_ABORT_MSG_IF(*end != '\0', "Malformed schedule field \"" << field << "\"");
+    return value;
+}
+
+} // namespace
+
+TypeId
+LinkScheduleReplayer::GetTypeId()
+{
+    static TypeId tid =
+        TypeId("ns3::LinkScheduleReplayer")
+            .SetParent<Object>()
+            .SetGroupName("PointToPointLayout")
+            .AddConstructor<LinkScheduleReplayer>()
+            .AddAttribute("Loop",
+                          "Restart the schedule when its end is reached; the last step "
+                          "then only marks the length of the schedule",
+                          BooleanValue(false),
+                          MakeBooleanAccessor(&LinkScheduleReplayer::m_loop),
+                          MakeBooleanChecker())
+            .AddTraceSource("Step",
+                            "A schedule step was applied",
+                            MakeTraceSourceAccessor(&LinkScheduleReplayer::m_stepTrace),
+                            "ns3::LinkScheduleReplayer::StepTracedCallback");
+    return tid;
+}
+
+LinkScheduleReplayer::LinkScheduleReplayer()
+    : m_loop(false),
+      m_binary(false),
+      m_next{0, 0, -1, -1},
+      m_nSteps(0),
+      m_loss(0)
+{
+    NS_LOG_FUNCTION(this);
+}
+
+LinkScheduleReplayer::~LinkScheduleReplayer()
+{
+    NS_LOG_FUNCTION(this);
+}
+
+void
+LinkScheduleReplayer::DoDispose()
+{
+    NS_LOG_FUNCTION(this);
+    m_event.Cancel();
+    m_devices.clear();
+    m_channels.clear();
+    m_errorModels.clear();
+    m_delayAccessor = nullptr;
+    Object::DoDispose();
+}
+
+void
+LinkScheduleReplayer::Install(Ptr<PointToPointNetDevice> device)
+{
+    NS_LOG_FUNCTION(this << device);
+    Ptr<Channel> channel = device->GetChannel();
+    NS_ABORT_MSG_UNLESS(channel && channel->GetNDevices() == 2,
+                        "The device must be attached to a point-to-point channel");
+
+    // Look the accessor up once, so that a delay step does not search the
+    // attribute list by name
+    if (!m_delayAccessor)
+    {
+        TypeId::AttributeInformation info;
+        NS_ABORT_MSG_UNLESS(channel->GetInstanceTypeId().LookupAttributeByName("Delay", &info),
+                            "The channel has no Delay attribute");
+        m_delayAccessor = info.accessor;
+    }
+    if (m_devices.empty())
+    {
+        DataRateValue rate;
+        device->GetAttribute("DataRate", rate);
+        m_rate = rate.Get();
+        TimeValue delay;
+        m_delayAccessor->Get(PeekPointer(channel), delay);
+        m_delay = delay.Get();
+    }
+
+    Ptr<NetDevice> peer =
+        channel->GetDevice(0) == device ? channel->GetDevice(1) : channel->GetDevice(0);
+    PointerValue existing;
+    peer->GetAttribute("ReceiveErrorModel", existing);
+    NS_ABORT_MSG_IF(existing.Get<ErrorModel>(),
+                    "The peer of " << device << " already has a ReceiveErrorModel, "
+                                   << "which the replayed loss would replace");
+    Ptr<RateErrorModel> errorModel = CreateObject<RateErrorModel>();
+    errorModel->SetUnit(RateErrorModel::ERROR_UNIT_PACKET);
+    errorModel->SetRate(m_loss);
+    if (m_loss <= 0)
+    {
+        errorModel->Disable();
+    }
+    peer->SetAttribute("ReceiveErrorModel", PointerValue(errorModel));
+
+    m_devices.push_back(device);
+    m_channels.push_back(channel);
+    m_errorModels.push_back(errorModel);
+}
+
+void
+LinkScheduleReplayer::Start(std::string filename, Time start)
+{
+    NS_LOG_FUNCTION(this << filename << start);
+    NS_ABORT_MSG_IF(m_devices.empty(), "No device to replay the schedule on");
+    m_file.open(filename, std::ios::binary);
+    NS_ABORT_MSG_UNLESS(m_file.is_open(), "Cannot open link schedule " << filename);
+
+    char magic[sizeof(MAGIC)];
+    m_file.read(magic, sizeof(magic));
+    m_binary = m_file.gcount() == sizeof(MAGIC) && std::memcmp(magic, MAGIC, sizeof(MAGIC)) == 0;
+    if (!m_binary)
+    {
+        m_file.clear();
+        m_file.seekg(0);
+    }
+    m_firstStep = m_file.tellg();
+    m_offset = start;
+    m_lastTime = Time(0);
+    ScheduleNext();
+}
+
+void
+LinkScheduleReplayer::Stop()
+{
+    NS_LOG_FUNCTION(this);
+    m_event.Cancel();
+    m_file.close();
+}
+
+uint64_t
+LinkScheduleReplayer::GetNSteps() const
+{
+    return m_nSteps;
+}
+
+bool
+LinkScheduleReplayer::ReadStep(Step& step)
+{
+    if (m_binary)
+    {
+        return static_cast<bool>(m_file.read(reinterpret_cast<char*>(&step), sizeof(step)));
+    }
+
+    std::string line;
+    while (std::getline(m_file, line))
+    {
+        if (line.empty() || line[0] == '#')
+        {
+            continue;
+        }
+        char time[64];
+        char rate[64];
+        char delay[64];
+        char loss[64];
+        NS_ABORT_MSG_UNLESS(
+            std::sscanf(line.c_str(), "%63s %63s %63s %63s", time, rate, delay, loss) == 4,
+            "Malformed schedule line \"" << line << "\"");
+        step.time = std::llround(ParseField(time, 0) * 1e9);
+        step.rate = std::llround(ParseField(rate, 0));
+        step.delay = std::llround(ParseField(delay, -1) * 1e6);
+        step.loss = ParseField(loss, -1);
+        return true;
+    }
+    return false;
+}
+
+void
+LinkScheduleReplayer::ScheduleNext()
+{
+    if (!ReadStep(m_next))
+    {
+        if (!m_loop || m_nSteps == 0)
+        {
+            NS_LOG_INFO("End of link schedule after " << m_nSteps << " steps");
+            return;
+        }
+        NS_ABORT_MSG_UNLESS(m_lastTime.IsStrictlyPositive(),
+                            "A looped link schedule must last more than zero time");
+        m_offset += m_lastTime;
+        m_lastTime = Time(0);
+        m_file.clear();
+        m_file.seekg(m_firstStep);
+        if (!ReadStep(m_next))
+        {
+            return;
+        }
+    }
+    Time at = NanoSeconds(m_next.time);
+    NS_ABORT_MSG_IF(at < m_lastTime, "Link schedule steps are not in time order");
+    m_lastTime = at;
+    m_event = Simulator::Schedule(Max(m_offset + at - Simulator::Now(), Time(0)),
+                                  &LinkScheduleReplayer::ApplyStep,
+                                  this);
+}
+
+void
+LinkScheduleReplayer::ApplyStep()
+{
+    NS_LOG_FUNCTION(this);
+    if (m_next.rate != 0)
+    {
+        m_rate = DataRate(m_next.rate);
+        for (auto& device : m_devices)
+        {
+            device->SetDataRate(m_rate);
+        }
+    }
+    if (m_next.delay >= 0)
+    {
+        m_delay = NanoSeconds(m_next.delay);
+        TimeValue delay(m_delay);
+        for (auto& channel : m_channels)
+        {
+            m_delayAccessor->Set(PeekPointer(channel), delay);
+        }
+    }
+    if (m_next.loss >= 0)
+    {
+        m_loss = m_next.loss;
+        for (auto& errorModel : m_errorModels)
+        {
+            errorModel->SetRate(m_loss);
+            if (m_loss > 0)
+            {
+                errorModel->Enable();
+            }
+            else
+            {
+                errorModel->Disable();
+            }
+        }
+    }
+    m_nSteps++;
+    m_stepTrace(m_rate, m_delay, m_loss);
+    ScheduleNext();
+}
+
+} // namespace ns3
@@ -0,0 +1,162 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// Define a replayer of recorded link rate/delay/loss schedules.
+
+#ifndef LINK_SCHEDULE_REPLAYER_H
+#define LINK_SCHEDULE_REPLAYER_H
+
+#include "ns3/attribute.h"
+#include "ns3/data-rate.h"
+#include "ns3/error-model.h"
+#include "ns3/event-id.h"
+#include "ns3/nstime.h"
+#include "ns3/object.h"
+#include "ns3/point-to-point-net-device.h"
+#include "ns3/traced-callback.h"
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * \ingroup point-to-point-layout
+ *
+ * \brief Replay a time-varying rate, delay and loss schedule on
+ * point-to-point links.
+ *
+ * The schedule is a sequence of steps; each step gives the time at which
+ * it takes effect and the new rate, one-way delay and packet loss
+ * probability, any of which may be left unchanged.  Two file formats
+ * are accepted:
+ *
+ * - text: one step per line, "time-s rate-bps delay-ms loss", where an
+ *   unchanged field is written "-"; empty lines and lines starting with
+ *   '#' are ignored;
+ * - binary: the magic "NS3LSCHD" followed by Step structures in host
+ *   byte order, where a zero rate, a negative delay and a negative loss
+ *   mean unchanged.
+ *
+ * Steps must be in time order.  The file is read one step ahead of the
+ * simulation and only one event is pending at any time, so a schedule
+ * of any length costs constant memory and O(1) work per step.
+ *
+ * The rate applies to the transmitting devices passed to Install, the
+ * delay to their channels (packets already in flight keep the delay they
+ * were sent with) and the loss to a RateErrorModel on the receiving
+ * peers, which must not have a ReceiveErrorModel already.
+ */
+class LinkScheduleReplayer : public Object
+{
+  public:
+    /**
+     * \brief Get the type ID.
+     * \return the object TypeId
+     */
+    static TypeId GetTypeId();
+
+    LinkScheduleReplayer();
+    ~LinkScheduleReplayer() override;
+
+    /// One binary schedule step
+    struct Step
+    {
+        int64_t time;  //!< Step time (ns), relative to the start
+        uint64_t rate; //!< New rate (bit/s), zero if unchanged
+        int64_t delay; //!< New one-way delay (ns), negative if unchanged
+        double loss;   //!< New loss probability, negative if unchanged
+    };
+
+    /**
+     * TracedCallback signature for schedule steps
+     * \param [in] rate the rate in effect
+     * \param [in] delay the delay in effect
+     * \param [in] loss the loss probability in effect
+     */
+    typedef void (*StepTracedCallback)(DataRate rate, Time delay, double loss);
+
+    /**
+     * Apply the schedule to the direction of a link transmitted by a
+     * device.  May be called for several devices before Start.  Aborts if
+     * the peer device already has a ReceiveErrorModel.
+     *
+     * \param device the transmitting device
+     */
+    void Install(Ptr<PointToPointNetDevice> device);
+
+    /**
+     * Open the schedule file and schedule its first step.
+     *
+     * \param filename the schedule file
+     * \param start the simulation time of schedule time zero
+     */
+    void Start(std::string filename, Time start = Seconds(0));
+
+    /**
+     * Stop replaying; the links keep their current parameters.
+     */
+    void Stop();
+
+    /**
+     * \returns the number of steps applied so far
+     */
+    uint64_t GetNSteps() const;
+
+  protected:
+    void DoDispose() override;
+
+  private:
+    /**
+     * Read the next step of the schedule
+     * \param step the step to fill
+     * \returns false at the end of the schedule
+     */
+    bool ReadStep(Step& step);
+
+    /**
+     * Schedule the next step, rewinding the file when looping
+     */
+    void ScheduleNext();
+
+    /**
+     * Apply the pending step and schedule the next one
+     */
+    void ApplyStep();
+
+    std::vector<Ptr<PointToPointNetDevice>> m_devices;  //!< Transmitting devices
+    std::vector<Ptr<Channel>> m_channels;               //!< Their channels
+    std::vector<Ptr<RateErrorModel>> m_errorModels;     //!< Loss on the peers
+    Ptr<const AttributeAccessor> m_delayAccessor;       //!< Channel Delay accessor
+    bool m_loop;                                        //!< Restart at the end
+    std::ifstream m_file;                               //!< Schedule stream
+    bool m_binary;                                      //!< Binary schedule
+    std::streampos m_firstStep;                         //!< Offset of the first step
+    Time m_offset;                                      //!< Simulation time of schedule zero
+    Time m_lastTime;                                    //!< Time of the last step read
+    Step m_next;                                        //!< Pending step
+    EventId m_event;                                    //!< Pending step event
+    uint64_t m_nSteps;                                  //!< Steps applied
+    DataRate m_rate;                                    //!< Rate in effect
+    Time m_delay;                                       //!< Delay in effect
+    double m_loss;                                      //!< Loss in effect
+    TracedCallback<DataRate, Time, double> m_stepTrace; //!< Step trace
+};
+
+} // namespace ns3
+
+#endif /* LINK_SCHEDULE_REPLAYER_H */
@@ -0,0 +1,423 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// Implement a publisher of live metrics into a shared-memory ring.
+
+#include "live-metrics-publisher.h"
+
+#include "ns3/abort.h"
+#include "ns3/config.h"
+#include "ns3/log.h"
+#include "ns3/simulator.h"
+#include "ns3/string.h"
+#include "ns3/uinteger.h"
+
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <fcntl.h>
+#include <new>
+#include <sstream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace ns3
+{
+
+NS_LOG_COMPONENT_DEFINE("LiveMetricsPublisher");
+
+NS_OBJECT_ENSURE_REGISTERED(LiveMetricsPublisher);
+
+namespace
+{
+
+const char MAGIC[8] = {'N', 'S', '3', 'M', 'E', 'T', 'R', 'C'}; //!< Shared object magic
+const uint32_t VERSION = 2;                                      //!< Layout version
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free,
+              "The ring counters must be lock-free to be shared between processes");
+
+/**
+ * \returns the size of the header, rounded up to a cache line
+ */
+constexpr std::size_t
+HeaderSize()
+{
+    return (sizeof(LiveMetricsPublisher::RingHeader) + 63) & ~std::size_t(63);
+}
+
+/**
+ * \param capacity the number of sample slots
+ * \param maxSeries the number of series records
+ * \returns the size of the shared object
+ */
+std::size_t
+RingSize(uint32_t capacity, uint32_t maxSeries)
+{
+    return HeaderSize() + maxSeries * sizeof(LiveMetricsPublisher::SeriesInfo) +
+           capacity * sizeof(LiveMetricsPublisher::Slot);
+}
+
+} // namespace
+
+TypeId
+LiveMetricsPublisher::GetTypeId()
+{
+    static TypeId tid =
+        TypeId("ns3::LiveMetricsPublisher")
+            .SetParent<Object>()
+            .SetGroupName("PointToPointLayout")
+            .AddConstructor<LiveMetricsPublisher>()
+            .AddAttribute("Name",
+                          "Name of the POSIX shared memory object",
+                          StringValue("/ns3-metrics"),
+                          MakeStringAccessor(&LiveMetricsPublisher::m_name),
+                          MakeStringChecker())
+            .AddAttribute("Capacity",
+                          "Number of sample slots of the ring, a power of two",
+                          UintegerValue(65536),
+                          MakeUintegerAccessor(&LiveMetricsPublisher::m_capacity),
+                          MakeUintegerChecker<uint32_t>(1))
+            .AddAttribute("MaxSeries",
+                          "Maximum number of series",
+                          UintegerValue(1024),
+                          MakeUintegerAccessor(&LiveMetricsPublisher::m_maxSeries),
+                          MakeUintegerChecker<uint32_t>(1));
+    return tid;
+}
+
+LiveMetricsPublisher::LiveMetricsPublisher()
+    : m_capacity(0),
+      m_maxSeries(0),
+      m_header(nullptr),
+      m_series(nullptr),
+      m_slots(nullptr),
+      m_size(0)
+{
+    NS_LOG_FUNCTION(this);
+}
+
+LiveMetricsPublisher::~LiveMetricsPublisher()
+{
+    NS_LOG_FUNCTION(this);
+    Close();
+}
+
+void
+LiveMetricsPublisher::DoDispose()
+{
+    NS_LOG_FUNCTION(this);
+    m_sampleEvent.Cancel();
+    m_monitor = nullptr;
+    Close();
+    Object::DoDispose();
+}
+
+void
+LiveMetricsPublisher::Close()
+{
+    if (m_header)
+    {
+        munmap(m_header, m_size);
+        shm_unlink(m_name.c_str());
+        m_header = nullptr;
+        m_series = nullptr;
+        m_slots = nullptr;
+    }
+}
+
+void
+LiveMetricsPublisher::Open()
+{
+    NS_LOG_FUNCTION(this);
+    if (m_header)
+    {
+        return;
+    }
+    NS_ABORT_MSG_UNLESS((m_capacity & (m_capacity - 1)) == 0,
+                        "The ring capacity must be a power of two");
+
+    int fd = shm_open(m_name.c_str(), O_CREAT | O_RDWR | O_TRUNC, 0644);
+    NS_ABORT_MSG_IF(fd < 0, "Cannot create shared memory " << m_name << ": " << std::strerror(errno));
+    m_size = RingSize(m_capacity, m_maxSeries);
+    NS_ABORT_MSG_IF(ftruncate(fd, m_size) != 0,
+                    "Cannot size shared memory " << m_name << ": " << std::strerror(errno));
+    void* base = mmap(nullptr, m_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    NS_ABORT_MSG_IF(base == MAP_FAILED,
+                    "Cannot map shared memory " << m_name << ": " << std::strerror(errno));
+
+    // The object starts zeroed; the magic is written last so that a reader
+    // attaching meanwhile sees either nothing or a complete header
+    m_header = new (base) RingHeader;
+    m_header->version = VERSION;
+    m_header->capacity = m_capacity;
+    m_header->maxSeries = m_maxSeries;
+    m_header->pid = getpid();
+    m_header->nSeries.store(0, std::memory_order_relaxed);
+    m_header->head.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(m_header->magic, MAGIC, sizeof(MAGIC));
+    m_series = reinterpret_cast<SeriesInfo*>(static_cast<char*>(base) + HeaderSize());
+    m_slots = reinterpret_cast<Slot*>(m_series + m_maxSeries);
+    NS_LOG_INFO("Publishing " << m_capacity << " sample slots in " << m_name);
+}
+
+uint32_t
+LiveMetricsPublisher::AddSeries(std::string label, Kind kind)
+{
+    NS_LOG_FUNCTION(this << label << kind);
+    Open();
+    uint32_t series = m_header->nSeries.load(std::memory_order_relaxed);
+    NS_ABORT_MSG_IF(series >= m_maxSeries, "Too many series; raise MaxSeries");
+    SeriesInfo& info = m_series[series];
+    info.kind = kind;
+    std::strncpy(info.label, label.c_str(), sizeof(info.label) - 1);
+    info.label[sizeof(info.label) - 1] = '\0';
+    m_header->nSeries.store(series + 1, std::memory_order_release);
+    return series;
+}
+
+void
+LiveMetricsPublisher::Publish(uint32_t series, double value)
+{
+    uint64_t head = m_header->head.load(std::memory_order_relaxed);
+    Slot& slot = m_slots[head & (m_capacity - 1)];
+    // The release fence orders the odd sequence before the field writes,
+    // so a reader that sees any of them also sees the slot as being written
+    slot.sequence.store(2 * head + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.sample.time = Simulator::Now().GetNanoSeconds();
+    slot.sample.value = value;
+    slot.sample.series = series;
+    slot.sequence.store(2 * head + 2, std::memory_order_release);
+    m_header->head.store(head + 1, std::memory_order_release);
+}
+
+void
+LiveMetricsPublisher::TraceSocket(std::string socketPath, std::string label, uint32_t segmentSize)
+{
+    NS_LOG_FUNCTION(this << socketPath << label << segmentSize);
+    uint32_t cwnd = AddSeries(label + " cwnd", CWND);
+    uint32_t rtt = AddSeries(label + " rtt", RTT);
+    bool connected = Config::ConnectWithoutContextFailSafe(
+        socketPath + "/CongestionWindow",
+        MakeCallback(&LiveMetricsPublisher::CwndChange, this).Bind(cwnd, segmentSize));
+    connected &= Config::ConnectWithoutContextFailSafe(
+        socketPath + "/RTT",
+        MakeCallback(&LiveMetricsPublisher::RttChange, this).Bind(rtt));
+    if (!connected)
+    {
+        NS_LOG_WARN("Some trace sources of " << socketPath << " are missing");
+    }
+}
+
+void
+LiveMetricsPublisher::TraceTcpSocket(uint32_t nodeId, uint32_t socketId, uint32_t segmentSize)
+{
+    TraceSocket("/NodeList/" + std::to_string(nodeId) + "/$ns3::TcpL4Protocol/SocketList/" +
+                    std::to_string(socketId),
+                "node " + std::to_string(nodeId) + " tcp " + std::to_string(socketId),
+                segmentSize);
+}
+
+void
+LiveMetricsPublisher::TraceQuicSocket(uint32_t nodeId, uint32_t socketId, uint32_t segmentSize)
+{
+    TraceSocket("/NodeList/" + std::to_string(nodeId) + "/$ns3::QuicL4Protocol/SocketList/" +
+                    std::to_string(socketId) + "/QuicSocketBase",
+                "node " + std::to_string(nodeId) + " quic " + std::to_string(socketId),
+                segmentSize);
+}
+
+void
+LiveMetricsPublisher::TraceQueue(Ptr<Object> queue, std::string label)
+{
+    NS_LOG_FUNCTION(this << queue << label);
+    uint32_t series = AddSeries(label, QUEUE);
+    NS_ABORT_MSG_UNLESS(queue->TraceConnectWithoutContext(
+                            "PacketsInQueue",
+                            MakeCallback(&LiveMetricsPublisher::QueueChange, this).Bind(series)),
+                        "The object has no PacketsInQueue trace source");
+}
+
+void
+LiveMetricsPublisher::TraceFlows(Ptr<DumbbellFlowMonitor> monitor, Time interval)
+{
+    NS_LOG_FUNCTION(this << monitor << interval);
+    Open();
+    m_monitor = monitor;
+    m_interval = interval;
+    m_sampleEvent.Cancel();
+    m_sampleEvent = Simulator::Schedule(m_interval, &LiveMetricsPublisher::SampleFlows, this);
+}
+
+void
+LiveMetricsPublisher::CwndChange(uint32_t series,
+                                 uint32_t segmentSize,
+                                 uint32_t oldValue,
+                                 uint32_t newValue)
+{
+    Publish(series, static_cast<double>(newValue) / segmentSize);
+}
+
+void
+LiveMetricsPublisher::RttChange(uint32_t series, Time oldValue, Time newValue)
+{
+    Publish(series, newValue.GetSeconds() * 1e3);
+}
+
+void
+LiveMetricsPublisher::QueueChange(uint32_t series, uint32_t oldValue, uint32_t newValue)
+{
+    Publish(series, newValue);
+}
+
+void
+LiveMetricsPublisher::SampleFlows()
+{
+    // Flows appear as the monitor classifies them
+    for (uint32_t flowId = m_flowSeries.size(); flowId < m_monitor->GetNFlows(); flowId++)
+    {
+        const DumbbellFlowMonitor::FlowTuple& t = m_monitor->GetFlowTuple(flowId);
+        std::ostringstream label;
+        label << t.source << ":" << t.sourcePort << " > " << t.destination << ":"
+              << t.destinationPort;
+        m_flowSeries.push_back(AddSeries(label.str(), THROUGHPUT));
+        m_flowRxBytes.push_back(0);
+    }
+    double seconds = m_interval.GetSeconds();
+    for (uint32_t flowId = 0; flowId < m_flowSeries.size(); flowId++)
+    {
+        uint64_t rxBytes = m_monitor->GetFlowRecord(flowId).rxBytes;
+        Publish(m_flowSeries[flowId], (rxBytes - m_flowRxBytes[flowId]) * 8 / seconds / 1e6);
+        m_flowRxBytes[flowId] = rxBytes;
+    }
+    m_sampleEvent = Simulator::Schedule(m_interval, &LiveMetricsPublisher::SampleFlows, this);
+}
+
+LiveMetricsReader::LiveMetricsReader()
+    : m_header(nullptr),
+      m_series(nullptr),
+      m_slots(nullptr),
+      m_size(0),
+      m_tail(0)
+{
+}
+
+LiveMetricsReader::~LiveMetricsReader()
+{
+    if (m_header)
+    {
+        munmap(const_cast<LiveMetricsPublisher::RingHeader*>(m_header), m_size);
+    }
+}
+
+bool
+LiveMetricsReader::Attach(std::string name)
+{
+    int fd = shm_open(name.c_str(), O_RDONLY, 0);
+    if (fd < 0)
+    {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || static_cast<std::size_t>(st.st_size) < HeaderSize())
+    {
+        close(fd);
+        return false;
+    }
+    void* base = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED)
+    {
+        return false;
+    }
+    auto header = static_cast<const LiveMetricsPublisher::RingHeader*>(base);
+    bool valid = std::memcmp(header->magic, MAGIC, sizeof(MAGIC)) == 0;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    valid = valid && header->version == VERSION &&
+            RingSize(header->capacity, header->maxSeries) ==
+                static_cast<std::size_t>(st.st_size);
+    if (!valid)
+    {
+        munmap(base, st.st_size);
+        return false;
+    }
+
+    m_header = header;
+    m_size = st.st_size;
+    m_series = reinterpret_cast<const LiveMetricsPublisher::SeriesInfo*>(
+        static_cast<const char*>(base) + HeaderSize());
+    m_slots = reinterpret_cast<const LiveMetricsPublisher::Slot*>(m_series + header->maxSeries);
+    // Start with whatever history the ring still holds
+    uint64_t head = m_header->head.load(std::memory_order_acquire);
+    m_tail = head > m_header->capacity ? head - m_header->capacity : 0;
+    return true;
+}
+
+bool
+LiveMetricsReader::IsPublisherAlive() const
+{
+    return m_header && (kill(m_header->pid, 0) == 0 || errno == EPERM);
+}
+
+uint64_t
+LiveMetricsReader::Poll(std::vector<LiveMetricsPublisher::Sample>& samples)
+{
+    uint64_t capacity = m_header->capacity;
+    uint64_t head = m_header->head.load(std::memory_order_acquire);
+    uint64_t lost = 0;
+    if (head - m_tail > capacity)
+    {
+        lost = head - capacity - m_tail;
+        m_tail = head - capacity;
+    }
+    for (uint64_t i = m_tail; i < head; ++i)
+    {
+        // Keep the copy only if the slot held sample i, complete, before
+        // and after it was copied; otherwise it was overwritten meanwhile
+        const LiveMetricsPublisher::Slot& slot = m_slots[i & (capacity - 1)];
+        uint64_t before = slot.sequence.load(std::memory_order_acquire);
+        LiveMetricsPublisher::Sample sample = slot.sample;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        uint64_t after = slot.sequence.load(std::memory_order_relaxed);
+        if (before == 2 * i + 2 && after == before)
+        {
+            samples.push_back(sample);
+        }
+        else
+        {
+            lost++;
+        }
+    }
+    m_tail = head;
+    return lost;
+}
+
+uint32_t
+LiveMetricsReader::GetNSeries() const
+{
+    return m_header->nSeries.load(std::memory_order_acquire);
+}
+
+LiveMetricsPublisher::SeriesInfo
+LiveMetricsReader::GetSeries(uint32_t series) const
+{
+    return m_series[series];
+}
+
+} // namespace ns3
@@ -0,0 +1,288 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// Define a publisher of live metrics into a shared-memory ring.
+
+#ifndef LIVE_METRICS_PUBLISHER_H
+#define LIVE_METRICS_PUBLISHER_H
+
+#include "dumbbell-flow-monitor.h"
+
+#include "ns3/event-id.h"
+#include "ns3/nstime.h"
+#include "ns3/object.h"
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * \ingroup point-to-point-layout
+ *
+ * \brief Publish per-flow throughput, cwnd, RTT and queue samples into a
+ * lock-free ring in POSIX shared memory, for a viewer in another process.
+ *
+ * Publishing a sample is a few stores into the mapping guarded by a
+ * per-slot sequence number, and one release store of the write counter:
+ * no system call, no lock, and the simulator never waits for the viewer.
+ * The ring is overwritten when full; a viewer that falls behind loses the
+ * oldest samples and is told how many.
+ *
+ * Each slot is a seqlock: the publisher sets its sequence to 2 n + 1
+ * before it writes sample n and to 2 n + 2 after, and a reader keeps a
+ * copy only if the sequence was 2 n + 2 both before and after copying it.
+ *
+ * The shared object (see the Name attribute) is laid out as a RingHeader,
+ * then MaxSeries SeriesInfo records, then Capacity Slot records.  A
+ * series is one curve (e.g. the cwnd of one socket); its record is
+ * written before the series count is published, so a viewer never sees
+ * a half-written label.  The object is unlinked when the publisher is
+ * disposed or destroyed.
+ */
+class LiveMetricsPublisher : public Object
+{
+  public:
+    /**
+     * \brief Get the type ID.
+     * \return the object TypeId
+     */
+    static TypeId GetTypeId();
+
+    LiveMetricsPublisher();
+    ~LiveMetricsPublisher() override;
+
+    /// Kind of a series, which sets its unit
+    enum Kind : uint32_t
+    {
+        THROUGHPUT = 0, //!< Mbps
+        CWND = 1,       //!< Segments
+        RTT = 2,        //!< Milliseconds
+        QUEUE = 3,      //!< Packets
+        OTHER = 4       //!< Anything else
+    };
+
+    /// Header of the shared object
+    struct RingHeader
+    {
+        char magic[8];                 //!< "NS3METRC"
+        uint32_t version;              //!< Layout version
+        uint32_t capacity;             //!< Number of sample slots, a power of two
+        uint32_t maxSeries;            //!< Number of series records
+        uint32_t pid;                  //!< Process id of the publisher
+        std::atomic<uint32_t> nSeries; //!< Series published so far
+        uint32_t reserved;             //!< Padding
+        std::atomic<uint64_t> head;    //!< Samples written so far
+    };
+
+    /// Description of a series
+    struct SeriesInfo
+    {
+        uint32_t kind;  //!< Kind
+        char label[60]; //!< Null-terminated label
+    };
+
+    /// One sample
+    struct Sample
+    {
+        int64_t time;      //!< Simulation time (ns)
+        double value;      //!< Value, in the unit of the series kind
+        uint32_t series;   //!< Series index
+        uint32_t reserved; //!< Padding
+    };
+
+    /// One sample slot of the ring
+    struct Slot
+    {
+        std::atomic<uint64_t> sequence; //!< 2 n + 1 while sample n is written, then 2 n + 2
+        Sample sample;                  //!< The sample
+    };
+
+    /**
+     * Create and map the shared object; called by the first AddSeries if
+     * needed.
+     */
+    void Open();
+
+    /**
+     * Add a series.
+     *
+     * \param label the label shown by the viewer (truncated to 59 chars)
+     * \param kind the kind of the series
+     * \returns the series index
+     */
+    uint32_t AddSeries(std::string label, Kind kind);
+
+    /**
+     * Publish a sample at the current simulation time.
+     *
+     * \param series the series index
+     * \param value the value
+     */
+    void Publish(uint32_t series, double value);
+
+    /**
+     * Publish the cwnd (in segments) and RTT of a socket.
+     *
+     * \param socketPath the Config path of the socket
+     * \param label the label prefix of both series
+     * \param segmentSize the segment size, to express the cwnd in segments
+     */
+    void TraceSocket(std::string socketPath, std::string label, uint32_t segmentSize);
+
+    /**
+     * Publish the cwnd and RTT of a TCP socket; see TraceSocket.
+     *
+     * \param nodeId the node id
+     * \param socketId the index of the socket in the node's TcpL4Protocol
+     * \param segmentSize the segment size
+     */
+    void TraceTcpSocket(uint32_t nodeId, uint32_t socketId, uint32_t segmentSize);
+
+    /**
+     * Publish the cwnd and RTT of a QUIC socket; see TraceSocket.
+     *
+     * \param nodeId the node id
+     * \param socketId the index of the socket in the node's QuicL4Protocol
+     * \param segmentSize the segment size
+     */
+    void TraceQuicSocket(uint32_t nodeId, uint32_t socketId, uint32_t segmentSize);
+
+    /**
+     * Publish the length of a queue or queue disc, on every change.
+     *
+     * \param queue a Queue or QueueDisc ("PacketsInQueue" trace source)
+     * \param label the label of the series
+     */
+    void TraceQueue(Ptr<Object> queue, std::string label);
+
+    /**
+     * Publish the receive throughput of every flow of a monitor, sampled
+     * periodically by a single event.
+     *
+     * \param monitor the flow monitor
+     * \param interval the sampling interval
+     */
+    void TraceFlows(Ptr<DumbbellFlowMonitor> monitor, Time interval);
+
+  protected:
+    void DoDispose() override;
+
+  private:
+    /**
+     * Unmap and unlink the shared object, if open
+     */
+    void Close();
+
+    /**
+     * cwnd trace sink
+     * \param series the series index
+     * \param segmentSize the segment size
+     * \param oldValue previous cwnd
+     * \param newValue new cwnd
+     */
+    void CwndChange(uint32_t series, uint32_t segmentSize, uint32_t oldValue, uint32_t newValue);
+
+    /**
+     * RTT trace sink
+     * \param series the series index
+     * \param oldValue previous RTT
+     * \param newValue new RTT
+     */
+    void RttChange(uint32_t series, Time oldValue, Time newValue);
+
+    /**
+     * Queue length trace sink
+     * \param series the series index
+     * \param oldValue previous length
+     * \param newValue new length
+     */
+    void QueueChange(uint32_t series, uint32_t oldValue, uint32_t newValue);
+
+    /**
+     * Sample the flows of the monitor and reschedule
+     */
+    void SampleFlows();
+
+    std::string m_name;                  //!< Shared object name
+    uint32_t m_capacity;                 //!< Sample slots
+    uint32_t m_maxSeries;                //!< Series records
+    RingHeader* m_header;                //!< Mapped header, null if not open
+    SeriesInfo* m_series;                //!< Mapped series records
+    Slot* m_slots;                       //!< Mapped sample slots
+    std::size_t m_size;                  //!< Size of the mapping
+    Ptr<DumbbellFlowMonitor> m_monitor;  //!< Monitor sampled by TraceFlows
+    Time m_interval;                     //!< Sampling interval of TraceFlows
+    EventId m_sampleEvent;               //!< Next flow sample
+    std::vector<uint32_t> m_flowSeries;  //!< Series of each monitor flow
+    std::vector<uint64_t> m_flowRxBytes; //!< Received bytes at the previous sample
+};
+
+/**
+ * \ingroup point-to-point-layout
+ *
+ * \brief Read the ring of a LiveMetricsPublisher from another process.
+ */
+class LiveMetricsReader
+{
+  public:
+    LiveMetricsReader();
+    ~LiveMetricsReader();
+
+    /**
+     * Map the shared object of a publisher, read-only.
+     *
+     * \param name the shared object name
+     * \returns false if it does not exist or is not a metrics ring
+     */
+    bool Attach(std::string name);
+
+    /**
+     * \returns true if the publisher process is still running
+     */
+    bool IsPublisherAlive() const;
+
+    /**
+     * Append the samples published since the previous call.
+     *
+     * \param samples the vector to append to
+     * \returns the number of samples lost because the ring was overrun
+     */
+    uint64_t Poll(std::vector<LiveMetricsPublisher::Sample>& samples);
+
+    /**
+     * \returns the number of series published so far
+     */
+    uint32_t GetNSeries() const;
+
+    /**
+     * \param series the series index
+     * \returns the description of a series
+     */
+    LiveMetricsPublisher::SeriesInfo GetSeries(uint32_t series) const;
+
+  private:
+    const LiveMetricsPublisher::RingHeader* m_header; //!< Mapped header
+    const LiveMetricsPublisher::SeriesInfo* m_series; //!< Mapped series records
+    const LiveMetricsPublisher::Slot* m_slots;        //!< Mapped sample slots
+    std::size_t m_size;                               //!< Size of the mapping
+    uint64_t m_tail;                                  //!< Next sample to read
+};
+
+} // namespace ns3
+
+#endif /* LIVE_METRICS_PUBLISHER_H */
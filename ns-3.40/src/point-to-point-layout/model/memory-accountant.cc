@@ -0,0 +1,352 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// Implement an accounting of the memory held by the simulation objects.
+
+#include "memory-accountant.h"
+
+#include "memory-probe.h"
+
+#include "ns3/abort.h"
+#include "ns3/application.h"
+#include "ns3/channel-list.h"
+#include "ns3/channel.h"
+#include "ns3/log.h"
+#include "ns3/net-device.h"
+#include "ns3/node-list.h"
+#include "ns3/node.h"
+#include "ns3/object-vector.h"
+#include "ns3/packet.h"
+#include "ns3/pointer.h"
+#include "ns3/queue-disc.h"
+#include "ns3/queue.h"
+#include "ns3/simulator.h"
+#include "ns3/socket.h"
+#include "ns3/tcp-rx-buffer.h"
+#include "ns3/tcp-socket-base.h"
+#include "ns3/tcp-tx-buffer.h"
+#include "ns3/traffic-control-layer.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <string>
+
+namespace ns3
+{
+
+NS_LOG_COMPONENT_DEFINE("MemoryAccountant");
+
+NS_OBJECT_ENSURE_REGISTERED(MemoryAccountant);
+
+namespace
+{
+
+/// Built-in subsystems, in the order of MemoryAccountant::m_subsystems
+enum Subsystem : uint32_t
+{
+    NODES,          //!< Nodes
+    STACK,          //!< Objects aggregated to the nodes
+    DEVICES,        //!< Net devices
+    CHANNELS,       //!< Channels
+    QUEUES,         //!< Device queues, queue discs and their internal queues
+    QUEUED_PACKETS, //!< Packets held in the device queues and queue discs
+    SOCKETS,        //!< Sockets
+    SOCKET_DATA,    //!< Data held in the socket buffers
+    APPLICATIONS,   //!< Applications
+    N_BUILTIN       //!< Number of built-in subsystems
+};
+
+/// Names of the built-in subsystems
+const char* const g_builtinNames[N_BUILTIN] = {"nodes",
+                                               "stack",
+                                               "devices",
+                                               "channels",
+                                               "queues",
+                                               "queued packets",
+                                               "sockets",
+                                               "socket data",
+                                               "applications"};
+
+/**
+ * Format a byte count for the summary.
+ *
+ * \param bytes the byte count
+ * \returns the count in MB
+ */
+double
+ToMegaBytes(uint64_t bytes)
+{
+    return bytes / 1048576.0;
+}
+
+} // namespace
+
+TypeId
+MemoryAccountant::GetTypeId()
+{
+    static TypeId tid =
+        TypeId("ns3::MemoryAccountant")
+            .SetParent<Object>()
+            .SetGroupName("PointToPointLayout")
+            .AddConstructor<MemoryAccountant>()
+            .AddAttribute("Interval",
+                          "Sampling interval, zero to sample only on demand",
+                          TimeValue(Seconds(1)),
+                          MakeTimeAccessor(&MemoryAccountant::m_interval),
+                          MakeTimeChecker(Time(0)));
+    return tid;
+}
+
+MemoryAccountant::MemoryAccountant()
+    : m_subsystems(g_builtinNames, g_builtinNames + N_BUILTIN),
+      m_peak(0),
+      m_peakBytes(0)
+{
+    NS_LOG_FUNCTION(this);
+}
+
+MemoryAccountant::~MemoryAccountant()
+{
+    NS_LOG_FUNCTION(this);
+}
+
+void
+MemoryAccountant::DoDispose()
+{
+    NS_LOG_FUNCTION(this);
+    m_sampleEvent.Cancel();
+    m_extra.clear();
+    Object::DoDispose();
+}
+
+void
+MemoryAccountant::AddSubsystem(std::string name, Callback<uint64_t> bytes)
+{
+    NS_LOG_FUNCTION(this << name);
+    NS_ABORT_MSG_UNLESS(m_timeline.empty(), "Cannot add a subsystem after the first sample");
+    m_subsystems.push_back(name);
+    m_extra.push_back(bytes);
+}
+
+void
+MemoryAccountant::Start()
+{
+    NS_LOG_FUNCTION(this);
+    m_sampleEvent.Cancel();
+    SampleAndReschedule();
+}
+
+void
+MemoryAccountant::SampleAndReschedule()
+{
+    Sample();
+    if (m_interval.IsStrictlyPositive())
+    {
+        m_sampleEvent =
+            Simulator::Schedule(m_interval, &MemoryAccountant::SampleAndReschedule, this);
+    }
+}
+
+void
+MemoryAccountant::Count(TypeMap& types, TypeId tid, uint32_t subsystem) const
+{
+    // A TypeId registered without a size reports std::size_t(-1)
+    std::size_t size = tid.GetSize();
+    uint64_t known = size != std::size_t(-1) ? size : 0;
+    auto [it, inserted] = types.emplace(tid.GetName(), TypeEntry{subsystem, 0, known});
+    it->second.count++;
+}
+
+void
+MemoryAccountant::Sample()
+{
+    NS_LOG_FUNCTION(this);
+    TypeMap types;
+    Snapshot snapshot{Simulator::Now(), MemoryProbe::GetResidentBytes(), {}};
+    snapshot.held.assign(m_subsystems.size(), 0);
+    uint64_t queuedPackets = 0;
+
+    for (auto n = NodeList::Begin(); n != NodeList::End(); ++n)
+    {
+        Ptr<Node> node = *n;
+        Count(types, node->GetInstanceTypeId(), NODES);
+
+        Object::AggregateIterator aggregates = node->GetAggregateIterator();
+        while (aggregates.HasNext())
+        {
+            Ptr<const Object> object = aggregates.Next();
+            if (object == node)
+            {
+                continue;
+            }
+            Count(types, object->GetInstanceTypeId(), STACK);
+
+            // TcpL4Protocol, UdpL4Protocol and the like list their sockets
+            ObjectVectorValue sockets;
+            if (!object->GetAttributeFailSafe("SocketList", sockets))
+            {
+                continue;
+            }
+            for (auto s = sockets.Begin(); s != sockets.End(); ++s)
+            {
+                Ptr<Socket> socket = DynamicCast<Socket>(s->second);
+                if (!socket)
+                {
+                    continue;
+                }
+                Count(types, socket->GetInstanceTypeId(), SOCKETS);
+                Ptr<TcpSocketBase> tcp = DynamicCast<TcpSocketBase>(socket);
+                if (tcp)
+                {
+                    snapshot.held[SOCKET_DATA] +=
+                        tcp->GetTxBuffer()->Size() + tcp->GetRxBuffer()->Size();
+                }
+                else
+                {
+                    snapshot.held[SOCKET_DATA] += socket->GetRxAvailable();
+                }
+            }
+        }
+
+        Ptr<TrafficControlLayer> tc = node->GetObject<TrafficControlLayer>();
+        for (uint32_t d = 0; d < node->GetNDevices(); ++d)
+        {
+            Ptr<NetDevice> device = node->GetDevice(d);
+            Count(types, device->GetInstanceTypeId(), DEVICES);
+
+            PointerValue txQueue;
+            if (device->GetAttributeFailSafe("TxQueue", txQueue))
+            {
+                Ptr<QueueBase> queue = txQueue.Get<QueueBase>();
+                if (queue)
+                {
+                    Count(types, queue->GetInstanceTypeId(), QUEUES);
+                    snapshot.held[QUEUED_PACKETS] += queue->GetNBytes();
+                    queuedPackets += queue->GetNPackets();
+                }
+            }
+
+            Ptr<QueueDisc> qd = tc ? tc->GetRootQueueDiscOnDevice(device) : nullptr;
+            if (qd)
+            {
+                Count(types, qd->GetInstanceTypeId(), QUEUES);
+                for (std::size_t i = 0; i < qd->GetNInternalQueues(); ++i)
+                {
+                    Count(types, qd->GetInternalQueue(i)->GetInstanceTypeId(), QUEUES);
+                }
+                snapshot.held[QUEUED_PACKETS] += qd->GetNBytes();
+                queuedPackets += qd->GetNPackets();
+            }
+        }
+
+        for (uint32_t a = 0; a < node->GetNApplications(); ++a)
+        {
+            Count(types, node->GetApplication(a)->GetInstanceTypeId(), APPLICATIONS);
+        }
+    }
+
+    for (auto c = ChannelList::Begin(); c != ChannelList::End(); ++c)
+    {
+        Count(types, (*c)->GetInstanceTypeId(), CHANNELS);
+    }
+
+    // A queued packet costs its bytes plus the Packet object itself
+    snapshot.held[QUEUED_PACKETS] += queuedPackets * sizeof(Packet);
+    for (const auto& [name, entry] : types)
+    {
+        snapshot.held[entry.subsystem] += entry.count * entry.size;
+    }
+    for (uint32_t i = 0; i < m_extra.size(); ++i)
+    {
+        snapshot.held[N_BUILTIN + i] = m_extra[i]();
+    }
+
+    uint64_t total = 0;
+    for (uint64_t bytes : snapshot.held)
+    {
+        total += bytes;
+    }
+    if (m_timeline.empty() || total > m_peakBytes)
+    {
+        m_peak = m_timeline.size();
+        m_peakBytes = total;
+        m_peakTypes = std::move(types);
+    }
+    m_timeline.push_back(std::move(snapshot));
+}
+
+uint64_t
+MemoryAccountant::GetPeakBytes() const
+{
+    return m_peakBytes;
+}
+
+void
+MemoryAccountant::Write(std::string prefix)
+{
+    NS_LOG_FUNCTION(this << prefix);
+    Sample();
+
+    std::ofstream summary(prefix + "-summary.txt");
+    NS_ABORT_MSG_UNLESS(summary.is_open(), "Cannot open " << prefix << "-summary.txt");
+    const Snapshot& peak = m_timeline[m_peak];
+    summary << std::fixed << std::setprecision(3);
+    summary << "# Peak at " << peak.time.GetSeconds() << " s: " << ToMegaBytes(m_peakBytes)
+            << " MB accounted, RSS " << ToMegaBytes(peak.rss) << " MB, peak RSS "
+            << ToMegaBytes(MemoryProbe::GetPeakResidentBytes()) << " MB\n";
+    summary << "\n# subsystem MB\n";
+    for (uint32_t i = 0; i < m_subsystems.size(); ++i)
+    {
+        summary << std::left << std::setw(16) << m_subsystems[i] << std::right << std::setw(12)
+                << ToMegaBytes(peak.held[i]) << "\n";
+    }
+
+    // Largest types first
+    std::vector<std::pair<std::string, TypeEntry>> types(m_peakTypes.begin(), m_peakTypes.end());
+    std::stable_sort(types.begin(), types.end(), [](const auto& a, const auto& b) {
+        return a.second.count * a.second.size > b.second.count * b.second.size;
+    });
+    summary << "\n# type subsystem count size(bytes) MB\n";
+    for (const auto& [name, entry] : types)
+    {
+        summary << std::left << std::setw(40) << name << std::setw(16)
+                << m_subsystems[entry.subsystem] << std::right << std::setw(10) << entry.count
+                << std::setw(8) << (entry.size ? std::to_string(entry.size) : "?")
+                << std::setw(12) << ToMegaBytes(entry.count * entry.size) << "\n";
+    }
+
+    std::ofstream timeline(prefix + "-timeline.dat");
+    NS_ABORT_MSG_UNLESS(timeline.is_open(), "Cannot open " << prefix << "-timeline.dat");
+    timeline << "# time(s) rss";
+    for (const auto& name : m_subsystems)
+    {
+        std::string column = name;
+        std::replace(column.begin(), column.end(), ' ', '-');
+        timeline << " " << column;
+    }
+    timeline << "\n";
+    for (const auto& snapshot : m_timeline)
+    {
+        timeline << snapshot.time.GetSeconds() << " " << snapshot.rss;
+        for (uint64_t bytes : snapshot.held)
+        {
+            timeline << " " << bytes;
+        }
+        timeline << "\n";
+    }
+}
+
+} // namespace ns3
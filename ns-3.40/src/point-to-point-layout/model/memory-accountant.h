@@ -0,0 +1,158 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// Define an accounting of the memory held by the simulation objects.
+
+#ifndef MEMORY_ACCOUNTANT_H
+#define MEMORY_ACCOUNTANT_H
+
+#include "ns3/callback.h"
+#include "ns3/event-id.h"
+#include "ns3/nstime.h"
+#include "ns3/object.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * \ingroup point-to-point-layout
+ *
+ * \brief Break the memory of a simulation down by object type and
+ * subsystem, over time.
+ *
+ * Every Interval, the accountant walks the NodeList and the ChannelList
+ * and counts the live objects per TypeId: the nodes and the objects
+ * aggregated to them (the protocol stacks), the net devices and their
+ * queues, the root queue discs and their internal queues, the sockets of
+ * every protocol with a SocketList attribute, the applications and the
+ * channels.  An object is charged the size registered for its TypeId
+ * (see TypeId::GetSize), i.e. its own size without what it points to;
+ * objects whose TypeId has no registered size are counted but charged
+ * nothing, and listed with a size of "?".
+ * To that are added the bytes that dominate large runs: the packets held
+ * in device queues and queue discs, and the data held in socket buffers.
+ * Other subsystems (e.g. a FlowMonitor) can be charged through
+ * AddSubsystem.  The resident set size (MemoryProbe) is sampled too, so
+ * the unaccounted part is visible.
+ *
+ * Some memory cannot be reached by walking the lists and is left to that
+ * unaccounted part: the packets in flight on the channels and every other
+ * packet or object held only by a pending event (the scheduler exposes no
+ * way to visit its events), which on long fat links can be a whole
+ * bandwidth-delay product per direction, and the state of a NetAnim
+ * AnimationInterface, which is private to it.
+ *
+ * Nothing is traced: the cost is one walk per sample, and nothing at all
+ * unless an accountant is created.  Write produces a summary with the
+ * per-subsystem and per-TypeId breakdown at the sample with the most
+ * accounted bytes, and a timeline with one line per sample.
+ */
+class MemoryAccountant : public Object
+{
+  public:
+    /**
+     * \brief Get the type ID.
+     * \return the object TypeId
+     */
+    static TypeId GetTypeId();
+
+    MemoryAccountant();
+    ~MemoryAccountant() override;
+
+    /**
+     * Charge a subsystem the accountant cannot find by itself.
+     *
+     * \param name the subsystem name
+     * \param bytes returns the bytes currently held by the subsystem
+     */
+    void AddSubsystem(std::string name, Callback<uint64_t> bytes);
+
+    /**
+     * Take the first sample now and the next ones every Interval, if not
+     * zero.
+     */
+    void Start();
+
+    /**
+     * Take a sample of every subsystem now.
+     */
+    void Sample();
+
+    /**
+     * \returns the bytes accounted at the peak sample
+     */
+    uint64_t GetPeakBytes() const;
+
+    /**
+     * Write the summary to <prefix>-summary.txt and the timeline to
+     * <prefix>-timeline.dat, taking a last sample first.
+     *
+     * \param prefix output file prefix
+     */
+    void Write(std::string prefix);
+
+  protected:
+    void DoDispose() override;
+
+  private:
+    /// Objects of one TypeId
+    struct TypeEntry
+    {
+        uint32_t subsystem; //!< Subsystem index
+        uint64_t count;     //!< Live objects
+        uint64_t size;      //!< Registered size of one object, 0 if unknown
+    };
+
+    /// One sample of the timeline
+    struct Snapshot
+    {
+        Time time;                  //!< Sample time
+        uint64_t rss;               //!< Resident set size
+        std::vector<uint64_t> held; //!< Bytes per subsystem
+    };
+
+    /// Per-TypeId counts by type name
+    typedef std::map<std::string, TypeEntry> TypeMap;
+
+    /**
+     * Count one object
+     * \param types the counts to update
+     * \param tid the TypeId of the object
+     * \param subsystem the subsystem index
+     */
+    void Count(TypeMap& types, TypeId tid, uint32_t subsystem) const;
+
+    /**
+     * Periodic sampling
+     */
+    void SampleAndReschedule();
+
+    Time m_interval;                         //!< Sampling interval
+    std::vector<std::string> m_subsystems;   //!< Subsystem names
+    std::vector<Callback<uint64_t>> m_extra; //!< Callbacks of the added subsystems
+    std::vector<Snapshot> m_timeline;        //!< Samples
+    TypeMap m_peakTypes;                     //!< Per-TypeId counts at the peak
+    uint32_t m_peak;                         //!< Index of the peak sample
+    uint64_t m_peakBytes;                    //!< Bytes accounted at the peak
+    EventId m_sampleEvent;                   //!< Next sample
+};
+
+} // namespace ns3
+
+#endif /* MEMORY_ACCOUNTANT_H */
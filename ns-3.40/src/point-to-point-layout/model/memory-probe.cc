@@ -0,0 +1,56 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// Implement a probe of the memory used by the simulation process.
+
+#include "memory-probe.h"
+
+#include <cstring>
+#include <fstream>
+#include <string>
+
+namespace ns3
+{
+
+uint64_t
+MemoryProbe::GetResidentBytes()
+{
+    return ReadStatusField("VmRSS");
+}
+
+uint64_t
+MemoryProbe::GetPeakResidentBytes()
+{
+    return ReadStatusField("VmHWM");
+}
+
+uint64_t
+MemoryProbe::ReadStatusField(const char* field)
+{
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    size_t length = std::strlen(field);
+    while (std::getline(status, line))
+    {
+        // e.g. "VmRSS:     123456 kB"
+        if (line.compare(0, length, field) == 0 && line.size() > length && line[length] == ':')
+        {
+            return std::stoull(line.substr(length + 1)) * 1024;
+        }
+    }
+    return 0;
+}
+
+} // namespace ns3
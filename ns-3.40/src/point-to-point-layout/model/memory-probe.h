@@ -0,0 +1,57 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// Define a probe of the memory used by the simulation process.
+
+#ifndef MEMORY_PROBE_H
+#define MEMORY_PROBE_H
+
+#include <cstdint>
+
+namespace ns3
+{
+
+/**
+ * \ingroup point-to-point-layout
+ *
+ * \brief Read the memory footprint of the simulation process.
+ *
+ * The values come from /proc/self/status and are zero where it is not
+ * available.
+ */
+class MemoryProbe
+{
+  public:
+    /**
+     * \returns the current resident set size, in bytes
+     */
+    static uint64_t GetResidentBytes();
+
+    /**
+     * \returns the peak resident set size, in bytes
+     */
+    static uint64_t GetPeakResidentBytes();
+
+  private:
+    /**
+     * \returns a size field of /proc/self/status, in bytes
+     * \param field the field name, e.g. "VmRSS"
+     */
+    static uint64_t ReadStatusField(const char* field);
+};
+
+} // namespace ns3
+
+#endif /* MEMORY_PROBE_H */
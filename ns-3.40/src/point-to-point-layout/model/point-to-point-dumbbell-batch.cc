@@ -0,0 +1,135 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// Implement an object to create many independent dumbbells in one simulation.
+
+#include "point-to-point-dumbbell-batch.h"
+
+#include "ns3/abort.h"
+#include "ns3/log.h"
+#include "ns3/node-list.h"
+
+#include <algorithm>
+
+namespace ns3
+{
+
+NS_LOG_COMPONENT_DEFINE("PointToPointDumbbellBatchHelper");
+
+PointToPointDumbbellBatchHelper::PointToPointDumbbellBatchHelper()
+{
+}
+
+PointToPointDumbbellBatchHelper::~PointToPointDumbbellBatchHelper()
+{
+}
+
+uint32_t
+PointToPointDumbbellBatchHelper::Add(uint32_t nLeftLeaf,
+                                     PointToPointHelper leftHelper,
+                                     uint32_t nRightLeaf,
+                                     PointToPointHelper rightHelper,
+                                     PointToPointHelper bottleneckHelper)
+{
+    m_firstNodeId.push_back(NodeList::GetNNodes());
+    m_instances.emplace_back(nLeftLeaf, leftHelper, nRightLeaf, rightHelper, bottleneckHelper);
+    m_endNodeId.push_back(NodeList::GetNNodes());
+    return m_instances.size() - 1;
+}
+
+uint32_t
+PointToPointDumbbellBatchHelper::Add(uint32_t nLeaf,
+                                     PointToPointHelper leaf_to_router0,
+                                     PointToPointHelper leaf_to_router1,
+                                     PointToPointHelper bottleneckHelper)
+{
+    m_firstNodeId.push_back(NodeList::GetNNodes());
+    m_instances.emplace_back(nLeaf, leaf_to_router0, leaf_to_router1, bottleneckHelper);
+    m_endNodeId.push_back(NodeList::GetNNodes());
+    return m_instances.size() - 1;
+}
+
+uint32_t
+PointToPointDumbbellBatchHelper::Add(
+    const std::vector<PointToPointDumbbellHelper::LeafLink>& leftLinks,
+    const std::vector<PointToPointDumbbellHelper::LeafLink>& rightLinks,
+    PointToPointHelper bottleneckHelper,
+    PointToPointHelper leafHelper)
+{
+    m_firstNodeId.push_back(NodeList::GetNNodes());
+    m_instances.emplace_back(leftLinks, rightLinks, bottleneckHelper, leafHelper);
+    m_endNodeId.push_back(NodeList::GetNNodes());
+    return m_instances.size() - 1;
+}
+
+uint32_t
+PointToPointDumbbellBatchHelper::GetN() const
+{
+    return m_instances.size();
+}
+
+PointToPointDumbbellHelper&
+PointToPointDumbbellBatchHelper::Get(uint32_t i)
+{
+    return m_instances.at(i);
+}
+
+uint32_t
+PointToPointDumbbellBatchHelper::GetInstanceOfNode(uint32_t nodeId) const
+{
+    // Each instance creates its nodes in one go, so node ids are contiguous
+    auto it = std::upper_bound(m_firstNodeId.begin(), m_firstNodeId.end(), nodeId);
+    if (it == m_firstNodeId.begin())
+    {
+        return GetN();
+    }
+    // The leaf counts do not give the node count of aggregated sides, so
+    // the range of every instance is recorded when it is built
+    uint32_t i = std::distance(m_firstNodeId.begin(), it) - 1;
+    return nodeId < m_endNodeId[i] ? i : GetN();
+}
+
+void
+PointToPointDumbbellBatchHelper::InstallStack(InternetStackHelper stack)
+{
+    for (auto& d : m_instances)
+    {
+        d.InstallStack(stack);
+    }
+}
+
+void
+PointToPointDumbbellBatchHelper::AssignIpv4Addresses(Ipv4Address base, Ipv4Mask mask)
+{
+    // One network per link: the leaf links of each side, then the bottleneck
+    uint32_t step = ~mask.Get() + 1;
+    uint32_t network = base.Get();
+    for (auto& d : m_instances)
+    {
+        uint32_t nNetworks = d.LeftCount() + d.RightCount() + 1;
+        NS_ABORT_MSG_IF(static_cast<uint64_t>(network) + static_cast<uint64_t>(nNetworks) * step >
+                            0xffffffffULL,
+                        "Out of IPv4 networks for the dumbbell instances");
+        Ipv4AddressHelper leftIp(Ipv4Address(network), mask);
+        network += d.LeftCount() * step;
+        Ipv4AddressHelper rightIp(Ipv4Address(network), mask);
+        network += d.RightCount() * step;
+        Ipv4AddressHelper routerIp(Ipv4Address(network), mask);
+        network += step;
+        d.AssignIpv4Addresses(leftIp, rightIp, routerIp);
+    }
+}
+
+} // namespace ns3
@@ -0,0 +1,136 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// Define an object to create many independent dumbbells in one simulation.
+
+#ifndef POINT_TO_POINT_DUMBBELL_BATCH_HELPER_H
+#define POINT_TO_POINT_DUMBBELL_BATCH_HELPER_H
+
+#include "point-to-point-dumbbell.h"
+
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * \ingroup point-to-point-layout
+ *
+ * \brief A helper to run many small, disjoint dumbbell topologies side
+ * by side in one simulation.
+ *
+ * Each instance is an ordinary PointToPointDumbbellHelper with its own
+ * link parameters; instances share no node or link, so they do not
+ * interact and their results can be reported separately (for instance
+ * with one DumbbellFlowMonitor per instance).  Running K instances in one
+ * process pays the process startup, TypeId registration and stack setup
+ * once instead of K times.
+ */
+class PointToPointDumbbellBatchHelper
+{
+  public:
+    PointToPointDumbbellBatchHelper();
+    ~PointToPointDumbbellBatchHelper();
+
+    /**
+     * Add an instance; see the PointToPointDumbbellHelper constructor with
+     * the same arguments.
+     *
+     * \param nLeftLeaf number of left side leaf nodes
+     * \param leftHelper helper for the left leaf links
+     * \param nRightLeaf number of right side leaf nodes
+     * \param rightHelper helper for the right leaf links
+     * \param bottleneckHelper helper for the bottleneck link
+     * \returns the instance index
+     */
+    uint32_t Add(uint32_t nLeftLeaf,
+                 PointToPointHelper leftHelper,
+                 uint32_t nRightLeaf,
+                 PointToPointHelper rightHelper,
+                 PointToPointHelper bottleneckHelper);
+
+    /**
+     * Add an instance; see the PointToPointDumbbellHelper constructor with
+     * the same arguments.
+     *
+     * \param nLeaf number of left and right side leaf nodes
+     * \param leaf_to_router0 helper for the links of the first leaves
+     * \param leaf_to_router1 helper for the links of the second leaves
+     * \param bottleneckHelper helper for the bottleneck link
+     * \returns the instance index
+     */
+    uint32_t Add(uint32_t nLeaf,
+                 PointToPointHelper leaf_to_router0,
+                 PointToPointHelper leaf_to_router1,
+                 PointToPointHelper bottleneckHelper);
+
+    /**
+     * Add an instance; see the PointToPointDumbbellHelper constructor with
+     * the same arguments.
+     *
+     * \param leftLinks the link of each left leaf
+     * \param rightLinks the link of each right leaf
+     * \param bottleneckHelper helper for the bottleneck link
+     * \param leafHelper helper providing the other leaf link settings
+     * \returns the instance index
+     */
+    uint32_t Add(const std::vector<PointToPointDumbbellHelper::LeafLink>& leftLinks,
+                 const std::vector<PointToPointDumbbellHelper::LeafLink>& rightLinks,
+                 PointToPointHelper bottleneckHelper,
+                 PointToPointHelper leafHelper = PointToPointHelper());
+
+    /**
+     * \returns the number of instances
+     */
+    uint32_t GetN() const;
+
+    /**
+     * \returns an instance
+     * \param i the instance index
+     */
+    PointToPointDumbbellHelper& Get(uint32_t i);
+
+    /**
+     * \returns the instance owning a node, or GetN() if none does
+     * \param nodeId the node id
+     */
+    uint32_t GetInstanceOfNode(uint32_t nodeId) const;
+
+    /**
+     * \param stack an InternetStackHelper used to install on every node
+     *              of every instance
+     */
+    void InstallStack(InternetStackHelper stack);
+
+    /**
+     * Give every link of every instance its own IPv4 network, taken in
+     * order from a range starting at base, so that no two instances share
+     * an address.
+     *
+     * \param base the first network
+     * \param mask the mask of every network
+     */
+    void AssignIpv4Addresses(Ipv4Address base = Ipv4Address("10.0.0.0"),
+                             Ipv4Mask mask = Ipv4Mask("255.255.255.0"));
+
+  private:
+    std::vector<PointToPointDumbbellHelper> m_instances; //!< Dumbbell instances
+    std::vector<uint32_t> m_firstNodeId;                 //!< First node id of each instance
+    std::vector<uint32_t> m_endNodeId;                   //!< Node id after each instance
+};
+
+} // namespace ns3
+
+#endif /* POINT_TO_POINT_DUMBBELL_BATCH_HELPER_H */
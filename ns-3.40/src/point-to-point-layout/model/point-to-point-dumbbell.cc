@@ -19,15 +19,24 @@
 
 #include "point-to-point-dumbbell.h"
 
+#include "ns3/boolean.h"
 #include "ns3/constant-position-mobility-model.h"
+#include "ns3/abort.h"
+#include "ns3/ipv4-list-routing.h"
 #include "ns3/ipv6-address-generator.h"
 #include "ns3/log.h"
 #include "ns3/node-list.h"
 #include "ns3/point-to-point-net-device.h"
+#include "ns3/queue-disc.h"
+#include "ns3/string.h"
+#include "ns3/traffic-control-helper.h"
+#include "ns3/traffic-control-layer.h"
 #include "ns3/vector.h"
 #include "ns3/quic-helper.h"
+#include <algorithm>
 #include <cmath>
 #include <iostream>
+#include <map>
 #include <sstream>
 
 namespace ns3
@@ -39,6 +48,8 @@ PointToPointDumbbellHelper::PointToPointDumbbellHelper(uint32_t nLeaf,
                                                        PointToPointHelper leaf_to_router0,
                                                        PointToPointHelper leaf_to_router1,
                                                        PointToPointHelper bottleneckHelper)
+    : m_aggregateLeft(false),
+      m_aggregateRight(false)
 {
     // Create the bottleneck routers
     m_routers.Create(2);
@@ -67,41 +78,147 @@ PointToPointDumbbellHelper::PointToPointDumbbellHelper(uint32_t nLeaf,
         m_rightLeafDevices.Add(c_right.Get(1));
     }
 }
-PointToPointDumbbellHelper::PointToPointDumbbellHelper(uint32_t nLeftLeaf,
-                                                       PointToPointHelper leftHelper,
-                                                       uint32_t nRightLeaf,
-                                                       PointToPointHelper rightHelper,
-                                                       PointToPointHelper bottleneckHelper)
+
+template <typename Helper>
+void
+PointToPointDumbbellHelper::Build(uint32_t nLeftLeaf,
+                                  Helper& leftHelper,
+                                  uint32_t nRightLeaf,
+                                  Helper& rightHelper,
+                                  PointToPointHelper& bottleneckHelper)
 {
     // Create the bottleneck routers
     m_routers.Create(2);
-    // Create the leaf nodes
-    m_leftLeaf.Create(nLeftLeaf);
-    m_rightLeaf.Create(nRightLeaf);
+    // Create the leaf nodes, a single one per aggregated side
+    m_leftLeaf.Create(m_aggregateLeft ? std::min(nLeftLeaf, 1U) : nLeftLeaf);
+    m_rightLeaf.Create(m_aggregateRight ? std::min(nRightLeaf, 1U) : nRightLeaf);
 
     // Add the link connecting routers
     m_routerDevices = bottleneckHelper.Install(m_routers);
     // Add the left side links
     for (uint32_t i = 0; i < nLeftLeaf; ++i)
     {
-        NetDeviceContainer c = leftHelper.Install(m_routers.Get(0), m_leftLeaf.Get(i));
+        NetDeviceContainer c = leftHelper.Install(m_routers.Get(0), GetLeft(i));
         m_leftRouterDevices.Add(c.Get(0));
         m_leftLeafDevices.Add(c.Get(1));
-    
     }
     // Add the right side links
     for (uint32_t i = 0; i < nRightLeaf; ++i)
     {
-        NetDeviceContainer c = rightHelper.Install(m_routers.Get(1), m_rightLeaf.Get(i));
+        NetDeviceContainer c = rightHelper.Install(m_routers.Get(1), GetRight(i));
         m_rightRouterDevices.Add(c.Get(0));
         m_rightLeafDevices.Add(c.Get(1));
     }
 }
 
+PointToPointDumbbellHelper::PointToPointDumbbellHelper(uint32_t nLeftLeaf,
+                                                       PointToPointHelper leftHelper,
+                                                       uint32_t nRightLeaf,
+                                                       PointToPointHelper rightHelper,
+                                                       PointToPointHelper bottleneckHelper,
+                                                       LeafAggregation aggregation)
+    : m_aggregateLeft(aggregation & AGGREGATE_LEFT),
+      m_aggregateRight(aggregation & AGGREGATE_RIGHT)
+{
+    Build(nLeftLeaf, leftHelper, nRightLeaf, rightHelper, bottleneckHelper);
+}
+
+PointToPointDumbbellHelper::PointToPointDumbbellHelper(uint32_t nLeftLeaf,
+                                                       PointToPointTrainHelper leftHelper,
+                                                       uint32_t nRightLeaf,
+                                                       PointToPointTrainHelper rightHelper,
+                                                       PointToPointHelper bottleneckHelper,
+                                                       LeafAggregation aggregation)
+    : m_aggregateLeft(aggregation & AGGREGATE_LEFT),
+      m_aggregateRight(aggregation & AGGREGATE_RIGHT)
+{
+    Build(nLeftLeaf, leftHelper, nRightLeaf, rightHelper, bottleneckHelper);
+}
+
+PointToPointDumbbellHelper::PointToPointDumbbellHelper(const std::vector<LeafLink>& leftLinks,
+                                                       const std::vector<LeafLink>& rightLinks,
+                                                       PointToPointHelper bottleneckHelper,
+                                                       PointToPointHelper leafHelper,
+                                                       LeafAggregation aggregation)
+    : m_aggregateLeft(aggregation & AGGREGATE_LEFT),
+      m_aggregateRight(aggregation & AGGREGATE_RIGHT)
+{
+    // Create the bottleneck routers
+    m_routers.Create(2);
+    // Create the leaf nodes, a single one per aggregated side
+    m_leftLeaf.Create(m_aggregateLeft ? std::min<uint32_t>(leftLinks.size(), 1) : leftLinks.size());
+    m_rightLeaf.Create(m_aggregateRight ? std::min<uint32_t>(rightLinks.size(), 1)
+                                        : rightLinks.size());
+
+    // Add the link connecting routers
+    m_routerDevices = bottleneckHelper.Install(m_routers);
+    // Add the leaf links of each side
+    InstallLeafLinks(m_routers.Get(0),
+                     m_leftLeaf,
+                     m_aggregateLeft,
+                     leftLinks,
+                     leafHelper,
+                     m_leftRouterDevices,
+                     m_leftLeafDevices);
+    InstallLeafLinks(m_routers.Get(1),
+                     m_rightLeaf,
+                     m_aggregateRight,
+                     rightLinks,
+                     leafHelper,
+                     m_rightRouterDevices,
+                     m_rightLeafDevices);
+}
+
 PointToPointDumbbellHelper::~PointToPointDumbbellHelper()
 {
 }
 
+void
+PointToPointDumbbellHelper::InstallLeafLinks(Ptr<Node> router,
+                                             const NodeContainer& leaves,
+                                             bool aggregate,
+                                             const std::vector<LeafLink>& links,
+                                             const PointToPointHelper& leafHelper,
+                                             NetDeviceContainer& routerDevices,
+                                             NetDeviceContainer& leafDevices)
+{
+    // One configured helper per distinct (rate, delay); leaves with the
+    // same parameters share its device and channel factories
+    std::map<std::pair<uint64_t, int64_t>, PointToPointHelper> helpers;
+    for (uint32_t i = 0; i < links.size(); ++i)
+    {
+        auto key = std::make_pair(links[i].rate.GetBitRate(), links[i].delay.GetTimeStep());
+        auto it = helpers.find(key);
+        if (it == helpers.end())
+        {
+            PointToPointHelper helper = leafHelper;
+            helper.SetDeviceAttribute("DataRate", DataRateValue(links[i].rate));
+            helper.SetChannelAttribute("Delay", TimeValue(links[i].delay));
+            it = helpers.emplace(key, helper).first;
+        }
+        NetDeviceContainer c = it->second.Install(router, leaves.Get(aggregate ? 0 : i));
+        routerDevices.Add(c.Get(0));
+        leafDevices.Add(c.Get(1));
+    }
+    NS_LOG_INFO(links.size() << " leaf links share " << helpers.size() << " configurations");
+}
+
+std::vector<PointToPointDumbbellHelper::LeafLink>
+PointToPointDumbbellHelper::SampleLeafLinks(uint32_t n,
+                                            Ptr<RandomVariableStream> rate,
+                                            Ptr<RandomVariableStream> delay,
+                                            Time resolution)
+{
+    std::vector<LeafLink> links(n);
+    for (auto& link : links)
+    {
+        link.rate = DataRate(static_cast<uint64_t>(std::llround(rate->GetValue())));
+        int64_t steps = std::llround(delay->GetValue() / resolution.GetSeconds());
+        link.delay = resolution * std::max<int64_t>(steps, 0);
+    }
+    return links;
+}
+
 Ptr<Node>
 PointToPointDumbbellHelper::GetLeft() const
 { // Get the left side bottleneck router
@@ -111,7 +228,7 @@ PointToPointDumbbellHelper::GetLeft() const
 Ptr<Node>
 PointToPointDumbbellHelper::GetLeft(uint32_t i) const
 { // Get the i'th left side leaf
-    return m_leftLeaf.Get(i);
+    return m_leftLeaf.Get(m_aggregateLeft ? 0 : i);
 }
 
 Ptr<Node>
@@ -123,7 +240,7 @@ PointToPointDumbbellHelper::GetRight() const
 Ptr<Node>
 PointToPointDumbbellHelper::GetRight(uint32_t i) const
 { // Get the i'th right side leaf
-    return m_rightLeaf.Get(i);
+    return m_rightLeaf.Get(m_aggregateRight ? 0 : i);
 }
 
 Ipv4Address
@@ -153,13 +270,13 @@ PointToPointDumbbellHelper::GetRightIpv6Address(uint32_t i) const
 uint32_t
 PointToPointDumbbellHelper::LeftCount() const
 { // Number of left side nodes
-    return m_leftLeaf.GetN();
+    return m_leftLeafDevices.GetN();
 }
 
 uint32_t
 PointToPointDumbbellHelper::RightCount() const
 { // Number of right side nodes
-    return m_rightLeaf.GetN();
+    return m_rightLeafDevices.GetN();
 }
 
 void
@@ -171,13 +288,144 @@ PointToPointDumbbellHelper::InstallStack(InternetStackHelper stack)
 }
 
 void
-PointToPointDumbbellHelper::InstallStackQuic(QuicHelper stack)
+PointToPointDumbbellHelper::InstallStackQuic(QuicHelper stack, bool quicOnRouters)
 {
-    stack.InstallQuic(m_routers);
+    if (quicOnRouters)
+    {
+        stack.InstallQuic(m_routers);
+    }
+    else
+    {
+        InternetStackHelper routerStack;
+        routerStack.Install(m_routers);
+    }
     stack.InstallQuic(m_leftLeaf);
     stack.InstallQuic(m_rightLeaf);
 }
 
+Ptr<DumbbellFlowMonitor>
+PointToPointDumbbellHelper::InstallFlowMonitor(bool delayHistogram)
+{
+    Ptr<DumbbellFlowMonitor> monitor = CreateObject<DumbbellFlowMonitor>();
+    monitor->SetAttribute("DelayHistogram", BooleanValue(delayHistogram));
+    for (uint32_t i = 0; i < m_leftLeaf.GetN(); ++i)
+    {
+        monitor->Install(m_leftLeaf.Get(i));
+    }
+    for (uint32_t i = 0; i < m_rightLeaf.GetN(); ++i)
+    {
+        monitor->Install(m_rightLeaf.Get(i));
+    }
+    return monitor;
+}
+
+Ptr<LinkScheduleReplayer>
+PointToPointDumbbellHelper::ReplayBottleneckSchedule(std::string filename, bool bothDirections)
+{
+    Ptr<LinkScheduleReplayer> replayer = CreateObject<LinkScheduleReplayer>();
+    replayer->Install(DynamicCast<PointToPointNetDevice>(m_routerDevices.Get(0)));
+    if (bothDirections)
+    {
+        replayer->Install(DynamicCast<PointToPointNetDevice>(m_routerDevices.Get(1)));
+    }
+    replayer->Start(filename);
+    return replayer;
+}
+
+std::pair<Ptr<Ipv4CompiledRouting>, Ptr<Ipv4CompiledRouting>>
+PointToPointDumbbellHelper::CompileRouterForwarding()
+{
+    return std::make_pair(Ipv4CompiledRouting::Install(m_routers.Get(0)),
+                          Ipv4CompiledRouting::Install(m_routers.Get(1)));
+}
+
+QueueDiscContainer
+PointToPointDumbbellHelper::InstallBottleneckQueueDisc(std::string type, QueueSize maxSize, bool bql)
+{
+    // Accept "FqCoDel" as well as "ns3::FqCoDelQueueDisc"
+    TypeId tid;
+    std::string name = type.rfind("ns3::", 0) == 0 ? type : "ns3::" + type;
+    if (!TypeId::LookupByNameFailSafe(name, &tid))
+    {
+        NS_ABORT_MSG_UNLESS(TypeId::LookupByNameFailSafe(name + "QueueDisc", &tid),
+                            "Unknown queue disc type " << type);
+    }
+
+    TrafficControlHelper tch;
+    TypeId::AttributeInformation info;
+    if (tid.LookupAttributeByName("MaxSize", &info))
+    {
+        tch.SetRootQueueDisc(tid.GetName(), "MaxSize", QueueSizeValue(maxSize));
+    }
+    else
+    {
+        tch.SetRootQueueDisc(tid.GetName());
+    }
+    if (bql)
+    {
+        tch.SetQueueLimits("ns3::DynamicQueueLimits");
+    }
+
+    for (uint32_t i = 0; i < m_routerDevices.GetN(); ++i)
+    {
+        Ptr<NetDevice> device = m_routerDevices.Get(i);
+        Ptr<TrafficControlLayer> tc = device->GetNode()->GetObject<TrafficControlLayer>();
+        NS_ABORT_MSG_UNLESS(tc, "Install the Internet stack before the bottleneck queue disc");
+        if (tc->GetRootQueueDiscOnDevice(device))
+        {
+            tch.Uninstall(device);
+        }
+    }
+    return tch.Install(m_routerDevices);
+}
+
+Ptr<BottleneckDelayProbe>
+PointToPointDumbbellHelper::InstallBottleneckDelayProbe(bool perConnection)
+{
+    Ptr<BottleneckDelayProbe> probe = CreateObject<BottleneckDelayProbe>();
+    probe->SetAttribute("PerConnection", BooleanValue(perConnection));
+    probe->Install(m_routerDevices.Get(0));
+    return probe;
+}
+
+Ptr<ReceiveCoalescer>
+PointToPointDumbbellHelper::EnableReceiveCoalescing(Time budget)
+{
+    Ptr<ReceiveCoalescer> coalescer = CreateObject<ReceiveCoalescer>();
+    coalescer->SetAttribute("Budget", TimeValue(budget));
+    for (uint32_t i = 0; i < m_leftLeafDevices.GetN(); ++i)
+    {
+        coalescer->Install(m_leftLeafDevices.Get(i));
+    }
+    for (uint32_t i = 0; i < m_rightLeafDevices.GetN(); ++i)
+    {
+        coalescer->Install(m_rightLeafDevices.Get(i));
+    }
+    return coalescer;
+}
+
+Ptr<LiveMetricsPublisher>
+PointToPointDumbbellHelper::EnableLiveMetrics(Ptr<DumbbellFlowMonitor> monitor,
+                                              Time interval,
+                                              std::string name)
+{
+    Ptr<LiveMetricsPublisher> publisher = CreateObject<LiveMetricsPublisher>();
+    publisher->SetAttribute("Name", StringValue(name));
+    if (monitor)
+    {
+        publisher->TraceFlows(monitor, interval);
+    }
+    Ptr<PointToPointNetDevice> device =
+        DynamicCast<PointToPointNetDevice>(m_routerDevices.Get(0));
+    publisher->TraceQueue(device->GetQueue(), "bottleneck device queue");
+    Ptr<TrafficControlLayer> tc = m_routers.Get(0)->GetObject<TrafficControlLayer>();
+    Ptr<QueueDisc> queueDisc = tc ? tc->GetRootQueueDiscOnDevice(device) : nullptr;
+    if (queueDisc)
+    {
+        publisher->TraceQueue(queueDisc, "bottleneck queue disc");
+    }
+    return publisher;
+}
 
 void
 PointToPointDumbbellHelper::AssignIpv4Addresses(Ipv4AddressHelper leftIp,
@@ -208,6 +456,34 @@ PointToPointDumbbellHelper::AssignIpv4Addresses(Ipv4AddressHelper leftIp,
         m_rightRouterInterfaces.Add(ifc.Get(1));
         rightIp.NewNetwork();
     }
+    // Send the packets of each aggregated leaf out of its own access link
+    if (m_aggregateLeft)
+    {
+        InstallSourceAddressRouting(m_leftLeafInterfaces);
+    }
+    if (m_aggregateRight)
+    {
+        InstallSourceAddressRouting(m_rightLeafInterfaces);
+    }
+}
+
+void
+PointToPointDumbbellHelper::InstallSourceAddressRouting(const Ipv4InterfaceContainer& interfaces)
+{
+    if (interfaces.GetN() == 0)
+    {
+        return;
+    }
+    Ptr<Ipv4> ipv4 = interfaces.Get(0).first;
+    Ptr<Ipv4ListRouting> list = DynamicCast<Ipv4ListRouting>(ipv4->GetRoutingProtocol());
+    NS_ABORT_MSG_UNLESS(list, "Aggregated leaves need an Ipv4ListRouting");
+    Ptr<Ipv4SourceAddressRouting> routing = CreateObject<Ipv4SourceAddressRouting>();
+    // Above the static (0) and global (-10) routing of InternetStackHelper
+    list->AddRoutingProtocol(routing, 10);
+    for (uint32_t i = 0; i < interfaces.GetN(); ++i)
+    {
+        routing->AddInterface(interfaces.Get(i).second);
+    }
 }
 
 void
@@ -20,14 +20,29 @@
 #ifndef POINT_TO_POINT_DUMBBELL_HELPER_H
 #define POINT_TO_POINT_DUMBBELL_HELPER_H
 
+#include "bottleneck-delay-probe.h"
+#include "dumbbell-flow-monitor.h"
+#include "ipv4-compiled-routing.h"
+#include "ipv4-source-address-routing.h"
+#include "link-schedule-replayer.h"
+#include "live-metrics-publisher.h"
+#include "point-to-point-train-helper.h"
+#include "receive-coalescer.h"
+
+#include "ns3/data-rate.h"
 #include "ns3/internet-stack-helper.h"
 #include "ns3/ipv4-address-helper.h"
 #include "ns3/ipv4-interface-container.h"
 #include "ns3/ipv6-address-helper.h"
 #include "ns3/ipv6-interface-container.h"
 #include "ns3/point-to-point-helper.h"
+#include "ns3/queue-disc-container.h"
+#include "ns3/queue-size.h"
 #include "ns3/quic-helper.h"
+#include "ns3/random-variable-stream.h"
 #include <string>
+#include <utility>
+#include <vector>
 
 namespace ns3
 {
@@ -41,10 +56,29 @@ namespace ns3
 class PointToPointDumbbellHelper
 {
   public:
+    /// Sides of the dumbbell whose leaves are aggregated into one node
+    enum LeafAggregation
+    {
+        AGGREGATE_NONE = 0,  //!< One node per leaf
+        AGGREGATE_LEFT = 1,  //!< One node for all the left leaves
+        AGGREGATE_RIGHT = 2, //!< One node for all the right leaves
+        AGGREGATE_BOTH = 3,  //!< One node per side
+    };
+
     /**
      * Create a PointToPointDumbbellHelper in order to easily create
      * dumbbell topologies using p2p links
      *
+     * With leaf aggregation, all the leaves of a side are hosted by a
+     * single node with one device, access link and address per leaf, so
+     * each flow keeps its own access-link serialization and delay while
+     * the side only costs one Internet stack.  GetLeft(i) (or GetRight(i))
+     * then returns that node for every i, and applications must bind
+     * their sockets to the device of leaf i (and to GetLeftIpv4Address(i))
+     * to use it: an Ipv4SourceAddressRouting added by AssignIpv4Addresses sends
+     * their packets out of the matching access link.  Aggregated leaves
+     * are IPv4 only.
+     *
      * \param nLeftLeaf number of left side leaf nodes in the dumbbell
      *
      * \param leftHelper PointToPointHelper used to install the links
@@ -60,19 +94,92 @@ class PointToPointDumbbellHelper
      * \param bottleneckHelper PointToPointHelper used to install the link
      *                         between the inner-routers, usually known as
      *                         the bottleneck link
+     *
+     * \param aggregation sides whose leaves share one node
      */
     PointToPointDumbbellHelper(uint32_t nLeftLeaf,
                                PointToPointHelper leftHelper,
                                uint32_t nRightLeaf,
                                PointToPointHelper rightHelper,
-                               PointToPointHelper bottleneckHelper);
+                               PointToPointHelper bottleneckHelper,
+                               LeafAggregation aggregation = AGGREGATE_NONE);
+
+    /**
+     * Create a dumbbell whose leaf links send their backlog in trains
+     * (see PointToPointTrainNetDevice), which cuts the events of fast
+     * access links; the bottleneck link is a plain one.  The arguments
+     * are those of the constructor above.  The leaf links do not fire the
+     * sender-side device traces nor the channel TxRxPointToPoint trace,
+     * so NetAnim shows no packets on them.
+     *
+     * \param nLeftLeaf number of left side leaf nodes
+     * \param leftHelper helper for the left leaf links
+     * \param nRightLeaf number of right side leaf nodes
+     * \param rightHelper helper for the right leaf links
+     * \param bottleneckHelper helper for the bottleneck link
+     * \param aggregation sides whose leaves share one node
+     */
+    PointToPointDumbbellHelper(uint32_t nLeftLeaf,
+                               PointToPointTrainHelper leftHelper,
+                               uint32_t nRightLeaf,
+                               PointToPointTrainHelper rightHelper,
+                               PointToPointHelper bottleneckHelper,
+                               LeafAggregation aggregation = AGGREGATE_NONE);
+
     PointToPointDumbbellHelper(uint32_t nLeaf,
                                PointToPointHelper leaf_to_router0,
                                PointToPointHelper leaf_to_router1,
                                PointToPointHelper bottleneckHelper);
 
+    /// Rate and delay of one leaf link
+    struct LeafLink
+    {
+        DataRate rate; //!< Link rate
+        Time delay;    //!< Link one-way delay
+    };
+
+    /**
+     * Create a dumbbell whose leaf links each have their own rate and
+     * delay.  Leaf links with the same rate and delay are installed by
+     * the same PointToPointHelper, so a table of thousands of leaves
+     * only costs one helper per distinct (rate, delay) pair.
+     *
+     * \param leftLinks the link of each left leaf, in leaf order
+     *
+     * \param rightLinks the link of each right leaf, in leaf order
+     *
+     * \param bottleneckHelper PointToPointHelper used to install the link
+     *                         between the inner-routers
+     *
+     * \param leafHelper PointToPointHelper providing the other device,
+     *                   channel and queue settings of the leaf links
+     *
+     * \param aggregation sides whose leaves share one node
+     */
+    PointToPointDumbbellHelper(const std::vector<LeafLink>& leftLinks,
+                               const std::vector<LeafLink>& rightLinks,
+                               PointToPointHelper bottleneckHelper,
+                               PointToPointHelper leafHelper = PointToPointHelper(),
+                               LeafAggregation aggregation = AGGREGATE_NONE);
+
     ~PointToPointDumbbellHelper();
 
+    /**
+     * Draw a table of leaf links from random variables.  Delays are
+     * rounded to the given resolution, so that leaves can share their
+     * link configuration.
+     *
+     * \param n number of leaves
+     * \param rate random variable giving the rates, in bit/s
+     * \param delay random variable giving the delays, in seconds
+     * \param resolution delay resolution
+     * \returns the table
+     */
+    static std::vector<LeafLink> SampleLeafLinks(uint32_t n,
+                                                 Ptr<RandomVariableStream> rate,
+                                                 Ptr<RandomVariableStream> delay,
+                                                 Time resolution = MicroSeconds(100));
+
   public:
     /**
      * \returns pointer to the node of the left side bottleneck
@@ -142,8 +249,103 @@ class PointToPointDumbbellHelper
     /**
      * \param stack an QuicHelper which is used to install
      *              on every node in the dumbbell
+     *
+     * \param quicOnRouters also install QUIC on the routers; when false,
+     *                      the routers, which never terminate a QUIC
+     *                      connection, only get a plain Internet stack
+     *                      and forward IP
+     */
+    void InstallStackQuic(QuicHelper stack, bool quicOnRouters = true);
+
+    /**
+     * Install a DumbbellFlowMonitor on the leaf nodes only.  The routers
+     * are not probed, so forwarded packets cost nothing extra.  Must be
+     * called after the Internet stack has been installed.
+     *
+     * \param delayHistogram keep a per-flow one-way delay histogram
+     * \returns the flow monitor
+     */
+    Ptr<DumbbellFlowMonitor> InstallFlowMonitor(bool delayHistogram = false);
+
+    /**
+     * Replay a rate/delay/loss schedule on the bottleneck link; see
+     * LinkScheduleReplayer for the file formats.
+     *
+     * \param filename the schedule file
+     * \param bothDirections apply the rate and loss to the right-to-left
+     *                       direction too, not only to left-to-right
+     * \returns the replayer, already started
+     */
+    Ptr<LinkScheduleReplayer> ReplayBottleneckSchedule(std::string filename,
+                                                       bool bothDirections = true);
+
+    /**
+     * Forward through both routers with an Ipv4CompiledRouting, whose
+     * per-packet cost does not grow with the number of leaf subnets.
+     * Must be called after the Internet stack has been installed; the
+     * routes may be populated before or after.  Calling it again returns
+     * the instances already installed.  Routes replaced later
+     * without changing their number need Ipv4CompiledRouting::Invalidate
+     * on the returned instances.
+     *
+     * \returns the compiled routing of the left and of the right router
+     */
+    std::pair<Ptr<Ipv4CompiledRouting>, Ptr<Ipv4CompiledRouting>> CompileRouterForwarding();
+
+    /**
+     * Install a queue disc on both ends of the bottleneck link, replacing
+     * the one already there (e.g. the default installed with the
+     * addresses).  Must be called after the Internet stack has been
+     * installed.
+     *
+     * \param type the queue disc type, e.g. "ns3::FqCoDelQueueDisc"; the
+     *             "ns3::" prefix and "QueueDisc" suffix may be omitted, as
+     *             in "FqCoDel"
+     * \param maxSize the MaxSize of the queue disc, if it has one
+     * \param bql enable byte queue limits (DynamicQueueLimits) on the
+     *            bottleneck devices
+     * \returns the queue discs, the left-to-right one first
+     */
+    QueueDiscContainer InstallBottleneckQueueDisc(std::string type,
+                                                  QueueSize maxSize = QueueSize("100p"),
+                                                  bool bql = true);
+
+    /**
+     * Measure the per-flow queueing delay of the left-to-right bottleneck
+     * direction.  Must be called after the bottleneck queue disc has been
+     * installed.
+     *
+     * \param perConnection tell flows apart by their source port too
+     * \returns the probe
+     */
+    Ptr<BottleneckDelayProbe> InstallBottleneckDelayProbe(bool perConnection = true);
+
+    /**
+     * Coalesce the back-to-back TCP segments received by every leaf before
+     * they reach its stack.  Must be called after the Internet stack has
+     * been installed, and after anything else that registers protocol
+     * handlers on the leaves (see ReceiveCoalescer).
+     *
+     * \param budget how long the first segment of a flow may be held
+     * \returns the coalescer, shared by all the leaf devices
+     */
+    Ptr<ReceiveCoalescer> EnableReceiveCoalescing(Time budget = MicroSeconds(50));
+
+    /**
+     * Publish live metrics of the dumbbell into shared memory: the receive
+     * throughput of every flow of a monitor, and the length of the
+     * left-to-right bottleneck device queue and queue disc.  Sockets can
+     * be added to the returned publisher once the applications created
+     * them.  Must be called after the Internet stack has been installed.
+     *
+     * \param monitor the flow monitor, or null for the queues only
+     * \param interval the throughput sampling interval
+     * \param name the shared memory object name
+     * \returns the publisher
      */
-    void InstallStackQuic(QuicHelper stack);
+    Ptr<LiveMetricsPublisher> EnableLiveMetrics(Ptr<DumbbellFlowMonitor> monitor,
+                                                Time interval = MilliSeconds(100),
+                                                std::string name = "/ns3-metrics");
 
     /**
      * \param leftIp Ipv4AddressHelper to assign Ipv4 addresses to the
@@ -196,6 +398,50 @@ class PointToPointDumbbellHelper
     Ipv6InterfaceContainer m_rightLeafInterfaces6;   //!< Right Leaf interfaces (IPv6)
     Ipv6InterfaceContainer m_rightRouterInterfaces6; //!< Right router interfaces (IPv6)
     Ipv6InterfaceContainer m_routerInterfaces6;      //!< Router interfaces (IPv6)
+    bool m_aggregateLeft;                            //!< One node for the left leaves
+    bool m_aggregateRight;                           //!< One node for the right leaves
+
+    /**
+     * Install the leaf links of one side, one helper per distinct link
+     * \param router the router of that side
+     * \param leaves the leaf nodes of that side
+     * \param aggregate all the links go to the first leaf node
+     * \param links the link of each leaf
+     * \param leafHelper the template helper
+     * \param routerDevices receives the router devices
+     * \param leafDevices receives the leaf devices
+     */
+    static void InstallLeafLinks(Ptr<Node> router,
+                                 const NodeContainer& leaves,
+                                 bool aggregate,
+                                 const std::vector<LeafLink>& links,
+                                 const PointToPointHelper& leafHelper,
+                                 NetDeviceContainer& routerDevices,
+                                 NetDeviceContainer& leafDevices);
+
+    /**
+     * Create the routers, the leaves and the links shared by the
+     * constructors that take one helper per side
+     * \tparam Helper PointToPointHelper or PointToPointTrainHelper
+     * \param nLeftLeaf number of left side leaf nodes
+     * \param leftHelper helper for the left leaf links
+     * \param nRightLeaf number of right side leaf nodes
+     * \param rightHelper helper for the right leaf links
+     * \param bottleneckHelper helper for the bottleneck link
+     */
+    template <typename Helper>
+    void Build(uint32_t nLeftLeaf,
+               Helper& leftHelper,
+               uint32_t nRightLeaf,
+               Helper& rightHelper,
+               PointToPointHelper& bottleneckHelper);
+
+    /**
+     * Route the packets of each leaf of an aggregated node out of its own
+     * access link
+     * \param interfaces the leaf interfaces of the node
+     */
+    static void InstallSourceAddressRouting(const Ipv4InterfaceContainer& interfaces);
 };
 
 } // namespace ns3
@@ -0,0 +1,84 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// Implement a helper to install point-to-point links with train devices.
+
+#include "point-to-point-train-helper.h"
+
+#include "point-to-point-train-net-device.h"
+
+#include "ns3/mac48-address.h"
+#include "ns3/net-device-queue-interface.h"
+#include "ns3/point-to-point-channel.h"
+#include "ns3/queue.h"
+
+namespace ns3
+{
+
+PointToPointTrainHelper::PointToPointTrainHelper()
+{
+    m_queueFactory.SetTypeId("ns3::DropTailQueue<Packet>");
+    m_deviceFactory.SetTypeId("ns3::PointToPointTrainNetDevice");
+    m_channelFactory.SetTypeId("ns3::PointToPointChannel");
+}
+
+void
+PointToPointTrainHelper::SetQueue(std::string type)
+{
+    m_queueFactory.SetTypeId(type);
+}
+
+void
+PointToPointTrainHelper::SetQueueAttribute(std::string name, const AttributeValue& value)
+{
+    m_queueFactory.Set(name, value);
+}
+
+void
+PointToPointTrainHelper::SetDeviceAttribute(std::string name, const AttributeValue& value)
+{
+    m_deviceFactory.Set(name, value);
+}
+
+void
+PointToPointTrainHelper::SetChannelAttribute(std::string name, const AttributeValue& value)
+{
+    m_channelFactory.Set(name, value);
+}
+
+NetDeviceContainer
+PointToPointTrainHelper::Install(Ptr<Node> a, Ptr<Node> b) const
+{
+    Ptr<PointToPointChannel> channel = m_channelFactory.Create<PointToPointChannel>();
+    NetDeviceContainer devices;
+    for (Ptr<Node> node : {a, b})
+    {
+        Ptr<PointToPointTrainNetDevice> device =
+            m_deviceFactory.Create<PointToPointTrainNetDevice>();
+        device->SetAddress(Mac48Address::Allocate());
+        node->AddDevice(device);
+        Ptr<Queue<Packet>> queue = m_queueFactory.Create<Queue<Packet>>();
+        device->SetQueue(queue);
+        // Flow control towards the traffic control layer, as PointToPointHelper
+        Ptr<NetDeviceQueueInterface> ndqi = CreateObject<NetDeviceQueueInterface>();
+        ndqi->GetTxQueue(0)->ConnectQueueTraces(queue);
+        device->AggregateObject(ndqi);
+        device->Attach(channel);
+        devices.Add(device);
+    }
+    return devices;
+}
+
+} // namespace ns3
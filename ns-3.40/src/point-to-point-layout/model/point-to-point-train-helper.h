@@ -0,0 +1,95 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// Define a helper to install point-to-point links with train devices.
+
+#ifndef POINT_TO_POINT_TRAIN_HELPER_H
+#define POINT_TO_POINT_TRAIN_HELPER_H
+
+#include "ns3/net-device-container.h"
+#include "ns3/node.h"
+#include "ns3/object-factory.h"
+
+#include <string>
+
+namespace ns3
+{
+
+/**
+ * \ingroup point-to-point-layout
+ *
+ * \brief Install point-to-point links whose two ends are
+ * PointToPointTrainNetDevice, with the same settings as PointToPointHelper
+ * (device, channel and queue attributes).
+ *
+ * Pcap and ascii tracing are not supported: the sending device does not
+ * fire the traces they rely on.  Nor does the channel fire its
+ * TxRxPointToPoint trace, which NetAnim (AnimationInterface) relies on to
+ * draw packets: the links appear idle in an animation.
+ */
+class PointToPointTrainHelper
+{
+  public:
+    PointToPointTrainHelper();
+
+    /**
+     * Set the type and attributes of the device queues.
+     *
+     * \param type the queue type, e.g. "ns3::DropTailQueue<Packet>"
+     */
+    void SetQueue(std::string type);
+
+    /**
+     * Set an attribute of the device queues.
+     *
+     * \param name the name of the attribute to set
+     * \param value the value of the attribute to set
+     */
+    void SetQueueAttribute(std::string name, const AttributeValue& value);
+
+    /**
+     * Set an attribute of the devices, e.g. "DataRate" or "MaxTrain".
+     *
+     * \param name the name of the attribute to set
+     * \param value the value of the attribute to set
+     */
+    void SetDeviceAttribute(std::string name, const AttributeValue& value);
+
+    /**
+     * Set an attribute of the channels, e.g. "Delay".
+     *
+     * \param name the name of the attribute to set
+     * \param value the value of the attribute to set
+     */
+    void SetChannelAttribute(std::string name, const AttributeValue& value);
+
+    /**
+     * Link two nodes.
+     *
+     * \param a the first node
+     * \param b the second node
+     * \returns the devices, the one of a first
+     */
+    NetDeviceContainer Install(Ptr<Node> a, Ptr<Node> b) const;
+
+  private:
+    ObjectFactory m_queueFactory;   //!< Queue factory
+    ObjectFactory m_deviceFactory;  //!< Device factory
+    ObjectFactory m_channelFactory; //!< Channel factory
+};
+
+} // namespace ns3
+
+#endif /* POINT_TO_POINT_TRAIN_HELPER_H */
@@ -0,0 +1,239 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// Implement a point-to-point device transmitting its backlog in trains.
+
+#include "point-to-point-train-net-device.h"
+
+#include "ns3/abort.h"
+#include "ns3/data-rate.h"
+#include "ns3/log.h"
+#include "ns3/node.h"
+#include "ns3/ppp-header.h"
+#include "ns3/queue.h"
+#include "ns3/simulator.h"
+#include "ns3/uinteger.h"
+
+#include <algorithm>
+#include <string>
+
+namespace ns3
+{
+
+NS_LOG_COMPONENT_DEFINE("PointToPointTrainNetDevice");
+
+NS_OBJECT_ENSURE_REGISTERED(PointToPointTrainNetDevice);
+
+namespace
+{
+
+/**
+ * \param tid a type
+ * \param name the name of one of its attributes
+ * \returns the accessor of the attribute
+ */
+Ptr<const AttributeAccessor>
+LookupAccessor(TypeId tid, std::string name)
+{
+    TypeId::AttributeInformation info;
+    NS_ABORT_MSG_UNLESS(tid.LookupAttributeByName(name, &info),
+                        tid.GetName() << " has no " << name << " attribute");
+    return info.accessor;
+}
+
+} // namespace
+
+TypeId
+PointToPointTrainNetDevice::GetTypeId()
+{
+    static TypeId tid =
+        TypeId("ns3::PointToPointTrainNetDevice")
+            .SetParent<PointToPointNetDevice>()
+            .SetGroupName("PointToPointLayout")
+            .AddConstructor<PointToPointTrainNetDevice>()
+            .AddAttribute("MaxTrain",
+                          "The maximum number of packets sent as one train",
+                          UintegerValue(64),
+                          MakeUintegerAccessor(&PointToPointTrainNetDevice::m_maxTrain),
+                          MakeUintegerChecker<uint32_t>(1))
+            .AddTraceSource("TrainTx",
+                            "A train started",
+                            MakeTraceSourceAccessor(&PointToPointTrainNetDevice::m_trainTrace),
+                            "ns3::PointToPointTrainNetDevice::TrainTracedCallback");
+    return tid;
+}
+
+PointToPointTrainNetDevice::PointToPointTrainNetDevice()
+    : m_maxTrain(64),
+      m_busy(false),
+      m_nTrains(0),
+      m_nPackets(0)
+{
+    NS_LOG_FUNCTION(this);
+}
+
+PointToPointTrainNetDevice::~PointToPointTrainNetDevice()
+{
+    NS_LOG_FUNCTION(this);
+}
+
+void
+PointToPointTrainNetDevice::DoDispose()
+{
+    NS_LOG_FUNCTION(this);
+    m_trainEvent.Cancel();
+    m_arrivalEvent.Cancel();
+    m_wire.clear();
+    m_channel = nullptr;
+    m_peer = nullptr;
+    m_rateAccessor = nullptr;
+    m_gapAccessor = nullptr;
+    m_delayAccessor = nullptr;
+    PointToPointNetDevice::DoDispose();
+}
+
+bool
+PointToPointTrainNetDevice::Send(Ptr<Packet> packet, const Address& dest, uint16_t protocolNumber)
+{
+    NS_LOG_FUNCTION(this << packet << dest << protocolNumber);
+    if (!IsLinkUp())
+    {
+        return false;
+    }
+
+    PppHeader ppp;
+    switch (protocolNumber)
+    {
+    case 0x0800: // IPv4
+        ppp.SetProtocol(0x0021);
+        break;
+    case 0x86DD: // IPv6
+        ppp.SetProtocol(0x0057);
+        break;
+    default:
+        NS_FATAL_ERROR("PPP Protocol number not defined!");
+    }
+    packet->AddHeader(ppp);
+
+    // A full queue drops the packet and fires its Drop trace; MacTxDrop is
+    // private to the plain device and does not fire
+    if (!GetQueue()->Enqueue(packet))
+    {
+        return false;
+    }
+    if (!m_busy)
+    {
+        StartTrain();
+    }
+    return true;
+}
+
+void
+PointToPointTrainNetDevice::StartTrain()
+{
+    if (!m_channel)
+    {
+        m_channel = DynamicCast<PointToPointChannel>(GetChannel());
+        NS_ABORT_MSG_UNLESS(m_channel && m_channel->GetNDevices() == 2,
+                            "The device must be attached to a point-to-point link");
+        m_peer = m_channel->GetPointToPointDevice(
+            m_channel->GetPointToPointDevice(0) == this ? 1 : 0);
+        // Look the accessors up once, so that a train does not search the
+        // attribute lists by name
+        m_rateAccessor = LookupAccessor(GetInstanceTypeId(), "DataRate");
+        m_gapAccessor = LookupAccessor(GetInstanceTypeId(), "InterframeGap");
+        m_delayAccessor = LookupAccessor(m_channel->GetInstanceTypeId(), "Delay");
+    }
+    // Read at every train, since they can change while the simulation runs
+    DataRateValue rate;
+    m_rateAccessor->Get(this, rate);
+    TimeValue gap;
+    m_gapAccessor->Get(this, gap);
+    TimeValue delay;
+    m_delayAccessor->Get(PeekPointer(m_channel), delay);
+
+    Ptr<Queue<Packet>> queue = GetQueue();
+    Time now = Simulator::Now();
+    Time offset(0);
+    uint32_t n = 0;
+    bool idleWire = m_wire.empty();
+    while (n < m_maxTrain && !queue->IsEmpty())
+    {
+        Ptr<Packet> packet = queue->Dequeue();
+        Time txTime = rate.Get().CalculateBytesTxTime(packet->GetSize());
+        Time arrival = now + offset + txTime + delay.Get();
+        // The wire keeps the order even if the delay was just reduced
+        if (!m_wire.empty())
+        {
+            arrival = std::max(arrival, m_wire.back().time);
+        }
+        m_wire.push_back({arrival, packet});
+        offset += txTime + gap.Get();
+        n++;
+    }
+    if (n == 0)
+    {
+        return;
+    }
+    NS_LOG_LOGIC("Train of " << n << " packets for " << offset);
+    m_busy = true;
+    m_nTrains++;
+    m_nPackets += n;
+    m_trainTrace(n, offset);
+    m_trainEvent = Simulator::Schedule(offset, &PointToPointTrainNetDevice::TrainComplete, this);
+    if (idleWire)
+    {
+        m_arrivalEvent = Simulator::ScheduleWithContext(m_peer->GetNode()->GetId(),
+                                                        m_wire.front().time - now,
+                                                        &PointToPointTrainNetDevice::Arrive,
+                                                        this);
+    }
+}
+
+void
+PointToPointTrainNetDevice::TrainComplete()
+{
+    m_busy = false;
+    StartTrain();
+}
+
+void
+PointToPointTrainNetDevice::Arrive()
+{
+    Ptr<Packet> packet = m_wire.front().packet;
+    m_wire.pop_front();
+    if (!m_wire.empty())
+    {
+        m_arrivalEvent = Simulator::ScheduleWithContext(m_peer->GetNode()->GetId(),
+                                                        m_wire.front().time - Simulator::Now(),
+                                                        &PointToPointTrainNetDevice::Arrive,
+                                                        this);
+    }
+    m_peer->Receive(packet);
+}
+
+uint64_t
+PointToPointTrainNetDevice::GetNTrains() const
+{
+    return m_nTrains;
+}
+
+uint64_t
+PointToPointTrainNetDevice::GetNPackets() const
+{
+    return m_nPackets;
+}
+
+} // namespace ns3
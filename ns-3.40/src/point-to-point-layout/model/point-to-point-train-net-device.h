@@ -0,0 +1,142 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// Define a point-to-point device transmitting its backlog in trains.
+
+#ifndef POINT_TO_POINT_TRAIN_NET_DEVICE_H
+#define POINT_TO_POINT_TRAIN_NET_DEVICE_H
+
+#include "ns3/attribute.h"
+#include "ns3/event-id.h"
+#include "ns3/nstime.h"
+#include "ns3/point-to-point-channel.h"
+#include "ns3/point-to-point-net-device.h"
+#include "ns3/traced-callback.h"
+
+#include <deque>
+
+namespace ns3
+{
+
+/**
+ * \ingroup point-to-point-layout
+ *
+ * \brief A PointToPointNetDevice that sends the packets waiting in its
+ * queue as one train, with one event per train instead of one per packet.
+ *
+ * When the transmitter becomes idle, up to MaxTrain packets are taken
+ * from the queue at once.  Their departure and arrival times are computed
+ * as the plain device would (transmission time at the DataRate, plus the
+ * InterframeGap, plus the channel Delay), and a single event marks the
+ * end of the train.  The arrivals are kept in order in the sending device,
+ * which has a single pending event per link direction: it hands the head
+ * packet to the peer device at its exact arrival time and re-arms itself
+ * for the next one.  A packet thus costs one event instead of two, and the
+ * scheduler holds one event per link instead of one per packet in flight.
+ *
+ * Differences with the plain device, which make it meant for access
+ * links rather than for a bottleneck:
+ *
+ * - the packets of a train leave the device queue when the train starts,
+ *   so a queue disc above the device may release its packets up to a
+ *   train earlier (the departure times are unchanged);
+ * - the MacTx, MacTxDrop, PhyTxBegin, PhyTxEnd and sniffer traces of the
+ *   sending device, and the channel TxRxPointToPoint trace, do not fire;
+ *   the TrainTx trace fires once per train instead.  The plain device
+ *   keeps these trace callbacks private, so a packet refused by a full
+ *   device queue is only seen by the Drop trace of the queue (see
+ *   GetQueue), which the plain device fires too.  The receiving device
+ *   fires its traces as usual.  NetAnim draws packets from the channel
+ *   trace, so it shows none on these links;
+ * - trains only form when the device queue holds several packets: with a
+ *   one-packet DropTail queue the device behaves as the plain one.
+ *
+ * Devices of this type are created by PointToPointTrainHelper.
+ */
+class PointToPointTrainNetDevice : public PointToPointNetDevice
+{
+  public:
+    /**
+     * \brief Get the type ID.
+     * \return the object TypeId
+     */
+    static TypeId GetTypeId();
+
+    PointToPointTrainNetDevice();
+    ~PointToPointTrainNetDevice() override;
+
+    /**
+     * TracedCallback signature for trains
+     * \param [in] packets the number of packets of the train
+     * \param [in] duration the time the train occupies the transmitter
+     */
+    typedef void (*TrainTracedCallback)(uint32_t packets, Time duration);
+
+    bool Send(Ptr<Packet> packet, const Address& dest, uint16_t protocolNumber) override;
+
+    /**
+     * \returns the number of trains sent
+     */
+    uint64_t GetNTrains() const;
+
+    /**
+     * \returns the number of packets sent in trains
+     */
+    uint64_t GetNPackets() const;
+
+  protected:
+    void DoDispose() override;
+
+  private:
+    /// A packet on the wire
+    struct Arrival
+    {
+        Time time;          //!< End of the reception at the peer
+        Ptr<Packet> packet; //!< The packet
+    };
+
+    /**
+     * Take a train from the queue and schedule its end
+     */
+    void StartTrain();
+
+    /**
+     * The transmitter is idle again
+     */
+    void TrainComplete();
+
+    /**
+     * Hand the head packet on the wire to the peer device
+     */
+    void Arrive();
+
+    uint32_t m_maxTrain;                          //!< Maximum packets per train
+    bool m_busy;                                  //!< A train is being transmitted
+    Ptr<PointToPointChannel> m_channel;           //!< Channel, once resolved
+    Ptr<const AttributeAccessor> m_rateAccessor;  //!< Device DataRate accessor
+    Ptr<const AttributeAccessor> m_gapAccessor;   //!< Device InterframeGap accessor
+    Ptr<const AttributeAccessor> m_delayAccessor; //!< Channel Delay accessor
+    Ptr<PointToPointNetDevice> m_peer;            //!< Device at the other end
+    std::deque<Arrival> m_wire;                   //!< Packets on the wire, in order
+    EventId m_trainEvent;                         //!< End of the current train
+    EventId m_arrivalEvent;                       //!< Next arrival
+    uint64_t m_nTrains;                           //!< Trains sent
+    uint64_t m_nPackets;                          //!< Packets sent
+    TracedCallback<uint32_t, Time> m_trainTrace;  //!< Fired for every train
+};
+
+} // namespace ns3
+
+#endif /* POINT_TO_POINT_TRAIN_NET_DEVICE_H */
@@ -0,0 +1,344 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// Implement a receive-side coalescer of back-to-back TCP segments.
+
+#include "receive-coalescer.h"
+
+#include "ns3/abort.h"
+#include "ns3/ipv4-l3-protocol.h"
+#include "ns3/log.h"
+#include "ns3/node.h"
+#include "ns3/simulator.h"
+#include "ns3/tcp-l4-protocol.h"
+#include "ns3/tcp-option-ts.h"
+#include "ns3/traffic-control-layer.h"
+#include "ns3/uinteger.h"
+
+namespace ns3
+{
+
+NS_LOG_COMPONENT_DEFINE("ReceiveCoalescer");
+
+NS_OBJECT_ENSURE_REGISTERED(ReceiveCoalescer);
+
+TypeId
+ReceiveCoalescer::GetTypeId()
+{
+    static TypeId tid =
+        TypeId("ns3::ReceiveCoalescer")
+            .SetParent<Object>()
+            .SetGroupName("PointToPointLayout")
+            .AddConstructor<ReceiveCoalescer>()
+            .AddAttribute("Budget",
+                          "How long the first segment of a flow may be held",
+                          TimeValue(MicroSeconds(50)),
+                          MakeTimeAccessor(&ReceiveCoalescer::m_budget),
+                          MakeTimeChecker(Time(0)))
+            .AddAttribute("MaxBytes",
+                          "Maximum IP payload of a merged packet",
+                          UintegerValue(65535 - 20),
+                          MakeUintegerAccessor(&ReceiveCoalescer::m_maxBytes),
+                          MakeUintegerChecker<uint32_t>(1, 65535 - 20));
+    return tid;
+}
+
+ReceiveCoalescer::ReceiveCoalescer()
+    : m_rxPackets(0),
+      m_deliveredPackets(0),
+      m_rxSegments(0),
+      m_deliveredSegments(0),
+      m_flushes{}
+{
+    NS_LOG_FUNCTION(this);
+}
+
+ReceiveCoalescer::~ReceiveCoalescer()
+{
+    NS_LOG_FUNCTION(this);
+}
+
+void
+ReceiveCoalescer::DoDispose()
+{
+    NS_LOG_FUNCTION(this);
+    m_timer.Cancel();
+    m_held.clear();
+    m_expiry.clear();
+    m_devices.clear();
+    Object::DoDispose();
+}
+
+void
+ReceiveCoalescer::Install(Ptr<NetDevice> device)
+{
+    NS_LOG_FUNCTION(this << device);
+    NS_ABORT_MSG_UNLESS(device->GetNode()->GetObject<TrafficControlLayer>(),
+                        "The Internet stack must be installed before receive coalescing");
+    device->SetReceiveCallback(MakeCallback(&ReceiveCoalescer::Receive, this));
+    m_devices[device];
+    if (!device->TraceConnectWithoutContext(
+            "MacRx",
+            MakeCallback(&ReceiveCoalescer::MacRx, this).Bind(device)))
+    {
+        NS_LOG_WARN("No MacRx trace on " << device << ", a replaced callback goes unnoticed");
+    }
+}
+
+void
+ReceiveCoalescer::MacRx(Ptr<NetDevice> device, Ptr<const Packet> packet)
+{
+    m_devices[device].macRx++;
+}
+
+bool
+ReceiveCoalescer::Mergeable(const TcpHeader& tcp, uint32_t payload)
+{
+    if (payload == 0 || tcp.GetFlags() != TcpHeader::ACK)
+    {
+        return false;
+    }
+    // Only the timestamp option, whose value must then match
+    const TcpHeader::TcpOptionList& options = tcp.GetOptionList();
+    return options.empty() || (options.size() == 1 && tcp.HasOption(TcpOption::TS));
+}
+
+bool
+ReceiveCoalescer::Continues(const Held& held, const Ipv4Header& ip, const TcpHeader& tcp)
+{
+    if (tcp.GetSequenceNumber() != held.next || tcp.GetAckNumber() != held.tcp.GetAckNumber() ||
+        tcp.GetWindowSize() != held.tcp.GetWindowSize() || ip.GetTos() != held.ip.GetTos() ||
+        ip.GetTtl() != held.ip.GetTtl() ||
+        tcp.HasOption(TcpOption::TS) != held.tcp.HasOption(TcpOption::TS))
+    {
+        return false;
+    }
+    if (tcp.HasOption(TcpOption::TS))
+    {
+        Ptr<const TcpOptionTS> ts = DynamicCast<const TcpOptionTS>(tcp.GetOption(TcpOption::TS));
+        Ptr<const TcpOptionTS> heldTs =
+            DynamicCast<const TcpOptionTS>(held.tcp.GetOption(TcpOption::TS));
+        return ts->GetTimestamp() == heldTs->GetTimestamp() && ts->GetEcho() == heldTs->GetEcho();
+    }
+    return true;
+}
+
+bool
+ReceiveCoalescer::Receive(Ptr<NetDevice> device,
+                          Ptr<const Packet> packet,
+                          uint16_t protocol,
+                          const Address& from)
+{
+    m_rxPackets++;
+    m_devices[device].received++;
+    if (protocol != Ipv4L3Protocol::PROT_NUMBER)
+    {
+        Deliver(device, packet, protocol, from);
+        return true;
+    }
+
+    Ptr<Packet> payload = packet->Copy();
+    Ipv4Header ip;
+    payload->RemoveHeader(ip);
+    if (ip.GetProtocol() != TcpL4Protocol::PROT_NUMBER || !ip.IsLastFragment() ||
+        ip.GetFragmentOffset() != 0)
+    {
+        Deliver(device, packet, protocol, from);
+        return true;
+    }
+    TcpHeader tcp;
+    payload->RemoveHeader(tcp);
+    uint32_t size = payload->GetSize();
+    if (size > 0)
+    {
+        m_rxSegments++;
+    }
+
+    FlowKey key(device, ip.GetSource(), ip.GetDestination(), tcp.GetSourcePort(),
+                tcp.GetDestinationPort());
+    auto it = m_held.find(key);
+    if (!Mergeable(tcp, size))
+    {
+        if (it != m_held.end())
+        {
+            FlushFlow(it, MISMATCH);
+        }
+        if (size > 0)
+        {
+            m_deliveredSegments++;
+        }
+        Deliver(device, packet, protocol, from);
+        return true;
+    }
+
+    if (it != m_held.end())
+    {
+        Held& held = it->second;
+        if (!Continues(held, ip, tcp))
+        {
+            FlushFlow(it, MISMATCH);
+        }
+        else if (held.ip.GetPayloadSize() + size > m_maxBytes)
+        {
+            FlushFlow(it, FULL);
+        }
+        else
+        {
+            held.payload->AddAtEnd(payload);
+            held.ip.SetPayloadSize(held.ip.GetPayloadSize() + size);
+            held.next += size;
+            held.segments++;
+            return true;
+        }
+    }
+
+    Time deadline = Simulator::Now() + m_budget;
+    m_held.emplace(key, Held{ip, tcp, payload, from, tcp.GetSequenceNumber() + size, deadline, 1});
+    m_expiry.emplace_back(deadline, key);
+    if (!m_timer.IsRunning())
+    {
+        m_timer = Simulator::Schedule(m_budget, &ReceiveCoalescer::Expire, this);
+    }
+    return true;
+}
+
+void
+ReceiveCoalescer::Deliver(Ptr<NetDevice> device,
+                          Ptr<const Packet> packet,
+                          uint16_t protocol,
+                          const Address& from)
+{
+    m_deliveredPackets++;
+    device->GetNode()->GetObject<TrafficControlLayer>()->Receive(device,
+                                                                 packet,
+                                                                 protocol,
+                                                                 from,
+                                                                 device->GetAddress(),
+                                                                 NetDevice::PACKET_HOST);
+}
+
+void
+ReceiveCoalescer::FlushFlow(HeldMap::iterator it, FlushReason reason)
+{
+    Held& held = it->second;
+    NS_LOG_LOGIC("Flush " << held.segments << " segments, reason " << reason);
+    Ptr<Packet> packet = held.payload;
+    if (Node::ChecksumEnabled())
+    {
+        held.tcp.InitializeChecksum(held.ip.GetSource(),
+                                    held.ip.GetDestination(),
+                                    TcpL4Protocol::PROT_NUMBER);
+        held.tcp.EnableChecksums();
+        held.ip.EnableChecksum();
+    }
+    packet->AddHeader(held.tcp);
+    packet->AddHeader(held.ip);
+    Ptr<NetDevice> device = std::get<0>(it->first);
+    Address from = held.from;
+    m_held.erase(it);
+    m_flushes[reason]++;
+    m_deliveredSegments++;
+    Deliver(device, packet, Ipv4L3Protocol::PROT_NUMBER, from);
+}
+
+void
+ReceiveCoalescer::Expire()
+{
+    Time now = Simulator::Now();
+    while (!m_expiry.empty() && m_expiry.front().first <= now)
+    {
+        auto it = m_held.find(m_expiry.front().second);
+        // The flow may have been flushed, and held again, since
+        if (it != m_held.end() && it->second.deadline == m_expiry.front().first)
+        {
+            FlushFlow(it, TIMEOUT);
+        }
+        m_expiry.pop_front();
+    }
+    if (!m_expiry.empty())
+    {
+        m_timer =
+            Simulator::Schedule(m_expiry.front().first - now, &ReceiveCoalescer::Expire, this);
+    }
+}
+
+void
+ReceiveCoalescer::Flush()
+{
+    NS_LOG_FUNCTION(this);
+    m_timer.Cancel();
+    m_expiry.clear();
+    while (!m_held.empty())
+    {
+        FlushFlow(m_held.begin(), EXPLICIT);
+    }
+}
+
+uint64_t
+ReceiveCoalescer::GetRxPackets() const
+{
+    return m_rxPackets;
+}
+
+uint64_t
+ReceiveCoalescer::GetDeliveredPackets() const
+{
+    return m_deliveredPackets;
+}
+
+uint64_t
+ReceiveCoalescer::GetBypassedPackets() const
+{
+    uint64_t bypassed = 0;
+    for (const auto& [device, counters] : m_devices)
+    {
+        if (counters.macRx > counters.received)
+        {
+            bypassed += counters.macRx - counters.received;
+        }
+    }
+    return bypassed;
+}
+
+double
+ReceiveCoalescer::GetMergeRatio() const
+{
+    return m_deliveredSegments > 0 ? double(m_rxSegments) / m_deliveredSegments : 1;
+}
+
+void
+ReceiveCoalescer::Report(std::ostream& os) const
+{
+    os << "Receive coalescing: " << m_rxPackets << " packets in, " << m_deliveredPackets
+       << " delivered; " << m_rxSegments << " TCP data segments in " << m_deliveredSegments
+       << " packets (merge ratio " << GetMergeRatio() << "); flushes: " << m_flushes[TIMEOUT]
+       << " timeout, " << m_flushes[FULL] << " full, " << m_flushes[MISMATCH] << " mismatch, "
+       << m_flushes[EXPLICIT] << " explicit" << std::endl;
+    for (const auto& [device, counters] : m_devices)
+    {
+        if (counters.macRx > counters.received)
+        {
+            NS_LOG_WARN("Device " << device->GetIfIndex() << " of node "
+                                  << device->GetNode()->GetId() << " bypassed the coalescer");
+            os << "Warning: " << counters.macRx - counters.received << " of the "
+               << counters.macRx << " packets received by device " << device->GetIfIndex()
+               << " of node " << device->GetNode()->GetId()
+               << " bypassed receive coalescing; its receive callback was replaced after Install"
+               << std::endl;
+        }
+    }
+}
+
+} // namespace ns3
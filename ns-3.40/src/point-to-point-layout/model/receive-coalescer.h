@@ -0,0 +1,244 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// Define a receive-side coalescer of back-to-back TCP segments.
+
+#ifndef RECEIVE_COALESCER_H
+#define RECEIVE_COALESCER_H
+
+#include "ns3/address.h"
+#include "ns3/event-id.h"
+#include "ns3/ipv4-address.h"
+#include "ns3/ipv4-header.h"
+#include "ns3/net-device.h"
+#include "ns3/nstime.h"
+#include "ns3/object.h"
+#include "ns3/packet.h"
+#include "ns3/tcp-header.h"
+
+#include <deque>
+#include <map>
+#include <ostream>
+#include <tuple>
+#include <utility>
+
+namespace ns3
+{
+
+/**
+ * \ingroup point-to-point-layout
+ *
+ * \brief Merge back-to-back in-order TCP segments of a flow before they
+ * reach the Internet stack, as GRO/LRO do in a kernel.
+ *
+ * The coalescer replaces the receive callback of the devices it is
+ * installed on and hands packets to the TrafficControlLayer of their
+ * node, which then goes on as usual.  A TCP segment carrying data with
+ * only the ACK flag is held for up to Budget; the following segments of
+ * the same flow are appended to it while they continue its sequence
+ * space with the same IP TOS and TTL and the same TCP ACK number, window
+ * and timestamps, up to MaxBytes of IP payload.  Anything else (other
+ * flags, other options, a gap, other protocols) flushes the held segment
+ * of its flow first and is delivered at once, so the order within a flow
+ * is kept.  Held segments are flushed by a single timer for all flows.
+ *
+ * The receiving TCP then processes, and acknowledges, one larger
+ * segment instead of several: with delayed ACKs a merged packet counts
+ * as one segment, so ACKs, and the events they cause on the reverse
+ * path, drop with the merge ratio.  Whatever sits above the device sees
+ * the merged packets, e.g. FlowMonitor counts fewer, larger packets at
+ * the receiver; the packet tags of the first segment are kept.
+ *
+ * Packets bypass Node::ReceiveFromDevice: only the TrafficControlLayer,
+ * hence IPv4, IPv6 and ARP, receives them.  Other protocol handlers of
+ * the node (e.g. packet sockets, promiscuous node handlers) see nothing
+ * from these devices, and registering a handler on the node after
+ * Install restores the node's receive callback on every device, which
+ * silently removes the coalescer.  Install it last, on devices whose
+ * traffic is for the Internet stack only.  The MacRx trace of every
+ * device is counted against the packets the coalescer got from it, and
+ * Report warns about the devices whose packets went around it.
+ */
+class ReceiveCoalescer : public Object
+{
+  public:
+    /**
+     * \brief Get the type ID.
+     * \return the object TypeId
+     */
+    static TypeId GetTypeId();
+
+    ReceiveCoalescer();
+    ~ReceiveCoalescer() override;
+
+    /**
+     * Intercept the packets received by a device.  The Internet stack must
+     * have been installed on its node, and no protocol handler may be
+     * registered on the node afterwards (see the class description).
+     *
+     * \param device the device
+     */
+    void Install(Ptr<NetDevice> device);
+
+    /**
+     * Deliver every held segment now.
+     */
+    void Flush();
+
+    /**
+     * \returns the packets received from the devices
+     */
+    uint64_t GetRxPackets() const;
+
+    /**
+     * \returns the packets delivered to the stacks
+     */
+    uint64_t GetDeliveredPackets() const;
+
+    /**
+     * \returns the packets that the devices passed up (MacRx) but that
+     * never reached the coalescer, because their receive callback was
+     * replaced after Install
+     */
+    uint64_t GetBypassedPackets() const;
+
+    /**
+     * \returns the number of TCP data segments received per TCP data
+     * packet delivered, 1 if nothing was merged
+     */
+    double GetMergeRatio() const;
+
+    /**
+     * Print the counters, and a warning for every device whose packets
+     * bypassed the coalescer.
+     *
+     * \param os the output stream
+     */
+    void Report(std::ostream& os) const;
+
+  protected:
+    void DoDispose() override;
+
+  private:
+    /// Device, source and destination addresses and ports of a flow
+    typedef std::tuple<Ptr<NetDevice>, Ipv4Address, Ipv4Address, uint16_t, uint16_t> FlowKey;
+
+    /// Segments held for a flow
+    struct Held
+    {
+        Ipv4Header ip;         //!< IP header of the first segment
+        TcpHeader tcp;         //!< TCP header of the first segment
+        Ptr<Packet> payload;   //!< Payload of the merged segments
+        Address from;          //!< Link-layer source
+        SequenceNumber32 next; //!< Sequence number following the payload
+        Time deadline;         //!< Flush time
+        uint32_t segments;     //!< Number of merged segments
+    };
+
+    /// Held segments by flow
+    typedef std::map<FlowKey, Held> HeldMap;
+
+    /// Packet counts of an intercepted device
+    struct DeviceCounters
+    {
+        uint64_t macRx{0};    //!< Packets passed up by the device (MacRx)
+        uint64_t received{0}; //!< Packets received by the coalescer
+    };
+
+    /// Reasons to flush held segments
+    enum FlushReason
+    {
+        TIMEOUT,  //!< The budget expired
+        FULL,     //!< The next segment would exceed MaxBytes
+        MISMATCH, //!< The next packet of the flow cannot be merged
+        EXPLICIT, //!< Flush was called
+        N_REASONS //!< Number of reasons
+    };
+
+    /**
+     * Device receive callback
+     * \param device the device
+     * \param packet the packet
+     * \param protocol the protocol number
+     * \param from the link-layer source
+     * \returns true
+     */
+    bool Receive(Ptr<NetDevice> device,
+                 Ptr<const Packet> packet,
+                 uint16_t protocol,
+                 const Address& from);
+
+    /**
+     * MacRx trace sink
+     * \param device the device
+     * \param packet the packet
+     */
+    void MacRx(Ptr<NetDevice> device, Ptr<const Packet> packet);
+
+    /**
+     * Hand a packet to the stack of the device node
+     * \param device the device
+     * \param packet the packet
+     * \param protocol the protocol number
+     * \param from the link-layer source
+     */
+    void Deliver(Ptr<NetDevice> device,
+                 Ptr<const Packet> packet,
+                 uint16_t protocol,
+                 const Address& from);
+
+    /**
+     * Deliver the segments held for a flow and forget them
+     * \param it the held segments
+     * \param reason the flush reason
+     */
+    void FlushFlow(HeldMap::iterator it, FlushReason reason);
+
+    /**
+     * Flush the flows whose budget expired and re-arm the timer
+     */
+    void Expire();
+
+    /**
+     * \returns true if a segment may be appended to the held ones
+     * \param held the held segments
+     * \param ip the IP header of the segment
+     * \param tcp the TCP header of the segment
+     */
+    static bool Continues(const Held& held, const Ipv4Header& ip, const TcpHeader& tcp);
+
+    /**
+     * \returns true if a segment may be held at all
+     * \param tcp the TCP header of the segment
+     * \param payload the payload size
+     */
+    static bool Mergeable(const TcpHeader& tcp, uint32_t payload);
+
+    Time m_budget;                                      //!< Maximum holding time
+    uint32_t m_maxBytes;                                //!< Maximum merged IP payload
+    HeldMap m_held;                                     //!< Held segments
+    std::map<Ptr<NetDevice>, DeviceCounters> m_devices; //!< Intercepted devices
+    std::deque<std::pair<Time, FlowKey>> m_expiry;      //!< Flush times, in order
+    EventId m_timer;                                    //!< Next flush
+    uint64_t m_rxPackets;                               //!< Packets received
+    uint64_t m_deliveredPackets;                        //!< Packets delivered
+    uint64_t m_rxSegments;                              //!< TCP data segments received
+    uint64_t m_deliveredSegments;                       //!< TCP data packets delivered
+    uint64_t m_flushes[N_REASONS];                      //!< Flushes by reason
+};
+
+} // namespace ns3
+
+#endif /* RECEIVE_COALESCER_H */
@@ -0,0 +1,200 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// Implement an object that forks a running simulation into branches.
+
+#include "scenario-forker.h"
+
+#include "ns3/abort.h"
+#include "ns3/log.h"
+#include "ns3/rng-seed-manager.h"
+#include "ns3/simulator.h"
+#include "ns3/uinteger.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace ns3
+{
+
+NS_LOG_COMPONENT_DEFINE("ScenarioForker");
+
+NS_OBJECT_ENSURE_REGISTERED(ScenarioForker);
+
+TypeId
+ScenarioForker::GetTypeId()
+{
+    static TypeId tid =
+        TypeId("ns3::ScenarioForker")
+            .SetParent<Object>()
+            .SetGroupName("PointToPointLayout")
+            .AddConstructor<ScenarioForker>()
+            .AddAttribute("MaxParallel",
+                          "Maximum number of children running at once, 0 for all",
+                          UintegerValue(0),
+                          MakeUintegerAccessor(&ScenarioForker::m_maxParallel),
+                          MakeUintegerChecker<uint32_t>());
+    return tid;
+}
+
+ScenarioForker::ScenarioForker()
+    : m_maxParallel(0),
+      m_branch(-1)
+{
+    NS_LOG_FUNCTION(this);
+}
+
+ScenarioForker::~ScenarioForker()
+{
+    NS_LOG_FUNCTION(this);
+}
+
+void
+ScenarioForker::DoDispose()
+{
+    NS_LOG_FUNCTION(this);
+    m_event.Cancel();
+    m_branches.clear();
+    m_flushCallbacks.clear();
+    Object::DoDispose();
+}
+
+uint32_t
+ScenarioForker::AddBranch(std::string name, Callback<void, uint32_t> apply)
+{
+    NS_LOG_FUNCTION(this << name);
+    m_branches.push_back({name, apply});
+    return m_branches.size() - 1;
+}
+
+void
+ScenarioForker::AddFlushCallback(Callback<void> callback)
+{
+    NS_LOG_FUNCTION(this);
+    m_flushCallbacks.push_back(callback);
+}
+
+void
+ScenarioForker::ForkAt(Time at)
+{
+    NS_LOG_FUNCTION(this << at);
+    m_event.Cancel();
+    m_event = Simulator::Schedule(at - Simulator::Now(), &ScenarioForker::Fork, this);
+}
+
+uint32_t
+ScenarioForker::GetNBranches() const
+{
+    return m_branches.size();
+}
+
+bool
+ScenarioForker::IsChild() const
+{
+    return m_branch >= 0;
+}
+
+uint32_t
+ScenarioForker::GetBranch() const
+{
+    NS_ABORT_MSG_UNLESS(IsChild(), "Not in a branch");
+    return m_branch;
+}
+
+std::string
+ScenarioForker::GetBranchName() const
+{
+    return m_branches.at(GetBranch()).name;
+}
+
+void
+ScenarioForker::Fork()
+{
+    NS_LOG_FUNCTION(this);
+    NS_ABORT_MSG_IF(m_branches.empty(), "No branch to fork");
+
+    // Anything still buffered would be written once by every process
+    for (auto& callback : m_flushCallbacks)
+    {
+        callback();
+    }
+    std::cout.flush();
+    std::cerr.flush();
+    std::clog.flush();
+    std::fflush(nullptr);
+
+    uint64_t run = RngSeedManager::GetRun();
+    std::map<pid_t, uint32_t> running;
+    uint32_t failures = 0;
+
+    // Reap one child, blocking
+    auto reap = [&running, &failures, this]() {
+        int status = 0;
+        pid_t pid = waitpid(-1, &status, 0);
+        NS_ABORT_MSG_IF(pid < 0, "waitpid failed: " << std::strerror(errno));
+        auto it = running.find(pid);
+        if (it == running.end())
+        {
+            return;
+        }
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+        {
+            std::cerr << "Branch " << m_branches[it->second].name << " (pid " << pid
+                      << ") failed with status " << status << std::endl;
+            failures++;
+        }
+        running.erase(it);
+    };
+
+    for (uint32_t i = 0; i < m_branches.size(); ++i)
+    {
+        while (m_maxParallel > 0 && running.size() >= m_maxParallel)
+        {
+            reap();
+        }
+        pid_t pid = fork();
+        NS_ABORT_MSG_IF(pid < 0, "fork failed: " << std::strerror(errno));
+        if (pid == 0)
+        {
+            // Streams created from now on differ between branches
+            m_branch = i;
+            RngSeedManager::SetRun(run + 1 + i);
+            NS_LOG_INFO("Branch " << m_branches[i].name << " at " << Simulator::Now().As(Time::S)
+                                  << ", run " << run + 1 + i);
+            m_branches[i].apply(i);
+            return;
+        }
+        NS_LOG_INFO("Forked branch " << m_branches[i].name << " as pid " << pid);
+        running[pid] = i;
+    }
+    while (!running.empty())
+    {
+        reap();
+    }
+
+    // The children did the teardown work, including the flush callbacks of
+    // SimulationTeardown: running them here as well would write twice
+    std::cout << m_branches.size() << " branches forked at " << Simulator::Now().As(Time::S)
+              << ", " << failures << " failed" << std::endl;
+    std::_Exit(failures > 0 ? 1 : 0);
+}
+
+} // namespace ns3
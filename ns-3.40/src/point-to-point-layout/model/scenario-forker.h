@@ -0,0 +1,138 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// Define an object that forks a running simulation into branches.
+
+#ifndef SCENARIO_FORKER_H
+#define SCENARIO_FORKER_H
+
+#include "ns3/callback.h"
+#include "ns3/event-id.h"
+#include "ns3/nstime.h"
+#include "ns3/object.h"
+
+#include <string>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * \ingroup point-to-point-layout
+ *
+ * \brief Simulate a shared warm-up once, then fork the process into one
+ * child per branch, each continuing with its own change.
+ *
+ * At the fork time the process runs the flush callbacks, flushes the
+ * standard streams and calls fork() once per branch.  In each child the
+ * RngSeedManager run number becomes the original run plus one plus the
+ * branch index, then the branch callback applies the change (a new flow,
+ * a rate step...), redirects the outputs of the child and, if the
+ * existing random variables must diverge too, re-assigns their streams
+ * (e.g. InternetStackHelper::AssignStreams), which re-seeds them with the
+ * new run number.  The child then carries on the simulation and exits as
+ * the program would.
+ *
+ * The parent only coordinates: it runs at most MaxParallel children at a
+ * time, waits for all of them and exits with status 1 if any failed, 0
+ * otherwise, without simulating past the fork time nor running any
+ * teardown work (see SimulationTeardown): that is left to the children.
+ *
+ * Files left open by the warm-up are shared by all the children; flush
+ * them with AddFlushCallback and reopen them per branch in the branch
+ * callback.
+ */
+class ScenarioForker : public Object
+{
+  public:
+    /**
+     * \brief Get the type ID.
+     * \return the object TypeId
+     */
+    static TypeId GetTypeId();
+
+    ScenarioForker();
+    ~ScenarioForker() override;
+
+    /**
+     * Add a branch.
+     *
+     * \param name the branch name, e.g. for its output directory
+     * \param apply called in the child right after the fork, with the
+     *              branch index
+     * \returns the branch index
+     */
+    uint32_t AddBranch(std::string name, Callback<void, uint32_t> apply);
+
+    /**
+     * Register work to run just before forking, e.g. flushing a file.
+     *
+     * \param callback the callback
+     */
+    void AddFlushCallback(Callback<void> callback);
+
+    /**
+     * Fork at a simulation time.
+     *
+     * \param at the fork time
+     */
+    void ForkAt(Time at);
+
+    /**
+     * \returns the number of branches
+     */
+    uint32_t GetNBranches() const;
+
+    /**
+     * \returns true in a child, after the fork
+     */
+    bool IsChild() const;
+
+    /**
+     * \returns the branch index of a child
+     */
+    uint32_t GetBranch() const;
+
+    /**
+     * \returns the branch name of a child
+     */
+    std::string GetBranchName() const;
+
+  protected:
+    void DoDispose() override;
+
+  private:
+    /// A branch
+    struct Branch
+    {
+        std::string name;               //!< Name
+        Callback<void, uint32_t> apply; //!< Change applied by the child
+    };
+
+    /**
+     * Fork the children; returns only in a child
+     */
+    void Fork();
+
+    uint32_t m_maxParallel;                       //!< Children running at once, 0 for all
+    std::vector<Branch> m_branches;               //!< Branches
+    std::vector<Callback<void>> m_flushCallbacks; //!< Run before forking
+    EventId m_event;                              //!< Fork event
+    int32_t m_branch;                             //!< Branch of a child, -1 in the parent
+};
+
+} // namespace ns3
+
+#endif /* SCENARIO_FORKER_H */
@@ -0,0 +1,430 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// Implement an on-disk cache of simulation results keyed by scenario.
+
+#include "scenario-result-cache.h"
+
+#include "ns3/abort.h"
+#include "ns3/boolean.h"
+#include "ns3/global-value.h"
+#include "ns3/hash.h"
+#include "ns3/log.h"
+#include "ns3/string.h"
+#include "ns3/uinteger.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <set>
+#include <sstream>
+#include <unistd.h>
+
+namespace ns3
+{
+
+NS_LOG_COMPONENT_DEFINE("ScenarioResultCache");
+
+NS_OBJECT_ENSURE_REGISTERED(ScenarioResultCache);
+
+namespace fs = std::filesystem;
+
+namespace
+{
+
+/**
+ * \param filename a file
+ * \returns its contents, empty if it cannot be read
+ */
+std::string
+ReadFile(const fs::path& filename)
+{
+    std::ifstream is(filename, std::ios::binary);
+    std::ostringstream os;
+    os << is.rdbuf();
+    return os.str();
+}
+
+/**
+ * \param filename a file
+ * \param contents its new contents
+ */
+void
+WriteFile(const fs::path& filename, const std::string& contents)
+{
+    std::ofstream os(filename, std::ios::binary);
+    NS_ABORT_MSG_UNLESS(os.is_open(), "Cannot write " << filename);
+    os << contents;
+}
+
+} // namespace
+
+TypeId
+ScenarioResultCache::GetTypeId()
+{
+    static TypeId tid =
+        TypeId("ns3::ScenarioResultCache")
+            .SetParent<Object>()
+            .SetGroupName("PointToPointLayout")
+            .AddConstructor<ScenarioResultCache>()
+            .AddAttribute("Directory",
+                          "Cache directory",
+                          StringValue("bbr-results/cache"),
+                          MakeStringAccessor(&ScenarioResultCache::m_directory),
+                          MakeStringChecker())
+            .AddAttribute("MaxSize",
+                          "Maximum total size of the entries in bytes, 0 for no limit",
+                          UintegerValue(1 << 30),
+                          MakeUintegerAccessor(&ScenarioResultCache::m_maxSize),
+                          MakeUintegerChecker<uint64_t>())
+            .AddAttribute("Verify",
+                          "Run the simulation even on a hit and compare its output "
+                          "with the cached one",
+                          BooleanValue(false),
+                          MakeBooleanAccessor(&ScenarioResultCache::m_verify),
+                          MakeBooleanChecker());
+    return tid;
+}
+
+ScenarioResultCache::ScenarioResultCache()
+    : m_maxSize(0),
+      m_verify(false),
+      m_verifyHit(false)
+{
+    NS_LOG_FUNCTION(this);
+}
+
+ScenarioResultCache::~ScenarioResultCache()
+{
+    NS_LOG_FUNCTION(this);
+}
+
+std::string
+ScenarioResultCache::ComputeKey(int argc, char* argv[])
+{
+    // argv[0] is covered by the build description
+    std::vector<std::string> args;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg(argv[i]);
+        if (arg.rfind("--cache", 0) != 0)
+        {
+            args.push_back(arg);
+        }
+    }
+    std::sort(args.begin(), args.end());
+    std::ostringstream description;
+    for (const auto& arg : args)
+    {
+        description << "arg " << arg << "\n";
+    }
+    return ComputeKey(description.str());
+}
+
+std::string
+ScenarioResultCache::ComputeKey(std::string description)
+{
+    NS_LOG_FUNCTION(this);
+    std::ostringstream os;
+    os << description;
+
+    // Attributes whose default was changed; the compiled-in defaults are
+    // part of the build.  Skipping unchanged values also keeps pointer
+    // values, which print as addresses, out of the key.
+    TypeId self = GetTypeId();
+    for (uint16_t i = 0; i < TypeId::GetRegisteredN(); ++i)
+    {
+        TypeId tid = TypeId::GetRegistered(i);
+        if (tid == self)
+        {
+            continue;
+        }
+        for (std::size_t j = 0; j < tid.GetAttributeN(); ++j)
+        {
+            TypeId::AttributeInformation info = tid.GetAttribute(j);
+            std::string value = info.initialValue->SerializeToString(info.checker);
+            if (value != info.originalInitialValue->SerializeToString(info.checker))
+            {
+                os << "default " << tid.GetName() << "::" << info.name << " " << value << "\n";
+            }
+        }
+    }
+    for (auto it = GlobalValue::Begin(); it != GlobalValue::End(); ++it)
+    {
+        StringValue value;
+        (*it)->GetValue(value);
+        os << "global " << (*it)->GetName() << " " << value.Get() << "\n";
+    }
+    os << DescribeBuild();
+
+    m_description = os.str();
+    std::ostringstream key;
+    key << std::hex << std::setw(16) << std::setfill('0') << Hash64(m_description);
+    m_key = key.str();
+    m_verifyHit = false;
+    NS_LOG_INFO("Key " << m_key);
+    return m_key;
+}
+
+std::string
+ScenarioResultCache::GetKey() const
+{
+    return m_key;
+}
+
+std::string
+ScenarioResultCache::GetEntryDirectory() const
+{
+    return m_directory + "/" + m_key;
+}
+
+std::string
+ScenarioResultCache::DescribeBuild()
+{
+    std::set<std::string> files;
+    std::error_code ec;
+    fs::path exe = fs::read_symlink("/proc/self/exe", ec);
+    if (!ec)
+    {
+        files.insert(exe.string());
+    }
+    std::ifstream maps("/proc/self/maps");
+    std::string line;
+    while (std::getline(maps, line))
+    {
+        std::size_t slash = line.find('/');
+        if (slash != std::string::npos && line.find("ns3", slash) != std::string::npos)
+        {
+            files.insert(line.substr(slash));
+        }
+    }
+
+    // Size and modification time stand for the contents, which would be
+    // too slow to hash on every run
+    std::ostringstream os;
+    for (const auto& file : files)
+    {
+        uintmax_t size = fs::file_size(file, ec);
+        auto mtime = fs::last_write_time(file, ec);
+        os << "build " << file << " " << size << " " << mtime.time_since_epoch().count() << "\n";
+    }
+    return os.str();
+}
+
+bool
+ScenarioResultCache::Lookup(std::string outputDir)
+{
+    NS_LOG_FUNCTION(this << outputDir);
+    NS_ABORT_MSG_IF(m_key.empty(), "ComputeKey must be called first");
+    fs::path entry = GetEntryDirectory();
+    fs::path description = entry / "description.txt";
+    m_summary.clear();
+    if (!fs::exists(description))
+    {
+        NS_LOG_INFO("Miss " << m_key);
+        return false;
+    }
+    if (ReadFile(description) != m_description)
+    {
+        NS_LOG_WARN("Key collision on " << m_key << ", treated as a miss");
+        return false;
+    }
+    if (m_verify)
+    {
+        NS_LOG_INFO("Hit " << m_key << ", running again to verify it");
+        m_verifyHit = true;
+        return false;
+    }
+
+    std::error_code ec;
+    fs::create_directories(outputDir, ec);
+    fs::copy(entry / "files",
+             outputDir,
+             fs::copy_options::recursive | fs::copy_options::overwrite_existing,
+             ec);
+    NS_ABORT_MSG_IF(ec, "Cannot copy cache entry " << entry << ": " << ec.message());
+    m_summary = ReadFile(entry / "summary.txt");
+    // The description time stamp orders the entries for eviction
+    fs::last_write_time(description, fs::file_time_type::clock::now(), ec);
+    NS_LOG_INFO("Hit " << m_key);
+    return true;
+}
+
+std::string
+ScenarioResultCache::GetSummary() const
+{
+    return m_summary;
+}
+
+bool
+ScenarioResultCache::Store(std::string outputDir, std::string summary)
+{
+    NS_LOG_FUNCTION(this << outputDir);
+    NS_ABORT_MSG_IF(m_key.empty(), "ComputeKey must be called first");
+    fs::path entry = GetEntryDirectory();
+
+    bool verified = true;
+    if (m_verifyHit)
+    {
+        std::vector<std::string> differences = Compare(outputDir, (entry / "files").string());
+        verified = differences.empty();
+        if (!verified)
+        {
+            std::cerr << "Cache verification failed for " << m_key << ":";
+            for (const auto& file : differences)
+            {
+                std::cerr << " " << file;
+            }
+            std::cerr << std::endl;
+        }
+        else
+        {
+            NS_LOG_INFO("Verified " << m_key);
+        }
+    }
+
+    // Build the entry aside, then rename it into place: readers see the
+    // old entry, no entry or the new one, never a partial one
+    std::error_code ec;
+    fs::path staging = m_directory + "/.staging-" + m_key + "-" + std::to_string(getpid());
+    fs::remove_all(staging, ec);
+    fs::create_directories(staging / "files", ec);
+    fs::copy(outputDir, staging / "files", fs::copy_options::recursive, ec);
+    NS_ABORT_MSG_IF(ec, "Cannot stage cache entry " << staging << ": " << ec.message());
+    WriteFile(staging / "summary.txt", summary);
+    WriteFile(staging / "description.txt", m_description);
+
+    // A failed verification keeps the cached entry
+    fs::path target = verified ? entry : fs::path(entry.string() + ".rejected");
+    if (!verified)
+    {
+        std::cerr << "New results kept in " << target.string() << std::endl;
+    }
+
+    // rename cannot replace a non-empty directory, so the old one is
+    // moved out of the way first
+    fs::path old = staging.string() + ".old";
+    fs::remove_all(old, ec);
+    fs::rename(target, old, ec);
+    fs::rename(staging, target, ec);
+    NS_ABORT_MSG_IF(ec, "Cannot store cache entry " << target << ": " << ec.message());
+    fs::remove_all(old, ec);
+
+    Evict();
+    return verified;
+}
+
+std::vector<std::string>
+ScenarioResultCache::Compare(std::string a, std::string b)
+{
+    std::map<std::string, std::pair<fs::path, fs::path>> files;
+    std::error_code ec;
+    for (const auto& f : fs::recursive_directory_iterator(a, ec))
+    {
+        if (f.is_regular_file())
+        {
+            files[fs::relative(f.path(), a).string()].first = f.path();
+        }
+    }
+    for (const auto& f : fs::recursive_directory_iterator(b, ec))
+    {
+        if (f.is_regular_file())
+        {
+            files[fs::relative(f.path(), b).string()].second = f.path();
+        }
+    }
+
+    std::vector<std::string> differences;
+    for (const auto& file : files)
+    {
+        const auto& paths = file.second;
+        if (paths.first.empty() || paths.second.empty() ||
+            fs::file_size(paths.first) != fs::file_size(paths.second) ||
+            ReadFile(paths.first) != ReadFile(paths.second))
+        {
+            differences.push_back(file.first);
+        }
+    }
+    return differences;
+}
+
+void
+ScenarioResultCache::Evict()
+{
+    if (m_maxSize == 0)
+    {
+        return;
+    }
+
+    /// A cache entry
+    struct Entry
+    {
+        fs::path path;           //!< Entry directory
+        uint64_t size;           //!< Total size of its files
+        fs::file_time_type used; //!< Last use
+    };
+
+    std::vector<Entry> entries;
+    uint64_t total = 0;
+    std::error_code ec;
+    for (const auto& dir : fs::directory_iterator(m_directory, ec))
+    {
+        // Staging directories belong to Store calls in progress
+        if (!dir.is_directory() || dir.path().filename().string().rfind(".staging-", 0) == 0)
+        {
+            continue;
+        }
+        Entry entry{dir.path(), 0, fs::file_time_type::min()};
+        for (const auto& f : fs::recursive_directory_iterator(dir.path(), ec))
+        {
+            if (f.is_regular_file())
+            {
+                entry.size += f.file_size();
+            }
+        }
+        // Entries without a description are incomplete and go first
+        fs::path description = dir.path() / "description.txt";
+        if (fs::exists(description))
+        {
+            entry.used = fs::last_write_time(description, ec);
+        }
+        total += entry.size;
+        entries.push_back(entry);
+    }
+
+    std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) {
+        return a.used < b.used;
+    });
+    fs::path current = GetEntryDirectory();
+    for (const auto& entry : entries)
+    {
+        if (total <= m_maxSize)
+        {
+            break;
+        }
+        if (fs::equivalent(entry.path, current, ec))
+        {
+            continue;
+        }
+        NS_LOG_INFO("Evicting " << entry.path);
+        fs::remove_all(entry.path, ec);
+        total -= entry.size;
+    }
+}
+
+} // namespace ns3
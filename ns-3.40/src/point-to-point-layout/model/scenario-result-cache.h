@@ -0,0 +1,172 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// Define an on-disk cache of simulation results keyed by scenario.
+
+#ifndef SCENARIO_RESULT_CACHE_H
+#define SCENARIO_RESULT_CACHE_H
+
+#include "ns3/object.h"
+
+#include <string>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * \ingroup point-to-point-layout
+ *
+ * \brief Skip simulations whose results are already known.
+ *
+ * The key of a run is a hash of a canonical description made of:
+ *
+ * - a caller-supplied description, typically the command line (see
+ *   ComputeKey(int, char**)) or a scenario file;
+ * - the initial value of every attribute of every registered TypeId,
+ *   which covers all Config::SetDefault calls;
+ * - every GlobalValue, which covers the RNG seed and run number;
+ * - the path, size and modification time of the executable and of the
+ *   ns-3 libraries it has loaded, which stand for the build.
+ *
+ * It must therefore be computed after the defaults are set and before
+ * the simulation is built.  An entry is a directory under the Directory
+ * attribute holding a copy of the output directory of the run, the
+ * summary the run printed and the canonical description, which is
+ * compared on every hit so that a hash collision is a miss.  Store builds
+ * an entry in a staging directory and renames it into place, so Lookup
+ * never sees a partial entry, even from a concurrent or interrupted
+ * Store.  When the entries exceed MaxSize bytes, the least recently used
+ * ones are removed.
+ *
+ * In Verify mode a hit is reported as a miss: the simulation runs again
+ * and Store compares its output files with the cached ones.  On a
+ * difference the cached entry is kept and the new results are stored
+ * next to it, in "<key>.rejected", for inspection.
+ *
+ * Usage:
+ * \code
+   Ptr<ScenarioResultCache> cache = CreateObject<ScenarioResultCache>();
+   cache->ComputeKey(argc, argv);
+   if (cache->Lookup(dir))
+     {
+       std::cout << cache->GetSummary();
+       return 0;   // dir now holds the cached results
+     }
+   ... run the simulation, writing to dir and its summary to summary ...
+   Simulator::Destroy();
+   std::cout << summary.str();
+   cache->Store(dir, summary.str());
+   \endcode
+ */
+class ScenarioResultCache : public Object
+{
+  public:
+    /**
+     * \brief Get the type ID.
+     * \return the object TypeId
+     */
+    static TypeId GetTypeId();
+
+    ScenarioResultCache();
+    ~ScenarioResultCache() override;
+
+    /**
+     * Compute the key of a run from its command line.  Arguments starting
+     * with "--cache" are ignored, so that the cache options themselves do
+     * not change the key; the order of the options does not matter.
+     *
+     * \param argc the argument count
+     * \param argv the arguments
+     * \returns the key
+     */
+    std::string ComputeKey(int argc, char* argv[]);
+
+    /**
+     * Compute the key of a run.
+     *
+     * \param description everything that identifies the run besides the
+     *                    attribute defaults, global values and build
+     * \returns the key
+     */
+    std::string ComputeKey(std::string description);
+
+    /**
+     * \returns the key computed last
+     */
+    std::string GetKey() const;
+
+    /**
+     * Look the key up and, on a hit, copy the cached files into the
+     * output directory.
+     *
+     * \param outputDir the output directory of the run
+     * \returns true on a hit; always false in Verify mode
+     */
+    bool Lookup(std::string outputDir);
+
+    /**
+     * \returns the summary stored with the entry of the last hit
+     */
+    std::string GetSummary() const;
+
+    /**
+     * Store the output directory of a run under the key, then evict the
+     * least recently used entries beyond MaxSize.  In Verify mode, first
+     * compare the output with the cached entry, if any, and keep that
+     * entry if they differ.
+     *
+     * \param outputDir the output directory of the run
+     * \param summary what the run printed, for GetSummary on later hits
+     * \returns false if Verify found a difference
+     */
+    bool Store(std::string outputDir, std::string summary = "");
+
+  private:
+    /**
+     * \returns the directory of the entry of the current key
+     */
+    std::string GetEntryDirectory() const;
+
+    /**
+     * \returns a description of the executable and ns-3 libraries
+     */
+    static std::string DescribeBuild();
+
+    /**
+     * \param a a directory
+     * \param b another directory
+     * \returns the relative paths of the files that differ or exist in
+     * only one of the directories
+     */
+    static std::vector<std::string> Compare(std::string a, std::string b);
+
+    /**
+     * Remove the least recently used entries until the cache fits MaxSize
+     */
+    void Evict();
+
+    std::string m_directory;   //!< Cache directory
+    uint64_t m_maxSize;        //!< Maximum total size of the entries, 0 for no limit
+    bool m_verify;             //!< Re-run hits and compare
+    std::string m_key;         //!< Current key
+    std::string m_description; //!< Canonical description of the current key
+    std::string m_summary;     //!< Summary of the last hit
+    bool m_verifyHit;          //!< Verify mode found an entry for the key
+};
+
+} // namespace ns3
+
+#endif /* SCENARIO_RESULT_CACHE_H */
@@ -0,0 +1,103 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// Implement timed and fast teardown paths for simulations about to exit.
+
+#include "simulation-teardown.h"
+
+#include "ns3/log.h"
+#include "ns3/simulator.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+namespace ns3
+{
+
+NS_LOG_COMPONENT_DEFINE("SimulationTeardown");
+
+namespace
+{
+
+/**
+ * \returns the registered flush callbacks
+ */
+std::vector<Callback<void>>&
+FlushCallbacks()
+{
+    static std::vector<Callback<void>> callbacks;
+    return callbacks;
+}
+
+} // namespace
+
+void
+SimulationTeardown::AddFlushCallback(Callback<void> callback)
+{
+    FlushCallbacks().push_back(callback);
+}
+
+void
+SimulationTeardown::Flush()
+{
+    // Move the callbacks out first: they may hold the last references to
+    // objects that register further callbacks
+    std::vector<Callback<void>> callbacks;
+    callbacks.swap(FlushCallbacks());
+    for (auto& callback : callbacks)
+    {
+        callback();
+    }
+}
+
+double
+SimulationTeardown::Destroy(std::ostream* report)
+{
+    NS_LOG_FUNCTION_NOARGS();
+    auto start = std::chrono::steady_clock::now();
+    Flush();
+    Simulator::Destroy();
+    double seconds =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (report)
+    {
+        *report << "Teardown: " << seconds << " s (flush callbacks and Simulator::Destroy)" << std::endl;
+    }
+    return seconds;
+}
+
+void
+SimulationTeardown::FastExit(int status, std::ostream* report)
+{
+    NS_LOG_FUNCTION(status);
+    auto start = std::chrono::steady_clock::now();
+    Flush();
+    if (report)
+    {
+        double seconds =
+            std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        *report << "Teardown: " << seconds << " s (fast exit, flush callbacks only)" << std::endl;
+    }
+    std::cout.flush();
+    std::cerr.flush();
+    std::clog.flush();
+    std::fflush(nullptr);
+    std::_Exit(status);
+}
+
+} // namespace ns3
@@ -0,0 +1,93 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// Define timed and fast teardown paths for simulations about to exit.
+
+#ifndef SIMULATION_TEARDOWN_H
+#define SIMULATION_TEARDOWN_H
+
+#include "ns3/callback.h"
+
+#include <ostream>
+
+namespace ns3
+{
+
+/**
+ * \ingroup point-to-point-layout
+ *
+ * \brief Tear down a finished simulation, either the regular way or by
+ * exiting the process at once.
+ *
+ * Simulator::Destroy disposes every node, device, channel, queue and
+ * socket one by one, and the helpers then release their containers; on
+ * topologies with thousands of leaves this takes seconds, none of which
+ * has an observable effect when the process is about to exit.
+ * FastExit skips all of it: it runs the registered flush callbacks (the
+ * only teardown work with an observable effect, e.g. exporters writing
+ * their last records), flushes the C and C++ standard streams and ends
+ * the process with std::_Exit, letting the operating system reclaim the
+ * whole heap in bulk.
+ *
+ * Output written through other streams (std::ofstream objects, ASCII or
+ * pcap traces) is lost by FastExit unless it is flushed by a registered
+ * callback; use Destroy when that cannot be guaranteed.
+ *
+ * Destroy only times what happens inside it.  Objects are freed when their
+ * last reference goes, so helpers and containers still alive at that point
+ * (e.g. a dumbbell helper in main) defer most of the freeing past the
+ * report; release them first, for instance by scoping them, so that the
+ * time of the regular path is comparable with FastExit.
+ */
+class SimulationTeardown
+{
+  public:
+    /**
+     * Register work to run before the teardown, in registration order.
+     *
+     * \param callback the callback
+     */
+    static void AddFlushCallback(Callback<void> callback);
+
+    /**
+     * Run the flush callbacks, then Simulator::Destroy.  The helpers should
+     * have been released before, see the class description.
+     *
+     * \param report stream to print the teardown time to, if any
+     * \returns the wall-clock teardown time, in seconds
+     */
+    static double Destroy(std::ostream* report = nullptr);
+
+    /**
+     * Run the flush callbacks, flush the standard streams and exit the
+     * process without destroying anything.  The reported time covers the
+     * flush callbacks only; what the operating system does after the exit
+     * is not measured.
+     *
+     * \param status the process exit status
+     * \param report stream to print the teardown time to, if any
+     */
+    [[noreturn]] static void FastExit(int status = 0, std::ostream* report = nullptr);
+
+  private:
+    /**
+     * Run and forget the flush callbacks
+     */
+    static void Flush();
+};
+
+} // namespace ns3
+
+#endif /* SIMULATION_TEARDOWN_H */
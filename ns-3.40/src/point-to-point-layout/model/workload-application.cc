@@ -0,0 +1,670 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// Implement a trace-driven workload generator and its sink.
+
+#include "workload-application.h"
+
+#include "ns3/abort.h"
+#include "ns3/boolean.h"
+#include "ns3/double.h"
+#include "ns3/inet-socket-address.h"
+#include "ns3/inet6-socket-address.h"
+#include "ns3/log.h"
+#include "ns3/node.h"
+#include "ns3/packet.h"
+#include "ns3/pointer.h"
+#include "ns3/simulator.h"
+#include "ns3/string.h"
+#include "ns3/tcp-socket-factory.h"
+#include "ns3/uinteger.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace ns3
+{
+
+NS_LOG_COMPONENT_DEFINE("WorkloadApplication");
+
+NS_OBJECT_ENSURE_REGISTERED(WorkloadApplication);
+NS_OBJECT_ENSURE_REGISTERED(WorkloadSink);
+
+TypeId
+WorkloadApplication::GetTypeId()
+{
+    static TypeId tid =
+        TypeId("ns3::WorkloadApplication")
+            .SetParent<Application>()
+            .SetGroupName("PointToPointLayout")
+            .AddConstructor<WorkloadApplication>()
+            .AddAttribute("Remote",
+                          "The address of the destination",
+                          AddressValue(),
+                          MakeAddressAccessor(&WorkloadApplication::m_peer),
+                          MakeAddressChecker())
+            .AddAttribute("Local",
+                          "The address on which to bind the sockets; unset to let "
+                          "the stack choose",
+                          AddressValue(),
+                          MakeAddressAccessor(&WorkloadApplication::m_local),
+                          MakeAddressChecker())
+            .AddAttribute("Protocol",
+                          "The type of protocol to use",
+                          TypeIdValue(TcpSocketFactory::GetTypeId()),
+                          MakeTypeIdAccessor(&WorkloadApplication::m_tid),
+                          MakeTypeIdChecker())
+            .AddAttribute("FlowSize",
+                          "A RandomVariableStream giving the flow sizes, in bytes",
+                          StringValue("ns3::ConstantRandomVariable[Constant=100000]"),
+                          MakePointerAccessor(&WorkloadApplication::m_flowSize),
+                          MakePointerChecker<RandomVariableStream>())
+            .AddAttribute("FlowSizeCdf",
+                          "File holding an empirical flow size CDF (\"size cdf\" per "
+                          "line); overrides FlowSize when set",
+                          StringValue(""),
+                          MakeStringAccessor(&WorkloadApplication::m_sizeCdfFile),
+                          MakeStringChecker())
+            .AddAttribute("InterArrival",
+                          "A RandomVariableStream giving the flow inter-arrival times, "
+                          "in seconds",
+                          StringValue("ns3::ExponentialRandomVariable[Mean=0.01]"),
+                          MakePointerAccessor(&WorkloadApplication::m_interArrival),
+                          MakePointerChecker<RandomVariableStream>())
+            .AddAttribute("TraceFile",
+                          "File of flow arrivals to replay (\"start-seconds size-bytes\" "
+                          "per line); overrides FlowSize and InterArrival when set",
+                          StringValue(""),
+                          MakeStringAccessor(&WorkloadApplication::m_traceFile),
+                          MakeStringChecker())
+            .AddAttribute("MaxFlows",
+                          "The number of flows to generate; zero means no limit",
+                          UintegerValue(0),
+                          MakeUintegerAccessor(&WorkloadApplication::m_maxFlows),
+                          MakeUintegerChecker<uint64_t>())
+            .AddAttribute("SendSize",
+                          "The amount of data to hand to the socket in each Send call",
+                          UintegerValue(65536),
+                          MakeUintegerAccessor(&WorkloadApplication::m_chunkSize),
+                          MakeUintegerChecker<uint32_t>(1))
+            .AddAttribute("ReuseConnections",
+                          "Start new flows on idle connections of completed flows",
+                          BooleanValue(false),
+                          MakeBooleanAccessor(&WorkloadApplication::m_reuseConnections),
+                          MakeBooleanChecker())
+            .AddAttribute("MaxIdleConnections",
+                          "The maximum number of idle connections kept for reuse",
+                          UintegerValue(16),
+                          MakeUintegerAccessor(&WorkloadApplication::m_maxIdleConnections),
+                          MakeUintegerChecker<uint32_t>())
+            .AddAttribute("TimeWaitLifetime",
+                          "MaxSegLifetime (s) set on connections closed by this "
+                          "application, which bounds their TIME_WAIT state",
+                          DoubleValue(0.01),
+                          MakeDoubleAccessor(&WorkloadApplication::m_timeWaitLifetime),
+                          MakeDoubleChecker<double>(0))
+            .AddAttribute("BottleneckRate",
+                          "The bottleneck rate used to compute the ideal FCT",
+                          DataRateValue(DataRate("10Mbps")),
+                          MakeDataRateAccessor(&WorkloadApplication::m_bottleneckRate),
+                          MakeDataRateChecker())
+            .AddAttribute("BaseRtt",
+                          "The round-trip propagation delay used to compute the ideal FCT",
+                          TimeValue(MilliSeconds(40)),
+                          MakeTimeAccessor(&WorkloadApplication::m_baseRtt),
+                          MakeTimeChecker());
+    return tid;
+}
+
+WorkloadApplication::WorkloadApplication()
+    : m_maxFlows(0),
+      m_chunkSize(65536),
+      m_reuseConnections(false),
+      m_maxIdleConnections(16),
+      m_timeWaitLifetime(0.01),
+      m_flowsStarted(0),
+      m_flowsCompleted(0),
+      m_activeFlows(0),
+      m_sndBufSize(0)
+{
+    NS_LOG_FUNCTION(this);
+}
+
+WorkloadApplication::~WorkloadApplication()
+{
+    NS_LOG_FUNCTION(this);
+}
+
+void
+WorkloadApplication::DoDispose()
+{
+    NS_LOG_FUNCTION(this);
+    m_arrivalEvent.Cancel();
+    m_flows.clear();
+    m_freeSlots.clear();
+    m_slotOf.clear();
+    m_idle.clear();
+    m_statistics = nullptr;
+    m_boundDevice = nullptr;
+    m_flowSize = nullptr;
+    m_interArrival = nullptr;
+    Application::DoDispose();
+}
+
+void
+WorkloadApplication::SetStatistics(Ptr<FctStatistics> statistics)
+{
+    m_statistics = statistics;
+}
+
+void
+WorkloadApplication::SetBoundDevice(Ptr<NetDevice> device)
+{
+    NS_LOG_FUNCTION(this << device);
+    m_boundDevice = device;
+}
+
+Ptr<FctStatistics>
+WorkloadApplication::GetStatistics() const
+{
+    return m_statistics;
+}
+
+uint64_t
+WorkloadApplication::GetFlowsStarted() const
+{
+    return m_flowsStarted;
+}
+
+uint64_t
+WorkloadApplication::GetFlowsCompleted() const
+{
+    return m_flowsCompleted;
+}
+
+uint32_t
+WorkloadApplication::GetActiveFlows() const
+{
+    return m_activeFlows;
+}
+
+int64_t
+WorkloadApplication::AssignStreams(int64_t stream)
+{
+    NS_LOG_FUNCTION(this << stream);
+    m_flowSize->SetStream(stream);
+    m_interArrival->SetStream(stream + 1);
+    return 2;
+}
+
+double
+WorkloadApplication::GetMeanFlowSize(std::string filename)
+{
+    NS_LOG_FUNCTION(filename);
+    std::ifstream cdf(filename);
+    NS_ABORT_MSG_UNLESS(cdf.is_open(), "Cannot open flow size CDF " << filename);
+    double mean = 0;
+    double lastSize = 0;
+    double lastProbability = 0;
+    bool first = true;
+    double size;
+    double probability;
+    while (cdf >> size >> probability)
+    {
+        // Each segment is uniform, so it contributes its midpoint
+        mean += (probability - lastProbability) * (first ? size : (size + lastSize) / 2);
+        lastSize = size;
+        lastProbability = probability;
+        first = false;
+    }
+    NS_ABORT_MSG_IF(first, "Empty flow size CDF " << filename);
+    return mean;
+}
+
+void
+WorkloadApplication::LoadSizeCdf()
+{
+    NS_LOG_FUNCTION(this << m_sizeCdfFile);
+    std::ifstream cdf(m_sizeCdfFile);
+    NS_ABORT_MSG_UNLESS(cdf.is_open(), "Cannot open flow size CDF " << m_sizeCdfFile);
+    Ptr<EmpiricalRandomVariable> sizes = CreateObject<EmpiricalRandomVariable>();
+    sizes->SetInterpolate(true);
+    double size;
+    double probability;
+    while (cdf >> size >> probability)
+    {
+        sizes->CDF(size, probability);
+    }
+    sizes->SetStream(m_flowSize->GetStream());
+    m_flowSize = sizes;
+}
+
+void
+WorkloadApplication::StartApplication()
+{
+    NS_LOG_FUNCTION(this);
+    if (!m_statistics)
+    {
+        m_statistics = CreateObject<FctStatistics>();
+    }
+    if (!m_sizeCdfFile.empty())
+    {
+        LoadSizeCdf();
+    }
+    if (!m_traceFile.empty())
+    {
+        m_trace.open(m_traceFile);
+        NS_ABORT_MSG_UNLESS(m_trace.is_open(), "Cannot open flow trace " << m_traceFile);
+    }
+    ScheduleNextArrival();
+}
+
+void
+WorkloadApplication::StopApplication()
+{
+    NS_LOG_FUNCTION(this);
+    m_arrivalEvent.Cancel();
+    if (m_trace.is_open())
+    {
+        m_trace.close();
+    }
+    for (auto& flow : m_flows)
+    {
+        if (flow.active)
+        {
+            flow.socket->Close();
+        }
+    }
+    for (auto& socket : m_idle)
+    {
+        socket->Close();
+    }
+    m_flows.clear();
+    m_freeSlots.clear();
+    m_slotOf.clear();
+    m_idle.clear();
+    m_activeFlows = 0;
+}
+
+void
+WorkloadApplication::ScheduleNextArrival()
+{
+    if (m_maxFlows != 0 && m_flowsStarted >= m_maxFlows)
+    {
+        return;
+    }
+
+    Time delay;
+    uint64_t size;
+    if (m_trace.is_open())
+    {
+        double start;
+        if (!(m_trace >> start >> size))
+        {
+            NS_LOG_INFO("End of flow trace after " << m_flowsStarted << " flows");
+            return;
+        }
+        delay = Max(Seconds(start) - Simulator::Now(), Time(0));
+    }
+    else
+    {
+        delay = Seconds(m_interArrival->GetValue());
+        size = std::max<uint64_t>(std::llround(m_flowSize->GetValue()), 1);
+    }
+    m_arrivalEvent = Simulator::Schedule(delay, &WorkloadApplication::FlowArrival, this, size);
+}
+
+void
+WorkloadApplication::FlowArrival(uint64_t size)
+{
+    StartFlow(size);
+    ScheduleNextArrival();
+}
+
+void
+WorkloadApplication::StartFlow(uint64_t size)
+{
+    NS_LOG_FUNCTION(this << size);
+    uint32_t slot;
+    if (!m_freeSlots.empty())
+    {
+        slot = m_freeSlots.back();
+        m_freeSlots.pop_back();
+    }
+    else
+    {
+        slot = m_flows.size();
+        m_flows.emplace_back();
+    }
+    Flow& flow = m_flows[slot];
+    flow.size = size;
+    flow.remaining = size;
+    flow.start = Simulator::Now();
+    flow.active = true;
+    m_flowsStarted++;
+    m_activeFlows++;
+
+    if (m_reuseConnections && !m_idle.empty())
+    {
+        flow.socket = m_idle.back();
+        m_idle.pop_back();
+        flow.reused = true;
+        flow.connected = true;
+        m_slotOf[PeekPointer(flow.socket)] = slot;
+        SendData(slot);
+        return;
+    }
+
+    flow.socket = Socket::CreateSocket(GetNode(), m_tid);
+    flow.reused = false;
+    flow.connected = false;
+    if (!m_reuseConnections)
+    {
+        // Only TCP sockets have this attribute
+        flow.socket->SetAttributeFailSafe("MaxSegLifetime", DoubleValue(m_timeWaitLifetime));
+    }
+    if (m_sndBufSize == 0)
+    {
+        UintegerValue sndBufSize;
+        if (flow.socket->GetAttributeFailSafe("SndBufSize", sndBufSize))
+        {
+            m_sndBufSize = sndBufSize.Get();
+        }
+    }
+    m_slotOf[PeekPointer(flow.socket)] = slot;
+
+    int ret = -1;
+    if (!m_local.IsInvalid())
+    {
+        ret = flow.socket->Bind(m_local);
+    }
+    else if (Inet6SocketAddress::IsMatchingType(m_peer))
+    {
+        ret = flow.socket->Bind6();
+    }
+    else
+    {
+        ret = flow.socket->Bind();
+    }
+    NS_ABORT_MSG_IF(ret == -1, "Failed to bind socket");
+    if (m_boundDevice)
+    {
+        // TCP looks up its route before it has a source address, so the
+        // bound address alone does not select the device
+        flow.socket->BindToNetDevice(m_boundDevice);
+    }
+
+    flow.socket->SetConnectCallback(
+        MakeCallback(&WorkloadApplication::ConnectionSucceeded, this),
+        MakeCallback(&WorkloadApplication::ConnectionFailed, this));
+    flow.socket->SetSendCallback(MakeCallback(&WorkloadApplication::DataAcked, this));
+    flow.socket->SetCloseCallbacks(MakeCallback(&WorkloadApplication::ConnectionClosed, this),
+                                   MakeCallback(&WorkloadApplication::ConnectionClosed, this));
+    flow.socket->Connect(m_peer);
+}
+
+void
+WorkloadApplication::SendData(uint32_t slot)
+{
+    Flow& flow = m_flows[slot];
+    while (flow.remaining > 0)
+    {
+        uint32_t available = flow.socket->GetTxAvailable();
+        if (available == 0)
+        {
+            break;
+        }
+        uint64_t toSend = std::min<uint64_t>({flow.remaining, available, m_chunkSize});
+        int sent = flow.socket->Send(Create<Packet>(toSend));
+        if (sent <= 0)
+        {
+            break;
+        }
+        flow.remaining -= sent;
+    }
+}
+
+void
+WorkloadApplication::ConnectionSucceeded(Ptr<Socket> socket)
+{
+    NS_LOG_FUNCTION(this << socket);
+    auto it = m_slotOf.find(PeekPointer(socket));
+    if (it == m_slotOf.end())
+    {
+        return;
+    }
+    m_flows[it->second].connected = true;
+    SendData(it->second);
+}
+
+void
+WorkloadApplication::ConnectionFailed(Ptr<Socket> socket)
+{
+    NS_LOG_FUNCTION(this << socket);
+    auto it = m_slotOf.find(PeekPointer(socket));
+    if (it != m_slotOf.end())
+    {
+        AbortFlow(it->second);
+    }
+}
+
+void
+WorkloadApplication::DataAcked(Ptr<Socket> socket, uint32_t available)
+{
+    auto it = m_slotOf.find(PeekPointer(socket));
+    if (it == m_slotOf.end())
+    {
+        return;
+    }
+    uint32_t slot = it->second;
+    Flow& flow = m_flows[slot];
+    if (!flow.connected)
+    {
+        return;
+    }
+    if (flow.remaining > 0)
+    {
+        SendData(slot);
+    }
+    // All bytes handed to the socket and the send buffer drained: every
+    // byte of the flow has been acknowledged
+    if (flow.remaining == 0 && socket->GetTxAvailable() >= m_sndBufSize)
+    {
+        CompleteFlow(slot);
+    }
+}
+
+void
+WorkloadApplication::ConnectionClosed(Ptr<Socket> socket)
+{
+    NS_LOG_FUNCTION(this << socket);
+    auto it = m_slotOf.find(PeekPointer(socket));
+    if (it != m_slotOf.end())
+    {
+        AbortFlow(it->second);
+        return;
+    }
+    // An idle connection closed by the peer
+    m_idle.erase(std::remove(m_idle.begin(), m_idle.end(), socket), m_idle.end());
+}
+
+Time
+WorkloadApplication::IdealFct(const Flow& flow) const
+{
+    Time ideal = m_bottleneckRate.CalculateBytesTxTime(flow.size) + m_baseRtt;
+    if (!flow.reused)
+    {
+        // Three-way handshake
+        ideal += m_baseRtt;
+    }
+    return ideal;
+}
+
+void
+WorkloadApplication::CompleteFlow(uint32_t slot)
+{
+    Flow& flow = m_flows[slot];
+    Time fct = Simulator::Now() - flow.start;
+    NS_LOG_LOGIC("Flow of " << flow.size << " bytes completed in " << fct.As(Time::MS));
+    m_statistics->RecordFlow(flow.size, fct, IdealFct(flow));
+    m_flowsCompleted++;
+    m_activeFlows--;
+
+    Ptr<Socket> socket = flow.socket;
+    m_slotOf.erase(PeekPointer(socket));
+    flow = Flow();
+    m_freeSlots.push_back(slot);
+
+    if (m_reuseConnections && m_idle.size() < m_maxIdleConnections)
+    {
+        m_idle.push_back(socket);
+    }
+    else
+    {
+        socket->SetAttributeFailSafe("MaxSegLifetime", DoubleValue(m_timeWaitLifetime));
+        socket->Close();
+    }
+}
+
+void
+WorkloadApplication::AbortFlow(uint32_t slot)
+{
+    Flow& flow = m_flows[slot];
+    NS_LOG_WARN("Flow of " << flow.size << " bytes aborted after "
+                           << (Simulator::Now() - flow.start).As(Time::MS));
+    m_activeFlows--;
+    m_slotOf.erase(PeekPointer(flow.socket));
+    flow = Flow();
+    m_freeSlots.push_back(slot);
+}
+
+TypeId
+WorkloadSink::GetTypeId()
+{
+    static TypeId tid = TypeId("ns3::WorkloadSink")
+                            .SetParent<Application>()
+                            .SetGroupName("PointToPointLayout")
+                            .AddConstructor<WorkloadSink>()
+                            .AddAttribute("Local",
+                                          "The address on which to listen",
+                                          AddressValue(),
+                                          MakeAddressAccessor(&WorkloadSink::m_local),
+                                          MakeAddressChecker())
+                            .AddAttribute("Protocol",
+                                          "The type of protocol to use",
+                                          TypeIdValue(TcpSocketFactory::GetTypeId()),
+                                          MakeTypeIdAccessor(&WorkloadSink::m_tid),
+                                          MakeTypeIdChecker());
+    return tid;
+}
+
+WorkloadSink::WorkloadSink()
+    : m_totalRx(0)
+{
+    NS_LOG_FUNCTION(this);
+}
+
+WorkloadSink::~WorkloadSink()
+{
+    NS_LOG_FUNCTION(this);
+}
+
+void
+WorkloadSink::DoDispose()
+{
+    NS_LOG_FUNCTION(this);
+    m_listener = nullptr;
+    m_accepted.clear();
+    Application::DoDispose();
+}
+
+uint64_t
+WorkloadSink::GetTotalRx() const
+{
+    return m_totalRx;
+}
+
+uint32_t
+WorkloadSink::GetOpenConnections() const
+{
+    return m_accepted.size();
+}
+
+void
+WorkloadSink::StartApplication()
+{
+    NS_LOG_FUNCTION(this);
+    if (!m_listener)
+    {
+        m_listener = Socket::CreateSocket(GetNode(), m_tid);
+        NS_ABORT_MSG_IF(m_listener->Bind(m_local) == -1, "Failed to bind socket");
+        m_listener->Listen();
+    }
+    m_listener->SetAcceptCallback(MakeNullCallback<bool, Ptr<Socket>, const Address&>(),
+                                  MakeCallback(&WorkloadSink::HandleAccept, this));
+}
+
+void
+WorkloadSink::StopApplication()
+{
+    NS_LOG_FUNCTION(this);
+    for (auto& [key, socket] : m_accepted)
+    {
+        socket->Close();
+    }
+    m_accepted.clear();
+    if (m_listener)
+    {
+        m_listener->Close();
+        m_listener->SetAcceptCallback(MakeNullCallback<bool, Ptr<Socket>, const Address&>(),
+                                      MakeNullCallback<void, Ptr<Socket>, const Address&>());
+    }
+}
+
+void
+WorkloadSink::HandleAccept(Ptr<Socket> socket, const Address& from)
+{
+    NS_LOG_FUNCTION(this << socket << from);
+    socket->SetRecvCallback(MakeCallback(&WorkloadSink::HandleRead, this));
+    socket->SetCloseCallbacks(MakeCallback(&WorkloadSink::HandleClose, this),
+                              MakeCallback(&WorkloadSink::HandleClose, this));
+    m_accepted[PeekPointer(socket)] = socket;
+}
+
+void
+WorkloadSink::HandleRead(Ptr<Socket> socket)
+{
+    Ptr<Packet> packet;
+    while ((packet = socket->Recv()))
+    {
+        if (packet->GetSize() == 0)
+        {
+            break;
+        }
+        m_totalRx += packet->GetSize();
+    }
+}
+
+void
+WorkloadSink::HandleClose(Ptr<Socket> socket)
+{
+    NS_LOG_FUNCTION(this << socket);
+    // Answer the peer's FIN; the stack keeps the socket until LAST_ACK
+    // completes, after which nothing references it any more
+    socket->Close();
+    m_accepted.erase(PeekPointer(socket));
+}
+
+} // namespace ns3
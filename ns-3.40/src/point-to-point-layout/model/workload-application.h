@@ -0,0 +1,311 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// Define a trace-driven workload generator and its sink.
+
+#ifndef WORKLOAD_APPLICATION_H
+#define WORKLOAD_APPLICATION_H
+
+#include "fct-statistics.h"
+
+#include "ns3/address.h"
+#include "ns3/application.h"
+#include "ns3/data-rate.h"
+#include "ns3/event-id.h"
+#include "ns3/net-device.h"
+#include "ns3/random-variable-stream.h"
+#include "ns3/socket.h"
+
+#include <fstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * \ingroup point-to-point-layout
+ *
+ * \brief Generate finite flows towards one remote address and measure
+ * their completion times.
+ *
+ * Flow sizes are drawn from the FlowSize random variable, or from an
+ * empirical CDF loaded from FlowSizeCdf (one "size cdf" pair per line,
+ * sizes in bytes, CDF values increasing up to 1).  Flows arrive
+ * according to the InterArrival random variable (exponential by default,
+ * i.e. Poisson arrivals), or are replayed from TraceFile (one
+ * "start-time-in-seconds size-in-bytes" pair per line, in time order).
+ * The trace is read lazily, one line ahead of the simulation.
+ *
+ * A flow completes when all of its bytes have been acknowledged, which
+ * is detected from the socket send callback without extra events.  Its
+ * completion time and slowdown are folded into an FctStatistics object
+ * and the per-flow state is recycled, so memory does not grow with the
+ * number of completed flows.  With ReuseConnections, a completed flow
+ * hands its connection back to an idle pool and the next flow starts on
+ * it without a handshake; otherwise the connection is closed with a
+ * short TIME_WAIT (TimeWaitLifetime) so closed sockets do not pile up.
+ *
+ * Use WorkloadSink on the remote side: unlike PacketSink it releases the
+ * accepted sockets when their connection closes.
+ */
+class WorkloadApplication : public Application
+{
+  public:
+    /**
+     * \brief Get the type ID.
+     * \return the object TypeId
+     */
+    static TypeId GetTypeId();
+
+    WorkloadApplication();
+    ~WorkloadApplication() override;
+
+    /**
+     * Set the statistics collector; several applications may share one.
+     * \param statistics the statistics collector
+     */
+    void SetStatistics(Ptr<FctStatistics> statistics);
+
+    /**
+     * \returns the statistics collector
+     */
+    Ptr<FctStatistics> GetStatistics() const;
+
+    /**
+     * Bind every socket to a device, e.g. the leaf device of an aggregated
+     * dumbbell leaf, so that its packets leave through that device.
+     * \param device the device, or nullptr to leave the sockets unbound
+     */
+    void SetBoundDevice(Ptr<NetDevice> device);
+
+    /**
+     * \returns the number of flows started so far
+     */
+    uint64_t GetFlowsStarted() const;
+
+    /**
+     * \returns the number of flows completed so far
+     */
+    uint64_t GetFlowsCompleted() const;
+
+    /**
+     * \returns the number of flows in progress
+     */
+    uint32_t GetActiveFlows() const;
+
+    /**
+     * Assign a fixed random variable stream number to the random variables
+     * used by this application.
+     *
+     * \param stream first stream index to use
+     * \return the number of stream indices assigned by this application
+     */
+    int64_t AssignStreams(int64_t stream);
+
+    /**
+     * Compute the mean flow size of a "size cdf" file, as FlowSizeCdf
+     * samples it: the probability of the first point is taken at its
+     * size, and sizes are interpolated linearly between points.
+     *
+     * \param filename the flow size CDF file
+     * \returns the mean flow size, in bytes
+     */
+    static double GetMeanFlowSize(std::string filename);
+
+  protected:
+    void DoDispose() override;
+
+  private:
+    void StartApplication() override;
+    void StopApplication() override;
+
+    /// State of one flow (and its connection)
+    struct Flow
+    {
+        Ptr<Socket> socket;    //!< Connection carrying the flow
+        uint64_t size{0};      //!< Flow size (bytes)
+        uint64_t remaining{0}; //!< Bytes not yet handed to the socket
+        Time start;            //!< Flow arrival time
+        bool reused{false};    //!< Started on a reused connection
+        bool connected{false}; //!< Connection established
+        bool active{false};    //!< Slot in use
+    };
+
+    /**
+     * Schedule the next flow arrival
+     */
+    void ScheduleNextArrival();
+
+    /**
+     * A flow arrives: start it and schedule the next arrival
+     * \param size the flow size, in bytes
+     */
+    void FlowArrival(uint64_t size);
+
+    /**
+     * Start a flow
+     * \param size the flow size, in bytes
+     */
+    void StartFlow(uint64_t size);
+
+    /**
+     * Push as much of a flow as the socket accepts
+     * \param slot the flow slot
+     */
+    void SendData(uint32_t slot);
+
+    /**
+     * Record a completed flow and recycle its slot
+     * \param slot the flow slot
+     */
+    void CompleteFlow(uint32_t slot);
+
+    /**
+     * Drop a flow whose connection failed
+     * \param slot the flow slot
+     */
+    void AbortFlow(uint32_t slot);
+
+    /**
+     * \returns the completion time of a flow in an empty network
+     * \param flow the flow
+     */
+    Time IdealFct(const Flow& flow) const;
+
+    /**
+     * Load FlowSizeCdf into an empirical random variable
+     */
+    void LoadSizeCdf();
+
+    /**
+     * Connection succeeded
+     * \param socket the socket
+     */
+    void ConnectionSucceeded(Ptr<Socket> socket);
+
+    /**
+     * Connection failed
+     * \param socket the socket
+     */
+    void ConnectionFailed(Ptr<Socket> socket);
+
+    /**
+     * Send buffer space became available
+     * \param socket the socket
+     * \param available bytes available in the send buffer
+     */
+    void DataAcked(Ptr<Socket> socket, uint32_t available);
+
+    /**
+     * Connection closed (normally or on error)
+     * \param socket the socket
+     */
+    void ConnectionClosed(Ptr<Socket> socket);
+
+    Address m_peer;                           //!< Remote address
+    Address m_local;                          //!< Local address to bind to
+    Ptr<NetDevice> m_boundDevice;             //!< Device to bind to, if any
+    TypeId m_tid;                             //!< Socket factory type
+    Ptr<RandomVariableStream> m_flowSize;     //!< Flow size (bytes)
+    Ptr<RandomVariableStream> m_interArrival; //!< Inter-arrival time (s)
+    std::string m_sizeCdfFile;                //!< Empirical flow size CDF
+    std::string m_traceFile;                  //!< Arrival trace to replay
+    uint64_t m_maxFlows;                      //!< Flow budget, zero for unlimited
+    uint32_t m_chunkSize;                     //!< Bytes per Send call
+    bool m_reuseConnections;                  //!< Keep connections for later flows
+    uint32_t m_maxIdleConnections;            //!< Size of the idle connection pool
+    double m_timeWaitLifetime;                //!< MaxSegLifetime of closed connections (s)
+    DataRate m_bottleneckRate;                //!< Rate used for the ideal FCT
+    Time m_baseRtt;                           //!< Base RTT used for the ideal FCT
+
+    Ptr<FctStatistics> m_statistics;                //!< FCT statistics
+    std::vector<Flow> m_flows;                      //!< Flow slots
+    std::vector<uint32_t> m_freeSlots;              //!< Unused flow slots
+    std::unordered_map<Socket*, uint32_t> m_slotOf; //!< Socket to flow slot
+    std::vector<Ptr<Socket>> m_idle;                //!< Idle reusable connections
+    std::ifstream m_trace;                          //!< Arrival trace stream
+    EventId m_arrivalEvent;                         //!< Next flow arrival
+    uint64_t m_flowsStarted;                        //!< Flows started
+    uint64_t m_flowsCompleted;                      //!< Flows completed
+    uint32_t m_activeFlows;                         //!< Flows in progress
+    uint32_t m_sndBufSize;                          //!< Send buffer size of the sockets
+};
+
+/**
+ * \ingroup point-to-point-layout
+ *
+ * \brief Accept connections, discard their data and release each socket
+ * once its connection closes.
+ */
+class WorkloadSink : public Application
+{
+  public:
+    /**
+     * \brief Get the type ID.
+     * \return the object TypeId
+     */
+    static TypeId GetTypeId();
+
+    WorkloadSink();
+    ~WorkloadSink() override;
+
+    /**
+     * \returns the total bytes received
+     */
+    uint64_t GetTotalRx() const;
+
+    /**
+     * \returns the number of open connections
+     */
+    uint32_t GetOpenConnections() const;
+
+  protected:
+    void DoDispose() override;
+
+  private:
+    void StartApplication() override;
+    void StopApplication() override;
+
+    /**
+     * Accept a new connection
+     * \param socket the new socket
+     * \param from the peer address
+     */
+    void HandleAccept(Ptr<Socket> socket, const Address& from);
+
+    /**
+     * Read and discard the available data
+     * \param socket the socket
+     */
+    void HandleRead(Ptr<Socket> socket);
+
+    /**
+     * The peer closed the connection
+     * \param socket the socket
+     */
+    void HandleClose(Ptr<Socket> socket);
+
+    Address m_local;                                     //!< Local address to listen on
+    TypeId m_tid;                                        //!< Socket factory type
+    Ptr<Socket> m_listener;                              //!< Listening socket
+    std::unordered_map<Socket*, Ptr<Socket>> m_accepted; //!< Open connections
+    uint64_t m_totalRx;                                  //!< Bytes received
+};
+
+} // namespace ns3
+
+#endif /* WORKLOAD_APPLICATION_H */
@@ -0,0 +1,147 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// Implement a helper to install workload generators on dumbbell leaves.
+
+#include "workload-helper.h"
+
+#include "workload-application.h"
+
+#include "ns3/inet-socket-address.h"
+#include "ns3/ipv4.h"
+#include "ns3/string.h"
+
+#include <set>
+
+namespace ns3
+{
+
+WorkloadHelper::WorkloadHelper(std::string protocol)
+{
+    m_factory.SetTypeId("ns3::WorkloadApplication");
+    m_factory.Set("Protocol", StringValue(protocol));
+    m_sinkFactory.SetTypeId("ns3::WorkloadSink");
+    m_sinkFactory.Set("Protocol", StringValue(protocol));
+    m_statistics = CreateObject<FctStatistics>();
+}
+
+void
+WorkloadHelper::SetAttribute(std::string name, const AttributeValue& value)
+{
+    m_factory.Set(name, value);
+}
+
+void
+WorkloadHelper::SetSinkAttribute(std::string name, const AttributeValue& value)
+{
+    m_sinkFactory.Set(name, value);
+}
+
+double
+WorkloadHelper::SetOfferedLoad(double load,
+                               DataRate rate,
+                               uint32_t nSenders,
+                               double meanSize,
+                               std::string sizeCdf)
+{
+    if (!sizeCdf.empty())
+    {
+        meanSize = WorkloadApplication::GetMeanFlowSize(sizeCdf);
+    }
+    double meanInterArrival = nSenders / (load * rate.GetBitRate() / (8 * meanSize));
+    SetAttribute("FlowSize",
+                 StringValue("ns3::ExponentialRandomVariable[Mean=" + std::to_string(meanSize) +
+                             "]"));
+    SetAttribute("FlowSizeCdf", StringValue(sizeCdf));
+    SetAttribute("InterArrival",
+                 StringValue("ns3::ExponentialRandomVariable[Mean=" +
+                             std::to_string(meanInterArrival) + "]"));
+    return meanSize;
+}
+
+ApplicationContainer
+WorkloadHelper::Install(Ptr<Node> node,
+                        const Address& remote,
+                        const Address& local,
+                        Ptr<NetDevice> device) const
+{
+    Ptr<WorkloadApplication> app = m_factory.Create<WorkloadApplication>();
+    app->SetAttribute("Remote", AddressValue(remote));
+    if (!local.IsInvalid())
+    {
+        app->SetAttribute("Local", AddressValue(local));
+    }
+    app->SetStatistics(m_statistics);
+    app->SetBoundDevice(device);
+    node->AddApplication(app);
+    return ApplicationContainer(app);
+}
+
+ApplicationContainer
+WorkloadHelper::InstallSink(NodeContainer nodes, uint16_t port) const
+{
+    ApplicationContainer apps;
+    std::set<uint32_t> installed;
+    for (auto i = nodes.Begin(); i != nodes.End(); ++i)
+    {
+        if (!installed.insert((*i)->GetId()).second)
+        {
+            continue;
+        }
+        Ptr<WorkloadSink> sink = m_sinkFactory.Create<WorkloadSink>();
+        sink->SetAttribute("Local", AddressValue(InetSocketAddress(Ipv4Address::GetAny(), port)));
+        (*i)->AddApplication(sink);
+        apps.Add(sink);
+    }
+    return apps;
+}
+
+ApplicationContainer
+WorkloadHelper::Install(const PointToPointDumbbellHelper& dumbbell, uint16_t port)
+{
+    NodeContainer right;
+    for (uint32_t i = 0; i < dumbbell.RightCount(); ++i)
+    {
+        right.Add(dumbbell.GetRight(i));
+    }
+    m_sinks = InstallSink(right, port);
+
+    ApplicationContainer apps;
+    for (uint32_t i = 0; i < dumbbell.LeftCount(); ++i)
+    {
+        Ipv4Address remote = dumbbell.GetRightIpv4Address(i % dumbbell.RightCount());
+        Ipv4Address local = dumbbell.GetLeftIpv4Address(i);
+        Ptr<Node> node = dumbbell.GetLeft(i);
+        Ptr<Ipv4> ipv4 = node->GetObject<Ipv4>();
+        Ptr<NetDevice> device = ipv4->GetNetDevice(ipv4->GetInterfaceForAddress(local));
+        apps.Add(
+            Install(node, InetSocketAddress(remote, port), InetSocketAddress(local, 0), device));
+    }
+    return apps;
+}
+
+ApplicationContainer
+WorkloadHelper::GetSinks() const
+{
+    return m_sinks;
+}
+
+Ptr<FctStatistics>
+WorkloadHelper::GetStatistics() const
+{
+    return m_statistics;
+}
+
+} // namespace ns3
@@ -0,0 +1,144 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// Define a helper to install workload generators on dumbbell leaves.
+
+#ifndef WORKLOAD_HELPER_H
+#define WORKLOAD_HELPER_H
+
+#include "fct-statistics.h"
+#include "point-to-point-dumbbell.h"
+
+#include "ns3/application-container.h"
+#include "ns3/data-rate.h"
+#include "ns3/node-container.h"
+#include "ns3/object-factory.h"
+
+#include <string>
+
+namespace ns3
+{
+
+/**
+ * \ingroup point-to-point-layout
+ *
+ * \brief Install WorkloadApplication senders and WorkloadSink receivers.
+ *
+ * All the senders installed by one helper share a single FctStatistics
+ * object, so the report covers the whole workload.
+ */
+class WorkloadHelper
+{
+  public:
+    /**
+     * Create a WorkloadHelper.
+     *
+     * \param protocol the name of the socket factory to use, e.g.
+     *                 "ns3::TcpSocketFactory"
+     */
+    WorkloadHelper(std::string protocol);
+
+    /**
+     * Set an attribute of the WorkloadApplication instances.
+     *
+     * \param name the name of the attribute to set
+     * \param value the value of the attribute to set
+     */
+    void SetAttribute(std::string name, const AttributeValue& value);
+
+    /**
+     * Set an attribute of the WorkloadSink instances.
+     *
+     * \param name the name of the attribute to set
+     * \param value the value of the attribute to set
+     */
+    void SetSinkAttribute(std::string name, const AttributeValue& value);
+
+    /**
+     * Set FlowSize, FlowSizeCdf and InterArrival for Poisson arrivals
+     * with which a number of senders together offer a load on a link.
+     * The arrival rate is computed from the mean of the CDF when one is
+     * given, and from meanSize otherwise.
+     *
+     * \param load the offered load, as a fraction of the link rate
+     * \param rate the link rate
+     * \param nSenders the number of senders sharing the load
+     * \param meanSize the mean of the exponential flow sizes, in bytes
+     * \param sizeCdf the flow size CDF file, or empty for exponential sizes
+     * \returns the mean flow size used, in bytes
+     */
+    double SetOfferedLoad(double load,
+                          DataRate rate,
+                          uint32_t nSenders,
+                          double meanSize,
+                          std::string sizeCdf = "");
+
+    /**
+     * Install a sender on a node.
+     *
+     * \param node the node
+     * \param remote the address of the sink
+     * \param local the address to bind the sockets to, if any
+     * \param device the device to bind the sockets to, if any
+     * \returns the installed application
+     */
+    ApplicationContainer Install(Ptr<Node> node,
+                                 const Address& remote,
+                                 const Address& local = Address(),
+                                 Ptr<NetDevice> device = nullptr) const;
+
+    /**
+     * Install a sink on each node; a node appearing several times gets a
+     * single sink.
+     *
+     * \param nodes the nodes
+     * \param port the port to listen on
+     * \returns the installed applications
+     */
+    ApplicationContainer InstallSink(NodeContainer nodes, uint16_t port) const;
+
+    /**
+     * Install a sender on every left leaf of a dumbbell, sending to the
+     * right leaf of the same index (modulo the number of right leaves),
+     * and a sink on every right leaf.  Each sender binds to the address
+     * and the device of its leaf, so aggregated leaves work too.  The IPv4 addresses of
+     * the dumbbell must have been assigned.
+     *
+     * \param dumbbell the dumbbell
+     * \param port the port of the sinks
+     * \returns the installed senders; the sinks are not returned
+     */
+    ApplicationContainer Install(const PointToPointDumbbellHelper& dumbbell, uint16_t port);
+
+    /**
+     * \returns the sinks installed by the last dumbbell Install call
+     */
+    ApplicationContainer GetSinks() const;
+
+    /**
+     * \returns the statistics shared by the senders
+     */
+    Ptr<FctStatistics> GetStatistics() const;
+
+  private:
+    ObjectFactory m_factory;         //!< Sender factory
+    ObjectFactory m_sinkFactory;     //!< Sink factory
+    Ptr<FctStatistics> m_statistics; //!< Shared statistics
+    ApplicationContainer m_sinks;    //!< Sinks of the last dumbbell install
+};
+
+} // namespace ns3
+
+#endif /* WORKLOAD_HELPER_H */